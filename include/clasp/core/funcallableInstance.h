@@ -59,11 +59,15 @@ namespace core {
     Base(funcallable_entry_point)
       , _Class(_Nil<Instance_O>())
       , _FunctionDescription(fdesc)
+      , _InterpretedCalls(0)
+      , _InlineCacheEpoch(0)
       , _CompiledDispatchFunction(_Nil<T_O>()) {};
     explicit FuncallableInstance_O(FunctionDescription* fdesc,Instance_sp metaClass, size_t slots) :
     Base(funcallable_entry_point),
       _Class(metaClass)
       , _FunctionDescription(fdesc)
+      , _InterpretedCalls(0)
+      , _InlineCacheEpoch(0)
       , _CompiledDispatchFunction(_Nil<T_O>())
     {};
     FuncallableInstance_O(FunctionDescription* fdesc, Instance_sp cl, Rack_sp rack)
@@ -71,6 +75,8 @@ namespace core {
         _Class(cl),
         _Rack(rack),
         _FunctionDescription(fdesc),
+        _InterpretedCalls(0),
+        _InlineCacheEpoch(0),
         _CompiledDispatchFunction(_Nil<T_O>())
     {};
     virtual ~FuncallableInstance_O(){};
@@ -82,6 +88,8 @@ namespace core {
     Instance_sp _Class;
     FunctionDescription* _FunctionDescription;
     std::atomic<size_t>        _InterpretedCalls;
+    // Inline cache entries for this generic function are valid only for this epoch
+    std::atomic<size_t>        _InlineCacheEpoch;
     std::atomic<T_sp>   _CompiledDispatchFunction;
   public:
 
@@ -134,9 +142,12 @@ namespace core {
     string __repr__() const;
 
     T_sp setFuncallableInstanceFunction(T_sp functionOrT);
+    bool compareAndSetFuncallableInstanceFunction(T_sp oldFunction, T_sp newFunction);
 
     size_t increment_calls () { return this->_InterpretedCalls++; }
     size_t interpreted_calls () { return this->_InterpretedCalls; }
+    size_t inline_cache_epoch () const { return this->_InlineCacheEpoch.load(std::memory_order_relaxed); }
+    void invalidate_inline_caches () { this->_InlineCacheEpoch++; }
 
     void describe(T_sp stream);
 
@@ -65,7 +65,9 @@ namespace core{
 #endif
     _RehashSize(_Nil<Number_O>()),
     _RehashThreshold(maybeFixRehashThreshold(0.7)),
-    _HashTableCount(0)
+    _MigrateIndex(0),
+    _HashTableCount(0),
+    _LockFreeReads(false)
     {};
   //	DEFAULT_CTOR_DTOR(HashTable_O);
     friend class HashTableEq_O;
@@ -83,7 +85,21 @@ namespace core{
     Number_sp _RehashSize;
     double _RehashThreshold;
     gctools::Vec0<Cons_O> _Table;
+    /*! One byte per _Table slot - empty, deleted or a 7 bit fingerprint of the hash of the key,
+        probed eight slots at a time so that most slots are rejected without calling keyTest */
+    SimpleVector_byte8_t_sp _Metadata;
+    /*! The full hash of the key in each _Table slot - reused when the table is rehashed */
+    SimpleVector_byte64_t_sp _Hashes;
+    /*! While a large table is being resized incrementally the entries that have not
+        been moved yet are in _OldTable - slots below _MigrateIndex are already done */
+    gctools::Vec0<Cons_O> _OldTable;
+    SimpleVector_byte8_t_sp _OldMetadata;
+    SimpleVector_byte64_t_sp _OldHashes;
+    size_t _MigrateIndex;
     size_t _HashTableCount;
+    /*! gethash does not take the read lock - writers publish a rebuilt _Table atomically
+        and store entry values before keys, see make-hash-table :thread-safe :lock-free */
+    bool _LockFreeReads;
 #ifdef CLASP_THREADS
     mutable mp::SharedMutex_sp _Mutex;
 #endif
@@ -103,12 +119,25 @@ namespace core{
     static void sxhash_eql(HashGenerator &running_hash, T_sp obj );
     static void sxhash_equal(HashGenerator &running_hash, T_sp obj );
     static void sxhash_equalp(HashGenerator &running_hash, T_sp obj );
-    void setupThreadSafeHashTable();
+    void setupThreadSafeHashTable(bool lockFreeReads = false);
 
   private:
     void setup(uint sz, Number_sp rehashSize, double rehashThreshold);
     uint resizeEmptyTable_no_lock(size_t sz);
     uint calculateHashTableCount() const;
+    void installTable_no_lock(gctools::Vec0<Cons_O>& newTable);
+    void resetMetadata_no_lock(size_t sz);
+    bool metadatap() const { return this->_Metadata && this->_Metadata->length() == this->_Table.size(); };
+    void setSlotMetadata_no_lock(size_t slot, uint64_t hash);
+    Cons_O* probeMetadata_no_lock(gctools::Vec0<Cons_O>& table, SimpleVector_byte8_t_sp metadata, SimpleVector_byte64_t_sp hashes, T_sp key, cl_index index, uint64_t hash);
+    gc::Fixnum expandedSize_no_lock() const;
+    bool resizeInProgressp() const { return this->_OldTable.size() != 0; };
+    void startIncrementalRehash_no_lock();
+    void migrateEntries_no_lock(size_t num);
+    void finishIncrementalRehash_no_lock();
+    void releaseOldTable_no_lock();
+    gctools::tagged_pointer<gctools::GCVector_moveable<Cons_O>> iterationContents_() const;
+    T_mv gethash_lock_free(T_sp key, T_sp defaultValue);
 
   public:
     List_sp hash_table_bucket(size_t index);
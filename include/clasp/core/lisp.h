@@ -186,12 +186,16 @@ class Lisp_O {
     //! Threads
 #ifdef CLASP_THREADS
     List_sp _ActiveThreads;
-    mutable mp::SharedMutex _ActiveThreadsMutex;
+    mutable mp::UpgradableSharedMutex _ActiveThreadsMutex;
     List_sp _DefaultSpecialBindings;
-    mutable mp::SharedMutex _DefaultSpecialBindingsMutex;
+    mutable mp::UpgradableSharedMutex _DefaultSpecialBindingsMutex;
 #endif
     // FIXME: Remove this mutex - I've switched to thread-safe hash tables
     //        and its not needed
+    // The tables that are read far more than written use UpgradableSharedMutex.
+    // The ones left on SharedMutex are unused, written only, or have readers that
+    // re-enter the lock or call into Lisp while holding it, which SharedMutex
+    // tolerates and a lock whose readers exclude writers would deadlock on.
 #ifdef CLASP_THREADS
     mutable mp::SharedMutex _SyspropMutex;
     mutable mp::SharedMutex _FinalizersMutex;
@@ -217,7 +221,7 @@ class Lisp_O {
     map<string, int> _SourceFileIndices; // map<string,FileScope_sp> 	_SourceFiles;
 #ifdef CLASP_THREADS
     //! Protect _SourceFiles
-    mutable mp::SharedMutex _SourceFilesMutex;
+    mutable mp::UpgradableSharedMutex _SourceFilesMutex;
 #endif
 
     /*! Store CATCH info */
@@ -234,7 +238,7 @@ class Lisp_O {
     gctools::Vec0<Package_sp> _Packages;
     map<string, int> _PackageNameIndexMap;
 #ifdef CLASP_THREADS
-    mutable mp::SharedMutex _PackagesMutex;
+    mutable mp::UpgradableSharedMutex _PackagesMutex;
 #endif
     bool _MpiEnabled;
     int _MpiRank;
@@ -256,7 +260,7 @@ class Lisp_O {
     /*! Store a table of generic functions - should this be a HashTable?  What about (setf XXX) generic functions? Aug2013 */
     HashTableEqual_sp _SingleDispatchGenericFunctionHashTableEqual;
 #ifdef CLASP_THREADS
-    mutable mp::SharedMutex _SingleDispatchGenericFunctionHashTableEqualMutex;
+    mutable mp::UpgradableSharedMutex _SingleDispatchGenericFunctionHashTableEqualMutex;
 #endif
 
 #ifdef DEBUG_MONITOR_SUPPORT
@@ -272,6 +276,7 @@ class Lisp_O {
     T_sp _NullStream;
     List_sp _ThePathnameTranslations; /* alist */
 #ifdef CLASP_THREADS
+    // Readers call ASSOC and parse pathnames, which can come back here
     mutable mp::SharedMutex _ThePathnameTranslationsMutex;
 #endif
     Complex_sp _ImaginaryUnit;
@@ -290,7 +295,7 @@ class Lisp_O {
     LongFloat_sp _LongFloatOne;
 #endif // ifdef CLASP_LONG_FLOAT
     bool _Booted;
-    mutable mp::SharedMutex _UnixSignalHandlersMutex;
+    mutable mp::UpgradableSharedMutex _UnixSignalHandlersMutex;
     List_sp _UnixSignalHandlers;
     GCRoots();
   };
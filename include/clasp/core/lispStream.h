@@ -130,6 +130,16 @@ cl_index clasp_write_byte8(T_sp stream, unsigned char *c, cl_index n);
 
 void clasp_force_output(T_sp strm);
 
+/*! Consume the characters of a buffered file stream that are single bytes in its
+    external format and already in its buffer, up to MAX of them and stopping at a
+    line break.  Return how many, with *RUN pointing at their bytes; zero means
+    that the next character must be read with clasp_read_char. */
+cl_index clasp_input_unibyte_run(T_sp strm, const unsigned char **run, cl_index max);
+/*! Like clasp_input_unibyte_run but leave the bytes in the buffer, so that the caller
+    can stop at a delimiter; consume the first N of them with clasp_input_unibyte_advance. */
+cl_index clasp_input_unibyte_peek(T_sp strm, const unsigned char **run, cl_index max);
+void clasp_input_unibyte_advance(T_sp strm, const unsigned char *run, cl_index n);
+
 T_sp clasp_read_byte(T_sp strm);
 void clasp_write_byte(T_sp c, T_sp strm);
 
@@ -366,11 +376,25 @@ class IOFileStream_O : public FileStream_O {
   LISP_CLASS(core, CorePkg, IOFileStream_O, "iofile-stream",FileStream_O);
   //    DECLARE_ARCHIVE();
 public: // Simple default ctor/dtor
-  IOFileStream_O(){};
+  IOFileStream_O() : _FileDescriptor(-1), _BufferMode(_IONBF), _BufferSize(0),
+                     _InputBuffer(NULL), _InputPos(0), _InputEnd(0),
+                     _OutputBuffer(NULL), _OutputFill(0) {};
   ~IOFileStream_O();
 
 private: // instance variables here
   int _FileDescriptor;
+public:
+  /*! User space buffering of the file descriptor - one of _IONBF, _IOLBF or _IOFBF
+      as set by set-buffering-mode.  The buffers are malloc'd and released on close. */
+  int _BufferMode;
+  cl_index _BufferSize;
+  /*! Bytes read from the descriptor but not yet consumed are _InputBuffer[_InputPos,_InputEnd) */
+  unsigned char *_InputBuffer;
+  cl_index _InputPos;
+  cl_index _InputEnd;
+  /*! Bytes written to the stream but not yet written to the descriptor */
+  unsigned char *_OutputBuffer;
+  cl_index _OutputFill;
 
 public: // Functions here
   static T_sp makeInput(const string &name, int fd) {
@@ -109,7 +109,9 @@ void debug_mutex_unlock(Mutex* m);
 #define SUSPBARR_NAMEWORD 0x0052424250535553
 #define DISSASSM_NAMEWORD 0x0053534153534944
 #define JITGDBIF_NAMEWORD 0x004942444754494a
+#define FASOLINK_NAMEWORD 0x004b4e4c4f534146
 #define MPSMESSG_NAMEWORD 0x005353454d53504d     // MPSMESSG
+#define MPISENDS_NAMEWORD 0x0053444e4553494d     // MISENDS
 
 struct Mutex {
   uint64_t _NameWord;
@@ -184,90 +186,6 @@ struct Mutex {
     }
   };
 
-  inline void muSleep(uint usec) { core::clasp_musleep(usec/1000000.0,false); };
-
-/* I derived this code from https://oroboro.com/upgradable-read-write-locks/ */
-  class UpgradableSharedMutex {
-  public:
-    Mutex mReadMutex;
-    Mutex mWriteMutex;
-    bool    mReadsBlocked;
-    uint     mMaxReaders;
-    uint     mReaders;
-  public:
-    UpgradableSharedMutex(uint64_t nameword, uint maxReaders = 64, uint64_t writenameword=0 ) :
-      mReadMutex(nameword),
-      mWriteMutex(writenameword ? writenameword : nameword),
-      mReadsBlocked( false ), mMaxReaders( maxReaders ), mReaders( 0 ) {};
-    void readLock() {
-      while ( 1 ) {
-        mReadMutex.lock();
-        if (( !mReadsBlocked ) && ( mReaders < mMaxReaders )) {
-          mReaders++; 
-          mReadMutex.unlock();
-          return;
-        }
-        mReadMutex.unlock();
-        muSleep( 0 );
-      }
-      assert( 0 );
-    };
-    void readUnlock() { 
-      mReadMutex.lock(); 
-      assert( mReaders );
-      mReaders--; 
-      mReadMutex.unlock(); 
-    };
-
-    /* Pass true for upgrade if you want to upgrade a read lock to a write lock.
-      Be careful though!!!! If two threads try to upgrade at the same time 
-      there will be a deadlock unless they do it in a loop using withTryLock(true).
-      See the hashTable.cc rehash_upgrade_write_lock for an example. */
-    bool writeTryLock(bool upgrade = false) {
-      if ( !mWriteMutex.lock(false))
-        return false;
-      waitReaders( upgrade ? 1 : 0 );
-      return true;
-    }
-    void writeLock(bool upgrade = false) {
-      mWriteMutex.lock(); 
-      waitReaders( upgrade ? 1 : 0 );
-    }
-    /*! Pass true releaseReadLock if when you release the write lock it also
-       releases the read lock */
-    void writeUnlock(bool releaseReadLock = false) {
-      mReadMutex.lock();
-      if ( releaseReadLock ) {
-        assert( mReaders <= 1 );
-        if ( mReaders == 1 )
-          mReaders--; 
-      }
-      mReadsBlocked = false;
-      mReadMutex.unlock();
-      mWriteMutex.unlock(); 
-    }
-  public:
-    void waitReaders(uint numReaders) {
-   // block new readers 
-      mReadMutex.lock();
-      mReadsBlocked = true;
-      mReadMutex.unlock();  
-   // wait for current readers to finish
-      while ( 1 ) {
-        mReadMutex.lock();
-        if ( mReaders == numReaders )
-        {
-          mReadMutex.unlock();  
-          break;
-        }
-        mReadMutex.unlock();  
-        muSleep( 0 );
-      }
-      assert( mReaders == numReaders );
-    }
-  };
-
-
   struct ConditionVariable {
     pthread_cond_t _ConditionVariable;
     ConditionVariable() {
@@ -306,6 +224,128 @@ struct Mutex {
       
   };
 
+#define RWLOCK_READER_SLOTS 16
+
+  /*! Index of the reader indicator this thread uses in every UpgradableSharedMutex */
+  inline size_t rwlock_reader_slot() {
+    static std::atomic<size_t> next_slot(0);
+    static thread_local size_t slot = next_slot.fetch_add(1,std::memory_order_relaxed)%RWLOCK_READER_SLOTS;
+    return slot;
+  }
+
+  /*! A reader-writer lock with writer preference.
+      Readers announce themselves in one of RWLOCK_READER_SLOTS counters, each on its own
+      cache line, so concurrent readers on different threads don't write the same line.
+      That costs RWLOCK_READER_SLOTS*64 bytes - over 1KB - for every mutex, so use it
+      where reads dominate and the lock is shared, not for every small object.
+      A writer takes mWriteMutex, raises mWriterActive so that new readers back off, and
+      parks until the reader counters drain. Readers that run into a writer park until it
+      is done. mReadMutex only guards parking - the fast paths never touch it.
+      Upgrading drops the read lock before waiting for the write lock, so two upgraders
+      can't deadlock; the caller must revalidate what it read. Releasing the write lock
+      of an upgrade without releaseReadLock downgrades back to a read lock atomically. */
+  class UpgradableSharedMutex {
+  public:
+    /* The GC doesn't promise 64-byte alignment for the objects that hold these, but
+       the slots are 64 bytes apart either way so no two counters share a line. */
+    struct alignas(64) ReaderSlot {
+      std::atomic<size_t> _Count;
+      char _pad[64-sizeof(std::atomic<size_t>)];
+      ReaderSlot() : _Count(0) {};
+    };
+    Mutex mReadMutex;
+    Mutex mWriteMutex;
+    ConditionVariable mReadersDrained;
+    ConditionVariable mWriterDone;
+    std::atomic<bool> mWriterActive;
+    bool mUpgraded;
+    alignas(64) ReaderSlot mReaders[RWLOCK_READER_SLOTS];
+  public:
+    UpgradableSharedMutex(uint64_t nameword, uint64_t writenameword=0 ) :
+      mReadMutex(nameword),
+      mWriteMutex(writenameword ? writenameword : nameword),
+      mWriterActive(false), mUpgraded(false) {};
+    void readLock() {
+      std::atomic<size_t>& count = this->mReaders[rwlock_reader_slot()]._Count;
+      while (1) {
+        count.fetch_add(1,std::memory_order_seq_cst);
+        if (!this->mWriterActive.load(std::memory_order_seq_cst)) return;
+        // A writer got in first - back out and wait for it
+        this->releaseReader(count);
+        this->mReadMutex.lock();
+        while (this->mWriterActive.load(std::memory_order_seq_cst)) {
+          this->mWriterDone.wait(this->mReadMutex);
+        }
+        this->mReadMutex.unlock();
+      }
+    };
+    void readUnlock() {
+      this->releaseReader(this->mReaders[rwlock_reader_slot()]._Count);
+    };
+
+    /* Pass true for upgrade if this thread holds the read lock. writeTryLock keeps the
+       read lock if it fails; writeLock always gives it up while it waits. */
+    bool writeTryLock(bool upgrade = false) {
+      if ( !mWriteMutex.lock(false))
+        return false;
+      this->acquireWriter(upgrade);
+      return true;
+    }
+    void writeLock(bool upgrade = false) {
+      if (upgrade) this->readUnlock();
+      mWriteMutex.lock();
+      this->acquireWriter(false);
+      this->mUpgraded = upgrade;
+    }
+    /*! Pass true releaseReadLock if when you release the write lock it also
+       releases the read lock that was upgraded */
+    void writeUnlock(bool releaseReadLock = false) {
+      if (this->mUpgraded && !releaseReadLock) {
+        // Downgrade - the writer flag keeps other readers out until we're counted
+        this->mReaders[rwlock_reader_slot()]._Count.fetch_add(1,std::memory_order_seq_cst);
+      }
+      this->mUpgraded = false;
+      this->mReadMutex.lock();
+      this->mWriterActive.store(false,std::memory_order_seq_cst);
+      this->mWriterDone.broadcast();
+      this->mReadMutex.unlock();
+      mWriteMutex.unlock();
+    }
+    /* The SharedMutex interface, so WITH_READ_LOCK and WITH_READ_WRITE_LOCK take either.
+       Unlike SharedMutex a reader here really excludes writers - so don't take the lock
+       again, signal an error or call out to Lisp while holding it. */
+    void shared_lock() { this->readLock(); };
+    void shared_unlock() { this->readUnlock(); };
+    void lock() { this->writeLock(); };
+    void unlock() { this->writeUnlock(); };
+  public:
+    size_t readerCount() const {
+      size_t total = 0;
+      for ( size_t i=0; i<RWLOCK_READER_SLOTS; ++i ) total += this->mReaders[i]._Count.load(std::memory_order_seq_cst);
+      return total;
+    }
+    void releaseReader(std::atomic<size_t>& count) {
+      count.fetch_sub(1,std::memory_order_seq_cst);
+      if (this->mWriterActive.load(std::memory_order_seq_cst)) {
+        this->mReadMutex.lock();
+        this->mReadersDrained.signal();
+        this->mReadMutex.unlock();
+      }
+    }
+    void acquireWriter(bool upgrade) {
+      // We hold mWriteMutex so no other writer or upgrader can be here
+      this->mWriterActive.store(true,std::memory_order_seq_cst);
+      if (upgrade) this->mReaders[rwlock_reader_slot()]._Count.fetch_sub(1,std::memory_order_seq_cst);
+      this->mUpgraded = upgrade;
+      if (this->readerCount()==0) return;
+      this->mReadMutex.lock();
+      while (this->readerCount()!=0) {
+        this->mReadersDrained.wait(this->mReadMutex);
+      }
+      this->mReadMutex.unlock();
+    }
+  };
+
 #ifdef CLASP_THREADS
   template <typename T>
     struct RAIIReadLock {
@@ -219,7 +219,7 @@ namespace mp {
     core::T_sp  _Name;
     core::T_sp  _Owner;
     UpgradableSharedMutex _SharedMutex;
-    SharedMutex_O(core::T_sp readName, core::T_sp writeName=_Nil<core::T_O>()) : _Name(readName), _Owner(_Nil<T_O>()),_SharedMutex(lisp_nameword(readName), 256, writeName.nilp() ? lisp_nameword(readName) : lisp_nameword(writeName)) {};
+    SharedMutex_O(core::T_sp readName, core::T_sp writeName=_Nil<core::T_O>()) : _Name(readName), _Owner(_Nil<T_O>()),_SharedMutex(lisp_nameword(readName), writeName.nilp() ? lisp_nameword(readName) : lisp_nameword(writeName)) {};
     void write_lock(bool upgrade=false) {
       this->_SharedMutex.writeLock(upgrade);
     };
@@ -304,6 +304,63 @@ namespace mp {
     }
     string __repr__() const;
   };
+};
+
+template <>
+struct gctools::GCInfo<mp::ConcurrentQueue_O> {
+  static bool constexpr NeedsInitialization = false;
+  static bool constexpr NeedsFinalization = true;
+  static GCInfo_policy constexpr Policy = normal;
+};
+
+namespace mp {
+
+  /*! A multi-producer/multi-consumer queue.
+      With no capacity it is a Michael-Scott linked queue of conses whose
+      _Head is a dummy cons; with a capacity it is a bounded ring where each
+      slot carries a sequence number (Vyukov) so producers and consumers only
+      contend on their own position counter.
+      Threads only touch _WaitMutex when they have to sleep. */
+  FORWARD(ConcurrentQueue);
+  class ConcurrentQueue_O : public core::CxxObject_O {
+    LISP_CLASS(mp, MpPkg, ConcurrentQueue_O, "ConcurrentQueue",core::CxxObject_O);
+  public:
+    static ConcurrentQueue_sp make_ConcurrentQueue(core::T_sp name, size_t capacity);
+  public:
+    core::T_sp _Name;
+    // Unbounded
+    std::atomic<core::T_sp> _Head;
+    char _pad0[64];
+    std::atomic<core::T_sp> _Tail;
+    char _pad1[64];
+    // Bounded
+    size_t _Capacity;
+    size_t _Mask;
+    core::T_sp _Slots;
+    std::atomic<size_t>* _Sequence;
+    char _pad2[64];
+    std::atomic<size_t> _EnqueuePos;
+    char _pad3[64];
+    std::atomic<size_t> _DequeuePos;
+    char _pad4[64];
+    std::atomic<gctools::Fixnum> _Count;
+    std::atomic<int> _SleepingConsumers;
+    std::atomic<int> _SleepingProducers;
+    Mutex _WaitMutex;
+    ConditionVariable _NotEmpty;
+    ConditionVariable _NotFull;
+    ConcurrentQueue_O(core::T_sp name, size_t capacity);
+    ~ConcurrentQueue_O();
+    bool try_push(core::T_sp obj);
+    bool try_pop(core::T_sp& obj);
+    /*! A negative timeout waits forever, zero never waits */
+    bool push(core::T_sp obj, double timeout);
+    bool pop(core::T_sp& obj, double timeout);
+    void notify_consumers();
+    /*! SLOTS is the number of objects just taken - more than one wakes every producer */
+    void notify_producers(size_t slots=1);
+    string __repr__() const;
+  };
   void mp__interrupt_process(Process_sp process, core::T_sp func);
 };
 
@@ -42,6 +42,13 @@ namespace core {
 #define WITH_PACKAGE_READ_LOCK(pkg) WITH_READ_LOCK(pkg->_Lock)
 #define WITH_PACKAGE_READ_WRITE_LOCK(pkg) WITH_READ_WRITE_LOCK(pkg->_Lock)
 
+/*! Incremented (under the package's write lock) whenever a package gains or
+    loses a symbol, changes its use list, or a symbol changes its home package.
+    Lookups memoized under one epoch are valid as long as it has not changed. */
+extern std::atomic<uint32_t> global_package_epoch;
+inline uint32_t package_epoch() { return global_package_epoch.load(std::memory_order_acquire); }
+inline void bump_package_epoch() { global_package_epoch.fetch_add(1, std::memory_order_acq_rel); }
+
 
 SMART(Package);
 class Package_O : public General_O {
@@ -64,18 +71,25 @@ class Package_O : public General_O {
   List_sp _LocalNicknames;
   T_sp _Documentation;
 #ifdef CLASP_THREADS
+  /*! Stays a SharedMutex: core:call-with-package-read-lock runs Lisp code that
+      interns into the package it holds, and use-package looks symbols up under
+      its own read lock.  An UpgradableSharedMutex would deadlock on both and
+      costs over 1KB per package. */
   mutable mp::SharedMutex _Lock;
 #endif
   bool systemLockedP = false;
   bool userLockedP = false;
   bool zombieP = false;
+  /*! Unique per package, identifies it in caches that can't hold pointers */
+  uint32_t _Serial = 0;
  public: // Creation class functions
   static Package_sp create(const string &p);
 
  public:
   /*! Very low level - add to internal symbols unless keyword
-	  package, in that case add to external symbols */
-  void add_symbol_to_package_no_lock(SimpleString_sp nameKey, Symbol_sp sym, bool exportp = false);
+	  package, in that case add to external symbols.  Pass false for
+	  bump_epoch only when no symbol of that name was accessible here */
+  void add_symbol_to_package_no_lock(SimpleString_sp nameKey, Symbol_sp sym, bool exportp = false, bool bump_epoch = true);
   void add_symbol_to_package(SimpleString_sp nameKey, Symbol_sp sym, bool exportp = false);
   void bootstrap_add_symbol_to_package(const char *symName, Symbol_sp sym, bool exportp = false, bool shadowp = false);
 
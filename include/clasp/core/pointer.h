@@ -48,6 +48,7 @@ namespace core {
 
   public: // Functions here
     void *ptr() const { return this->m_raw_data; };
+    void set_ptr(void *p) { this->m_raw_data = p; };
     virtual bool eql_(T_sp obj) const;
     bool in_pointer_range(Pointer_sp other, intptr_t size) { return ((char*)this->m_raw_data>=(char*)other->m_raw_data) && (char*)this->m_raw_data<((char*)other->m_raw_data+size); };
     bool in_pointer_range(Pointer_sp low, Pointer_sp high) { return ((char*)this->m_raw_data>=(char*)low->m_raw_data) && (char*)this->m_raw_data<((char*)high->m_raw_data);  };
@@ -39,6 +39,17 @@ enum clasp_readtable_case {
   clasp_case_preserve
 };
 
+/*! Syntax types as small integers, for the reader's dense per-readtable cache */
+typedef enum { syntax_constituent = 0,
+               syntax_whitespace,
+               syntax_terminating_macro,
+               syntax_non_terminating_macro,
+               syntax_single_escape,
+               syntax_multiple_escape,
+               syntax_invalid } ReaderSyntax;
+
+#define READTABLE_SYNTAX_CACHE_SIZE 256
+
 FORWARD(Readtable);
 class Readtable_O : public General_O {
   LISP_CLASS(core, ClPkg, Readtable_O, "readtable",General_O);
@@ -54,6 +65,13 @@ GCPRIVATE: // instance variables here
   HashTable_sp SyntaxTypes_;
   HashTable_sp MacroCharacters_;
   HashTable_sp DispatchMacroCharacters_;
+  /*! Syntax types of the Latin-1 characters, rebuilt from SyntaxTypes_ after it changes */
+  unsigned char SyntaxCache_[READTABLE_SYNTAX_CACHE_SIZE];
+  /*! Stored with release after SyntaxCache_ is filled and loaded with acquire, so a
+      thread that sees it set also sees the whole cache */
+  std::atomic<bool> SyntaxCacheValid_{false};
+  /*! Fresh for every refill of SyntaxCache_, so it names this readtable's current syntax */
+  std::atomic<uint32_t> SyntaxStamp_{0};
 
 public: // static functions here
   static Readtable_sp create_standard_readtable();
@@ -76,6 +94,21 @@ public: // instance member functions here
 
   /*! syntax-type returns the syntax type of a character */
   Symbol_sp syntax_type_(Character_sp ch) const;
+  /*! The syntax type of a character as a ReaderSyntax, from the dense cache when possible */
+  ReaderSyntax syntax_class_(claspCharacter c) {
+    if (c < READTABLE_SYNTAX_CACHE_SIZE) {
+      if (!this->SyntaxCacheValid_.load(std::memory_order_acquire)) this->fill_syntax_cache_();
+      return (ReaderSyntax)this->SyntaxCache_[c];
+    }
+    return this->syntax_class_uncached_(c);
+  }
+  ReaderSyntax syntax_class_uncached_(claspCharacter c) const;
+  void fill_syntax_cache_();
+  /*! Changes whenever the syntax of any character may have changed */
+  uint32_t syntax_stamp_() {
+    if (!this->SyntaxCacheValid_.load(std::memory_order_acquire)) this->fill_syntax_cache_();
+    return this->SyntaxStamp_.load(std::memory_order_relaxed);
+  }
 
   /*! Define a macro character */
   T_sp set_macro_character_(Character_sp ch, T_sp funcDesig, T_sp non_terminating);
@@ -95,6 +128,8 @@ public: // instance member functions here
   Character_sp convert_case_(Character_sp c);
 };
 T_sp cl__copy_readtable(T_sp fromReadTable, T_sp toReadTable);
+/*! The syntax type of chr in any kind of readtable */
+ReaderSyntax reader_syntax(T_sp readtable, Character_sp chr);
 T_sp cl__readtable_case(T_sp);
 T_sp core__readtable_case_set(T_sp mode, T_sp readTable);
 T_sp core__syntax_type(T_sp, Character_sp);
@@ -0,0 +1,48 @@
+/*
+    File: sampleProfiler.h
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+See directory 'clasp/licenses' for full details.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+#ifndef _core__sampleProfiler_H //[
+#define _core__sampleProfiler_H
+
+#include <map>
+#include <string>
+
+namespace core {
+
+/*! Name the function containing address, memoizing the result in cache */
+std::string sample_profiler_symbolize(uintptr_t address, std::map<uintptr_t,std::string>& cache);
+/*! Map the raw pointers of the live processes to their names */
+std::map<void*,std::string> sample_profiler_process_names();
+std::string sample_profiler_process_name(void* process, std::map<void*,std::string>& names);
+
+void core__sample_profiler_start(Fixnum frequency, Fixnum buffer_size, Fixnum max_depth, T_sp threads);
+T_mv core__sample_profiler_stop();
+List_sp core__sample_profiler_folded_stacks();
+void core__sample_profiler_write(T_sp pathname, T_sp format);
+
+};
+
+#endif //]
@@ -0,0 +1,45 @@
+/*
+    File: string_to_float.h
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+ 
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+ 
+See directory 'clasp/licenses' for full details.
+ 
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+#ifndef _core__string_to_float_H //[
+#define _core__string_to_float_H
+
+namespace core {
+
+/*! Parse [sign] digits [. digits] [marker [sign] digits] from [begin,end)
+    into the correctly rounded double.  Any of the Common Lisp exponent
+    markers (e s f d l, either case) is accepted.  Return false if the
+    characters are not a decimal float. */
+bool clasp_parse_double(const char *begin, const char *end, double &result);
+
+//! Like clasp_parse_double but rounds directly to a single float
+bool clasp_parse_single_float(const char *begin, const char *end, float &result);
+
+T_mv core__parse_float(String_sp str, Fixnum start, T_sp end, T_sp type);
+
+};
+
+#endif
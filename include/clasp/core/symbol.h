@@ -74,6 +74,9 @@ class Symbol_O : public General_O {
   mutable std::atomic<uint32_t> _BindingIdx;
   std::atomic<uint32_t>  _Flags;
   std::atomic<T_sp>   _PropertyList;
+  // Printer metadata memoized by write_symbol.cc - see the layouts there
+  mutable std::atomic<uint64_t> _PrintPackageCache;
+  mutable std::atomic<uint64_t> _PrintEscapeCache;
 
   friend class Instance_O;
   friend class Package_O;
@@ -281,6 +284,9 @@ public:
   T_sp getPackage() const;
   T_sp homePackage() const { return this->getPackage(); }
   void setPackage(T_sp p);
+  /*! setPackage for a symbol that was just created and hasn't been seen by anyone,
+      so no cache can hold it and the package epoch is left alone */
+  void setPackageOfFreshSymbol(T_sp p);
 
   /*! Return the name of the symbol with the package prefix
 	 * unless this symbol is in the current package
@@ -63,9 +63,11 @@ public:
 
 public:
   typename Vec::pointer_to_moveable contents() const { return this->_Vector.contents(); };
+  typename Vec::pointer_to_moveable contents_acquire() const { return this->_Vector.contents_acquire(); };
 
 public:
   void swap(Vec0_impl &other) { this->_Vector.swap(other._Vector); };
+  void swap_release(Vec0_impl &other) { this->_Vector.swap_release(other._Vector); };
   iterator begin() { return this->_Vector.begin(); };
   iterator end() { return this->_Vector.end(); };
   const_iterator begin() const { return this->_Vector.begin(); };
@@ -15,6 +15,14 @@ void initialize_gc_functions();
 Fixnum core__header_kind(core::T_sp obj);
 Fixnum core__header_stamp(core::T_sp obj);
 
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_GC_MPS 1
+#define SNAPSHOT_GC_BOEHM 2
+/*! The marker that starts each object in a heap snapshot */
+#define SNAPSHOT_OBJECT_MARK 0xeeeeffc0
+void gctools__save_lisp_and_die(const std::string& filename);
+void save_snapshot_header(std::ostream& out, uint32_t gc_kind, size_t header_size);
+
 
 };
 
@@ -92,6 +92,29 @@ namespace gctools {
 
 namespace gctools {
 #ifdef USE_BOEHM
+  // Defined in threadlocal.h once ThreadLocalState is complete
+  inline bool interrupts_pending_p();
+
+  /*! Return a cleared block of at least size bytes from this thread's free list
+      for its size class.  When the list runs dry it is refilled with a batch from
+      GC_malloc_many - only then is the collector entered. */
+  inline void* boehm_thread_local_malloc(size_t size)
+  {
+    size_t granules = (size+BOEHM_THREAD_LOCAL_GRANULE_BYTES-1)/BOEHM_THREAD_LOCAL_GRANULE_BYTES;
+    if (granules >= BOEHM_THREAD_LOCAL_SIZE_CLASSES) {
+      return GC_MALLOC(size);
+    }
+    void** head = &my_thread_low_level->_BoehmFreeLists[granules];
+    void* obj = *head;
+    if (UNLIKELY(obj==NULL)) {
+      obj = GC_malloc_many(granules*BOEHM_THREAD_LOCAL_GRANULE_BYTES);
+      if (obj==NULL) return GC_MALLOC(size);
+    }
+    *head = GC_NEXT(obj);
+    GC_NEXT(obj) = NULL;
+    return obj;
+  }
+
   inline Header_s* do_boehm_atomic_allocation(const Header_s::StampWtagMtag& the_header, size_t size) 
   {
     RAII_DISABLE_INTERRUPTS();
@@ -118,7 +141,7 @@ namespace gctools {
     size_t tail_size = ((rand()%8)+1)*Alignment();
     true_size += tail_size;
 #endif
-    Header_s* header = reinterpret_cast<Header_s*>(GC_MALLOC(true_size));
+    Header_s* header = reinterpret_cast<Header_s*>(boehm_thread_local_malloc(true_size));
     my_thread_low_level->_Allocations.registerAllocation(the_header.unshifted_stamp(),true_size);
 #ifdef DEBUG_GUARD
     memset(header,0x00,true_size);
@@ -357,11 +380,14 @@ extern void bad_general_mps_reserve_error(mps_ap_t* allocation_point);
 #ifdef USE_BOEHM
       Cons* cons;
       { RAII_DISABLE_INTERRUPTS();
-        cons = reinterpret_cast<Cons*>(GC_MALLOC(sizeof(Cons)));
+        cons = reinterpret_cast<Cons*>(boehm_thread_local_malloc(sizeof(Cons)));
         my_thread_low_level->_Allocations.registerAllocation(STAMP_CONS,sizeof(Cons));
         new (cons) Cons(std::forward<ARGS>(args)...);
       }
-      handle_all_queued_interrupts();
+      // Interrupts can be queued by another thread or a signal handler at any
+      // time, not just while we were in the collector, so look for them on every
+      // allocation - only the slow path that handles them is out of line.
+      if (interrupts_pending_p()) handle_all_queued_interrupts();
       return smart_ptr<Cons>((Tagged)tag_cons(cons));
 #endif
 #ifdef USE_MPS
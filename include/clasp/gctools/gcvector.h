@@ -219,8 +219,23 @@ public:
     this->_Contents = op;
   }
 
+  /*! Like swap but the new contents are published with a store-release
+      so that lock free readers using contents_acquire see them fully built */
+  void swap_release(my_type &that) {
+    tagged_pointer_to_moveable op = that._Contents;
+    that._Contents = this->_Contents;
+    __atomic_store_n(&this->_Contents.thePointer, op.thePointer, __ATOMIC_RELEASE);
+  }
+
   pointer_to_moveable contents() const { return this->_Contents; };
 
+  /*! Load the contents with load-acquire - pairs with swap_release */
+  pointer_to_moveable contents_acquire() const {
+    impl_type *tagged = __atomic_load_n(&this->_Contents.thePointer, __ATOMIC_ACQUIRE);
+    if (tagged == NULL) return NULL;
+    return untag_general<impl_type *>(tagged);
+  };
+
 private:
   T &errorEmpty() {
     throw_hard_error("GCVector had no contents");
@@ -4,10 +4,23 @@
 #include <signal.h>
 #include <chrono>
 
+#ifdef USE_BOEHM
+// Small objects are carved out of per-thread free lists, one per size class
+// of BOEHM_THREAD_LOCAL_GRANULE_BYTES granules.  Larger objects go straight to GC_MALLOC.
+#define BOEHM_THREAD_LOCAL_GRANULE_BYTES 16
+#define BOEHM_THREAD_LOCAL_SIZE_CLASSES 17
+#endif
+
 namespace gctools {
 
   extern "C" void HitAllocationSizeThreshold();
   extern "C" void HitAllocationNumberThreshold();
+  struct GlobalAllocationProfiler;
+  void HitAllocationSampleThreshold(GlobalAllocationProfiler* allocations, stamp_t stamp, size_t size);
+
+  // While the allocation profiler is off each thread still checks in every
+  // ALLOCATION_SAMPLE_IDLE_BYTES so that it notices when it is switched on.
+#define ALLOCATION_SAMPLE_IDLE_BYTES (1024*1024)
 
   extern void monitorAllocation(stamp_t k, size_t sz);
   extern void count_allocation(const stamp_t k);
@@ -35,6 +48,10 @@ namespace gctools {
    std::atomic<int64_t> _HitAllocationSizeCounter;
    size_t               _AllocationNumberThreshold;
    size_t               _AllocationSizeThreshold;
+   // Bytes left before this thread takes the next allocation sample
+   int64_t              _SampleCountdown;
+   // The jittered budget _SampleCountdown was last refilled with, 0 while idle
+   int64_t              _SampleBudget;
 #ifdef DEBUG_MONITOR_ALLOCATIONS
    MonitorAllocations _Monitor;
 #endif
@@ -42,18 +59,28 @@ namespace gctools {
  GlobalAllocationProfiler() :
    _AllocationSizeThreshold(1024*1024)
    , _AllocationNumberThreshold(16386)
+     , _SampleCountdown(ALLOCATION_SAMPLE_IDLE_BYTES)
+     , _SampleBudget(0)
      , _HitAllocationNumberCounter(0)
      , _HitAllocationSizeCounter(0)
    {};
  GlobalAllocationProfiler(size_t size, size_t number) : _AllocationSizeThreshold(size), _AllocationNumberThreshold(number)
+     , _SampleCountdown(ALLOCATION_SAMPLE_IDLE_BYTES)
+     , _SampleBudget(0)
      , _HitAllocationNumberCounter(0)
      , _HitAllocationSizeCounter(0)
    {};
     
+   // Only the owning thread writes these counters, other threads just read them,
+   // so plain relaxed stores avoid a locked read-modify-write on every allocation.
    inline void registerAllocation(stamp_t stamp, size_t size) {
-     this->_BytesAllocated += size;
-     this->_AllocationSizeCounter += size;
-     this->_AllocationNumberCounter++;
+     this->_BytesAllocated.store(this->_BytesAllocated.load(std::memory_order_relaxed)+size,std::memory_order_relaxed);
+     this->_AllocationSizeCounter.store(this->_AllocationSizeCounter.load(std::memory_order_relaxed)+size,std::memory_order_relaxed);
+     this->_AllocationNumberCounter.store(this->_AllocationNumberCounter.load(std::memory_order_relaxed)+1,std::memory_order_relaxed);
+     this->_SampleCountdown -= size;
+     if (__builtin_expect(this->_SampleCountdown<0,0)) {
+       HitAllocationSampleThreshold(this,stamp,size);
+     }
 #if defined(DEBUG_COUNT_ALLOCATIONS) && defined(DEBUG_SLOW)
     gctools::count_allocation(stamp);
 #endif
@@ -81,6 +108,12 @@ namespace gctools {
     void*                  _StackTop;
     int                    _DisableInterrupts;
     GlobalAllocationProfiler _Allocations;
+#ifdef USE_BOEHM
+    // Heads of the thread local free lists indexed by granule count.
+    // This struct lives on the thread's stack so Boehm scans the heads
+    // as roots and the objects waiting on the lists stay alive.
+    void*                  _BoehmFreeLists[BOEHM_THREAD_LOCAL_SIZE_CLASSES];
+#endif
     // Time unwinds
     std::chrono::time_point<std::chrono::high_resolution_clock> _start_unwind;
     std::chrono::duration<size_t,std::nano>   _unwind_time;
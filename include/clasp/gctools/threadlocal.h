@@ -150,6 +150,11 @@ namespace gctools {
 #endif
 
   void registerBytesAllocated(size_t bytes);
+
+#ifdef USE_BOEHM
+  //! Cheap enough to check on every allocation
+  inline bool interrupts_pending_p() { return my_thread->_PendingInterrupts.consp(); }
+#endif
 };
 
 
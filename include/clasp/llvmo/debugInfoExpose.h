@@ -996,6 +996,8 @@ size_t number_of_object_files();
 
 size_t total_memory_allocated_for_object_files();
 
+void save_object_file_manifest(std::ostream& out);
+
 };
 
 
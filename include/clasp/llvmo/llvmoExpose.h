@@ -4658,6 +4658,22 @@ struct ObjectFileInfo {
   ObjectFileInfo* _next;
 };
 
+/*! Where the linker put the code and stackmaps of one object file.
+    This is recorded by the NotifyLoaded callback for the object file itself,
+    whichever thread ends up linking it, and is carried over to the thread
+    that runs the startup code of the object file. */
+struct ObjectFileLinkInfo {
+  bool      _loaded;
+  void*     _startup;
+  void*     _text_segment_start;
+  size_t    _text_segment_size;
+  size_t    _text_segment_SectionID;
+  uintptr_t _stackmap;
+  size_t    _stackmap_size;
+  ObjectFileLinkInfo() : _loaded(false), _startup(NULL), _text_segment_start(NULL), _text_segment_size(0),
+                         _text_segment_SectionID(0), _stackmap(0), _stackmap_size(0) {};
+};
+
 FORWARD(ClaspJIT);
 class ClaspJIT_O : public core::General_O {
   LISP_CLASS(llvmo, LlvmoPkg, ClaspJIT_O, "clasp-jit", core::General_O);
@@ -4672,6 +4688,11 @@ public:
   void addObjectFile(const char* buffer, size_t bytes, size_t startupID, JITDylib& dylib, 
                      const char* faso_filename, size_t faso_index,
                      bool print=false);
+  void addObjectFileUnlinked(const char* buffer, size_t bytes, JITDylib& dylib, bool print=false);
+  bool linkObjectFile(const char* buffer, size_t startupID, JITDylib& dylib, ObjectFileLinkInfo& info, bool print=false);
+  void startUpObjectFile(const char* buffer, size_t bytes, size_t startupID,
+                         const char* faso_filename, size_t faso_index,
+                         const ObjectFileLinkInfo& info, bool print=false);
   ClaspJIT_O();
   ~ClaspJIT_O();
 public:
@@ -0,0 +1,48 @@
+/*
+    File: binarySerializer.h
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+See directory 'clasp/licenses' for full details.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+#ifndef binarySerializer_H //[
+#define binarySerializer_H
+
+#include <string>
+#include <clasp/core/object.h>
+#include <clasp/mpip/mpiPackage.h>
+
+namespace mpip {
+
+/*! Encode obj into a compact binary form that can be handed to MPI.
+    Shared structure and circularity are preserved, numeric vectors are
+    copied as raw memory.  Unsupported objects signal an error. */
+void serialize_object(core::T_sp obj, std::string &buffer);
+
+/*! Rebuild the object that serialize_object wrote into data[0..size) */
+core::T_sp deserialize_object(const char *data, size_t size);
+
+core::T_sp mpi__serialize_to_octets(core::T_sp obj);
+core::T_sp mpi__deserialize_from_octets(core::T_sp octets);
+};
+
+#endif //]
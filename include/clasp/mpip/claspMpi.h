@@ -101,6 +101,32 @@ public:
 
   core::T_mv prim_Recv(int source, int tag);
 
+  /*! Start sending an object and return a request for prim_Wait or prim_Test.
+	  The object is serialized immediately so it may be modified afterwards */
+  core::T_sp prim_Isend(int dest, int tag, core::T_sp obj);
+
+  /*! Return a request for an object from source/tag. The message is matched
+	  by prim_Wait or prim_Test */
+  core::T_sp prim_Irecv(int source, int tag);
+
+  /*! Block until the request completes, return (values object source tag).
+	  The request can't be used again afterwards */
+  core::T_mv prim_Wait(core::T_sp request);
+
+  /*! Return (values completep object source tag) without blocking.
+	  Once completep is true the request can't be used again */
+  core::T_mv prim_Test(core::T_sp request);
+
+  //! Broadcast obj from root to every process and return it
+  core::T_sp prim_Bcast(core::T_sp obj, int root);
+
+  /*! Combine the double vectors of all processes elementwise with op
+	  (one of cl:+ cl:* cl:max cl:min) and return the result on root */
+  core::T_sp prim_Reduce(core::T_sp vec, core::T_sp op, int root);
+
+  //! Concatenate the double vectors of all processes in rank order
+  core::T_sp prim_Allgather(core::T_sp vec);
+
   DEFAULT_CTOR_DTOR(Mpi_O);
 };
 
@@ -34,6 +34,8 @@ THE SOFTWARE.
 #include <unistd.h>
 #include <sys/mman.h>
 #include <dlfcn.h>
+#include <chrono>
+#include <thread>
 #ifdef _TARGET_OS_DARWIN
 #import <mach-o/dyld.h>
 #endif
@@ -74,6 +76,7 @@ THE SOFTWARE.
 #include <clasp/core/environment.h>
 #include <clasp/llvmo/intrinsics.h>
 #include <clasp/llvmo/llvmoExpose.h>
+#include <clasp/core/mpPackage.h>
 #include <clasp/core/wrappers.h>
 
 
@@ -678,6 +681,82 @@ CL_DEFUN void core__link_faso_files(T_sp outputPathDesig, List_sp fasoFiles, boo
   if (verbose) write_bf_stream(BF("Returning %s\n") % _rep_(filename));
 }
 
+/*! The number of threads that link the object files of a faso file.
+    Zero means one per core (up to FASO_MAX_LINK_THREADS), one links
+    everything in the loading thread. */
+#define FASO_MAX_LINK_THREADS 8
+std::atomic<size_t> global_faso_link_threads(0);
+
+CL_DOCSTRING("Return the number of threads that load-faso uses to link object files - zero means one per core");
+CL_DEFUN size_t core__faso_link_threads() {
+  return global_faso_link_threads.load();
+}
+
+CL_DOCSTRING("Set the number of threads that load-faso uses to link object files - zero means one per core and one means no parallel linking");
+CL_DEFUN size_t core__set_faso_link_threads(size_t threads) {
+  global_faso_link_threads.store(threads);
+  return threads;
+}
+
+struct FasoObjectFile {
+  const char*              _Start;
+  size_t                   _Length;
+  size_t                   _ObjectID;
+  llvm::orc::JITDylib*     _Dylib;
+  bool                     _Linked;
+  llvmo::ObjectFileLinkInfo _Info;
+};
+
+/*! The object files of one faso file that are waiting to be linked.
+    Link threads take the next object file until there are none left. */
+struct FasoLinkJob {
+  llvmo::ClaspJIT_O*          _JIT;
+  std::vector<FasoObjectFile> _ObjectFiles;
+  std::atomic<size_t>         _Next;
+  bool                        _Print;
+  FasoLinkJob(llvmo::ClaspJIT_O* jit, bool print) : _JIT(jit), _Next(0), _Print(print) {};
+};
+
+void faso_link_object_files(FasoLinkJob* job) {
+  size_t ofi;
+  while ((ofi = job->_Next.fetch_add(1)) < job->_ObjectFiles.size()) {
+    FasoObjectFile& of = job->_ObjectFiles[ofi];
+    of._Linked = job->_JIT->linkObjectFile(of._Start,of._ObjectID,*of._Dylib,of._Info,job->_Print);
+  }
+}
+
+SYMBOL_SC_(CorePkg, faso_link_worker_abort);
+CL_LAMBDA(condition hook);
+CL_DOCSTRING("The ext:*invoke-debugger-hook* of a faso link worker - end the worker and leave the condition for load-faso to signal");
+CL_DEFUN void core__faso_link_worker_abort(T_sp condition, T_sp hook) {
+  mp::Process_sp this_process = gc::As<mp::Process_sp>(mp::_sym_STARcurrent_processSTAR->symbolValue());
+  this_process->_AbortCondition = condition;
+  throw mp::AbortProcess();
+}
+
+SYMBOL_SC_(CorePkg, faso_link_worker);
+CL_DEFUN void core__faso_link_worker(Pointer_sp job) {
+  // Nobody can answer the debugger in a link worker
+  DynamicScopeManager scope(ext::_sym_STARinvoke_debugger_hookSTAR, _sym_faso_link_worker_abort->symbolFunction());
+  faso_link_object_files((FasoLinkJob*)job->ptr());
+}
+
+/*! The link workers of one load-faso.  They use the FasoLinkJob on the loading
+    thread's stack, so they are joined before it goes away however load-faso is left. */
+struct FasoLinkWorkers {
+  List_sp _Workers;
+  bool    _Joined;
+  FasoLinkWorkers(List_sp workers) : _Workers(workers), _Joined(false) {};
+  void join() {
+    if (this->_Joined) return;
+    for ( auto cur : this->_Workers ) {
+      pthread_join(gc::As_unsafe<mp::Process_sp>(CONS_CAR(cur))->_Thread,NULL);
+    }
+    this->_Joined = true;
+  }
+  ~FasoLinkWorkers() { this->join(); }
+};
+
 CL_LAMBDA(path-designator &optional (verbose *load-verbose*) (print t) (external-format :default))
 CL_DEFUN core::T_sp core__load_faso(T_sp pathDesig, T_sp verbose, T_sp print, T_sp external_format)
 {
@@ -694,22 +773,68 @@ CL_DEFUN core::T_sp core__load_faso(T_sp pathDesig, T_sp verbose, T_sp print, T_
     SIMPLE_ERROR(BF("Could not mmap %s because of %s") % _rep_(pathDesig) % strerror(errno));
   }
   close(fd); // Ok to close file descriptor after mmap
+  auto start_time = std::chrono::steady_clock::now();
   llvmo::ClaspJIT_sp jit = gc::As<llvmo::ClaspJIT_sp>(llvmo::_sym_STARjit_engineSTAR->symbolValue());
   FasoHeader* header = (FasoHeader*)memory;
+  FasoLinkJob job(&*jit,print.notnilp());
+  // Hand every object file to the jit first - none of them is linked yet.
   llvmo::JITDylib_sp jitDylib;
   for (size_t ofi = 0; ofi<header->_NumberOfObjectFiles; ++ofi) {
     if (!jitDylib || header->_ObjectFiles[ofi]._ObjectID==0) {
       jitDylib = jit->createAndRegisterJITDylib(filename->get_std_string());
     }
-    void* of_start = (void*)((char*)header + header->_ObjectFiles[ofi]._StartPage*header->_PageSize);
-    size_t of_length = header->_ObjectFiles[ofi]._ObjectFileSize;
+    FasoObjectFile of;
+    of._Start = (const char*)((char*)header + header->_ObjectFiles[ofi]._StartPage*header->_PageSize);
+    of._Length = header->_ObjectFiles[ofi]._ObjectFileSize;
+    of._ObjectID = header->_ObjectFiles[ofi]._ObjectID;
+    of._Dylib = jitDylib->wrappedPtr();
+    of._Linked = false;
     if (print.notnilp()) write_bf_stream(BF("%s:%d Adding faso %s object file %d to jit\n") % __FILE__ % __LINE__ % _rep_(filename) % ofi);
-    jit->addObjectFile((const char*)of_start,of_length,
-                       header->_ObjectFiles[ofi]._ObjectID,
-                       *jitDylib->wrappedPtr(),
-                       name_buffer,
-                       ofi,
-                       print.notnilp() );
+    jit->addObjectFileUnlinked(of._Start,of._Length,*of._Dylib,print.notnilp());
+    job._ObjectFiles.push_back(of);
+  }
+  // Link them, in parallel if there are enough of them.
+  size_t threads = global_faso_link_threads.load();
+  if (threads==0) threads = std::min((size_t)std::thread::hardware_concurrency(),(size_t)FASO_MAX_LINK_THREADS);
+  threads = std::min(threads,job._ObjectFiles.size());
+  ql::list workers;
+  size_t linking_threads = 1;
+  for (size_t ti=1; ti<threads; ++ti) {
+    mp::Process_sp worker = mp::Process_O::make_process(_sym_faso_link_worker,
+                                                        _sym_faso_link_worker->symbolFunction(),
+                                                        Cons_O::createList(Pointer_O::create(&job)),
+                                                        _Nil<T_O>(), 0);
+    if (worker->enable()==0) {
+      workers << worker;
+      ++linking_threads;
+    }
+  }
+  FasoLinkWorkers started(workers.cons());
+  faso_link_object_files(&job);
+  started.join();
+  // Signal what went wrong in a worker here, where it can be handled
+  for ( auto cur : started._Workers ) {
+    mp::Process_sp worker = gc::As_unsafe<mp::Process_sp>(CONS_CAR(cur));
+    if (worker->_Aborted) {
+      if (worker->_AbortCondition.notnilp()) cl__error(worker->_AbortCondition,_Nil<T_O>());
+      SIMPLE_ERROR(BF("A thread linking the object files of %s was aborted") % _rep_(filename));
+    }
+  }
+  auto link_time = std::chrono::steady_clock::now();
+  // Run the startup code of each object file in order.
+  for (size_t ofi = 0; ofi<job._ObjectFiles.size(); ++ofi) {
+    FasoObjectFile& of = job._ObjectFiles[ofi];
+    if (!of._Linked) SIMPLE_ERROR(BF("Could not link object file %lu of %s") % ofi % _rep_(filename));
+    jit->startUpObjectFile(of._Start,of._Length,of._ObjectID,name_buffer,ofi,of._Info,print.notnilp());
+  }
+  if (verbose.notnilp()) {
+    auto end_time = std::chrono::steady_clock::now();
+    write_bf_stream(BF("Loaded faso %s - %lu object files linked by %lu threads in %.3f seconds, started up in %.3f seconds\n")
+                    % _rep_(filename)
+                    % job._ObjectFiles.size()
+                    % linking_threads
+                    % std::chrono::duration<double>(link_time-start_time).count()
+                    % std::chrono::duration<double>(end_time-link_time).count());
   }
   return _lisp->_true();
 }
@@ -49,6 +49,368 @@ THE SOFTWARE.
 
 namespace core {
 
+/* ----------------------------------------------------------------------
+ * Shortest round-trip digits for single and double floats.
+ *
+ * This is the Ryu algorithm (Ulf Adams, "Ryu: fast float-to-string
+ * conversion", PLDI 2018).  It works entirely in 64/128 bit integer
+ * arithmetic so printing a float doesn't cons any bignums.  The tables of
+ * truncated powers of five are computed once with GMP the first time they
+ * are needed.  float_to_digits only takes this path when no position is
+ * requested, everything else still goes through the Steele-White code below.
+ */
+
+#define RYU_DOUBLE_MANTISSA_BITS 52
+#define RYU_DOUBLE_BIAS 1023
+#define RYU_DOUBLE_POW5_INV_BITCOUNT 125
+#define RYU_DOUBLE_POW5_BITCOUNT 125
+#define RYU_DOUBLE_POW5_INV_TABLE_SIZE 342
+#define RYU_DOUBLE_POW5_TABLE_SIZE 326
+#define RYU_FLOAT_MANTISSA_BITS 23
+#define RYU_FLOAT_BIAS 127
+#define RYU_FLOAT_POW5_INV_BITCOUNT 59
+#define RYU_FLOAT_POW5_BITCOUNT 61
+#define RYU_FLOAT_POW5_INV_TABLE_SIZE 31
+#define RYU_FLOAT_POW5_TABLE_SIZE 47
+
+typedef unsigned __int128 ryu_uint128;
+
+//! Number of bits in 5^e, for 0 <= e <= 3528
+static inline int32_t ryu_pow5bits(int32_t e) {
+  return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+//! floor(log10(2^e)), for 0 <= e <= 1650
+static inline uint32_t ryu_log10_pow2(int32_t e) {
+  return ((uint32_t)e * 78913) >> 18;
+}
+
+//! floor(log10(5^e)), for 0 <= e <= 2620
+static inline uint32_t ryu_log10_pow5(int32_t e) {
+  return ((uint32_t)e * 732923) >> 20;
+}
+
+static inline uint32_t ryu_pow5_factor(uint64_t value) {
+  uint32_t count = 0;
+  while (value % 5 == 0) {
+    value /= 5;
+    ++count;
+  }
+  return count;
+}
+
+static inline bool ryu_multiple_of_pow5(uint64_t value, uint32_t p) {
+  return ryu_pow5_factor(value) >= p;
+}
+
+static inline bool ryu_multiple_of_pow2(uint64_t value, uint32_t p) {
+  return (value & ((1ull << p) - 1)) == 0;
+}
+
+struct RyuTables {
+  ryu_uint128 double_pow5_inv_split[RYU_DOUBLE_POW5_INV_TABLE_SIZE];
+  ryu_uint128 double_pow5_split[RYU_DOUBLE_POW5_TABLE_SIZE];
+  uint64_t float_pow5_inv_split[RYU_FLOAT_POW5_INV_TABLE_SIZE];
+  uint64_t float_pow5_split[RYU_FLOAT_POW5_TABLE_SIZE];
+
+  static ryu_uint128 low_128_bits(const mpz_class &v) {
+    mpz_class mask = (mpz_class(1) << 64) - 1;
+    mpz_class lo = v & mask;
+    mpz_class hi = (v >> 64) & mask;
+    return ((ryu_uint128)mpz_get_ui(hi.get_mpz_t()) << 64) | mpz_get_ui(lo.get_mpz_t());
+  }
+  //! floor(2^(bitlength(5^i)-1+bitcount) / 5^i) + 1
+  static mpz_class pow5_inv(size_t i, int bitcount) {
+    mpz_class pow5;
+    mpz_ui_pow_ui(pow5.get_mpz_t(), 5, i);
+    mpz_class numerator = mpz_class(1) << (mpz_sizeinbase(pow5.get_mpz_t(), 2) - 1 + bitcount);
+    mpz_class result = numerator / pow5;
+    return result + 1;
+  }
+  //! 5^i truncated to its top bitcount bits
+  static mpz_class pow5(size_t i, int bitcount) {
+    mpz_class pow5;
+    mpz_ui_pow_ui(pow5.get_mpz_t(), 5, i);
+    int shift = (int)mpz_sizeinbase(pow5.get_mpz_t(), 2) - bitcount;
+    if (shift > 0) return pow5 >> shift;
+    return pow5 << -shift;
+  }
+  RyuTables() {
+    for (size_t i = 0; i < RYU_DOUBLE_POW5_INV_TABLE_SIZE; ++i)
+      this->double_pow5_inv_split[i] = low_128_bits(pow5_inv(i, RYU_DOUBLE_POW5_INV_BITCOUNT));
+    for (size_t i = 0; i < RYU_DOUBLE_POW5_TABLE_SIZE; ++i)
+      this->double_pow5_split[i] = low_128_bits(pow5(i, RYU_DOUBLE_POW5_BITCOUNT));
+    for (size_t i = 0; i < RYU_FLOAT_POW5_INV_TABLE_SIZE; ++i)
+      this->float_pow5_inv_split[i] = (uint64_t)low_128_bits(pow5_inv(i, RYU_FLOAT_POW5_INV_BITCOUNT));
+    for (size_t i = 0; i < RYU_FLOAT_POW5_TABLE_SIZE; ++i)
+      this->float_pow5_split[i] = (uint64_t)low_128_bits(pow5(i, RYU_FLOAT_POW5_BITCOUNT));
+  }
+};
+
+static const RyuTables &ryu_tables() {
+  static RyuTables tables;
+  return tables;
+}
+
+//! (m * mul) >> j for 64 <= j, m < 2^55
+static inline uint64_t ryu_mul_shift64(uint64_t m, ryu_uint128 mul, int32_t j) {
+  ryu_uint128 b0 = (ryu_uint128)m * (uint64_t)mul;
+  ryu_uint128 b2 = (ryu_uint128)m * (uint64_t)(mul >> 64);
+  return (uint64_t)(((b0 >> 64) + b2) >> (j - 64));
+}
+
+//! (m * factor) >> shift for 32 < shift
+static inline uint32_t ryu_mul_shift32(uint32_t m, uint64_t factor, int32_t shift) {
+  uint64_t bits0 = (uint64_t)m * (uint32_t)factor;
+  uint64_t bits1 = (uint64_t)m * (uint32_t)(factor >> 32);
+  return (uint32_t)(((bits0 >> 32) + bits1) >> (shift - 32));
+}
+
+/*! Shortest decimal (output * 10^exponent) that reads back as the double
+    with the given raw mantissa and exponent fields */
+static void ryu_double_decimal(uint64_t ieeeMantissa, uint32_t ieeeExponent, uint64_t &output, int32_t &exponent) {
+  const RyuTables &tables = ryu_tables();
+  int32_t e2;
+  uint64_t m2;
+  if (ieeeExponent == 0) {
+    e2 = 1 - RYU_DOUBLE_BIAS - RYU_DOUBLE_MANTISSA_BITS - 2;
+    m2 = ieeeMantissa;
+  } else {
+    e2 = (int32_t)ieeeExponent - RYU_DOUBLE_BIAS - RYU_DOUBLE_MANTISSA_BITS - 2;
+    m2 = (1ull << RYU_DOUBLE_MANTISSA_BITS) | ieeeMantissa;
+  }
+  const bool acceptBounds = (m2 & 1) == 0;
+  // The interval of decimals that read back as this float is (mm, mp) around mv
+  const uint64_t mv = 4 * m2;
+  const uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+  uint64_t vr, vp, vm;
+  int32_t e10;
+  bool vmIsTrailingZeros = false;
+  bool vrIsTrailingZeros = false;
+  if (e2 >= 0) {
+    const uint32_t q = ryu_log10_pow2(e2) - (e2 > 3);
+    e10 = (int32_t)q;
+    const int32_t k = RYU_DOUBLE_POW5_INV_BITCOUNT + ryu_pow5bits((int32_t)q) - 1;
+    const int32_t i = -e2 + (int32_t)q + k;
+    ryu_uint128 mul = tables.double_pow5_inv_split[q];
+    vr = ryu_mul_shift64(4 * m2, mul, i);
+    vp = ryu_mul_shift64(4 * m2 + 2, mul, i);
+    vm = ryu_mul_shift64(4 * m2 - 1 - mmShift, mul, i);
+    if (q <= 21) {
+      // Only one of mp, mv and mm can be a multiple of 5, if any
+      if (mv % 5 == 0) {
+        vrIsTrailingZeros = ryu_multiple_of_pow5(mv, q);
+      } else if (acceptBounds) {
+        vmIsTrailingZeros = ryu_multiple_of_pow5(mv - 1 - mmShift, q);
+      } else {
+        vp -= ryu_multiple_of_pow5(mv + 2, q);
+      }
+    }
+  } else {
+    const uint32_t q = ryu_log10_pow5(-e2) - (-e2 > 1);
+    e10 = (int32_t)q + e2;
+    const int32_t i = -e2 - (int32_t)q;
+    const int32_t k = ryu_pow5bits(i) - RYU_DOUBLE_POW5_BITCOUNT;
+    const int32_t j = (int32_t)q - k;
+    ryu_uint128 mul = tables.double_pow5_split[i];
+    vr = ryu_mul_shift64(4 * m2, mul, j);
+    vp = ryu_mul_shift64(4 * m2 + 2, mul, j);
+    vm = ryu_mul_shift64(4 * m2 - 1 - mmShift, mul, j);
+    if (q <= 1) {
+      // mv has at least q trailing zero bits and so do mp and mm
+      vrIsTrailingZeros = true;
+      if (acceptBounds) {
+        vmIsTrailingZeros = mmShift == 1;
+      } else {
+        --vp;
+      }
+    } else if (q < 63) {
+      vrIsTrailingZeros = ryu_multiple_of_pow2(mv, q);
+    }
+  }
+  // Remove digits while the interval still contains a shorter decimal
+  int32_t removed = 0;
+  uint8_t lastRemovedDigit = 0;
+  if (vmIsTrailingZeros || vrIsTrailingZeros) {
+    while (vp / 10 > vm / 10) {
+      vmIsTrailingZeros &= vm % 10 == 0;
+      vrIsTrailingZeros &= lastRemovedDigit == 0;
+      lastRemovedDigit = (uint8_t)(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    if (vmIsTrailingZeros) {
+      while (vm % 10 == 0) {
+        vrIsTrailingZeros &= lastRemovedDigit == 0;
+        lastRemovedDigit = (uint8_t)(vr % 10);
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        ++removed;
+      }
+    }
+    if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0) {
+      // The exact value is ...50000, round to even
+      lastRemovedDigit = 4;
+    }
+    output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5);
+  } else {
+    bool roundUp = false;
+    while (vp / 10 > vm / 10) {
+      roundUp = (vr % 10) >= 5;
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    output = vr + (vr == vm || roundUp);
+  }
+  exponent = e10 + removed;
+}
+
+//! Same as ryu_double_decimal for single floats
+static void ryu_float_decimal(uint32_t ieeeMantissa, uint32_t ieeeExponent, uint64_t &output, int32_t &exponent) {
+  const RyuTables &tables = ryu_tables();
+  int32_t e2;
+  uint32_t m2;
+  if (ieeeExponent == 0) {
+    e2 = 1 - RYU_FLOAT_BIAS - RYU_FLOAT_MANTISSA_BITS - 2;
+    m2 = ieeeMantissa;
+  } else {
+    e2 = (int32_t)ieeeExponent - RYU_FLOAT_BIAS - RYU_FLOAT_MANTISSA_BITS - 2;
+    m2 = (1u << RYU_FLOAT_MANTISSA_BITS) | ieeeMantissa;
+  }
+  const bool acceptBounds = (m2 & 1) == 0;
+  const uint32_t mv = 4 * m2;
+  const uint32_t mp = 4 * m2 + 2;
+  const uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+  const uint32_t mm = 4 * m2 - 1 - mmShift;
+  uint32_t vr, vp, vm;
+  int32_t e10;
+  bool vmIsTrailingZeros = false;
+  bool vrIsTrailingZeros = false;
+  uint8_t lastRemovedDigit = 0;
+  if (e2 >= 0) {
+    const uint32_t q = ryu_log10_pow2(e2);
+    e10 = (int32_t)q;
+    const int32_t k = RYU_FLOAT_POW5_INV_BITCOUNT + ryu_pow5bits((int32_t)q) - 1;
+    const int32_t i = -e2 + (int32_t)q + k;
+    vr = ryu_mul_shift32(mv, tables.float_pow5_inv_split[q], i);
+    vp = ryu_mul_shift32(mp, tables.float_pow5_inv_split[q], i);
+    vm = ryu_mul_shift32(mm, tables.float_pow5_inv_split[q], i);
+    if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+      // The loop below won't run but we still need the digit below vr to round
+      const int32_t l = RYU_FLOAT_POW5_INV_BITCOUNT + ryu_pow5bits((int32_t)(q - 1)) - 1;
+      lastRemovedDigit = (uint8_t)(ryu_mul_shift32(mv, tables.float_pow5_inv_split[q - 1], -e2 + (int32_t)q - 1 + l) % 10);
+    }
+    if (q <= 9) {
+      if (mv % 5 == 0) {
+        vrIsTrailingZeros = ryu_multiple_of_pow5(mv, q);
+      } else if (acceptBounds) {
+        vmIsTrailingZeros = ryu_multiple_of_pow5(mm, q);
+      } else {
+        vp -= ryu_multiple_of_pow5(mp, q);
+      }
+    }
+  } else {
+    const uint32_t q = ryu_log10_pow5(-e2);
+    e10 = (int32_t)q + e2;
+    const int32_t i = -e2 - (int32_t)q;
+    const int32_t k = ryu_pow5bits(i) - RYU_FLOAT_POW5_BITCOUNT;
+    int32_t j = (int32_t)q - k;
+    vr = ryu_mul_shift32(mv, tables.float_pow5_split[i], j);
+    vp = ryu_mul_shift32(mp, tables.float_pow5_split[i], j);
+    vm = ryu_mul_shift32(mm, tables.float_pow5_split[i], j);
+    if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+      j = (int32_t)q - 1 - (ryu_pow5bits(i + 1) - RYU_FLOAT_POW5_BITCOUNT);
+      lastRemovedDigit = (uint8_t)(ryu_mul_shift32(mv, tables.float_pow5_split[i + 1], j) % 10);
+    }
+    if (q <= 1) {
+      vrIsTrailingZeros = true;
+      if (acceptBounds) {
+        vmIsTrailingZeros = mmShift == 1;
+      } else {
+        --vp;
+      }
+    } else if (q < 31) {
+      vrIsTrailingZeros = ryu_multiple_of_pow2(mv, q - 1);
+    }
+  }
+  int32_t removed = 0;
+  if (vmIsTrailingZeros || vrIsTrailingZeros) {
+    while (vp / 10 > vm / 10) {
+      vmIsTrailingZeros &= vm % 10 == 0;
+      vrIsTrailingZeros &= lastRemovedDigit == 0;
+      lastRemovedDigit = (uint8_t)(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    if (vmIsTrailingZeros) {
+      while (vm % 10 == 0) {
+        vrIsTrailingZeros &= lastRemovedDigit == 0;
+        lastRemovedDigit = (uint8_t)(vr % 10);
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        ++removed;
+      }
+    }
+    if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0) {
+      lastRemovedDigit = 4;
+    }
+    output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5);
+  } else {
+    while (vp / 10 > vm / 10) {
+      lastRemovedDigit = (uint8_t)(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    output = vr + (vr == vm || lastRemovedDigit >= 5);
+  }
+  exponent = e10 + removed;
+}
+
+/*! Write the shortest digits of a finite, nonzero single or double float
+    into buffer (at least 20 chars) and return how many were written.
+    k is set like the Steele-White scale - number = 0.digits * 10^k.
+    Returns 0 if the number can't take the fast path. */
+static size_t ryu_float_to_digits(Float_sp number, char *buffer, Fixnum &k) {
+  uint64_t output;
+  int32_t exponent;
+  if (number.single_floatp()) {
+    float f = number.unsafe_single_float();
+    if (f == 0.0f || !std::isfinite(f)) return 0;
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    ryu_float_decimal(bits & ((1u << RYU_FLOAT_MANTISSA_BITS) - 1),
+                      (bits >> RYU_FLOAT_MANTISSA_BITS) & 0xff, output, exponent);
+  } else if (DoubleFloat_sp df = number.asOrNull<DoubleFloat_O>()) {
+    double d = df->get();
+    if (d == 0.0 || !std::isfinite(d)) return 0;
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    ryu_double_decimal(bits & ((1ull << RYU_DOUBLE_MANTISSA_BITS) - 1),
+                       (uint32_t)(bits >> RYU_DOUBLE_MANTISSA_BITS) & 0x7ff, output, exponent);
+  } else {
+    return 0;
+  }
+  char reversed[20];
+  size_t length = 0;
+  do {
+    reversed[length++] = '0' + (char)(output % 10);
+    output /= 10;
+  } while (output);
+  for (size_t i = 0; i < length; ++i) buffer[i] = reversed[length - 1 - i];
+  k = exponent + (Fixnum)length;
+  return length;
+}
+
 #define PRINT_BASE clasp_make_fixnum(10)
 #define EXPT_RADIX(x) clasp_ash(clasp_make_fixnum(1), x)
 
@@ -233,6 +595,25 @@ CL_DOCSTRING("float_to_digits");
 CL_DEFUN T_mv core__float_to_digits(T_sp tdigits, Float_sp number, T_sp position, T_sp relativep) {
   ASSERT(tdigits.nilp()||gc::IsA<Str8Ns_sp>(tdigits));
   gctools::Fixnum k;
+  if (position.nilp()) {
+    char buffer[24];
+    size_t length = ryu_float_to_digits(number, buffer, k);
+    if (length > 0) {
+      StrNs_sp digits;
+      if (tdigits.nilp()) {
+        digits = gc::As<StrNs_sp>(core__make_vector(cl::_sym_base_char,
+                                                    24,
+                                                    true /* adjustable */,
+                                                    clasp_make_fixnum(0) /* fill pointer */));
+      } else {
+        digits = gc::As<StrNs_sp>(tdigits);
+      }
+      for (size_t i = 0; i < length; ++i) {
+        digits->vectorPushExtend(clasp_make_character(buffer[i]));
+      }
+      return Values(clasp_make_fixnum(k), digits);
+    }
+  }
   float_approx approx[1];
   setup(number, approx);
   change_precision(approx, position, relativep);
@@ -223,6 +223,8 @@ T_sp FuncallableInstance_O::setFuncallableInstanceFunction(T_sp function) {
    * aren't actually closures at the moment. */
   if (gc::IsA<Function_sp>(function)) {
     this->GFUN_DISPATCHER_set(function);
+    // A new discriminating function starts counting its calls again
+    this->_InterpretedCalls = 0;
     // If the function has no closure slots, we can use its entry point.
     if (gc::IsA<ClosureWithSlots_sp>(function)) {
       ClosureWithSlots_sp closure = gc::As_unsafe<ClosureWithSlots_sp>(function);
@@ -237,6 +239,22 @@ T_sp FuncallableInstance_O::setFuncallableInstanceFunction(T_sp function) {
   return ((this->sharedThis<FuncallableInstance_O>()));
 }
 
+/*! Install newFunction only if oldFunction is still the GFUN_DISPATCHER.
+    This is used to swap in a discriminating function that was compiled in
+    another thread - if the generic function was invalidated while it was
+    being compiled then the compiled function is out of date and dropped.
+    Another thread may setFuncallableInstanceFunction at the same time, so
+    the entry point is always the one that goes through GFUN_DISPATCHER. */
+bool FuncallableInstance_O::compareAndSetFuncallableInstanceFunction(T_sp oldFunction, T_sp newFunction) {
+  if (!gc::IsA<Function_sp>(newFunction)) {
+    TYPE_ERROR(newFunction, cl::_sym_function);
+  }
+  T_sp expected = oldFunction;
+  if (!this->_CompiledDispatchFunction.compare_exchange_strong(expected, newFunction)) return false;
+  this->entry.store(funcallable_entry_point);
+  return true;
+}
+
 void FuncallableInstance_O::describe(T_sp stream) {
   stringstream ss;
   ss << (BF("FuncallableInstance\n")).str();
@@ -265,10 +283,19 @@ CL_DEFUN T_sp clos__setFuncallableInstanceFunction(T_sp obj, T_sp func) {
 
 namespace core {
 
+CL_DOCSTRING("Return the number of calls that the dispatch interpreter has made for the generic function since its discriminating function was last set");
 CL_DEFUN size_t clos__generic_function_interpreted_calls(FuncallableInstance_sp gf) {
   return gf->interpreted_calls();
 }
 
+CL_DOCSTRING("Set the discriminating function of the funcallable instance OBJ to NEW-FUNCTION if it is still OLD-FUNCTION. Return true if it was set.");
+CL_DEFUN bool clos__compare_and_set_funcallable_instance_function(T_sp obj, T_sp old_function, T_sp new_function) {
+  if (FuncallableInstance_sp iobj = obj.asOrNull<FuncallableInstance_O>()) {
+    return iobj->compareAndSetFuncallableInstanceFunction(old_function,new_function);
+  }
+  SIMPLE_ERROR(BF("You can only set the function of funcallable instances - you tried to set it on a: %s") % _rep_(obj));
+}
+
 CL_DEFUN T_sp clos__generic_function_compiled_dispatch_function(T_sp obj) {
   return gc::As<FuncallableInstance_sp>(obj)->GFUN_DISPATCHER();
 }
@@ -355,9 +382,25 @@ std::string dtree_op_name(int dtree_op) {
 };
 
 SYMBOL_EXPORT_SC_(ClosPkg,interp_wrong_nargs);
-SYMBOL_EXPORT_SC_(ClosPkg, compile_discriminating_function);
+SYMBOL_EXPORT_SC_(ClosPkg, tiered_compile_discriminating_function);
 
-#define COMPILE_TRIGGER 1024 // completely arbitrary
+/*! The number of interpreted calls after which a discriminating function is compiled.
+    Zero means that discriminating functions stay interpreted.
+    Compilation increases build time so it is off until it is asked for. */
+std::atomic<size_t> global_dtree_compile_threshold(0);
+
+CL_DOCSTRING("Return the number of interpreted calls after which the discriminating function of a generic function is compiled - zero means never");
+CL_DEFUN size_t clos__dtree_compile_threshold() {
+  return global_dtree_compile_threshold.load();
+}
+
+// The default threshold of 1024 is completely arbitrary
+CL_LAMBDA(&optional (threshold 1024));
+CL_DOCSTRING("Compile discriminating functions that are interpreted THRESHOLD times - zero turns compilation off");
+CL_DEFUN size_t clos__set_dtree_compile_threshold(size_t threshold) {
+  global_dtree_compile_threshold.store(threshold);
+  return threshold;
+}
 
 CL_LAMBDA(program gf args);
 CL_DEFUN T_mv clos__interpret_dtree_program(SimpleVector_sp program, T_sp generic_function,
@@ -368,12 +411,15 @@ CL_DEFUN T_mv clos__interpret_dtree_program(SimpleVector_sp program, T_sp generi
   for ( size_t i=0; i<program->length(); ++i ) {
     DTILOG(BF("[%3d] : %s\n") % i % _safe_rep_((*program)[i]));
   }
-#if 0 // Compilation disabled for now because it increases build time
-  // Increment the call count, and if it's high enough, compile the thing
-  size_t calls = gc::As_unsafe<FuncallableInstance_sp>(generic_function)->increment_calls();
-  if (calls >= COMPILE_TRIGGER)
-    eval::funcall(clos::_sym_compile_discriminating_function, generic_function);
-#endif
+  // Increment the call count, and if it just reached the threshold, compile the thing.
+  // Only the call that reaches the threshold triggers so each dispatcher is compiled once.
+  {
+    FuncallableInstance_sp gf = gc::As_unsafe<FuncallableInstance_sp>(generic_function);
+    size_t calls = gf->increment_calls() + 1;
+    size_t threshold = global_dtree_compile_threshold.load(std::memory_order_relaxed);
+    if (threshold != 0 && calls == threshold)
+      eval::funcall(clos::_sym_tiered_compile_discriminating_function, generic_function, gf->GFUN_DISPATCHER());
+  }
   // Regardless of whether we triggered the compile, we next
   // Dispatch
   Vaslist valist_copy(*args);
@@ -567,6 +613,95 @@ CL_DEFUN T_mv clos__interpret_dtree_program(SimpleVector_sp program, T_sp generi
   return core::eval::funcall(clos::_sym_dispatch_miss_va,generic_function,args);
 }
 
+/*! Inline caches for generic function call sites.
+    A call site that is compiled with an inline cache owns a simple-vector
+    laid out as [misses, miss-epoch, entry...] where each entry is nil or an
+    immutable simple-vector #(generic-function stamp function epoch).
+    An entry is only used while its epoch is the inline cache epoch of its
+    generic function.  CLOS bumps that epoch when the outcomes in the call
+    history of the generic function change (methods are added or removed,
+    or a class it was called on is redefined) - a dispatch miss that only
+    adds to the call history leaves existing entries valid. */
+#define INLINE_CACHE_MISSES_OFFSET 0
+#define INLINE_CACHE_MISS_EPOCH_OFFSET 1
+#define INLINE_CACHE_ENTRIES_OFFSET 2
+#define INLINE_CACHE_ENTRY_GF 0
+#define INLINE_CACHE_ENTRY_STAMP 1
+#define INLINE_CACHE_ENTRY_FUNCTION 2
+#define INLINE_CACHE_ENTRY_EPOCH 3
+#define INLINE_CACHE_ENTRY_SIZE 4
+// After this many misses with no change in dispatch a call site is megamorphic
+#define INLINE_CACHE_MEGAMORPHIC_MISSES 64
+
+CL_DOCSTRING("Invalidate the inline cache entries of the generic function GF");
+CL_DEFUN void clos__invalidate_inline_caches(FuncallableInstance_sp gf) {
+  gf->invalidate_inline_caches();
+}
+
+/*! Return the stamp of a general object in the same form as DTREE_OP_STAMP_READ */
+static uintptr_t inline_cache_general_stamp(T_sp arg) {
+  General_O* client_ptr = gctools::untag_general<General_O*>((General_O*)arg.raw_());
+  uintptr_t stamp = (uintptr_t)(llvmo::template_read_general_stamp(client_ptr));
+  switch (stamp & gctools::Header_s::where_mask) {
+  case gctools::Header_s::rack_wtag:
+      return (uintptr_t)(llvmo::template_read_rack_stamp(client_ptr));
+  case gctools::Header_s::wrapped_wtag:
+      return (uintptr_t)(llvmo::template_read_wrapped_stamp(client_ptr));
+  case gctools::Header_s::derivable_wtag:
+      return (uintptr_t)(llvmo::template_read_derived_stamp(client_ptr));
+  }
+  return stamp;
+}
+
+SYMBOL_EXPORT_SC_(ClosPkg, inline_cache_miss);
+
+CL_DOCSTRING("Return the function to call at a call site with inline cache CACHE that calls FUNCTION with first argument ARG. This is the cached effective method if there is one for the stamp of ARG, otherwise FUNCTION itself.");
+CL_DEFUN T_sp clos__inline_cache_lookup(SimpleVector_sp cache, T_sp function, T_sp arg) {
+  if (!gc::IsA<FuncallableInstance_sp>(function) || !arg.generalp()) return function;
+  Fixnum epoch = gc::As_unsafe<FuncallableInstance_sp>(function)->inline_cache_epoch();
+  // The stamps are tagged fixnums so they can be stored in the cache directly
+  uintptr_t stamp = inline_cache_general_stamp(arg);
+  size_t length = cache->length();
+  for (size_t i(INLINE_CACHE_ENTRIES_OFFSET); i<length; ++i) {
+    T_sp tentry = (*cache)[i];
+    if (tentry.nilp()) break;
+    SimpleVector_sp entry = gc::As_unsafe<SimpleVector_sp>(tentry);
+    if ((*entry)[INLINE_CACHE_ENTRY_STAMP].tagged_() == stamp
+        && (*entry)[INLINE_CACHE_ENTRY_GF] == function
+        && (*entry)[INLINE_CACHE_ENTRY_EPOCH].unsafe_fixnum() == epoch)
+      return (*entry)[INLINE_CACHE_ENTRY_FUNCTION];
+  }
+  Fixnum misses = (*cache)[INLINE_CACHE_MISSES_OFFSET].unsafe_fixnum();
+  if ((*cache)[INLINE_CACHE_MISS_EPOCH_OFFSET].unsafe_fixnum() != epoch) {
+    // Dispatch changed since the call site went megamorphic - give it another chance
+    misses = 0;
+    (*cache)[INLINE_CACHE_MISS_EPOCH_OFFSET] = make_fixnum(epoch);
+  }
+  if (misses >= INLINE_CACHE_MEGAMORPHIC_MISSES) return function;
+  (*cache)[INLINE_CACHE_MISSES_OFFSET] = make_fixnum(misses+1);
+  T_mv result = core::eval::funcall(clos::_sym_inline_cache_miss, function, arg);
+  T_sp target = result;
+  if (result.second().nilp()) return function;
+  SimpleVector_sp entry = SimpleVector_O::make(INLINE_CACHE_ENTRY_SIZE);
+  (*entry)[INLINE_CACHE_ENTRY_GF] = function;
+  (*entry)[INLINE_CACHE_ENTRY_STAMP] = T_sp((gctools::Tagged)stamp);
+  (*entry)[INLINE_CACHE_ENTRY_FUNCTION] = target;
+  (*entry)[INLINE_CACHE_ENTRY_EPOCH] = make_fixnum(epoch);
+  // Fill an empty or stale entry, otherwise replace one round robin
+  size_t slots = length-INLINE_CACHE_ENTRIES_OFFSET;
+  size_t victim = INLINE_CACHE_ENTRIES_OFFSET + (misses % slots);
+  for (size_t i(INLINE_CACHE_ENTRIES_OFFSET); i<length; ++i) {
+    T_sp tentry = (*cache)[i];
+    if (tentry.nilp()
+        || (*gc::As_unsafe<SimpleVector_sp>(tentry))[INLINE_CACHE_ENTRY_EPOCH].unsafe_fixnum() != epoch) {
+      victim = i;
+      break;
+    }
+  }
+  (*cache)[victim] = entry;
+  return target;
+}
+
 SYMBOL_EXPORT_SC_(ClosPkg,codegen_dispatcher);
 SYMBOL_EXPORT_SC_(KeywordPkg,force_compile);
 SYMBOL_EXPORT_SC_(KeywordPkg,generic_function_name);
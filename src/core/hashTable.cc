@@ -78,11 +78,13 @@ CL_DEFUN Vector_sp core__hash_table_pairs(HashTable_sp hash_table)
 {
   SimpleVector_sp keyvalues = SimpleVector_O::make(hash_table->_HashTableCount*2);
   size_t idx(0);
-  for (size_t it(0), itEnd(hash_table->_Table.size()); it < itEnd; ++it) {
-    Cons_O& entry = hash_table->_Table[it];
-    if (!entry.ocar().no_keyp()&&!entry.ocar().deletedp()) {
-      (*keyvalues)[idx++] = entry.ocar();
-      (*keyvalues)[idx++] = entry.cdr();
+  for (gc::Vec0<Cons_O>* table : { &hash_table->_OldTable, &hash_table->_Table }) {
+    for (size_t it(0), itEnd(table->size()); it < itEnd; ++it) {
+      Cons_O& entry = (*table)[it];
+      if (!entry.ocar().no_keyp()&&!entry.ocar().deletedp()) {
+        (*keyvalues)[idx++] = entry.ocar();
+        (*keyvalues)[idx++] = entry.cdr();
+      }
     }
   }
   return keyvalues;
@@ -93,13 +95,15 @@ void verifyHashTable(bool print, std::ostream& ss, HashTable_O* ht, const char*
 {
   size_t cnt = 0;
   Vector_sp keys = core__make_vector(_lisp->_true(),ht->_HashTableCount+16, true, make_fixnum(0));
-  for (size_t it(0), itEnd(ht->_Table.size()); it < itEnd; ++it) {
-    Cons_O& entry = ht->_Table[it];
-    if (!entry.ocar().no_keyp()&&!entry.ocar().deletedp()) {
+  for (gc::Vec0<Cons_O>* table : { &ht->_OldTable, &ht->_Table }) {
+    for (size_t it(0), itEnd(table->size()); it < itEnd; ++it) {
+      Cons_O& entry = (*table)[it];
+      if (!entry.ocar().no_keyp()&&!entry.ocar().deletedp()) {
         if (print) {
-            ss << "Entry["<<it<<"] at " << (void*)&entry << "   key: " << _rep_(entry.ocar()) << " value: " << (entry.cdr()) << "\n";
+          ss << ((table == &ht->_OldTable) ? "OldEntry[" : "Entry[") <<it<<"] at " << (void*)&entry << "   key: " << _rep_(entry.ocar()) << " value: " << (entry.cdr()) << "\n";
         }
-      keys->vectorPushExtend(entry.ocar());
+        keys->vectorPushExtend(entry.ocar());
+      }
     }
   }
   gctools::gctools__garbage_collect();
@@ -219,9 +223,11 @@ void HashTable_O::set_thread_safe(bool thread_safe)
 }
 #endif
 
+SYMBOL_EXPORT_SC_(KeywordPkg, lock_free);
+
 CL_LAMBDA(&key (test (function eql)) (size 0) (rehash-size 2.0) (rehash-threshold 0.7) weakness debug thread-safe);
 CL_DECLARE();
-CL_DOCSTRING("see CLHS");
+CL_DOCSTRING("see CLHS - THREAD-SAFE may be T, which locks every access, or :LOCK-FREE, where only writers take the lock and GETHASH never blocks");
 CL_DEFUN T_sp cl__make_hash_table(T_sp test, Fixnum_sp size, Number_sp rehash_size, Real_sp orehash_threshold, Symbol_sp weakness, T_sp debug, T_sp thread_safe) {
   SYMBOL_EXPORT_SC_(KeywordPkg, key);
   if (weakness.notnilp()) {
@@ -255,17 +261,30 @@ CL_DEFUN T_sp cl__make_hash_table(T_sp test, Fixnum_sp size, Number_sp rehash_si
     SIMPLE_ERROR(BF("Illegal test[%s] for make-hash-table") % _rep_(test));
   }
   if (thread_safe.notnilp()) {
-    table->setupThreadSafeHashTable();
+    table->setupThreadSafeHashTable(thread_safe == kw::_sym_lock_free);
   }
   return table;
 }
 
-void HashTable_O::setupThreadSafeHashTable() {
+void HashTable_O::setupThreadSafeHashTable(bool lockFreeReads) {
 #ifdef CLASP_THREADS
   SimpleBaseString_sp sbsread = SimpleBaseString_O::make("USRHSHR");
   SimpleBaseString_sp sbswrite = SimpleBaseString_O::make("USRHSHW");
   this->_Mutex = mp::SharedMutex_O::make_shared_mutex(sbsread,sbswrite);
+#ifndef USE_MPS
+  // Under MPS a lookup can find the table stale and has to rehash it, so readers must lock
+  this->_LockFreeReads = lockFreeReads;
 #endif
+#endif
+}
+
+/*! Replace the table with NEWTABLE, which must be completely filled in.
+    Lock free readers keep using whichever table they loaded, so NEWTABLE
+    must be visible in full before the pointer to it is - the pointer is
+    published with a store-release that pairs with the load-acquire in
+    gethash_lock_free. */
+void HashTable_O::installTable_no_lock(gctools::Vec0<Cons_O>& newTable) {
+  this->_Table.swap_release(newTable);
 }
 
 CL_LAMBDA(ht);
@@ -295,14 +314,24 @@ HashTable_sp HashTable_O::create_thread_safe(T_sp test, SimpleBaseString_sp read
   return ht;
 }
 
+/*! The table that HASH_TABLE_ITER walks.  A resize in progress is finished
+    first so that every entry is in _Table - an entry visited in _OldTable
+    could otherwise be migrated into _Table by the loop body and be visited
+    a second time. */
+gctools::tagged_pointer<gctools::GCVector_moveable<Cons_O>> HashTable_O::iterationContents_() const {
+  {
+    HT_READ_LOCK(this);
+    if (!this->resizeInProgressp()) return this->_Table._Vector._Contents;
+  }
+  HT_WRITE_LOCK(this);
+  const_cast<HashTable_O*>(this)->finishIncrementalRehash_no_lock();
+  return this->_Table._Vector._Contents;
+}
+
 // FIXME: contents read could just be atomic maybe?
 #define HASH_TABLE_ITER(tablep, key, value) \
-  gctools::tagged_pointer<gctools::GCVector_moveable<Cons_O>> iter_datap;\
-  {\
-    HT_READ_LOCK(tablep);\
-    iter_datap = tablep->_Table._Vector._Contents;\
-  }\
-  for (size_t it(0), itEnd(iter_datap->_End); it < itEnd; ++it) {\
+  gctools::tagged_pointer<gctools::GCVector_moveable<Cons_O>> iter_datap = tablep->iterationContents_();\
+  for (size_t it(0), itEnd(iter_datap ? iter_datap->_End : 0); it < itEnd; ++it) {\
   Cons_O& entry = (*iter_datap)[it];\
   T_sp key = entry.ocar();\
   T_sp value = entry.cdr();\
@@ -392,10 +421,17 @@ CL_DEFUN bool cl__remhash(T_sp key, HashTableBase_sp ht) {
 
 T_sp HashTable_O::clrhash() {
   ASSERT(!clasp_zerop(this->_RehashSize));
-  this->_HashTableCount = 0;
+  HT_WRITE_LOCK(this);
   T_sp no_key = _NoKey<T_O>();
-  this->_Table.resize(0,Cons_O(no_key,no_key));
-  this->setup(16, this->_RehashSize, this->_RehashThreshold);
+  gctools::Vec0<Cons_O> emptyTable;
+  emptyTable.resize(16,Cons_O(no_key,no_key));
+  this->installTable_no_lock(emptyTable);
+  this->resetMetadata_no_lock(16);
+  this->releaseOldTable_no_lock();
+  this->_HashTableCount = 0;
+#ifdef USE_MPS
+  mps_ld_reset(const_cast<mps_ld_t>(&(this->_LocationDependency)), global_arena);
+#endif
   VERIFY_HASH_TABLE(this);
   return this->asSmartPtr();
 }
@@ -591,7 +627,7 @@ bool HashTable_O::equalp(T_sp other) const {
 }
 
 List_sp HashTable_O::keysAsCons() {
-  HT_READ_LOCK(this);
+  // mapHash takes the lock itself - it may need the write lock to finish a resize
   List_sp res = _Nil<T_O>();
   this->mapHash([&res](T_sp key, T_sp val) {
                   res = Cons_O::create(key,res);
@@ -637,12 +673,90 @@ uint HashTable_O::resizeEmptyTable_no_lock(size_t sz) {
   T_sp no_key = _NoKey<T_O>();
   this->_HashTableCount = 0;
   this->_Table.resize(sz,Cons_O(no_key,no_key));
+  this->resetMetadata_no_lock(sz);
+  this->releaseOldTable_no_lock();
 #ifdef USE_MPS
   mps_ld_reset(const_cast<mps_ld_t>(&(this->_LocationDependency)), global_arena);
 #endif
   return sz;
 }
 
+/*! Tables with at least this many slots are resized incrementally */
+#define HT_INCREMENTAL_REHASH_SIZE 65536
+/*! The number of old slots moved into the new table each time a key is added */
+#define HT_MIGRATE_ENTRIES 64
+
+#define HT_META_EMPTY 0x00
+#define HT_META_DELETED 0x01
+#define HT_META_BYTES 0x0101010101010101ULL
+#define HT_META_HIGH_BITS 0x8080808080808080ULL
+
+/*! The metadata byte of a full slot - the top seven bits of the hash with the high bit set */
+static inline byte8_t hash_fingerprint(uint64_t hash) {
+  return 0x80 | (byte8_t)(hash >> 57);
+}
+
+/*! Set the high bit of every zero byte of word.  Bytes above a zero byte may
+    also be flagged but the lowest flagged byte is always a real zero byte. */
+static inline uint64_t zero_bytes(uint64_t word) {
+  return (word - HT_META_BYTES) & ~word & HT_META_HIGH_BITS;
+}
+
+void HashTable_O::resetMetadata_no_lock(size_t sz) {
+  this->_Metadata = SimpleVector_byte8_t_O::make(sz,HT_META_EMPTY,true);
+  this->_Hashes = SimpleVector_byte64_t_O::make(sz,0,true);
+}
+
+void HashTable_O::setSlotMetadata_no_lock(size_t slot, uint64_t hash) {
+  (*this->_Hashes)[slot] = hash;
+  (*this->_Metadata)[slot] = hash_fingerprint(hash);
+}
+
+/*! Search for KEY with the full hash HASH starting at slot INDEX.
+    Eight metadata bytes are compared at once and keyTest is only called
+    for slots whose fingerprint and full hash both match.
+    Return the entry or NULL if the key is not in the table. */
+Cons_O* HashTable_O::probeMetadata_no_lock(gctools::Vec0<Cons_O>& table, SimpleVector_byte8_t_sp metadata, SimpleVector_byte64_t_sp slotHashes, T_sp key, cl_index index, uint64_t hash) {
+  const byte8_t* meta = &(*metadata)[0];
+  const uint64_t* hashes = &(*slotHashes)[0];
+  byte8_t fingerprint = hash_fingerprint(hash);
+  uint64_t pattern = HT_META_BYTES * fingerprint;
+  size_t size = table.size();
+  size_t cur = index;
+  for (size_t probed = 0; probed < size; ) {
+    if (cur + 8 <= size) {
+      uint64_t group;
+      memcpy(&group,meta+cur,8);
+      uint64_t matches = zero_bytes(group^pattern);
+      uint64_t empties = zero_bytes(group);
+      if (empties) {
+        // Only slots before the first empty one can hold the key
+        matches &= (empties & (~empties+1)) - 1;
+      }
+      while (matches) {
+        size_t slot = cur + (__builtin_ctzll(matches)>>3);
+        Cons_O& entry = table[slot];
+        if (hashes[slot] == hash && this->keyTest(entry.ocar(), key)) return &entry;
+        matches &= matches - 1;
+      }
+      if (empties) return NULL;
+      cur += 8;
+      probed += 8;
+    } else {
+      byte8_t m = meta[cur];
+      if (m == HT_META_EMPTY) return NULL;
+      if (m == fingerprint && hashes[cur] == hash) {
+        Cons_O& entry = table[cur];
+        if (this->keyTest(entry.ocar(), key)) return &entry;
+      }
+      ++cur;
+      ++probed;
+    }
+    if (cur == size) cur = 0;
+  }
+  return NULL;
+}
+
 CL_LAMBDA(arg);
 CL_DECLARE();
 CL_DOCSTRING("hash-table-count");
@@ -658,9 +772,11 @@ size_t HashTable_O::hashTableCount() const {
 uint HashTable_O::calculateHashTableCount() const {
   HT_READ_LOCK(this);
   uint cnt = 0;
-  for (size_t it(0), itEnd(this->_Table.size()); it < itEnd; ++it) {
-    const Cons_O& entry = this->_Table[it];
-    if (!entry.ocar().no_keyp()&&!entry.ocar().deletedp()) ++cnt;
+  for (const gc::Vec0<Cons_O>* table : { &this->_OldTable, &this->_Table }) {
+    for (size_t it(0), itEnd(table->size()); it < itEnd; ++it) {
+      const Cons_O& entry = (*table)[it];
+      if (!entry.ocar().no_keyp()&&!entry.ocar().deletedp()) ++cnt;
+    }
   }
   return cnt;
 }
@@ -700,6 +816,15 @@ CL_DEFUN T_mv core__gethash3(T_sp key, T_sp hashTable, T_sp default_value) {
 List_sp HashTable_O::tableRef_no_read_lock(T_sp key, bool under_write_lock, cl_index index, HashGenerator& hg) {
     DEBUG_HASH_TABLE({core::write_bf_stream(BF("%s:%d key = %s  index = %ld\n") % __FILE__ % __LINE__ % _rep_(key) % index , T_sp());});
   VERIFY_HASH_TABLE(this);
+  if (this->metadatap()) {
+    uint64_t hash = hg.rawhash();
+    Cons_O* entryP = this->probeMetadata_no_lock(this->_Table, this->_Metadata, this->_Hashes, key, index, hash);
+    if (!entryP && this->resizeInProgressp()) {
+      entryP = this->probeMetadata_no_lock(this->_OldTable, this->_OldMetadata, this->_OldHashes, key, hash % this->_OldTable.size(), hash);
+    }
+    if (entryP) return gc::smart_ptr<Cons_O>(entryP);
+    goto NOT_FOUND;
+  }
   for (size_t cur = index, curEnd(this->_Table.size()); cur<curEnd; ++cur ) {
     Cons_O& entry = this->_Table[cur];
     if (entry.ocar().no_keyp()) goto NOT_FOUND;
@@ -752,8 +877,33 @@ CL_DEFUN void core__hash_table_force_rehash(HashTable_sp ht) {
   ht->rehash_no_lock(false, _NoKey<T_O>());
 }
 
+/*! Lookup without the read lock.  Writers store an entry's value before its key
+    and only ever publish a complete table, so a reader sees either the old or the
+    new state of every entry.  A deleted slot can be reused for another key while
+    we look at it, so the key is checked again after the value has been loaded. */
+T_mv HashTable_O::gethash_lock_free(T_sp key, T_sp default_value) {
+ RETRY:
+  auto table = this->_Table.contents_acquire();
+  if (!table) return Values(default_value, _Nil<T_O>());
+  size_t size = table->_End;
+  HashGenerator hg;
+  cl_index index = this->sxhashKey(key, size, hg);
+  for (size_t probe = 0; probe < size; ++probe) {
+    Cons_O& entry = table->_Data[(index + probe < size) ? index + probe : index + probe - size];
+    T_sp entryKey = entry._Car.load(std::memory_order_acquire);
+    if (entryKey.no_keyp()) break;
+    if (entryKey.deletedp() || !this->keyTest(entryKey, key)) continue;
+    T_sp value = entry._Cdr.load(std::memory_order_acquire);
+    if (entry._Car.load(std::memory_order_acquire).raw_() != entryKey.raw_()) goto RETRY;
+    if (value.no_keyp()) break;
+    return Values(value, _lisp->_true());
+  }
+  return Values(default_value, _Nil<T_O>());
+}
+
 T_mv HashTable_O::gethash(T_sp key, T_sp default_value) {
   LOG(BF("gethash looking for key[%s]") % _rep_(key));
+  if (this->_LockFreeReads) return this->gethash_lock_free(key, default_value);
   HT_READ_LOCK(this);
   VERIFY_HASH_TABLE(this);
   HashGenerator hg;
@@ -802,7 +952,15 @@ bool HashTable_O::remhash(T_sp key) {
   List_sp keyValuePair = this->tableRef_no_read_lock( key, true /*under_write_lock*/, index, hg );
   if (keyValuePair.consp()) {
     Cons_sp pair = gc::As_unsafe<Cons_sp>(keyValuePair);
-    pair->rplaca(_Deleted<T_O>());
+    pair->_Car.store(_Deleted<T_O>(), std::memory_order_release);
+    if (this->metadatap()) {
+      Cons_O* entryP = &*pair;
+      if (this->resizeInProgressp() && &this->_OldTable[0] <= entryP && entryP < &this->_OldTable[0] + this->_OldTable.size()) {
+        (*this->_OldMetadata)[entryP - &this->_OldTable[0]] = HT_META_DELETED;
+      } else {
+        (*this->_Metadata)[entryP - &this->_Table[0]] = HT_META_DELETED;
+      }
+    }
     this->_HashTableCount--;
     VERIFY_HASH_TABLE(this);
     return true;
@@ -823,7 +981,7 @@ T_sp HashTable_O::setf_gethash_no_write_lock(T_sp key, T_sp value)
   if (keyValuePair.consp()) {
     Cons_sp pair = gc::As_unsafe<Cons_sp>(keyValuePair);
     // rewrite value
-    pair->rplacd(value);
+    pair->_Cdr.store(value, std::memory_order_release);
     DEBUG_HASH_TABLE({core::write_bf_stream(BF("%s:%d Found key/value pair: %s\n") % __FILE__ % __LINE__ % _rep_(keyValuePair), T_sp());});
     DEBUG_HASH_TABLE({core::write_bf_stream(BF("%s:%d  Did rplacd value: %s to cons at %p\n") % __FILE__ % __LINE__ % _rep_(value) % &*pair, T_sp());});
     DEBUG_HASH_TABLE({core::write_bf_stream(BF("%s:%d  After rplacd value: %s\n") % __FILE__ % __LINE__ % _rep_(pair->cdr()), T_sp());});
@@ -839,6 +997,7 @@ T_sp HashTable_O::setf_gethash_no_write_lock(T_sp key, T_sp value)
   hg.addAddressesToLocationDependency(&this->_LocationDependency);
 #endif
   DEBUG_HASH_TABLE({core::write_bf_stream(BF("%s:%d Looking for empty slot index = %ld\n")  % __FILE__ % __LINE__ % index, T_sp());});
+  if (this->resizeInProgressp()) this->migrateEntries_no_lock(HT_MIGRATE_ENTRIES);
   Cons_O* entryP = nullptr;
   entryP = &this->_Table[index];
   size_t cur;
@@ -852,13 +1011,22 @@ T_sp HashTable_O::setf_gethash_no_write_lock(T_sp key, T_sp value)
   }
   goto NO_ROOM;
  ADD_KEY_VALUE:
-  entryP->rplaca(key);
-  entryP->rplacd(value);
+  // The value goes in first so that a lock free reader never sees the key without it
+  entryP->_Cdr.store(value, std::memory_order_release);
+  entryP->_Car.store(key, std::memory_order_release);
+  if (this->metadatap()) this->setSlotMetadata_no_lock(cur, hg.rawhash());
   this->_HashTableCount++;
   DEBUG_HASH_TABLE({core::write_bf_stream(BF("%s:%d Found empty slot at index = %ld\n")  % __FILE__ % __LINE__ % cur , T_sp());});
   VERIFY_HASH_TABLE_VA(this,cur,key);
   if (this->_HashTableCount > this->_RehashThreshold * this->_Table.size()) {
     LOG(BF("Expanding hash table"));
+#ifndef USE_MPS
+    if (!this->resizeInProgressp() && !this->_LockFreeReads && this->metadatap()
+        && this->_Table.size() >= HT_INCREMENTAL_REHASH_SIZE) {
+      this->startIncrementalRehash_no_lock();
+      return value;
+    }
+#endif
     this->rehash_no_lock(true, _NoKey<T_O>());
     VERIFY_HASH_TABLE(this);
   }
@@ -898,24 +1066,30 @@ List_sp HashTable_O::rehash_no_lock(bool expandTable, T_sp findKey) {
   DEBUG_HASH_TABLE({core::write_bf_stream(BF("%s:%d rehash_no_lock\n") % __FILE__ % __LINE__ , T_sp());});
   ASSERTF(!clasp_zerop(this->_RehashSize), BF("RehashSize is zero - it shouldn't be"));
   ASSERTF(this->_Table.size() != 0, BF("HashTable is empty in expandHashTable - this shouldn't be"));
+  this->finishIncrementalRehash_no_lock();
   List_sp foundKeyValuePair(_Nil<T_O>());
   LOG(BF("At start of expandHashTable current hash table size: %d") % this->_Table.size());
-  gc::Fixnum curSize = this->_Table.size();
-  gc::Fixnum newSize = 0;
-  if (expandTable) {
-    if (cl__integerp(this->_RehashSize)) {
-      newSize = curSize + clasp_to_int(gc::As<Integer_sp>(this->_RehashSize));
-    } else if (cl__floatp(this->_RehashSize)) {
-      newSize = curSize * clasp_to_double(this->_RehashSize);
-    }
-  } else {
-    newSize = curSize;
-  }
-  gc::Vec0<Cons_O> oldTable;
-  oldTable.swap(this->_Table);
+  gc::Fixnum newSize = expandTable ? this->expandedSize_no_lock() : this->_Table.size();
+  // Build the new table off to the side so that lock free readers never see it half full
+  if (newSize < 16) newSize = 16;
+  T_sp no_key = _NoKey<T_O>();
+  gc::Vec0<Cons_O> newTable;
+  newTable.resize(newSize,Cons_O(no_key,no_key));
+#ifdef USE_MPS
+  mps_ld_reset(const_cast<mps_ld_t>(&(this->_LocationDependency)), global_arena);
+#endif
   size_t oldHashTableCount = this->_HashTableCount;
-  newSize = this->resizeEmptyTable_no_lock(newSize);
+  size_t newHashTableCount = 0;
   LOG(BF("Resizing table to size: %d") % newSize);
+#ifdef USE_MPS
+  // Hashes of addresses are stale after objects move so they must all be recalculated
+  bool reuseHashes = false;
+#else
+  bool reuseHashes = this->metadatap();
+#endif
+  SimpleVector_byte64_t_sp oldHashes = this->_Hashes;
+  this->resetMetadata_no_lock(newSize);
+  gc::Vec0<Cons_O>& oldTable = this->_Table;
   size_t oldSize = oldTable.size();
   for (size_t it(0), itEnd(oldSize); it < itEnd; ++it) {
     Cons_O& entry = oldTable[it];
@@ -936,9 +1110,30 @@ List_sp HashTable_O::rehash_no_lock(bool expandTable, T_sp findKey) {
           foundKeyValuePair = gc::smart_ptr<Cons_O>((Cons_O*)&entry);
         }
       }
-      this->setf_gethash_no_write_lock(key,value);
+      // The keys are all distinct so take the first free slot without searching for the key
+      uint64_t hash;
+      if (reuseHashes) {
+        hash = (*oldHashes)[it];
+      } else {
+        HashGenerator hg;
+        this->sxhashKey(key, newSize, hg);
+#ifdef USE_MPS
+        hg.addAddressesToLocationDependency(&this->_LocationDependency);
+#endif
+        hash = hg.rawhash();
+      }
+      cl_index index = hash % newSize;
+      while (!newTable[index].ocar().no_keyp()) {
+        if (++index == (cl_index)newSize) index = 0;
+      }
+      newTable[index].setCdr(value);
+      newTable[index].setCar(key);
+      this->setSlotMetadata_no_lock(index, hash);
+      ++newHashTableCount;
     }
   }
+  this->installTable_no_lock(newTable);
+  this->_HashTableCount = newHashTableCount;
 #ifdef DEBUG_REHASH_COUNT
   this->_RehashCount++;
   MONITOR(BF("Hash-table rehash id %lu initial-size %lu rehash-number %lu rehash-size %lu oldHashTableCount %lu _HashTableCount %lu\n")
@@ -970,21 +1165,95 @@ List_sp HashTable_O::rehash_no_lock(bool expandTable, T_sp findKey) {
   return foundKeyValuePair;
 }
 
+gc::Fixnum HashTable_O::expandedSize_no_lock() const {
+  gc::Fixnum curSize = this->_Table.size();
+  gc::Fixnum newSize = curSize;
+  if (cl__integerp(this->_RehashSize)) {
+    newSize = curSize + clasp_to_int(gc::As<Integer_sp>(this->_RehashSize));
+  } else if (cl__floatp(this->_RehashSize)) {
+    newSize = curSize * clasp_to_double(this->_RehashSize);
+  }
+  return newSize;
+}
+
+/*! Resize a large table without stopping to move every entry.
+    The current table becomes _OldTable and every new key that is added
+    moves the next HT_MIGRATE_ENTRIES slots of it into the new table.
+    Lookups search the new table and then the old one until it is empty. */
+void HashTable_O::startIncrementalRehash_no_lock() {
+  gc::Fixnum newSize = this->expandedSize_no_lock();
+  T_sp no_key = _NoKey<T_O>();
+  gc::Vec0<Cons_O> newTable;
+  newTable.resize(newSize,Cons_O(no_key,no_key));
+  this->_OldTable.swap(this->_Table);
+  this->_Table.swap_release(newTable);
+  this->_OldMetadata = this->_Metadata;
+  this->_OldHashes = this->_Hashes;
+  this->resetMetadata_no_lock(newSize);
+  this->_MigrateIndex = 0;
+#ifdef DEBUG_REHASH_COUNT
+  this->_RehashCount++;
+#endif
+}
+
+void HashTable_O::migrateEntries_no_lock(size_t num) {
+  gc::Vec0<Cons_O>& oldTable = this->_OldTable;
+  size_t oldSize = oldTable.size();
+  size_t newSize = this->_Table.size();
+  size_t end = std::min(this->_MigrateIndex + num, oldSize);
+  for (size_t it(this->_MigrateIndex); it < end; ++it) {
+    Cons_O& entry = oldTable[it];
+    T_sp key = entry.ocar();
+    if (key.no_keyp()||key.deletedp()) continue;
+    uint64_t hash = (*this->_OldHashes)[it];
+    cl_index index = hash % newSize;
+    while (!(this->_Table[index].ocar().no_keyp()||this->_Table[index].ocar().deletedp())) {
+      if (++index == newSize) index = 0;
+    }
+    this->_Table[index].setCdr(entry.cdr());
+    this->_Table[index].setCar(key);
+    this->setSlotMetadata_no_lock(index, hash);
+    entry.setCar(_Deleted<T_O>());
+    (*this->_OldMetadata)[it] = HT_META_DELETED;
+  }
+  this->_MigrateIndex = end;
+  if (end == oldSize) this->releaseOldTable_no_lock();
+}
+
+void HashTable_O::finishIncrementalRehash_no_lock() {
+  if (this->resizeInProgressp()) {
+    this->migrateEntries_no_lock(this->_OldTable.size());
+  }
+}
+
+void HashTable_O::releaseOldTable_no_lock() {
+  gc::Vec0<Cons_O> empty;
+  this->_OldTable.swap(empty);
+  this->_OldMetadata.reset_();
+  this->_OldHashes.reset_();
+  this->_MigrateIndex = 0;
+}
+
+CL_LAMBDA(hash-table);
+CL_DECLARE();
+CL_DOCSTRING("Return true if HASH-TABLE is being resized incrementally and still has entries in its old table");
+CL_DEFUN bool core__hash_table_resize_in_progress_p(HashTableBase_sp hash_table) {
+  if (HashTable_sp ht = hash_table.asOrNull<HashTable_O>()) {
+    HT_READ_LOCK(&*ht);
+    return ht->resizeInProgressp();
+  }
+  return false;
+}
+
 List_sp HashTable_O::rehash_upgrade_write_lock(bool expandTable, T_sp findKey) {
   if (this->_Mutex) {
-  tryAgain:
-    if (this->_Mutex->write_try_lock(true /*upgrade*/)) {
-      List_sp result = this->rehash_no_lock(expandTable,findKey);
-        // Releasing the read lock will be done by the caller using RAII
-      this->_Mutex->write_unlock( false /*releaseReadLock*/);
-      return result;
-    }
-#ifdef _TARGET_OS_DARWIN
-    pthread_yield_np();
-#else
-    pthread_yield();
-#endif
-    goto tryAgain;
+    // The upgrade gives up the read lock while it waits, so another thread may
+    // have rehashed in the meantime - rehash_no_lock looks findKey up afresh.
+    this->_Mutex->write_lock(true /*upgrade*/);
+    List_sp result = this->rehash_no_lock(expandTable,findKey);
+    // Downgrade - releasing the read lock will be done by the caller using RAII
+    this->_Mutex->write_unlock( false /*releaseReadLock*/);
+    return result;
   } else {
     return this->rehash_no_lock(expandTable,findKey);
   }
@@ -1040,23 +1309,26 @@ CL_DEFMETHOD List_sp HashTable_O::hash_table_bucket(size_t index)
 CL_DEFMETHOD T_sp HashTable_O::hash_table_average_search_length()
 {
   HT_READ_LOCK(this);
-  gc::Fixnum iend(this->_Table.size());
   double sum = 0.0;
   gc::Fixnum count = 0;
-  for (gc::Fixnum it(0), itEnd(iend); it < itEnd; ++it) {
-    const Cons_O& entry = this->_Table[it];
-    if (!(entry.ocar().no_keyp()||entry.ocar().deletedp())) {
-      HashGenerator hg;
-      gc::Fixnum index = this->sxhashKey(entry.ocar(), this->_Table.size(), hg );
-      gc::Fixnum delta;
-      if (index > it) {
-        delta = (it+iend)-index;
-      } else {
-        delta = (it-index);
+  // Entries still waiting to be migrated are measured against the old table
+  for (const gc::Vec0<Cons_O>* table : { &this->_OldTable, &this->_Table }) {
+    gc::Fixnum iend(table->size());
+    for (gc::Fixnum it(0), itEnd(iend); it < itEnd; ++it) {
+      const Cons_O& entry = (*table)[it];
+      if (!(entry.ocar().no_keyp()||entry.ocar().deletedp())) {
+        HashGenerator hg;
+        gc::Fixnum index = this->sxhashKey(entry.ocar(), iend, hg );
+        gc::Fixnum delta;
+        if (index > it) {
+          delta = (it+iend)-index;
+        } else {
+          delta = (it-index);
+        }
+//        printf("%s:%d  index = %lld  it = %lld  delta=%lld\n", __FILE__, __LINE__, index, it, delta );
+        sum = sum + delta;
+        count++;
       }
-//      printf("%s:%d  index = %lld  it = %lld  delta=%lld\n", __FILE__, __LINE__, index, it, delta );
-      sum = sum + delta;
-      count++;
     }
   }
   if (count>0) {
@@ -985,12 +985,22 @@ Package_sp Lisp_O::makePackage(const string &name, list<string> const &nicknames
   while (true) {
     string usedNickName;
     string packageUsingNickName;
+    string missingUsePackage;
     {
       WITH_READ_WRITE_LOCK(this->_Roots._PackagesMutex);
       map<string, int>::iterator it = this->_Roots._PackageNameIndexMap.find(name);
       if (it != this->_Roots._PackageNameIndexMap.end()) {
         goto name_exists;
       }
+      gctools::Vec0<Package_sp> usePkgs;
+      for (list<string>::const_iterator jit = usePackages.begin(); jit != usePackages.end(); jit++) {
+        T_sp usePkg = this->findPackage_no_lock(*jit, false);
+        if (usePkg.nilp()) {
+          missingUsePackage = *jit;
+          goto use_package_missing;
+        }
+        usePkgs.push_back(gc::As<Package_sp>(usePkg));
+      }
       LOG(BF("Creating package with name[%s]") % name);
       Package_sp newPackage = Package_O::create(name);
       int packageIndex = this->_Roots._Packages.size();
@@ -1019,8 +1029,7 @@ Package_sp Lisp_O::makePackage(const string &name, list<string> const &nicknames
 //        printf("%s:%d in makePackage  for package %s  shadow: %s\n", __FILE__,__LINE__, newPackage->getName().c_str(),sx->get_std_string().c_str());
         newPackage->shadow(sx);
       }
-      for (list<string>::const_iterator jit = usePackages.begin(); jit != usePackages.end(); jit++) {
-        Package_sp usePkg = gc::As<Package_sp>(this->findPackage_no_lock(*jit, true));
+      for (auto usePkg : usePkgs) {
         LOG(BF("Using package[%s]") % usePkg->getName());
         newPackage->usePackage(usePkg);
       }
@@ -1041,6 +1050,9 @@ Package_sp Lisp_O::makePackage(const string &name, list<string> const &nicknames
   nickname_exists:
     SIMPLE_PACKAGE_ERROR_2_args("Package nickname[~a] is already being used by package[~a]" , usedNickName , packageUsingNickName);
     continue;
+  use_package_missing:
+    PACKAGE_ERROR(SimpleBaseString_O::make(missingUsePackage));
+    continue;
   }
 }
 
@@ -1067,20 +1079,31 @@ T_sp Lisp_O::findPackage_no_lock(const string &name, bool errorp) const {
 }
 
 T_sp Lisp_O::findPackage(const string &name, bool errorp) const {
-  WITH_READ_LOCK(this->_Roots._PackagesMutex);
-  return this->findPackage_no_lock(name,errorp);
+  T_sp pkg;
+  {
+    WITH_READ_LOCK(this->_Roots._PackagesMutex);
+    pkg = this->findPackage_no_lock(name,false);
+  }
+  // Signal outside the lock - the error system finds packages too
+  if (pkg.nilp() && errorp) {
+    PACKAGE_ERROR(SimpleBaseString_O::make(name));
+  }
+  return pkg;
 }
 
 
 void Lisp_O::remove_package(const string& name ) {
-  WITH_READ_WRITE_LOCK(this->_Roots._PackagesMutex);
-  //        printf("%s:%d Lisp_O::findPackage name: %s\n", __FILE__, __LINE__, name.c_str());
-  map<string, int>::const_iterator fi = this->_Roots._PackageNameIndexMap.find(name);
-  if (fi == this->_Roots._PackageNameIndexMap.end()) {
-    PACKAGE_ERROR(SimpleBaseString_O::make(name));
+  {
+    WITH_READ_WRITE_LOCK(this->_Roots._PackagesMutex);
+    //        printf("%s:%d Lisp_O::findPackage name: %s\n", __FILE__, __LINE__, name.c_str());
+    map<string, int>::const_iterator fi = this->_Roots._PackageNameIndexMap.find(name);
+    if (fi != this->_Roots._PackageNameIndexMap.end()) {
+      this->_Roots._Packages[fi->second]->setZombieP(true);
+      this->_Roots._PackageNameIndexMap.erase(fi);
+      return;
+    }
   }
-  this->_Roots._PackageNameIndexMap.erase(name);
-  this->_Roots._Packages[fi->second]->setZombieP(true);
+  PACKAGE_ERROR(SimpleBaseString_O::make(name));
 }
 
 bool Lisp_O::recognizesPackage(const string &packageName) const {
@@ -1102,12 +1125,16 @@ List_sp Lisp_O::allPackagesAsCons() const {
 }
 
 void Lisp_O::inPackage(const string &p) {
-  WITH_READ_LOCK(this->_Roots._PackagesMutex);
-  map<string, int>::const_iterator pi = this->_Roots._PackageNameIndexMap.find(p);
-  if (pi == this->_Roots._PackageNameIndexMap.end()) {
+  T_sp pkg = _Nil<T_O>();
+  {
+    WITH_READ_LOCK(this->_Roots._PackagesMutex);
+    map<string, int>::const_iterator pi = this->_Roots._PackageNameIndexMap.find(p);
+    if (pi != this->_Roots._PackageNameIndexMap.end()) pkg = this->_Roots._Packages[pi->second];
+  }
+  if (pkg.nilp()) {
     SIMPLE_ERROR(BF("I do not recognize package: %s") % p );
   }
-  this->selectPackage(this->_Roots._Packages[pi->second]);
+  this->selectPackage(gc::As_unsafe<Package_sp>(pkg));
 }
 
 Package_sp Lisp_O::getCurrentPackage() const {
@@ -2182,8 +2209,11 @@ CL_LAMBDA(gf-symbol &optional errorp);
 CL_DOCSTRING("Lookup a single dispatch generic function. If errorp is true and the generic function isn't found throw an exception - otherwise return _Unbound<SingleDispatchGenericFunctionClosure_O>()");
 CL_LISPIFY_NAME(find_single_dispatch_generic_function);
 CL_DEFUN SingleDispatchGenericFunctionClosure_sp Lisp_O::find_single_dispatch_generic_function(T_sp gfName, bool errorp) {
-  WITH_READ_LOCK(_lisp->_Roots._SingleDispatchGenericFunctionHashTableEqualMutex);
-  T_sp tfn = _lisp->_Roots._SingleDispatchGenericFunctionHashTableEqual->gethash(gfName, _Nil<T_O>());
+  T_sp tfn;
+  {
+    WITH_READ_LOCK(_lisp->_Roots._SingleDispatchGenericFunctionHashTableEqualMutex);
+    tfn = _lisp->_Roots._SingleDispatchGenericFunctionHashTableEqual->gethash(gfName, _Nil<T_O>());
+  }
   if (tfn.nilp()) {
     if (errorp) {
       SIMPLE_ERROR(BF("No single-dispatch-generic-function named %s") % _rep_(gfName));
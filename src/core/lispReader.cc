@@ -52,7 +52,9 @@ THE SOFTWARE.
 #include <clasp/core/cons.h>
 //#include "lisp_ParserExtern.h"
 #include <clasp/core/lispReader.h>
+#include <clasp/core/string_to_float.h>
 #include <clasp/core/readtable.h>
+#include <clasp/core/designators.h>
 #include <clasp/core/wrappers.h>
 
 
@@ -70,12 +72,8 @@ namespace core {
 typedef Fixnum trait_chr_type;
 
 struct Token {
-  SourcePosInfo_sp sourcePosInfo;
   vector<trait_chr_type>  chars;
   void clear() { this->chars.clear();};
-  void recordSourcePos(SourcePosInfo_sp sp) {
-    this->sourcePosInfo = sp;
-  }
   trait_chr_type* data() { return this->chars.data();};
   void push_back(trait_chr_type c) { this->chars.push_back(c); };
   size_t size() const { return this->chars.size(); };
@@ -83,6 +81,29 @@ struct Token {
   trait_chr_type& operator[](int i) { return this->chars[i]; };
   const trait_chr_type& operator[](int i) const { return this->chars[i]; };
 };
+
+/*! Tokens keep their storage between reads. Each thread has one per
+    level of reader nesting - a stream's read-char may itself call READ. */
+struct TokenPool {
+  vector<Token*> _Tokens;
+  size_t _Depth = 0;
+  ~TokenPool() { for ( auto token : this->_Tokens ) delete token; };
+};
+
+thread_local TokenPool reader_token_pool;
+
+struct PooledToken {
+  Token& _Token;
+  PooledToken() : _Token(acquire()) {};
+  ~PooledToken() { --reader_token_pool._Depth; };
+  static Token& acquire() {
+    TokenPool& pool = reader_token_pool;
+    if (pool._Depth == pool._Tokens.size()) pool._Tokens.push_back(new Token());
+    Token& token = *pool._Tokens[pool._Depth++];
+    token.clear();
+    return token;
+  }
+};
   
 #define TRAIT_DIGIT          0x000100000000
 #define TRAIT_ALPHABETIC     0x000200000000
@@ -127,13 +148,16 @@ SYMBOL_EXPORT_SC_(ClPkg, STARread_suppressSTAR);
 
 /*! Return a uint that combines the character x with its character TRAITs
       See CLHS 2.1.4.2 */
-trait_chr_type constituentChar(Character_sp ch, trait_chr_type trait = 0) {
-  claspCharacter x = ch.unsafe_character();
-  ASSERT(x<CHAR_MASK);
-  if (trait != 0) return (x | trait);
-  trait_chr_type result = 0;
+trait_chr_type current_read_base() {
   trait_chr_type read_base = unbox_fixnum(gc::As<Fixnum_sp>(cl::_sym_STARread_baseSTAR->symbolValue()));
   ASSERT(read_base>=2 && read_base<=36);
+  return read_base;
+}
+
+/*! Like constituentChar, with *read-base* looked up once by the caller */
+trait_chr_type constituent_traits(claspCharacter x, trait_chr_type read_base) {
+  ASSERT(x<CHAR_MASK);
+  trait_chr_type result = 0;
   if (x >= '0' && x <= '9') {
     trait_chr_type uix = x - '0';
     if (uix < read_base) {
@@ -186,12 +210,13 @@ LETTER:
   return result;
 }
 
-T_sp constituentCharAsFixnum(Character_sp ch, trait_chr_type trait = 0 ) {
-  trait_chr_type ct = constituentChar(ch,trait);
-  return core::make_fixnum((Fixnum)ct);
+trait_chr_type constituentChar(Character_sp ch, trait_chr_type trait = 0) {
+  claspCharacter x = ch.unsafe_character();
+  ASSERT(x<CHAR_MASK);
+  if (trait != 0) return (x | trait);
+  return constituent_traits(x,current_read_base());
 }
 
-
 // -----------------------------------------------------------
 //
 // Read symbols for reader macros #: and #\
@@ -214,49 +239,73 @@ void unread_ch(T_sp sin, Character_sp c) {
   clasp_unread_char(clasp_as_claspCharacter(c), sin);
 }
 
-/*! See SACLA reader.lisp::collect-escaped-lexemes */
-List_sp collect_escaped_lexemes(Character_sp c, T_sp sin) {
-  T_sp readTable = _lisp->getCurrentReadTable();
-  Symbol_sp syntax_type = core__syntax_type(readTable,c);
-  if (syntax_type == kw::_sym_invalid) {
-    SIMPLE_ERROR(BF("invalid-character-error: %s") % _rep_(c));
-  } else if (syntax_type == kw::_sym_multiple_escape) {
-    return _Nil<T_O>();
-  } else if (syntax_type == kw::_sym_single_escape) {
-    return Cons_O::create(constituentCharAsFixnum(read_ch_or_die(sin),TRAIT_ESCAPED),
-                          collect_escaped_lexemes(read_ch_or_die(sin), sin));
-  } else if (syntax_type == kw::_sym_constituent || syntax_type == kw::_sym_whitespace || syntax_type == kw::_sym_terminating_macro || syntax_type == kw::_sym_non_terminating_macro) {
-    return Cons_O::create(constituentCharAsFixnum(c,TRAIT_ESCAPED), collect_escaped_lexemes(read_ch_or_die(sin), sin));
+/*! See SACLA reader.lisp::collect-escaped-lexemes.
+    Accumulate the characters up to the closing multiple escape. */
+void collect_escaped_lexemes(T_sp readTable, T_sp sin, Token& token) {
+  while (1) {
+    Character_sp c = read_ch_or_die(sin);
+    switch (reader_syntax(readTable,c)) {
+    case syntax_invalid:
+        SIMPLE_ERROR(BF("invalid-character-error: %s") % _rep_(c));
+    case syntax_multiple_escape:
+        return;
+    case syntax_single_escape:
+        token.push_back(constituentChar(read_ch_or_die(sin),TRAIT_ALPHABETIC|TRAIT_ESCAPED));
+        break;
+    default:
+        token.push_back(constituentChar(c,TRAIT_ALPHABETIC|TRAIT_ESCAPED));
+        break;
+    }
+  }
+}
+
+/*! Take the constituent characters that follow straight out of a buffered
+    file stream's buffer, rather than reading them one at a time. Stops at
+    the first character that needs the general path. */
+void collect_constituent_run(T_sp readTable, T_sp sin, Token& token) {
+  Readtable_sp rt = readTable.asOrNull<Readtable_O>();
+  if (!rt) return;
+  const unsigned char* run;
+  cl_index n = clasp_input_unibyte_peek(sin, &run, ~(cl_index)0);
+  cl_index i = 0;
+  for ( ; i<n; ++i ) {
+    ReaderSyntax syntax = rt->syntax_class_(run[i]);
+    if (syntax != syntax_constituent && syntax != syntax_non_terminating_macro) break;
+    token.push_back(run[i]|TRAIT_ALPHABETIC);
   }
-  return _Nil<T_O>();
+  clasp_input_unibyte_advance(sin, run, i);
 }
 
 /*! See SACLA reader.lisp::collect-lexemes.
-    Set extended to true if a non base-char is seen.*/
-List_sp collect_lexemes(/*Character_sp*/ T_sp tc, T_sp sin) {
-  if (tc.notnilp()) {
+    Accumulate the rest of the token that starts with tc. */
+void collect_lexemes(/*Character_sp*/ T_sp tc, T_sp sin, Token& token) {
+  T_sp readTable = _lisp->getCurrentReadTable();
+  for ( ; tc.notnilp(); tc = read_ch(sin) ) {
     Character_sp c = gc::As<Character_sp>(tc);
-    T_sp readTable = _lisp->getCurrentReadTable();
-    Symbol_sp syntax_type = core__syntax_type(readTable,c);
-    if (syntax_type == kw::_sym_invalid) {
-      SIMPLE_ERROR(BF("invalid-character-error: %s") % _rep_(c));
-    } else if (syntax_type == kw::_sym_whitespace) {
-      if (_sym_STARpreserve_whitespace_pSTAR->symbolValue().isTrue()) {
+    switch (reader_syntax(readTable,c)) {
+    case syntax_invalid:
+        SIMPLE_ERROR(BF("invalid-character-error: %s") % _rep_(c));
+    case syntax_whitespace:
+        if (_sym_STARpreserve_whitespace_pSTAR->symbolValue().isTrue()) {
+          unread_ch(sin, c);
+        }
+        return;
+    case syntax_terminating_macro:
         unread_ch(sin, c);
-      }
-    } else if (syntax_type == kw::_sym_terminating_macro) {
-      unread_ch(sin, c);
-    } else if (syntax_type == kw::_sym_multiple_escape) {
-      return Cons_O::create(collect_escaped_lexemes(read_ch_or_die(sin), sin),
-                            collect_lexemes(read_ch(sin), sin));
-    } else if (syntax_type == kw::_sym_single_escape) {
-      return Cons_O::create(Cons_O::create(constituentCharAsFixnum(read_ch_or_die(sin)),_Nil<T_O>()),
-                            collect_lexemes(read_ch(sin), sin));
-    } else if (syntax_type == kw::_sym_constituent || syntax_type == kw::_sym_non_terminating_macro) {
-      return Cons_O::create(constituentCharAsFixnum(c), collect_lexemes(read_ch(sin), sin));
+        return;
+    case syntax_multiple_escape:
+        collect_escaped_lexemes(readTable,sin,token);
+        break;
+    case syntax_single_escape:
+        token.push_back(constituentChar(read_ch_or_die(sin),TRAIT_ALPHABETIC|TRAIT_ESCAPED));
+        break;
+    case syntax_constituent:
+    case syntax_non_terminating_macro:
+        token.push_back(constituentChar(c,TRAIT_ALPHABETIC));
+        collect_constituent_run(readTable,sin,token);
+        break;
     }
   }
-  return _Nil<T_O>();
 }
 
 
@@ -286,106 +335,6 @@ UnEscapedCase case_state(Fixnum c, UnEscapedCase curCase) {
 }
 
 
-UnEscapedCase check_case(List_sp cur_char, UnEscapedCase curCase) {
-  while (cur_char.notnilp()) {
-    T_sp obj = oCar(cur_char);
-    if (obj.consp()) {
-      return check_case(obj,curCase);
-    } else if (obj.fixnump()) {
-      curCase = case_state(obj.unsafe_fixnum(),curCase);
-    } else if (obj.nilp()) {
-      return curCase;
-    }
-    cur_char = oCdr(cur_char);
-  }
-  return curCase;
-}
-
-
-Character_sp lexeme_character(T_sp lexeme) {
-  if (lexeme.fixnump()) {
-    return core::clasp_make_character(CHR(lexeme));
-  }
-  SIMPLE_ERROR(BF("Unknown lexeme %s") % _rep_(lexeme));
-}
-
-void make_str_upcase(StrNs_sp sout, List_sp cur_char) {
-  while (cur_char.notnilp()) {
-    T_sp obj = oCar(cur_char);
-    if (obj.consp()) {
-      make_str_upcase(sout, obj);
-    } else if (obj.fixnump()) {
-      if (obj.unsafe_fixnum()&TRAIT_ESCAPED)
-        sout->vectorPushExtend(core::clasp_make_character(CHR(obj.unsafe_fixnum())));
-      else sout->vectorPushExtend(core::clasp_make_character(toupper(CHR(obj.unsafe_fixnum()))));
-    } else if (obj.nilp()) {
-      // Handling name ||   do nothing
-    }
-    cur_char = oCdr(cur_char);
-  }
-}
-
-void make_str_downcase(StrNs_sp sout, List_sp cur_char) {
-  while (cur_char.notnilp()) {
-    T_sp obj = oCar(cur_char);
-    if (obj.consp()) {
-      make_str_downcase(sout, obj);
-    } else if (obj.fixnump()) {
-      if (obj.unsafe_fixnum()&TRAIT_ESCAPED)
-        sout->vectorPushExtend(core::clasp_make_character(CHR(obj.unsafe_fixnum())));
-      else sout->vectorPushExtend(core::clasp_make_character(tolower(CHR(obj.unsafe_fixnum()))));
-    } else if (obj.nilp()) {
-      // Handling name ||   do nothing
-    }
-    cur_char = oCdr(cur_char);
-  }
-}
-
-void make_str_preserve_case(StrNs_sp sout, List_sp cur_char) {
-  while (cur_char.notnilp()) {
-    T_sp obj = oCar(cur_char);
-    if (obj.consp()) {
-      make_str_preserve_case(sout, obj);
-    } else if (obj.fixnump()) {
-      sout->vectorPushExtend(core::clasp_make_character(CHR(obj.unsafe_fixnum())));
-    } else if (obj.nilp()) {
-      // Handling name ||   do nothing
-    }
-    cur_char = oCdr(cur_char);
-  }
-}
-
-/*! Works like SACLA readtable::make-str but accumulates the characters
-      into a stringstream */
-void make_str(StrNs_sp sout, List_sp cur_char) {
-  T_sp readtable = _lisp->getCurrentReadTable();
-  Symbol_sp case_ = cl__readtable_case(readtable);
-  if (case_ == kw::_sym_invert) {
-    UnEscapedCase strcase = check_case(cur_char,undefined);
-    switch (strcase) {
-      case undefined:
-      case mixed:
-          make_str_preserve_case(sout,cur_char);
-          return;
-      case up:
-          make_str_downcase(sout,cur_char);
-          return;
-      case down:
-          make_str_upcase(sout,cur_char);
-          return;
-      }
-    UNREACHABLE();
-  } else if (case_ == kw::_sym_upcase) {
-    make_str_upcase(sout,cur_char);
-  } else if (case_ == kw::_sym_downcase) {
-    make_str_downcase(sout,cur_char);
-  } else if (case_ == kw::_sym_preserve) {
-    make_str_preserve_case(sout,cur_char);
-  } else {
-    SIMPLE_ERROR(BF("Bad readtable case %s") % _rep_(case_));
-  }
-}
-
 string fix_exponent_char(const char *cur) {
   stringstream ss;
   while (*cur) {
@@ -541,6 +490,16 @@ void apply_readtable_case(Token& token, size_t start, size_t end) {
 }
 
 
+void collect_lexemes(T_sp tc, T_sp sin, StrNs_sp sout, bool apply_case) {
+  PooledToken pooled;
+  Token& token = pooled._Token;
+  collect_lexemes(tc,sin,token);
+  if (apply_case) apply_readtable_case(token,0,token.size());
+  for ( size_t i=0, iEnd(token.size()); i<iEnd; ++i ) {
+    sout->vectorPushExtend(clasp_make_character(CHR(token[i])));
+  }
+}
+
 SimpleString_sp symbolTokenStr(T_sp stream, Token &token, size_t start, size_t end, bool only_dots_ok=false) {
   bool extended = false;
   SafeBufferStrWNs buffer;
@@ -862,69 +821,57 @@ T_sp interpret_token_or_throw_reader_error(T_sp sin, Token &token, bool only_dot
   case tfloatp:
     // interpret float
     {
-      switch (exponent) {
-      case undefined_exp: {
-        char *lastValid = NULL;
-        if (cl::_sym_STARreadDefaultFloatFormatSTAR->symbolValue() == cl::_sym_single_float) {
-          string numstr = tokenStr(sin,token, start - token.data())->get_std_string();
-          float f = ::strtof(numstr.c_str(), &lastValid);
-          return clasp_make_single_float(f);
-        } else if (cl::_sym_STARreadDefaultFloatFormatSTAR->symbolValue() == cl::_sym_DoubleFloat_O) {
-          string numstr = tokenStr(sin,token, start - token.data())->get_std_string();
-          double d = ::strtod(numstr.c_str(), &lastValid);
-          return DoubleFloat_O::create(d);
-        }
-        else if (cl::_sym_STARreadDefaultFloatFormatSTAR->symbolValue() == cl::_sym_ShortFloat_O) {
-          string numstr = tokenStr(sin,token, start - token.data())->get_std_string();
-          float f = ::strtof(numstr.c_str(), &lastValid);
-          return clasp_make_single_float(f); //ShortFloat_O::create(f) crashes
-        }
-        else if (cl::_sym_STARreadDefaultFloatFormatSTAR->symbolValue() == cl::_sym_LongFloat_O) {
-          string numstr = tokenStr(sin,token, start - token.data())->get_std_string();
-          LongFloat l = ::strtod(numstr.c_str(), &lastValid);
-          return LongFloat_O::create(l);
-        }
-        else {
-          SIMPLE_ERROR(BF("Handle *read-default-float-format* of %s") % _rep_(cl::_sym_STARreadDefaultFloatFormatSTAR->symbolValue()));
-        }
+      // The state machine has already checked the syntax so the token is ascii
+      char small[64];
+      std::string large;
+      char *chars = small;
+      if (token.size() >= sizeof(small)) {
+        large.resize(token.size());
+        chars = &large[0];
       }
-      case float_exp: {
-        char *lastValid = NULL;
-        string numstr = fix_exponent_char(tokenStr(sin,token, start - token.data())->get_std_string().c_str());
-        double d = ::strtod(numstr.c_str(), &lastValid);
-        return DoubleFloat_O::create(d);
-      }
-      case short_float_exp: {
-        char *lastValid = NULL;
-        string numstr = fix_exponent_char(tokenStr(sin,token, start - token.data())->get_std_string().c_str());
-        double d = ::strtod(numstr.c_str(), &lastValid);
-        return clasp_make_single_float(d);
+      for (size_t i = 0, iEnd(token.size()); i < iEnd; ++i) chars[i] = (char)CHR(token[i]);
+      const char *chars_end = chars + token.size();
+      if (exponent == undefined_exp) {
+        T_sp format = cl::_sym_STARreadDefaultFloatFormatSTAR->symbolValue();
+        if (format == cl::_sym_single_float || format == cl::_sym_ShortFloat_O) {
+          exponent = single_float_exp;
+        } else if (format == cl::_sym_DoubleFloat_O) {
+          exponent = double_float_exp;
+        } else if (format == cl::_sym_LongFloat_O) {
+          exponent = long_float_exp;
+        } else {
+          SIMPLE_ERROR(BF("Handle *read-default-float-format* of %s") % _rep_(format));
+        }
       }
+      switch (exponent) {
+      case short_float_exp:
       case single_float_exp: {
-        char *lastValid = NULL;
-        string numstr = fix_exponent_char(tokenStr(sin,token, start - token.data())->get_std_string().c_str());
-        double d = ::strtod(numstr.c_str(), &lastValid);
-        return clasp_make_single_float(d);
+        float f;
+        if (clasp_parse_single_float(chars, chars_end, f)) return clasp_make_single_float(f);
+        break;
       }
+      case float_exp:
       case double_float_exp: {
-        char *lastValid = NULL;
-        string numstr = fix_exponent_char(tokenStr(sin,token, start - token.data())->get_std_string().c_str());
-        double d = ::strtod(numstr.c_str(), &lastValid);
-        return DoubleFloat_O::create(d);
+        double d;
+        if (clasp_parse_double(chars, chars_end, d)) return DoubleFloat_O::create(d);
+        break;
       }
       case long_float_exp: {
+#ifdef CLASP_LONG_FLOAT
         char *lastValid = NULL;
         string numstr = fix_exponent_char(tokenStr(sin,token, start - token.data())->get_std_string().c_str());
-#ifdef CLASP_LONG_FLOAT
         LongFloat d = ::strtold(numstr.c_str(), &lastValid);
         return LongFloat_O::create(d);
 #else
-        double d = ::strtod(numstr.c_str(), &lastValid);
-        return DoubleFloat_O::create(d);
+        double d;
+        if (clasp_parse_double(chars, chars_end, d)) return DoubleFloat_O::create(d);
+        break;
 #endif
       }
+      default:
+          break;
       }
-      SIMPLE_ERROR(BF("Shouldn't get here - unhandled exponent type"));
+      SIMPLE_ERROR(BF("Could not interpret float token %s") % tokenStr(sin,token, start - token.data())->get_std_string());
     }
   }
   LOG_READ(BF("Bad state %d") % state);
@@ -1052,6 +999,122 @@ T_sp read_lisp_object(T_sp sin, bool eofErrorP, T_sp eofValue, bool recursiveP)
 }
 
 
+SYMBOL_EXPORT_SC_(KeywordPkg, begin_list);
+SYMBOL_EXPORT_SC_(KeywordPkg, end_list);
+SYMBOL_EXPORT_SC_(KeywordPkg, atom);
+SYMBOL_EXPORT_SC_(KeywordPkg, dot);
+SYMBOL_EXPORT_SC_(KeywordPkg, skip);
+
+typedef enum { read_event_none,
+               read_event_object,
+               read_event_dot } ReadEventResult;
+
+ReadEventResult read_object_events(T_sp function, T_sp sin, T_sp readTable, bool skip, bool in_list, bool eofErrorP, T_sp eofValue);
+
+/*! The open paren has been consumed - report the elements up to and including the close paren.
+    A consing dot must have at least one object before it and exactly one after it, as in read_list */
+void read_list_events(T_sp function, T_sp sin, T_sp readTable, bool skip) {
+  core__stack_monitor();
+  size_t before_dot = 0;
+  bool got_dotted = false;
+  size_t after_dot = 0;
+  while (1) {
+    Character_sp cp = gc::As<Character_sp>(cl__peek_char(_lisp->_true(), sin, _lisp->_true(), _Nil<T_O>(), _lisp->_true()));
+    if (clasp_as_claspCharacter(cp) == ')') {
+      if (got_dotted && after_dot == 0) {
+        READER_ERROR(SimpleBaseString_O::make("Nothing after consing dot"),
+                     _Nil<T_O>(), sin);
+      }
+      read_ch_or_die(sin);
+      if (!skip) eval::funcall(function, kw::_sym_end_list, _Nil<T_O>());
+      return;
+    }
+    // After the object that follows the dot only comments may come before the close
+    // paren - read the next thing suppressed so that an extra object is never reported
+    bool after_cdr = got_dotted && after_dot > 0;
+    ReadEventResult result = read_object_events(function, sin, readTable, skip || after_cdr, true, true, _Nil<T_O>());
+    if (after_cdr && result != read_event_none) {
+      READER_ERROR(SimpleBaseString_O::make("More than one object after consing dot"),
+                   _Nil<T_O>(), sin);
+    }
+    if (result == read_event_dot) {
+      if (before_dot == 0 || got_dotted) {
+        READER_ERROR(SimpleBaseString_O::make("An illegal dot was encountered by the reader."),
+                     _Nil<T_O>(), sin);
+      }
+      got_dotted = true;
+      eval::funcall(function, kw::_sym_dot, _Nil<T_O>());
+    } else if (result == read_event_object) {
+      if (got_dotted) ++after_dot;
+      else ++before_dot;
+    }
+  }
+}
+
+/*! Read one object from sin and report it to function as events. Lists are taken
+    apart here so they never exist in memory; any other object, including what other
+    reader macros return, arrives whole as one :atom event. When skip is true nothing
+    is reported and atoms are read with *read-suppress* bound to T.
+    A consing dot inside a list is returned as read_event_dot and reported by the caller
+    once it has checked where the dot is. Return read_event_none if only a comment was
+    read, or at eof when eofErrorP is false. */
+ReadEventResult read_object_events(T_sp function, T_sp sin, T_sp readTable, bool skip, bool in_list, bool eofErrorP, T_sp eofValue) {
+  T_sp tc = cl__peek_char(_lisp->_true(), sin, _lisp->_boolean(eofErrorP), _Nil<T_O>(), _lisp->_true());
+  if (tc.nilp()) return read_event_none;
+  Character_sp c = gc::As_unsafe<Character_sp>(tc);
+  if (clasp_as_claspCharacter(c) == '(' && reader_syntax(readTable,c) == syntax_terminating_macro) {
+    read_ch_or_die(sin);
+    bool skip_list = skip || (eval::funcall(function, kw::_sym_begin_list, _Nil<T_O>()) == kw::_sym_skip);
+    read_list_events(function, sin, readTable, skip_list);
+    return read_event_object;
+  }
+  T_mv mv;
+  if (skip) {
+    DynamicScopeManager scope(cl::_sym_STARread_suppressSTAR, _lisp->_true());
+    mv = lisp_object_query(sin, true, eofValue, true);
+  } else {
+    mv = lisp_object_query(sin, true, eofValue, true);
+  }
+  if (mv.number_of_values() == 0) return read_event_none;
+  if (skip) return read_event_object;
+  T_sp obj = mv;
+  if (obj == _sym_dot) {
+    if (!in_list) {
+      READER_ERROR(SimpleBaseString_O::make("An illegal dot was encountered by the reader."),
+                   _Nil<T_O>(), sin);
+    }
+    return read_event_dot;
+  }
+  eval::funcall(function, kw::_sym_atom, obj);
+  return read_event_object;
+}
+
+CL_LAMBDA(function &optional input-stream-designator (eof-error-p t) eof-value);
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Read the next object from the stream without building it, calling FUNCTION
+with two arguments for each piece: (:begin-list nil) and (:end-list nil) around the
+elements of a list, (:dot nil) before the cdr of a dotted list, and (:atom object)
+for anything else. Only lists are streamed - what other reader macros return, such
+as strings, vectors and quoted forms, arrives whole as an atom. If FUNCTION returns
+:skip for :begin-list, the rest of that list is read without consing (atoms are
+read with *read-suppress* true) and no further events are reported for it,
+including its :end-list. As with READ, a #n= label can be referred to by #n# anywhere
+after it in the same object, but a label in front of a list makes that whole list
+one atom, because the #= reader macro has to build what it labels.
+Return T once an object has been read, or EOF-VALUE at end of file when
+EOF-ERROR-P is false.)doc");
+CL_DEFUN T_sp core__map_read_events(T_sp function, T_sp input_stream_designator, T_sp eof_error_p, T_sp eof_value) {
+  T_sp sin = coerce::inputStreamDesignator(input_stream_designator);
+  T_sp readTable = _lisp->getCurrentReadTable();
+  DynamicScopeManager scope(_sym_STARsharp_equal_final_tableSTAR, _Nil<T_O>());
+  while (1) {
+    if (read_object_events(function, sin, readTable, false, false, eof_error_p.isTrue(), eof_value) != read_event_none)
+      return _lisp->_true();
+    T_sp tc = cl__peek_char(_lisp->_true(), sin, eof_error_p, _Nil<T_O>(), _lisp->_true());
+    if (tc.nilp()) return eof_value;
+  }
+}
+
 /*!
       Read a character from the stream and based on what it is continue to process the
       stream until a complete symbol/number of macro is processed.
@@ -1065,8 +1128,10 @@ T_mv lisp_object_query(T_sp sin, bool eofErrorP, T_sp eofValue, bool recursiveP)
   ++monitorReaderStep;
 #endif
   bool only_dots_ok = false;
-  Token token;
+  PooledToken pooled;
+  Token& token = pooled._Token;
   T_sp readTable = _lisp->getCurrentReadTable();
+  trait_chr_type read_base = current_read_base();
   Character_sp xxx, y, z, X, Y, Z;
 /* See the CLHS 2.2 Reader Algorithm  - continue has the effect of jumping to step 1 */
 step1:
@@ -1080,20 +1145,20 @@ step1:
   }
   xxx = gc::As<Character_sp>(tx);
   LOG_READ(BF("Read character x[%d/%s]") % (int)clasp_as_claspCharacter(xxx) % (char)clasp_as_claspCharacter(xxx));
-  Symbol_sp xxx_syntax_type = core__syntax_type(readTable,xxx);
+  ReaderSyntax xxx_syntax_type = reader_syntax(readTable,xxx);
   //    step2:
-  if (xxx_syntax_type == kw::_sym_invalid) {
+  if (xxx_syntax_type == syntax_invalid) {
     LOG_READ(BF("step2 - invalid-character[%c]") % clasp_as_claspCharacter(xxx));
     READER_ERROR(SimpleBaseString_O::make("A char with syntax type invalid was encountered by the reader."),
                  _Nil<T_O>(), sin);
   }
   //    step3:
-  if (xxx_syntax_type == kw::_sym_whitespace) {
+  if (xxx_syntax_type == syntax_whitespace) {
     LOG_READ(BF("step3 - whitespace character[%c/%d]") % clasp_as_claspCharacter(xxx) % clasp_as_claspCharacter(xxx));
     goto step1;
   }
   //    step4:
-  if ((xxx_syntax_type == kw::_sym_terminating_macro) || (xxx_syntax_type == kw::_sym_non_terminating_macro)) {
+  if ((xxx_syntax_type == syntax_terminating_macro) || (xxx_syntax_type == syntax_non_terminating_macro)) {
     _BLOCK_TRACEF(BF("Processing macro character x[%s]") % clasp_as_claspCharacter(xxx));
     LOG_READ(BF("step4 - terminating-macro-character or non-terminating-macro-character char[%c]") % clasp_as_claspCharacter(xxx));
     T_sp reader_macro;
@@ -1122,7 +1187,7 @@ step1:
     return object;
   }
   //    step5:
-  if (xxx_syntax_type == kw::_sym_single_escape) {
+  if (xxx_syntax_type == syntax_single_escape) {
     LOG_READ(BF("step5 - single-escape-character char[%c]") % clasp_as_claspCharacter(xxx));
     LOG_READ(BF("Handling single escape"));
     T_sp ty = cl__read_char(sin, _lisp->_true(), _Nil<T_O>(), _lisp->_true());
@@ -1136,7 +1201,7 @@ step1:
     goto step8;
   }
   //    step6:
-  if (xxx_syntax_type == kw::_sym_multiple_escape) {
+  if (xxx_syntax_type == syntax_multiple_escape) {
     LOG_READ(BF("step6 - multiple-escape-character char[%c]") % clasp_as_claspCharacter(xxx));
     LOG_READ(BF("Handling multiple escape - clearing token"));
     token.clear();
@@ -1145,12 +1210,12 @@ step1:
     goto step9;
   }
   //    step7:
-  if ( xxx_syntax_type /*readTable->syntax_type(xxx)*/ == kw::_sym_constituent) {
+  if ( xxx_syntax_type /*readTable->syntax_type(xxx)*/ == syntax_constituent) {
     LOG_READ(BF("step7 - Handling constituent-character char[%s]") % _rep_(xxx));
     token.clear();
     // X = readTable->convert_case(x);
     X = xxx; // convert case once the entire token is accumulated
-    token.push_back(constituentChar(X));
+    token.push_back(constituent_traits(X.unsafe_character(),read_base));
   }
 step8:
   LOG_READ(BF("step8"));
@@ -1162,34 +1227,34 @@ step8:
     }
     Character_sp y(gc::As_unsafe<Character_sp>(ty));
     LOG_READ(BF("Step8: Read y[%s/%c]") % clasp_as_claspCharacter(y) % (char)clasp_as_claspCharacter(y));
-    Symbol_sp y8_syntax_type = core__syntax_type(readTable,y);
-    LOG_READ(BF("y8_syntax_type=%s") % _rep_(y8_syntax_type));
-    if ((y8_syntax_type == kw::_sym_constituent) || (y8_syntax_type == kw::_sym_non_terminating_macro)) {
+    ReaderSyntax y8_syntax_type = reader_syntax(readTable,y);
+    LOG_READ(BF("y8_syntax_type=%d") % y8_syntax_type);
+    if ((y8_syntax_type == syntax_constituent) || (y8_syntax_type == syntax_non_terminating_macro)) {
       // Y = readTable->convert_case(y);
       Y = y;  // convert case once the entire token is accumulated
       LOG_READ(BF("  Pushing back character %d") % constituentChar(Y));
-      token.push_back(constituentChar(Y));
+      token.push_back(constituent_traits(Y.unsafe_character(),read_base));
       goto step8;
     }
-    if (y8_syntax_type == kw::_sym_single_escape) {
+    if (y8_syntax_type == syntax_single_escape) {
       z = gc::As<Character_sp>(cl__read_char(sin, _lisp->_true(), _Nil<T_O>(), _lisp->_true()));
       token.push_back(constituentChar(z, TRAIT_ALPHABETIC|TRAIT_ESCAPED));
       LOG_READ(BF("Single escape read z[%s] accumulated token[%s]") % clasp_as_claspCharacter(z) % tokenStr(sin,token));
       goto step8;
     }
-    if (y8_syntax_type == kw::_sym_multiple_escape) {
+    if (y8_syntax_type == syntax_multiple_escape) {
       // |....| or ....|| or ..|.|.. is ok
       only_dots_ok = true;
       goto step9;
     }
-    if (y8_syntax_type == kw::_sym_invalid)
+    if (y8_syntax_type == syntax_invalid)
       SIMPLE_ERROR(BF("ReaderError_O::create()"));
-    if (y8_syntax_type == kw::_sym_terminating_macro) {
+    if (y8_syntax_type == syntax_terminating_macro) {
       LOG_READ(BF("UNREADING char y[%s]") % clasp_as_claspCharacter(y));
       clasp_unread_char(clasp_as_claspCharacter(y), sin);
       goto step10;
     }
-    if (y8_syntax_type == kw::_sym_whitespace) {
+    if (y8_syntax_type == syntax_whitespace) {
       LOG_READ(BF("y is whitespace"));
 #if 0
       if (_sym_STARpreserve_whitespace_pSTAR->symbolValue().isTrue()) { // Can this be recursiveP?
@@ -1206,28 +1271,27 @@ step9:
   LOG_READ(BF("step9"));
   {
     y = gc::As<Character_sp>(cl__read_char(sin, _lisp->_true(), _Nil<T_O>(), _lisp->_true()));
-    Symbol_sp y9_syntax_type = core__syntax_type(readTable,y);
-    LOG_READ(BF("Step9: Read y[%s] y9_syntax_type[%s]") % clasp_as_claspCharacter(y) % _rep_(y9_syntax_type));
-    if ((y9_syntax_type == kw::_sym_constituent) || (y9_syntax_type == kw::_sym_non_terminating_macro) || (y9_syntax_type == kw::_sym_terminating_macro) || (y9_syntax_type == kw::_sym_whitespace)) {
+    ReaderSyntax y9_syntax_type = reader_syntax(readTable,y);
+    LOG_READ(BF("Step9: Read y[%s] y9_syntax_type[%d]") % clasp_as_claspCharacter(y) % y9_syntax_type);
+    if ((y9_syntax_type == syntax_constituent) || (y9_syntax_type == syntax_non_terminating_macro) || (y9_syntax_type == syntax_terminating_macro) || (y9_syntax_type == syntax_whitespace)) {
       token.push_back(constituentChar(y, TRAIT_ALPHABETIC|TRAIT_ESCAPED));
       LOG_READ(BF("token[%s]") % tokenStr(sin,token));
       goto step9;
     }
-    LOG_READ(BF("About to test y9_syntax_type[%s] single_escape[%s] are equal? ==> %d") % _rep_(y9_syntax_type) % _rep_(kw::_sym_single_escape) % (y9_syntax_type == kw::_sym_single_escape));
-    if (y9_syntax_type == kw::_sym_single_escape) {
+    if (y9_syntax_type == syntax_single_escape) {
       LOG_READ(BF("Handling single_escape_character"));
       z = gc::As<Character_sp>(cl__read_char(sin, _lisp->_true(), _Nil<T_O>(), _lisp->_true()));
       token.push_back(constituentChar(z, TRAIT_ALPHABETIC|TRAIT_ESCAPED));
       LOG_READ(BF("Read z[%s] accumulated token[%s]") % clasp_as_claspCharacter(z) % tokenStr(sin,token));
       goto step9;
     }
-    if (y9_syntax_type == kw::_sym_multiple_escape) {
+    if (y9_syntax_type == syntax_multiple_escape) {
       LOG_READ(BF("Handling multiple_escape_character"));
       // |....| or ....|| or ..|.|.. is ok
       only_dots_ok = true;
       goto step8;
     }
-    if (y9_syntax_type == kw::_sym_invalid) {
+    if (y9_syntax_type == syntax_invalid) {
       SIMPLE_ERROR(BF("ReaderError_O::create()"));
     }
     SIMPLE_ERROR(BF("Should never get here"));
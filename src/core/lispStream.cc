@@ -365,6 +365,7 @@ static int restartable_io_error(T_sp strm, const char *s);
 static void unread_error(T_sp strm);
 static void unread_twice(T_sp strm);
 static void io_error(T_sp strm) NO_RETURN;
+static bool io_file_unread_bytes(T_sp strm, unsigned char *c, cl_index n);
 #ifdef CLASP_UNICODE
 cl_index encoding_error(T_sp strm, unsigned char *buffer, claspCharacter c);
 claspCharacter decoding_error(T_sp strm, unsigned char **buffer, int length, unsigned char *buffer_end);
@@ -804,10 +805,13 @@ eformat_unread_char(T_sp strm, claspCharacter c) {
     if (i != EOF) {
       ndx += StreamEncoder(strm)(strm, buffer + ndx, i);
     }
+    if (l.nilp() && gc::IsA<IOFileStream_sp>(strm) && io_file_unread_bytes(strm, buffer, ndx)) {
+      ndx = 0;
+    }
     while (ndx != 0) {
       l = Cons_O::create(make_fixnum(buffer[--ndx]), l);
     }
-    StreamByteStack(strm) = gc::As<Cons_sp>(l);
+    StreamByteStack(strm) = gc::As<List_sp>(l);
     StreamLastChar(strm) = EOF;
     StreamInputCursor(strm).backup(strm, c);
   }
@@ -2943,26 +2947,24 @@ consume_byte_stack(T_sp strm, unsigned char *c, cl_index n) {
   return out;
 }
 
+/* The descriptor is buffered in user space unless the buffering mode
+ * is :none.  The kernel file offset runs ahead of the stream position by
+ * the unconsumed input bytes and behind it by the pending output bytes;
+ * io_file_get_position/io_file_set_position account for both. */
+
 static cl_index
-io_file_read_byte8(T_sp strm, unsigned char *c, cl_index n) {
-  unlikely_if(StreamByteStack(strm).notnilp()) { // != _Nil<T_O>()) {
-    return consume_byte_stack(strm, c, n);
-  }
-  else {
-    int f = IOFileStreamDescriptor(strm);
-    gctools::Fixnum out = 0;
-    clasp_disable_interrupts();
-    do {
-      out = read(f, c, sizeof(char) * n);
-    } while (out < 0 && restartable_io_error(strm, "read"));
-    clasp_enable_interrupts();
-    return out;
-  }
+fd_read(T_sp strm, int f, unsigned char *c, cl_index n) {
+  gctools::Fixnum out = 0;
+  clasp_disable_interrupts();
+  do {
+    out = read(f, c, sizeof(char) * n);
+  } while (out < 0 && restartable_io_error(strm, "read"));
+  clasp_enable_interrupts();
+  return out;
 }
 
 static cl_index
-output_file_write_byte8(T_sp strm, unsigned char *c, cl_index n) {
-  int f = IOFileStreamDescriptor(strm);
+fd_write(T_sp strm, int f, unsigned char *c, cl_index n) {
   gctools::Fixnum out;
   clasp_disable_interrupts();
   do {
@@ -2972,6 +2974,227 @@ output_file_write_byte8(T_sp strm, unsigned char *c, cl_index n) {
   return out;
 }
 
+static void
+io_file_flush_output_buffer(T_sp strm) {
+  IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+  unsigned char *c = fs->_OutputBuffer;
+  cl_index n = fs->_OutputFill;
+  /* Clear the fill first so that an error while writing does not make
+   * us write the same bytes again when the stream is closed. */
+  fs->_OutputFill = 0;
+  while (n > 0) {
+    cl_index out = fd_write(strm, fs->fileDescriptor(), c, n);
+    c += out;
+    n -= out;
+  }
+}
+
+/* Give back to the descriptor the input bytes that were read ahead but
+ * not consumed, so that the kernel file offset is the stream position.
+ * Unseekable descriptors (pipes, sockets) have independent input and
+ * output, so there the buffer is kept. */
+static void
+io_file_discard_input_buffer(T_sp strm) {
+  IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+  cl_index unread = fs->_InputEnd - fs->_InputPos;
+  if (unread) {
+    if (lseek(fs->fileDescriptor(), -(clasp_off_t)unread, SEEK_CUR) == (clasp_off_t)-1)
+      return;
+  }
+  fs->_InputPos = fs->_InputEnd = 0;
+}
+
+static void
+io_file_set_buffering(T_sp strm, int buffer_mode, cl_index buffer_size) {
+  IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+  if (fs->_OutputFill)
+    io_file_flush_output_buffer(strm);
+  io_file_discard_input_buffer(strm);
+  if (fs->_InputEnd) {
+    /* Unseekable with read ahead bytes that cannot be given back,
+     * keep the buffer that holds them. */
+    unlikely_if(buffer_mode == _IONBF)
+      FEerror("Cannot unbuffer ~A while it holds unread input", 1, strm.raw_());
+    buffer_size = fs->_BufferSize;
+  } else {
+    gctools::clasp_dealloc((char *)fs->_InputBuffer);
+    fs->_InputBuffer = NULL;
+    if (buffer_mode != _IONBF && clasp_input_stream_p(strm))
+      fs->_InputBuffer = (unsigned char *)gctools::clasp_alloc_atomic(buffer_size);
+  }
+  gctools::clasp_dealloc((char *)fs->_OutputBuffer);
+  fs->_OutputBuffer = NULL;
+  if (buffer_mode != _IONBF && clasp_output_stream_p(strm))
+    fs->_OutputBuffer = (unsigned char *)gctools::clasp_alloc_atomic(buffer_size);
+  fs->_BufferMode = buffer_mode;
+  fs->_BufferSize = (buffer_mode == _IONBF) ? 0 : buffer_size;
+}
+
+static void
+io_file_release_buffers(T_sp strm) {
+  IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+  gctools::clasp_dealloc((char *)fs->_InputBuffer);
+  gctools::clasp_dealloc((char *)fs->_OutputBuffer);
+  fs->_InputBuffer = fs->_OutputBuffer = NULL;
+  fs->_InputPos = fs->_InputEnd = fs->_OutputFill = 0;
+  fs->_BufferMode = _IONBF;
+  fs->_BufferSize = 0;
+}
+
+/* Undo the consumption of the N bytes in C if they are the ones just before
+ * the input buffer position - this lets unread-char avoid the byte stack. */
+static bool
+io_file_unread_bytes(T_sp strm, unsigned char *c, cl_index n) {
+  IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+  if (fs->_InputBuffer && fs->_InputPos >= n &&
+      memcmp(fs->_InputBuffer + fs->_InputPos - n, c, n) == 0) {
+    fs->_InputPos -= n;
+    return true;
+  }
+  return false;
+}
+
+/* Length of the prefix of [P,END) whose bytes each decode to the character
+ * with the same code and are not line breaks.  With ASCII_ONLY that excludes
+ * bytes >= 128, as in UTF-8 and US-ASCII.  Eight bytes are checked at a time. */
+static inline cl_index
+unibyte_run_length(const unsigned char *p, const unsigned char *end, bool ascii_only) {
+  const uint64_t ones = 0x0101010101010101ULL;
+  const uint64_t highs = 0x8080808080808080ULL;
+  const uint64_t newlines = ones * CLASP_CHAR_CODE_LINEFEED;
+  const uint64_t returns = ones * CLASP_CHAR_CODE_RETURN;
+  const uint64_t high_mask = ascii_only ? highs : 0;
+  const unsigned char *start = p;
+  while (end - p >= (ptrdiff_t)sizeof(uint64_t)) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    uint64_t nl = w ^ newlines;
+    uint64_t cr = w ^ returns;
+    if ((w & high_mask) ||
+        ((nl - ones) & ~nl & highs) ||
+        ((cr - ones) & ~cr & highs))
+      break;
+    p += sizeof(uint64_t);
+  }
+  for (; p < end; ++p) {
+    unsigned char c = *p;
+    if ((ascii_only && c > 127) || c == CLASP_CHAR_CODE_LINEFEED || c == CLASP_CHAR_CODE_RETURN)
+      break;
+  }
+  return p - start;
+}
+
+/* Return true if the decoder of STRM maps single bytes to characters and
+ * set ASCII_ONLY if it is only for the bytes below 128. */
+static bool
+unibyte_decoder_p(Stream_sp strm, bool &ascii_only) {
+  cl_eformat_decoder decoder = strm->_Decoder;
+  if (strm->_ByteSize != 8 || strm->_EofChar != EOF)
+    return false;
+#ifdef CLASP_UNICODE
+  if (decoder == utf_8_decoder || decoder == ascii_decoder) {
+    ascii_only = true;
+    return true;
+  }
+#endif
+  if (decoder == passthrough_decoder) {
+    ascii_only = false;
+    return true;
+  }
+  return false;
+}
+
+cl_index clasp_input_unibyte_peek(T_sp tstrm, const unsigned char **run, cl_index max) {
+  IOFileStream_sp strm = tstrm.asOrNull<IOFileStream_O>();
+  if (!strm || !strm->_InputBuffer || strm->_InputPos == strm->_InputEnd)
+    return 0;
+  bool ascii_only;
+  if (strm->ops.read_char != eformat_read_char ||
+      strm->_ByteStack.notnilp() ||
+      !unibyte_decoder_p(strm, ascii_only))
+    return 0;
+  const unsigned char *start = strm->_InputBuffer + strm->_InputPos;
+  const unsigned char *end = strm->_InputBuffer + strm->_InputEnd;
+  if ((cl_index)(end - start) > max)
+    end = start + max;
+  *run = start;
+  return unibyte_run_length(start, end, ascii_only);
+}
+
+void clasp_input_unibyte_advance(T_sp tstrm, const unsigned char *run, cl_index n) {
+  if (n == 0)
+    return;
+  IOFileStream_sp strm = gc::As_unsafe<IOFileStream_sp>(tstrm);
+  ASSERT(run == strm->_InputBuffer + strm->_InputPos);
+  strm->_InputPos += n;
+  claspCharacter last = run[n - 1];
+  strm->_LastChar = last;
+  strm->_LastCode[0] = last;
+  strm->_LastCode[1] = EOF;
+  StreamCursor &cursor = strm->_InputCursor;
+  cursor._PrevLineNumber = cursor._LineNumber;
+  cursor._Column += n;
+  cursor._PrevColumn = cursor._Column - 1;
+}
+
+cl_index clasp_input_unibyte_run(T_sp strm, const unsigned char **run, cl_index max) {
+  cl_index n = clasp_input_unibyte_peek(strm, run, max);
+  clasp_input_unibyte_advance(strm, *run, n);
+  return n;
+}
+
+static cl_index
+io_file_read_byte8(T_sp strm, unsigned char *c, cl_index n) {
+  unlikely_if(StreamByteStack(strm).notnilp()) { // != _Nil<T_O>()) {
+    return consume_byte_stack(strm, c, n);
+  }
+  IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+  int f = fs->fileDescriptor();
+  if (!fs->_InputBuffer)
+    return fd_read(strm, f, c, n);
+  if (fs->_InputPos == fs->_InputEnd) {
+    /* Pending output has to reach the file before we read
+     * what may be the same bytes back. */
+    if (fs->_OutputFill)
+      io_file_flush_output_buffer(strm);
+    fs->_InputPos = fs->_InputEnd = 0;
+    if (n >= fs->_BufferSize)
+      return fd_read(strm, f, c, n);
+    fs->_InputEnd = fd_read(strm, f, fs->_InputBuffer, fs->_BufferSize);
+  }
+  /* Never block for more bytes when we already have some to return */
+  cl_index avail = fs->_InputEnd - fs->_InputPos;
+  if (n > avail)
+    n = avail;
+  memcpy(c, fs->_InputBuffer + fs->_InputPos, n);
+  fs->_InputPos += n;
+  return n;
+}
+
+static cl_index
+output_file_write_byte8(T_sp strm, unsigned char *c, cl_index n) {
+  IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+  if (!fs->_OutputBuffer)
+    return fd_write(strm, fs->fileDescriptor(), c, n);
+  if (fs->_OutputFill + n > fs->_BufferSize) {
+    io_file_flush_output_buffer(strm);
+    if (n >= fs->_BufferSize) {
+      cl_index left = n;
+      while (left > 0) {
+        cl_index out = fd_write(strm, fs->fileDescriptor(), c, left);
+        c += out;
+        left -= out;
+      }
+      return n;
+    }
+  }
+  memcpy(fs->_OutputBuffer + fs->_OutputFill, c, n);
+  fs->_OutputFill += n;
+  if (fs->_BufferMode == _IOLBF && memchr(c, '\n', n))
+    io_file_flush_output_buffer(strm);
+  return n;
+}
+
 static cl_index
 io_file_write_byte8(T_sp strm, unsigned char *c, cl_index n) {
   unlikely_if(StreamByteStack(strm).notnilp()) { // != _Nil<T_O>()) {
@@ -2981,6 +3204,11 @@ io_file_write_byte8(T_sp strm, unsigned char *c, cl_index n) {
       clasp_file_position_set(strm, aux);
     StreamByteStack(strm) = _Nil<T_O>();
   }
+  IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+  unlikely_if(fs->_InputPos != fs->_InputEnd) {
+    /* Writing happens at the stream position, not after the read ahead */
+    io_file_discard_input_buffer(strm);
+  }
   return output_file_write_byte8(strm, c, n);
 }
 
@@ -2988,6 +3216,11 @@ static int
 io_file_listen(T_sp strm) {
   if (StreamByteStack(strm).notnilp()) // != _Nil<T_O>())
     return CLASP_LISTEN_AVAILABLE;
+  {
+    IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+    if (fs->_InputPos != fs->_InputEnd)
+      return CLASP_LISTEN_AVAILABLE;
+  }
   if (StreamFlags(strm) & CLASP_STREAM_MIGHT_SEEK) {
     cl_env_ptr the_env = clasp_process_env();
     int f = IOFileStreamDescriptor(strm);
@@ -3031,6 +3264,10 @@ io_file_clear_input(T_sp strm) {
     /* Do not stop here: the FILE structure needs also to be flushed */
   }
 #endif
+  {
+    IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+    fs->_InputPos = fs->_InputEnd = 0;
+  }
   while (file_listen(strm, f) == CLASP_LISTEN_AVAILABLE) {
     claspCharacter c = eformat_read_char(strm);
     if (c == EOF)
@@ -3038,8 +3275,19 @@ io_file_clear_input(T_sp strm) {
   }
 }
 
-#define io_file_clear_output generic_void
-#define io_file_force_output generic_void
+static void
+io_file_clear_output(T_sp strm) {
+  IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+  fs->_OutputFill = 0;
+}
+
+static void
+io_file_force_output(T_sp strm) {
+  IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+  if (fs->_OutputFill)
+    io_file_flush_output_buffer(strm);
+}
+
 #define io_file_finish_output io_file_force_output
 
 static int
@@ -3056,6 +3304,7 @@ io_file_element_type(T_sp strm) {
 static T_sp
 io_file_length(T_sp strm) {
   int f = IOFileStreamDescriptor(strm);
+  io_file_force_output(strm);
   T_sp output = clasp_file_len(f); // NIL or Integer_sp
   if (StreamByteSize(strm) != 8 && output.notnilp()) {
     cl_index bs = StreamByteSize(strm);
@@ -3081,6 +3330,10 @@ io_file_get_position(T_sp strm) {
   clasp_enable_interrupts();
   unlikely_if(offset < 0)
     io_error(strm);
+  {
+    IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+    offset = offset - (fs->_InputEnd - fs->_InputPos) + fs->_OutputFill;
+  }
   if (sizeof(clasp_off_t) == sizeof(long)) {
     output = Integer_O::create((gctools::Fixnum)offset);
   } else {
@@ -3117,8 +3370,17 @@ io_file_set_position(T_sp strm, T_sp large_disp) {
     disp = clasp_integer_to_off_t(large_disp);
     mode = SEEK_SET;
   }
+  io_file_force_output(strm);
   disp = lseek(f, disp, mode);
-  return (disp == (clasp_off_t)-1) ? _Nil<T_O>() : _lisp->_true();
+  if (disp == (clasp_off_t)-1) {
+    // The descriptor didn't move so the buffered input still follows the stream position
+    return _Nil<T_O>();
+  }
+  {
+    IOFileStream_sp fs = gc::As_unsafe<IOFileStream_sp>(strm);
+    fs->_InputPos = fs->_InputEnd = 0;
+  }
+  return _lisp->_true();
 }
 
 static int
@@ -3126,6 +3388,23 @@ io_file_column(T_sp strm) {
   return StreamOutputColumn(strm);
 }
 
+/* If flushing the buffer of a stream being closed signals an error that
+ * unwinds out of io_file_close, still close the descriptor and the stream
+ * so that neither leaks. */
+struct IOFileCloseGuard {
+  T_sp _Stream;
+  bool _Closed;
+  IOFileCloseGuard(T_sp strm) : _Stream(strm), _Closed(false){};
+  ~IOFileCloseGuard() {
+    if (!this->_Closed) {
+      io_file_release_buffers(this->_Stream);
+      safe_close(IOFileStreamDescriptor(this->_Stream));
+      IOFileStreamDescriptor(this->_Stream) = -1;
+      generic_close(this->_Stream);
+    }
+  }
+};
+
 static T_sp
 io_file_close(T_sp strm) {
   int f = IOFileStreamDescriptor(strm);
@@ -3134,11 +3413,18 @@ io_file_close(T_sp strm) {
       FEerror("Cannot close the standard output", 0);
   unlikely_if(f == STDIN_FILENO)
       FEerror("Cannot close the standard input", 0);
+  {
+    IOFileCloseGuard guard(strm);
+    io_file_force_output(strm);
+    guard._Closed = true;
+  }
+  io_file_release_buffers(strm);
   failed = safe_close(f);
+  IOFileStreamDescriptor(strm) = -1;
+  generic_close(strm);
   unlikely_if(failed < 0)
       cannot_close(strm);
-  IOFileStreamDescriptor(strm) = -1;
-  return generic_close(strm);
+  return _lisp->_true();
 }
 
 static claspCharacter io_file_decode_char_from_buffer(Stream_sp strm, unsigned char *buffer, unsigned char **buffer_pos, unsigned char **buffer_end, bool seekable, cl_index min_needed_bytes) {
@@ -3272,8 +3558,53 @@ io_file_read_vector(T_sp tstrm, T_sp data, cl_index start, cl_index end) {
     }
   } else if (elementType == cl::_sym_base_char ||
              elementType == cl::_sym_character ) {
+    bool base = (elementType == cl::_sym_base_char);
+    IOFileStream_sp fs = strm.asOrNull<IOFileStream_O>();
+    if (fs && fs->_InputBuffer) {
+      /* Copy runs of single byte characters straight out of the stream
+       * buffer and decode only what is left one character at a time. */
+      while (start < end) {
+        const unsigned char *run;
+        cl_index n = clasp_input_unibyte_run(strm, &run, end - start);
+        if (n) {
+          if (base) {
+            memcpy(vec->rowMajorAddressOfElement_(start), run, n);
+          } else {
+            claspCharacter *dest = (claspCharacter *)vec->rowMajorAddressOfElement_(start);
+            for (cl_index i = 0; i < n; ++i) dest[i] = run[i];
+          }
+          start += n;
+          continue;
+        }
+        claspCharacter c = ops.read_char(strm);
+        if (c == EOF)
+          break;
+        vec->rowMajorAset(start++, clasp_make_character(c));
+      }
+      return start;
+    }
     FileReadBuffer buffer(strm);
+    bool ascii_only;
+    bool unibyte = (ops.read_char == eformat_read_char) && unibyte_decoder_p(strm, ascii_only);
     while (start < end) {
+      if (unibyte && buffer.__buffer_pos < buffer.__buffer_end) {
+        cl_index n = unibyte_run_length(buffer.__buffer_pos,
+                                        std::min(buffer.__buffer_end, buffer.__buffer_pos + (end - start)),
+                                        ascii_only);
+        if (n) {
+          if (base) {
+            memcpy(vec->rowMajorAddressOfElement_(start), buffer.__buffer_pos, n);
+          } else {
+            claspCharacter *dest = (claspCharacter *)vec->rowMajorAddressOfElement_(start);
+            for (cl_index i = 0; i < n; ++i) dest[i] = buffer.__buffer_pos[i];
+          }
+          buffer.__buffer_pos += n;
+          start += n;
+          strm->_LastChar = strm->_LastCode[0] = buffer.__buffer_pos[-1];
+          strm->_LastCode[1] = EOF;
+          continue;
+        }
+      }
       claspCharacter c = buffer.decode_char_from_buffer((end-start) * (strm->_ByteSize / 8));
       if (c != EOF)
         vec->rowMajorAset(start++, clasp_make_character(c));
@@ -4505,13 +4836,14 @@ maybe_make_windows_console_fd(T_sp fname, int desc, StreamMode smm,
 #define maybe_make_windows_console_fd clasp_make_file_stream_from_fd
 #endif
 
-CL_LAMBDA(stream mode);
+CL_LAMBDA(stream mode &optional buffer-size);
 CL_DECLARE();
-CL_DOCSTRING("set-buffering-mode");
+CL_DOCSTRING("Set the buffering mode of STREAM to one of :none, :line or :full. BUFFER-SIZE is the size in bytes of the buffers, it defaults to BUFSIZ.");
 CL_DEFUN 
-T_sp core__set_buffering_mode(T_sp stream, T_sp buffer_mode_symbol) {
+T_sp core__set_buffering_mode(T_sp stream, T_sp buffer_mode_symbol, T_sp buffer_size_designator) {
   enum StreamMode mode = StreamMode(stream);
   int buffer_mode;
+  cl_index buffer_size = BUFSIZ;
 
   unlikely_if(!AnsiStreamP(stream)) {
     FEerror("Cannot set buffer of ~A", 1, stream.raw_());
@@ -4525,17 +4857,23 @@ T_sp core__set_buffering_mode(T_sp stream, T_sp buffer_mode_symbol) {
     buffer_mode = _IOFBF;
   else
     FEerror("Not a valid buffering mode: ~A", 1, buffer_mode_symbol.raw_());
+  if (buffer_size_designator.notnilp()) {
+    unlikely_if(!buffer_size_designator.fixnump() || buffer_size_designator.unsafe_fixnum() <= 0)
+      TYPE_ERROR(buffer_size_designator, cl::_sym_fixnum);
+    buffer_size = buffer_size_designator.unsafe_fixnum();
+  }
 
   if (mode == clasp_smm_output || mode == clasp_smm_io || mode == clasp_smm_input) {
     FILE *fp = IOStreamStreamFile(stream);
 
     if (buffer_mode != _IONBF) {
-      cl_index buffer_size = BUFSIZ;
       char *new_buffer = gctools::clasp_alloc_atomic(buffer_size);
       StreamBuffer(stream) = new_buffer;
       setvbuf(fp, new_buffer, buffer_mode, buffer_size);
     } else
       setvbuf(fp, NULL, _IONBF, 0);
+  } else if (mode == clasp_smm_output_file || mode == clasp_smm_io_file || mode == clasp_smm_input_file) {
+    io_file_set_buffering(stream, buffer_mode, buffer_size);
   }
   return stream;
 }
@@ -5337,10 +5675,12 @@ T_sp clasp_open_stream(T_sp fn, enum StreamMode smm, T_sp if_exists,
     }
     output = clasp_make_stream_from_FILE(fn, fp, smm, byte_size, flags,
                                          external_format);
-    core__set_buffering_mode(output, byte_size ? kw::_sym_full : kw::_sym_line);
+    core__set_buffering_mode(output, byte_size ? kw::_sym_full : kw::_sym_line, _Nil<T_O>());
   } else {
     output = clasp_make_file_stream_from_fd(fn, f, smm, byte_size, flags,
                                             external_format);
+    if (smm != clasp_smm_probe)
+      core__set_buffering_mode(output, kw::_sym_full, _Nil<T_O>());
   }
   if (smm == clasp_smm_probe) {
     eval::funcall(cl::_sym_close, output);
@@ -6193,6 +6533,15 @@ CL_DEFUN T_mv cl__read_line(T_sp sin, T_sp eof_error_p, T_sp eof_value, T_sp rec
   StrWNs_sp sbuf_wide;
   // Read loop
   while (1) {
+    if (small) {
+      // Take whatever single byte characters a buffered file stream already holds in bulk
+      const unsigned char *run;
+      cl_index n = clasp_input_unibyte_run(sin, &run, ~(cl_index)0);
+      if (n) {
+        for (cl_index i = 0; i < n; ++i) sbuf_small->vectorPushExtend(run[i]);
+        continue;
+      }
+    }
     claspCharacter cc = read_char(sin);
     if (cc == EOF) { // hit end of file
       missing_newline_p = _lisp->_true();
@@ -27,6 +27,7 @@ THE SOFTWARE.
 
 #include <sched.h>
 #include <sys/types.h>
+#include <chrono>
 #include <clasp/core/foundation.h>
 #include <clasp/core/object.h>
 #include <clasp/core/lisp.h>
@@ -41,6 +42,9 @@ THE SOFTWARE.
 #include <clasp/core/lispList.h>
 #include <clasp/gctools/interrupt.h>
 #include <clasp/core/evaluator.h>
+#include <clasp/core/array.h>
+#include <clasp/core/numbers.h>
+#include <clasp/core/ql.h>
 
 
 extern "C" {
@@ -262,13 +266,13 @@ string Mutex_O::__repr__() const {
 }
 
 CL_LAMBDA(mutex &optional (upgrade nil));
-CL_DOCSTRING("Obtain the write lock for this mutex. upgradep should be true if and only if this thread currently holds the shared lock for the same mutex.");
+CL_DOCSTRING("Obtain the write lock for this mutex. upgradep should be true if and only if this thread currently holds the shared lock for the same mutex; the shared lock is given up while waiting, so anything read under it must be checked again. Releasing the write lock without releasep then returns to holding the shared lock.");
 CL_DEFUN void mp__write_lock(SharedMutex_sp m, bool upgrade) {
   m->write_lock(upgrade);
 }
 
 CL_LAMBDA(mutex &optional (upgrade nil));
-CL_DOCSTRING("Try to obtain the write lock for this mutex. If it cannot be obtained immediately, return false. Otherwise, return true.");
+CL_DOCSTRING("Try to obtain the write lock for this mutex. If it cannot be obtained immediately, return false. Otherwise, return true. An upgrading caller keeps its shared lock if this fails.");
 CL_DEFUN bool mp__write_try_lock(SharedMutex_sp m, bool upgrade) {
   return m->write_try_lock(upgrade);
 }
@@ -555,6 +559,269 @@ string ConditionVariable_O::__repr__() const {
   return ss.str();
 }
 
+ConcurrentQueue_O::ConcurrentQueue_O(core::T_sp name, size_t capacity)
+  : _Name(name), _Capacity(0), _Mask(0), _Slots(_Nil<core::T_O>()), _Sequence(NULL),
+    _EnqueuePos(0), _DequeuePos(0), _Count(0), _SleepingConsumers(0), _SleepingProducers(0),
+    _WaitMutex(lisp_nameword(name)) {
+  core::T_sp dummy = core::Cons_O::create(_Nil<core::T_O>(),_Nil<core::T_O>());
+  this->_Head.store(dummy);
+  this->_Tail.store(dummy);
+  if (capacity>0) {
+    size_t size = 1;
+    while (size<capacity) size <<= 1;
+    this->_Capacity = size;
+    this->_Mask = size-1;
+    this->_Slots = core::SimpleVector_O::make(size);
+    this->_Sequence = new std::atomic<size_t>[size];
+    for ( size_t i=0; i<size; ++i ) this->_Sequence[i].store(i,std::memory_order_relaxed);
+  }
+}
+
+ConcurrentQueue_O::~ConcurrentQueue_O() {
+  if (this->_Sequence) delete[] this->_Sequence;
+}
+
+ConcurrentQueue_sp ConcurrentQueue_O::make_ConcurrentQueue(core::T_sp name, size_t capacity) {
+  GC_ALLOCATE_VARIADIC(ConcurrentQueue_O,q,name,capacity);
+  return q;
+}
+
+bool ConcurrentQueue_O::try_push(core::T_sp obj) {
+  if (this->_Capacity==0) {
+    core::T_sp node = core::Cons_O::create(obj,_Nil<core::T_O>());
+    while (true) {
+      core::T_sp tail = this->_Tail.load(std::memory_order_acquire);
+      core::Cons_O* tailCons = tail.unsafe_cons();
+      core::T_sp next = tailCons->_Cdr.load(std::memory_order_acquire);
+      if (tail.raw_()!=this->_Tail.load(std::memory_order_acquire).raw_()) continue;
+      if (next.nilp()) {
+        if (tailCons->_Cdr.compare_exchange_weak(next,node)) {
+          this->_Tail.compare_exchange_strong(tail,node);
+          break;
+        }
+      } else {
+        // Another producer linked a node but hasn't swung _Tail yet - help it along
+        this->_Tail.compare_exchange_strong(tail,next);
+      }
+    }
+    this->_Count.fetch_add(1);
+    return true;
+  }
+  core::SimpleVector_sp slots = gc::As_unsafe<core::SimpleVector_sp>(this->_Slots);
+  size_t pos = this->_EnqueuePos.load(std::memory_order_relaxed);
+  while (true) {
+    std::atomic<size_t>& seq = this->_Sequence[pos&this->_Mask];
+    intptr_t diff = (intptr_t)seq.load(std::memory_order_acquire)-(intptr_t)pos;
+    if (diff==0) {
+      if (this->_EnqueuePos.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed)) {
+        (*slots)[pos&this->_Mask] = obj;
+        seq.store(pos+1,std::memory_order_release);
+        this->_Count.fetch_add(1);
+        return true;
+      }
+    } else if (diff<0) {
+      return false; // full
+    } else {
+      pos = this->_EnqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool ConcurrentQueue_O::try_pop(core::T_sp& obj) {
+  if (this->_Capacity==0) {
+    while (true) {
+      core::T_sp head = this->_Head.load(std::memory_order_acquire);
+      core::T_sp tail = this->_Tail.load(std::memory_order_acquire);
+      core::Cons_O* headCons = head.unsafe_cons();
+      core::T_sp next = headCons->_Cdr.load(std::memory_order_acquire);
+      if (head.raw_()!=this->_Head.load(std::memory_order_acquire).raw_()) continue;
+      if (next.nilp()) return false; // empty
+      if (head.raw_()==tail.raw_()) {
+        this->_Tail.compare_exchange_strong(tail,next);
+        continue;
+      }
+      core::Cons_O* nextCons = next.unsafe_cons();
+      core::T_sp value = nextCons->_Car.load(std::memory_order_acquire);
+      if (this->_Head.compare_exchange_weak(head,next)) {
+        // next is the new dummy - drop its reference so the queue doesn't keep the object alive
+        nextCons->_Car.store(_Nil<core::T_O>(),std::memory_order_relaxed);
+        this->_Count.fetch_sub(1);
+        obj = value;
+        return true;
+      }
+    }
+  }
+  core::SimpleVector_sp slots = gc::As_unsafe<core::SimpleVector_sp>(this->_Slots);
+  size_t pos = this->_DequeuePos.load(std::memory_order_relaxed);
+  while (true) {
+    std::atomic<size_t>& seq = this->_Sequence[pos&this->_Mask];
+    intptr_t diff = (intptr_t)seq.load(std::memory_order_acquire)-(intptr_t)(pos+1);
+    if (diff==0) {
+      if (this->_DequeuePos.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed)) {
+        obj = (*slots)[pos&this->_Mask];
+        (*slots)[pos&this->_Mask] = _Nil<core::T_O>();
+        seq.store(pos+this->_Mask+1,std::memory_order_release);
+        this->_Count.fetch_sub(1);
+        return true;
+      }
+    } else if (diff<0) {
+      return false; // empty
+    } else {
+      pos = this->_DequeuePos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+/*! Sleepers register under _WaitMutex and then re-check the queue, while the other
+    side publishes and then checks for sleepers; the seq_cst fences make sure at least
+    one of them sees the other so no wakeup is lost. */
+void ConcurrentQueue_O::notify_consumers() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->_SleepingConsumers.load(std::memory_order_relaxed)>0) {
+    this->_WaitMutex.lock();
+    this->_NotEmpty.signal();
+    this->_WaitMutex.unlock();
+  }
+}
+
+void ConcurrentQueue_O::notify_producers(size_t slots) {
+  if (this->_Capacity==0) return;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->_SleepingProducers.load(std::memory_order_relaxed)>0) {
+    this->_WaitMutex.lock();
+    if (slots>1) this->_NotFull.broadcast();
+    else this->_NotFull.signal();
+    this->_WaitMutex.unlock();
+  }
+}
+
+#define CONCURRENT_QUEUE_SPIN 64
+
+bool ConcurrentQueue_O::push(core::T_sp obj, double timeout) {
+  bool pushed = this->try_push(obj);
+  for ( int spin=0; !pushed && timeout!=0.0 && spin<CONCURRENT_QUEUE_SPIN; ++spin ) {
+    sched_yield();
+    pushed = this->try_push(obj);
+  }
+  if (!pushed && timeout!=0.0) {
+    auto deadline = std::chrono::steady_clock::now()+std::chrono::duration<double>(timeout<0.0 ? 0.0 : timeout);
+    this->_WaitMutex.lock();
+    this->_SleepingProducers.fetch_add(1);
+    while (!(pushed = this->try_push(obj))) {
+      if (timeout<0.0) {
+        this->_NotFull.wait(this->_WaitMutex);
+      } else {
+        double remaining = std::chrono::duration<double>(deadline-std::chrono::steady_clock::now()).count();
+        if (remaining<=0.0) break;
+        this->_NotFull.timed_wait(this->_WaitMutex,remaining);
+      }
+    }
+    this->_SleepingProducers.fetch_sub(1);
+    this->_WaitMutex.unlock();
+  }
+  if (pushed) this->notify_consumers();
+  return pushed;
+}
+
+bool ConcurrentQueue_O::pop(core::T_sp& obj, double timeout) {
+  bool popped = this->try_pop(obj);
+  for ( int spin=0; !popped && timeout!=0.0 && spin<CONCURRENT_QUEUE_SPIN; ++spin ) {
+    sched_yield();
+    popped = this->try_pop(obj);
+  }
+  if (!popped && timeout!=0.0) {
+    auto deadline = std::chrono::steady_clock::now()+std::chrono::duration<double>(timeout<0.0 ? 0.0 : timeout);
+    this->_WaitMutex.lock();
+    this->_SleepingConsumers.fetch_add(1);
+    while (!(popped = this->try_pop(obj))) {
+      if (timeout<0.0) {
+        this->_NotEmpty.wait(this->_WaitMutex);
+      } else {
+        double remaining = std::chrono::duration<double>(deadline-std::chrono::steady_clock::now()).count();
+        if (remaining<=0.0) break;
+        this->_NotEmpty.timed_wait(this->_WaitMutex,remaining);
+      }
+    }
+    this->_SleepingConsumers.fetch_sub(1);
+    this->_WaitMutex.unlock();
+  }
+  if (popped) this->notify_producers();
+  return popped;
+}
+
+string ConcurrentQueue_O::__repr__() const {
+  stringstream ss;
+  ss << "#<CONCURRENT-QUEUE ";
+  ss << _rep_(this->_Name);
+  ss << " count: " << this->_Count.load();
+  if (this->_Capacity) ss << "/" << this->_Capacity;
+  ss << ">";
+  return ss.str();
+}
+
+static double concurrent_queue_timeout(core::T_sp timeout) {
+  if (timeout.nilp()) return -1.0;
+  double seconds = core::clasp_to_double(timeout);
+  return seconds<0.0 ? 0.0 : seconds;
+}
+
+CL_LAMBDA(&key (name "Anonymous Queue") capacity);
+CL_DOCSTRING("Make a new multi-producer/multi-consumer queue. If CAPACITY is NIL the queue is unbounded, otherwise it holds at most CAPACITY objects (rounded up to a power of two) and pushing onto a full queue blocks.");
+CL_DEFUN ConcurrentQueue_sp mp__make_concurrent_queue(core::T_sp name, core::T_sp capacity) {
+  size_t cap = 0;
+  if (capacity.notnilp()) {
+    if (!capacity.fixnump() || capacity.unsafe_fixnum()<=0) {
+      SIMPLE_ERROR(BF("The capacity of a concurrent queue must be NIL or a positive fixnum - got %s") % _rep_(capacity));
+    }
+    cap = capacity.unsafe_fixnum();
+  }
+  return ConcurrentQueue_O::make_ConcurrentQueue(name,cap);
+}
+
+CL_DEFUN core::T_sp mp__concurrent_queue_name(ConcurrentQueue_sp queue) {
+  return queue->_Name;
+}
+
+CL_DOCSTRING("Return the capacity of the queue, or NIL if it is unbounded.");
+CL_DEFUN core::T_sp mp__concurrent_queue_capacity(ConcurrentQueue_sp queue) {
+  if (queue->_Capacity==0) return _Nil<core::T_O>();
+  return core::clasp_make_fixnum(queue->_Capacity);
+}
+
+CL_DOCSTRING("Return the number of objects in the queue. The result may be out of date as soon as it is returned.");
+CL_DEFUN core::Fixnum_sp mp__concurrent_queue_count(ConcurrentQueue_sp queue) {
+  gctools::Fixnum count = queue->_Count.load();
+  return core::clasp_make_fixnum(count<0 ? 0 : count);
+}
+
+CL_LAMBDA(queue object &optional timeout);
+CL_DOCSTRING("Add OBJECT to the end of QUEUE. On a full bounded queue wait up to TIMEOUT seconds for room (forever if TIMEOUT is NIL, not at all if it is 0). Return true if the object was added.");
+CL_DEFUN bool mp__concurrent_queue_push(ConcurrentQueue_sp queue, core::T_sp object, core::T_sp timeout) {
+  return queue->push(object,concurrent_queue_timeout(timeout));
+}
+
+CL_LAMBDA(queue &optional timeout default);
+CL_DOCSTRING("Remove and return the object at the front of QUEUE. If the queue is empty wait up to TIMEOUT seconds (forever if TIMEOUT is NIL, not at all if it is 0). Return (values object t), or (values default nil) if nothing arrived.");
+CL_DEFUN core::T_mv mp__concurrent_queue_pop(ConcurrentQueue_sp queue, core::T_sp timeout, core::T_sp default_) {
+  core::T_sp obj;
+  if (queue->pop(obj,concurrent_queue_timeout(timeout))) return Values(obj,_lisp->_true());
+  return Values(default_,_Nil<core::T_O>());
+}
+
+CL_LAMBDA(queue max &optional (timeout 0));
+CL_DOCSTRING("Remove up to MAX objects from the front of QUEUE and return them as a list in queue order. Waits up to TIMEOUT seconds for the first object (default: don't wait, NIL: wait forever); the rest are only taken if they are already there.");
+CL_DEFUN core::List_sp mp__concurrent_queue_pop_batch(ConcurrentQueue_sp queue, size_t max, core::T_sp timeout) {
+  ql::list result;
+  core::T_sp obj;
+  if (max==0 || !queue->pop(obj,concurrent_queue_timeout(timeout))) return result.cons();
+  result << obj;
+  size_t taken = 1;
+  for ( ; taken<max && queue->try_pop(obj); ++taken ) result << obj;
+  // pop already woke one producer for the first slot
+  if (taken>1) queue->notify_producers(taken-1);
+  return result.cons();
+}
+
 CL_DEFUN void mp__push_default_special_binding(core::Symbol_sp symbol, core::T_sp form)
 {
   _lisp->push_default_special_binding(symbol,form);
@@ -290,6 +290,7 @@ CL_DEFUN T_sp cl__delete_package(T_sp pobj)
     } );
   pkg->_ExternalSymbols->clrhash();
   pkg->_Shadowing->clrhash();
+  bump_package_epoch();
   string package_name = pkg->packageName();
   pkg->_Name = SimpleBaseString_O::make("");
   _lisp->remove_package(package_name);
@@ -436,6 +437,9 @@ SYMBOL_EXPORT_SC_(ClPkg, unintern);
 
 
 
+std::atomic<uint32_t> global_package_epoch;
+std::atomic<uint32_t> global_package_serial;
+
 Package_sp Package_O::create(const string &name) {
   Package_sp p = Package_O::create();
   p->setName(name);
@@ -455,6 +459,9 @@ void Package_O::initialize() {
 #endif
   this->_KeywordPackage = false;
   this->_AmpPackage = false;
+  this->_Serial = global_package_serial.fetch_add(1, std::memory_order_relaxed) + 1;
+  // Caches keyed on the serial must never see a recycled one under the same epoch
+  bump_package_epoch();
 }
 
 string Package_O::packageName() const {
@@ -548,7 +555,7 @@ Symbol_mv Package_O::findSymbol_SimpleString_no_lock(SimpleString_sp nameKey) co
       LOG(BF("Looking in package[%s]") % _rep_(upkg));
       T_mv eu = upkg->_ExternalSymbols->gethash(nameKey, _Nil<T_O>());
       val = gc::As<Symbol_sp>(eu);
-      foundp = ei.second().isTrue();
+      foundp = eu.second().isTrue();
       if (foundp) {
         LOG(BF("Found it in the _ExternalsSymbols list - returning[%s]") % (_rep_(val)));
         return Values(val, kw::_sym_inherited);
@@ -558,9 +565,107 @@ Symbol_mv Package_O::findSymbol_SimpleString_no_lock(SimpleString_sp nameKey) co
   return Values(_Nil<Symbol_O>(), _Nil<Symbol_O>());
 }
 
+#ifdef USE_BOEHM
+/*! A per-thread, direct mapped cache of successful lookups.  An entry is only
+    trusted while global_package_epoch is unchanged, which means the symbol is
+    still present in the package, so it is consulted without the package lock.
+    Boehm never moves objects so the raw symbol pointer stays good; MPS does move
+    them, so there findSymbol_SimpleString always takes the lock. */
+#define FIND_SYMBOL_CACHE_SIZE 512
+
+typedef enum { find_status_none = 0,
+               find_status_external,
+               find_status_internal,
+               find_status_inherited } FindSymbolStatus;
+
+struct FindSymbolCacheEntry {
+  uint32_t _Epoch;
+  uint32_t _PackageSerial;
+  Symbol_O* _Symbol;
+  FindSymbolStatus _Status;
+};
+
+thread_local FindSymbolCacheEntry find_symbol_cache[FIND_SYMBOL_CACHE_SIZE];
+
+template <typename StringType>
+static uint32_t template_symbol_name_hash(const StringType& name) {
+  const typename StringType::simple_element_type* cp((const typename StringType::simple_element_type*)name.rowMajorAddressOfElement_(0));
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0, iEnd(name.length()); i < iEnd; ++i, ++cp) {
+    hash = (hash ^ static_cast<uint32_t>(*cp)) * 16777619u;
+  }
+  return hash;
+}
+
+static uint32_t symbol_name_hash(SimpleString_sp name) {
+  if (SimpleBaseString_sp sb = name.asOrNull<SimpleBaseString_O>())
+    return template_symbol_name_hash(*sb);
+  return template_symbol_name_hash(*gc::As_unsafe<SimpleCharacterString_sp>(name));
+}
+
+static bool symbol_name_equal(SimpleString_sp name1, SimpleString_sp name2) {
+  size_t len1 = name1->length();
+  size_t len2 = name2->length();
+  if (len1 != len2) return false;
+  if (SimpleBaseString_sp sb1 = name1.asOrNull<SimpleBaseString_O>()) {
+    if (SimpleBaseString_sp sb2 = name2.asOrNull<SimpleBaseString_O>())
+      return template_string_EQ_equal(*sb1, *sb2, 0, len1, 0, len2);
+    return template_string_EQ_equal(*sb1, *gc::As_unsafe<SimpleCharacterString_sp>(name2), 0, len1, 0, len2);
+  }
+  SimpleCharacterString_sp sc1 = gc::As_unsafe<SimpleCharacterString_sp>(name1);
+  if (SimpleBaseString_sp sb2 = name2.asOrNull<SimpleBaseString_O>())
+    return template_string_EQ_equal(*sc1, *sb2, 0, len1, 0, len2);
+  return template_string_EQ_equal(*sc1, *gc::As_unsafe<SimpleCharacterString_sp>(name2), 0, len1, 0, len2);
+}
+
+static Symbol_sp find_status_symbol(FindSymbolStatus status) {
+  switch (status) {
+  case find_status_external: return kw::_sym_external;
+  case find_status_internal: return kw::_sym_internal;
+  case find_status_inherited: return kw::_sym_inherited;
+  default: return _Nil<Symbol_O>();
+  }
+}
+
+static FindSymbolStatus find_status_code(T_sp status) {
+  if (status == kw::_sym_external) return find_status_external;
+  if (status == kw::_sym_internal) return find_status_internal;
+  if (status == kw::_sym_inherited) return find_status_inherited;
+  return find_status_none;
+}
+#endif // USE_BOEHM
+
 Symbol_mv Package_O::findSymbol_SimpleString(SimpleString_sp nameKey) const {
+#ifdef USE_BOEHM
+  // Read the epoch before looking so that a racing change can only make the entry stale
+  uint32_t epoch = package_epoch();
+  FindSymbolCacheEntry& entry = find_symbol_cache[symbol_name_hash(nameKey) & (FIND_SYMBOL_CACHE_SIZE - 1)];
+  if (entry._Epoch == epoch &&
+      entry._PackageSerial == this->_Serial &&
+      entry._Symbol &&
+      symbol_name_equal(entry._Symbol->_Name, nameKey)) {
+    Symbol_sp sym(entry._Symbol);
+    return Values(sym, find_status_symbol(entry._Status));
+  }
+  Symbol_sp sym;
+  Symbol_sp status;
+  {
+    WITH_PACKAGE_READ_LOCK(this);
+    Symbol_mv values = this->findSymbol_SimpleString_no_lock(nameKey);
+    sym = values;
+    status = gc::As<Symbol_sp>(values.valueGet_(1));
+  }
+  if (status.notnilp()) {
+    entry._Epoch = epoch;
+    entry._PackageSerial = this->_Serial;
+    entry._Symbol = sym.get();
+    entry._Status = find_status_code(status);
+  }
+  return Values(sym, status);
+#else
   WITH_PACKAGE_READ_LOCK(this);
   return this->findSymbol_SimpleString_no_lock(nameKey);
+#endif
 }
 
 Symbol_mv Package_O::findSymbol(const string &name) const {
@@ -672,6 +777,7 @@ bool Package_O::usePackage(Package_sp usePackage) {
   {
     WITH_PACKAGE_READ_WRITE_LOCK(this);
     this->_UsingPackages.push_back(usePackage);
+    bump_package_epoch();
   }
   Package_sp me(this);
   {
@@ -687,6 +793,7 @@ bool Package_O::unusePackage_no_outer_lock(Package_sp usePackage) {
        it != this->_UsingPackages.end(); ++it) {
     if ((*it) == usePackage) {
       this->_UsingPackages.erase(it);
+      bump_package_epoch();
       for (auto jt = usePackage->_PackagesUsedBy.begin();
            jt != usePackage->_PackagesUsedBy.end(); ++jt) {
         if (*jt == me) {
@@ -709,6 +816,7 @@ bool Package_O::unusePackage_no_inner_lock(Package_sp usePackage) {
        it != this->_UsingPackages.end(); ++it) {
     if ((*it) == usePackage) {
       this->_UsingPackages.erase(it);
+      bump_package_epoch();
       for (auto jt = usePackage->_PackagesUsedBy.begin();
            jt != usePackage->_PackagesUsedBy.end(); ++jt) {
         if (*jt == me) {
@@ -852,6 +960,7 @@ void Package_O::unexport(Symbol_sp sym) {
     } else if (status == kw::_sym_external) {
       this->_ExternalSymbols->remhash(nameKey);
       this->_InternalSymbols->setf_gethash(nameKey,sym);
+      bump_package_epoch();
     }
   }
   if (error == not_accessible_in_this_package) {
@@ -862,11 +971,13 @@ void Package_O::unexport(Symbol_sp sym) {
   }
 }
 
-void Package_O::add_symbol_to_package_no_lock(SimpleString_sp nameKey, Symbol_sp sym, bool exportp) {
+void Package_O::add_symbol_to_package_no_lock(SimpleString_sp nameKey, Symbol_sp sym, bool exportp, bool bump_epoch) {
   if (this->isKeywordPackage() || this->actsLikeKeywordPackage() || exportp) {
     this->_ExternalSymbols->hash_table_setf_gethash(nameKey, sym);
+    bump_package_epoch();
   } else {
     this->_InternalSymbols->hash_table_setf_gethash(nameKey, sym);
+    if (bump_epoch) bump_package_epoch();
   }
 }
 
@@ -887,6 +998,19 @@ void Package_O::bootstrap_add_symbol_to_package(const char *symName, Symbol_sp s
 }
 
 T_mv Package_O::intern(SimpleString_sp name) {
+  {
+    // Nearly every name the reader interns already exists, so look for it
+    // without the write lock first and only take it to add a symbol.
+    Symbol_mv values = this->findSymbol_SimpleString(name);
+    Symbol_sp sym = values;
+    Symbol_sp status = gc::As<Symbol_sp>(values.valueGet_(1));
+    if (status.notnilp()) {
+      if (this->actsLikeKeywordPackage()) {
+        sym->setf_symbolValue(sym);
+      }
+      return Values(sym, status);
+    }
+  }
   WITH_PACKAGE_READ_WRITE_LOCK(this);
 //  client_validate(name);
   Symbol_mv values = this->findSymbol_SimpleString_no_lock(name);
@@ -898,9 +1022,12 @@ T_mv Package_O::intern(SimpleString_sp name) {
     client_validate(name);
     sym->makunbound();
     status = _Nil<Symbol_O>();
-    sym->setPackage(this->sharedThis<Package_O>());
+    sym->setPackageOfFreshSymbol(this->sharedThis<Package_O>());
     LOG(BF("Created symbol<%s>") % _rep_(sym));
-    this->add_symbol_to_package_no_lock(sym->symbolName(), sym, false);
+    // No symbol by this name was accessible here, so no cached lookup or printed
+    // prefix can depend on it and the epoch is left alone - unless the new symbol
+    // is external, where packages using this one can see it.
+    this->add_symbol_to_package_no_lock(sym->symbolName(), sym, false, false);
   }
   if (this->actsLikeKeywordPackage()) {
     sym->setf_symbolValue(sym);
@@ -940,11 +1067,13 @@ bool Package_O::unintern_no_lock(Symbol_sp sym) {
       }
       if (status == kw::_sym_internal) {
         this->_InternalSymbols->remhash(nameKey);
+        bump_package_epoch();
         if (sym->getPackage().get() == this)
           sym->setPackage(_Nil<Package_O>());
         return true;
       } else if (status == kw::_sym_external) {
         this->_ExternalSymbols->remhash(nameKey);
+        bump_package_epoch();
         if (sym->getPackage().get() == this)
           sym->setPackage(_Nil<Package_O>());
         return true;
@@ -221,6 +221,15 @@ CL_DEFUN T_sp core__reader_double_quote_string(T_sp stream, Character_sp ch) {
   SafeBufferStrWNs buffer;
   bool done = false;
   while (!done) {
+    // Copy what a buffered file stream holds up to the next quote or escape in bulk
+    const unsigned char *run;
+    cl_index n = clasp_input_unibyte_peek(stream, &run, ~(cl_index)0);
+    cl_index i = 0;
+    for (; i < n && run[i] != '"' && run[i] != '\\'; ++i)
+      buffer.string()->vectorPushExtend(run[i]);
+    clasp_input_unibyte_advance(stream, run, i);
+    if (i && i == n)
+      continue;
     Character_sp nc = gc::As<Character_sp>(cl__read_char(stream, _lisp->_true(), _Nil<T_O>(), _lisp->_true()));
     claspCharacter cc = clasp_as_claspCharacter(nc);
     if (cc == '"')
@@ -415,8 +424,7 @@ CL_DECLARE();
 CL_DOCSTRING("sharp_backslash");
 CL_DEFUN T_mv core__sharp_backslash(T_sp sin, Character_sp ch, T_sp num) {
   SafeBufferStr8Ns sslexemes;
-  List_sp lexemes = collect_lexemes(ch, sin);
-  make_str_preserve_case(sslexemes.string(), lexemes);
+  collect_lexemes(ch, sin, sslexemes.string(), false);
   if (!cl::_sym_STARread_suppressSTAR->symbolValue().isTrue()) {
     if (sslexemes.string()->length() == 1 ) {
       return Values(sslexemes.string()->rowMajorAref(0));
@@ -566,9 +574,8 @@ CL_DECLARE();
 CL_DOCSTRING("sharp_colon");
 CL_DEFUN T_mv core__sharp_colon(T_sp sin, Character_sp ch, T_sp num) {
   // CHECKME
-  List_sp lexemes = collect_lexemes(ch, sin);
   SafeBufferStrWNs sslexemes;
-  make_str(sslexemes.string(), lexemes);
+  collect_lexemes(ch, sin, sslexemes.string(), true);
   SimpleString_sp lexeme_str = sslexemes.string()->asMinimalSimpleString();
   if (!cl::_sym_STARread_suppressSTAR->symbolValue().isTrue()) {
     Symbol_sp new_symbol = Symbol_O::create(gc::As<SimpleString_sp>(lexeme_str->unsafe_subseq(1,lexeme_str->length())));
@@ -831,6 +838,7 @@ HashTable_sp Readtable_O::create_standard_syntax_table() {
 Readtable_sp Readtable_O::create_standard_readtable() {
   GC_ALLOCATE(Readtable_O, rt);
   rt->SyntaxTypes_ = Readtable_O::create_standard_syntax_table();
+  rt->SyntaxCacheValid_.store(false, std::memory_order_release);
   ASSERTNOTNULL(_sym_reader_backquoted_expression->symbolFunction());
   ASSERT(_sym_reader_backquoted_expression->symbolFunction().notnilp());
   rt->set_macro_character_(clasp_make_standard_character('`'),
@@ -900,6 +908,7 @@ void Readtable_O::initialize() {
   //	printf("%s:%d Initializing readtable\n", __FILE__, __LINE__ );
   this->Case_ = kw::_sym_upcase;
   this->SyntaxTypes_ = HashTableEql_O::create_default();
+  this->SyntaxCacheValid_.store(false, std::memory_order_release);
   this->MacroCharacters_ = HashTableEql_O::create_default();
   this->DispatchMacroCharacters_ = HashTableEql_O::create_default();
 }
@@ -930,9 +939,41 @@ Symbol_sp Readtable_O::setf_readtable_case_(Symbol_sp newCase) {
 
 T_sp Readtable_O::set_syntax_type_(Character_sp ch, T_sp syntaxType) {
   this->SyntaxTypes_->setf_gethash(ch, syntaxType);
+  this->SyntaxCacheValid_.store(false, std::memory_order_release);
   return _lisp->_true();
 }
 
+static ReaderSyntax reader_syntax_from_symbol(T_sp syntax_type) {
+  if (syntax_type == kw::_sym_constituent) return syntax_constituent;
+  if (syntax_type == kw::_sym_whitespace) return syntax_whitespace;
+  if (syntax_type == kw::_sym_terminating_macro) return syntax_terminating_macro;
+  if (syntax_type == kw::_sym_non_terminating_macro) return syntax_non_terminating_macro;
+  if (syntax_type == kw::_sym_single_escape) return syntax_single_escape;
+  if (syntax_type == kw::_sym_multiple_escape) return syntax_multiple_escape;
+  return syntax_invalid;
+}
+
+ReaderSyntax Readtable_O::syntax_class_uncached_(claspCharacter c) const {
+  return reader_syntax_from_symbol(this->syntax_type_(clasp_make_character(c)));
+}
+
+std::atomic<uint32_t> global_readtable_syntax_stamp;
+
+void Readtable_O::fill_syntax_cache_() {
+  for ( claspCharacter c=0; c<READTABLE_SYNTAX_CACHE_SIZE; ++c ) {
+    this->SyntaxCache_[c] = this->syntax_class_uncached_(c);
+  }
+  this->SyntaxStamp_.store(global_readtable_syntax_stamp.fetch_add(1, std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+  this->SyntaxCacheValid_.store(true, std::memory_order_release);
+}
+
+ReaderSyntax reader_syntax(T_sp readtable, Character_sp chr) {
+  if (gc::IsA<Readtable_sp>(readtable))
+    return gc::As_unsafe<Readtable_sp>(readtable)->syntax_class_(chr.unsafe_character());
+  return reader_syntax_from_symbol(eval::funcall(eclector_readtable::_sym_syntax_type,readtable,chr));
+}
+
 SYMBOL_EXPORT_SC_(KeywordPkg, macro_function);
 
 T_sp Readtable_O::set_macro_character_(Character_sp ch, T_sp funcDesig, T_sp non_terminating_p) {
@@ -1054,6 +1095,7 @@ Readtable_sp Readtable_O::copyReadtable_(gc::Nilable<Readtable_sp> tdest) {
 		dest->DispatchMacroCharacters_->setf_gethash(key,table);
   });
   dest->Case_ = this->Case_;
+  dest->SyntaxCacheValid_.store(false, std::memory_order_release);
   return dest;
 }
 
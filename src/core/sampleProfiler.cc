@@ -0,0 +1,505 @@
+/*
+    File: sampleProfiler.cc
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+See directory 'clasp/licenses' for full details.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+
+/* ----------------------------------------------------------------------
+ * Statistical CPU profiler.
+ *
+ * An ITIMER_PROF timer delivers SIGPROF to whichever thread is burning
+ * CPU.  The handler walks that thread's frame pointer chain (clasp and
+ * all JITted code are compiled with frame pointers) starting from the
+ * interrupted context and appends the return addresses to one big
+ * preallocated buffer.  Slots in the buffer are claimed with a single
+ * fetch_add so the handler never takes a lock or allocates - it is cheap
+ * enough to leave running.
+ *
+ * Each sample is laid out as  [depth+1, process, pc0, pc1, ... ]  where pc0
+ * is the interrupted instruction and the rest are return addresses.
+ *
+ * Symbolization is done after the profiler stops using the same tables the
+ * backtrace code uses (lookup_address) and, for JITted and faso code that
+ * isn't in them, *jit-saved-symbol-info*.  The result is written either as
+ * folded stacks (one "a;b;c count" line per unique stack, the input to
+ * flamegraph.pl) or as an uncompressed pprof profile.proto.
+ */
+
+#include <csignal>
+#include <sched.h>
+#include <ucontext.h>
+#include <sys/time.h>
+#include <time.h>
+#include <fstream>
+#include <clasp/core/foundation.h>
+#include <clasp/core/object.h>
+#include <clasp/core/lisp.h>
+#include <clasp/core/symbolTable.h>
+#include <clasp/core/array.h>
+#include <clasp/core/predicates.h>
+#include <clasp/core/ql.h>
+#include <clasp/core/pathname.h>
+#include <clasp/core/debugger.h>
+#include <clasp/core/hashTableEqual.h>
+#include <clasp/core/mpPackage.h>
+#include <clasp/core/sampleProfiler.h>
+#include <clasp/llvmo/llvmoExpose.h>
+#include <clasp/core/wrappers.h>
+
+namespace core {
+bool maybe_demangle(const std::string& fnName, std::string& output);
+};
+
+SYMBOL_EXPORT_SC_(KeywordPkg,folded);
+SYMBOL_EXPORT_SC_(KeywordPkg,pprof);
+SYMBOL_EXPORT_SC_(KeywordPkg,current);
+SYMBOL_EXPORT_SC_(KeywordPkg,all);
+
+namespace core {
+
+#define SAMPLE_PROFILER_MAX_TARGETS 64
+
+struct SampleProfiler {
+  std::atomic<bool>     _Running;
+  std::atomic<int>      _ActiveHandlers;
+  std::atomic<size_t>   _Fill;
+  std::atomic<size_t>   _Dropped;
+  uintptr_t*            _Buffer;
+  size_t                _Capacity;
+  size_t                _MaxDepth;
+  Fixnum                _Frequency;
+  // Raw Process_O pointers of the processes to sample - zero means all of them
+  size_t                _NumTargets;
+  void*                 _Targets[SAMPLE_PROFILER_MAX_TARGETS];
+  struct sigaction      _SavedAction;
+  struct timespec       _StartTime;
+  struct timespec       _EndTime;
+  SampleProfiler() : _Running(false), _ActiveHandlers(0), _Fill(0), _Dropped(0), _Buffer(NULL), _Capacity(0), _MaxDepth(0), _Frequency(0), _NumTargets(0) {};
+};
+
+SampleProfiler global_sample_profiler;
+
+static void sample_profiler_context(void* context, uintptr_t& pc, uintptr_t& fp, uintptr_t& sp) {
+  ucontext_t* uc = (ucontext_t*)context;
+#if defined(_TARGET_OS_LINUX)
+  pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+  fp = (uintptr_t)uc->uc_mcontext.gregs[REG_RBP];
+  sp = (uintptr_t)uc->uc_mcontext.gregs[REG_RSP];
+#elif defined(_TARGET_OS_DARWIN)
+  pc = (uintptr_t)uc->uc_mcontext->__ss.__rip;
+  fp = (uintptr_t)uc->uc_mcontext->__ss.__rbp;
+  sp = (uintptr_t)uc->uc_mcontext->__ss.__rsp;
+#elif defined(_TARGET_OS_FREEBSD)
+  pc = (uintptr_t)uc->uc_mcontext.mc_rip;
+  fp = (uintptr_t)uc->uc_mcontext.mc_rbp;
+  sp = (uintptr_t)uc->uc_mcontext.mc_rsp;
+#else
+  pc = 0; fp = 0; sp = 0;
+#endif
+}
+
+/*! The SIGPROF handler - it must stay async-signal-safe.
+    No allocation, no locks, nothing that touches lisp objects beyond
+    reading the raw pointer of the current process. */
+static void sample_profiler_handler(int sig, siginfo_t* info, void* context) {
+  SampleProfiler& prof = global_sample_profiler;
+  // Count ourselves in before looking at _Running so stop can wait for us
+  prof._ActiveHandlers.fetch_add(1,std::memory_order_acq_rel);
+  if (!prof._Running.load(std::memory_order_acquire)) {
+    prof._ActiveHandlers.fetch_sub(1,std::memory_order_acq_rel);
+    return;
+  }
+  int saved_errno = errno;
+  void* process = NULL;
+  if (my_thread) process = (void*)my_thread->_Process.raw_();
+  bool wanted = (prof._NumTargets == 0);
+  for ( size_t i=0; i<prof._NumTargets; ++i ) {
+    if (prof._Targets[i] == process) wanted = true;
+  }
+  if (wanted) {
+    uintptr_t pcs[prof._MaxDepth];
+    uintptr_t pc, fp, sp;
+    sample_profiler_context(context,pc,fp,sp);
+    uintptr_t stack_top = my_thread_low_level ? (uintptr_t)my_thread_low_level->_StackTop : 0;
+    size_t depth = 0;
+    pcs[depth++] = pc;
+    // Follow the saved frame pointers while they stay on this thread's stack and keep going up
+    while (depth<prof._MaxDepth && fp>=sp && (fp+2*sizeof(uintptr_t))<=stack_top && (fp&(sizeof(uintptr_t)-1))==0) {
+      uintptr_t next_fp = ((uintptr_t*)fp)[0];
+      uintptr_t return_address = ((uintptr_t*)fp)[1];
+      if (return_address == 0) break;
+      pcs[depth++] = return_address;
+      if (next_fp <= fp) break;
+      fp = next_fp;
+    }
+    size_t need = depth+2;
+    size_t start = prof._Fill.fetch_add(need,std::memory_order_relaxed);
+    if (start+need <= prof._Capacity) {
+      uintptr_t* slot = prof._Buffer+start;
+      slot[1] = (uintptr_t)process;
+      for ( size_t i=0; i<depth; ++i ) slot[2+i] = pcs[i];
+      // Write the header last - a zero header marks the end of the samples
+      __atomic_store_n(&slot[0],(uintptr_t)(depth+1),__ATOMIC_RELEASE);
+    } else {
+      prof._Dropped.fetch_add(1,std::memory_order_relaxed);
+    }
+  }
+  prof._ActiveHandlers.fetch_sub(1,std::memory_order_acq_rel);
+  errno = saved_errno;
+}
+
+CL_LAMBDA(&key (frequency 100) (buffer-size 8388608) (max-depth 128) (threads :all));
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Start the statistical profiler.  Every 1/FREQUENCY seconds of CPU time the
+running thread records its stack into a BUFFER-SIZE byte buffer, up to MAX-DEPTH frames deep.
+THREADS is :ALL, :CURRENT or a list of mp:process objects to sample.
+Samples from the previous run are discarded.)doc");
+CL_DEFUN void core__sample_profiler_start(Fixnum frequency, Fixnum buffer_size, Fixnum max_depth, T_sp threads)
+{
+  SampleProfiler& prof = global_sample_profiler;
+  if (prof._Running.load()) {
+    SIMPLE_ERROR(BF("The sample profiler is already running"));
+  }
+  if (frequency<=0 || frequency>1000000) {
+    SIMPLE_ERROR(BF("The sample profiler frequency must be between 1 and 1000000 - not %d") % frequency);
+  }
+  if (max_depth<1 || max_depth>1024) {
+    SIMPLE_ERROR(BF("The sample profiler max-depth must be between 1 and 1024 - not %d") % max_depth);
+  }
+  size_t capacity = buffer_size/sizeof(uintptr_t);
+  if (capacity < (size_t)max_depth+2) {
+    SIMPLE_ERROR(BF("The sample profiler buffer-size %d is too small to hold one sample") % buffer_size);
+  }
+  prof._NumTargets = 0;
+  if (threads == kw::_sym_current) {
+    prof._Targets[prof._NumTargets++] = (void*)my_thread->_Process.raw_();
+  } else if (threads.consp()) {
+    for ( auto cur : (List_sp)threads ) {
+      if (prof._NumTargets>=SAMPLE_PROFILER_MAX_TARGETS) {
+        SIMPLE_ERROR(BF("The sample profiler can only be restricted to %d processes") % SAMPLE_PROFILER_MAX_TARGETS);
+      }
+      prof._Targets[prof._NumTargets++] = (void*)gc::As<mp::Process_sp>(oCar(cur)).raw_();
+    }
+  } else if (threads != kw::_sym_all) {
+    SIMPLE_ERROR(BF("The sample profiler threads must be :all, :current or a list of processes - not %s") % _rep_(threads));
+  }
+  if (prof._Buffer) free(prof._Buffer);
+  prof._Buffer = (uintptr_t*)calloc(capacity,sizeof(uintptr_t));
+  if (!prof._Buffer) {
+    SIMPLE_ERROR(BF("Could not allocate %d bytes for the sample profiler") % buffer_size);
+  }
+  prof._Capacity = capacity;
+  prof._MaxDepth = max_depth;
+  prof._Frequency = frequency;
+  prof._Fill.store(0);
+  prof._Dropped.store(0);
+  struct sigaction new_action;
+  new_action.sa_sigaction = sample_profiler_handler;
+  sigemptyset(&new_action.sa_mask);
+  new_action.sa_flags = SA_SIGINFO | SA_RESTART;
+  struct sigaction old_action;
+  if (sigaction(SIGPROF,&new_action,&old_action) != 0) {
+    SIMPLE_ERROR(BF("Could not install the SIGPROF handler for the sample profiler: %s") % strerror(errno));
+  }
+  // A previous run may have left our handler installed - keep what was there before it
+  if (!((old_action.sa_flags & SA_SIGINFO) && old_action.sa_sigaction == sample_profiler_handler)) {
+    prof._SavedAction = old_action;
+  }
+  clock_gettime(CLOCK_MONOTONIC,&prof._StartTime);
+  prof._Running.store(true,std::memory_order_release);
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = (frequency==1) ? 999999 : 1000000/frequency;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF,&timer,NULL) != 0) {
+    prof._Running.store(false);
+    sigaction(SIGPROF,&prof._SavedAction,NULL);
+    SIMPLE_ERROR(BF("Could not start the ITIMER_PROF timer for the sample profiler: %s") % strerror(errno));
+  }
+}
+
+CL_DOCSTRING("Stop the statistical profiler.  Return the number of samples recorded and the number dropped because the buffer was full.");
+CL_DEFUN T_mv core__sample_profiler_stop()
+{
+  SampleProfiler& prof = global_sample_profiler;
+  if (!prof._Running.load()) return Values(_Nil<T_O>());
+  struct itimerval timer;
+  memset(&timer,0,sizeof(timer));
+  setitimer(ITIMER_PROF,&timer,NULL);
+  prof._Running.store(false,std::memory_order_release);
+  // Let any handler that is still walking a stack on another thread finish
+  while (prof._ActiveHandlers.load(std::memory_order_acquire) != 0) sched_yield();
+  // A SIGPROF can still be pending on another thread after the timer is disarmed.
+  // Under SIG_DFL that would kill the process, so then our handler stays installed -
+  // it returns at once while _Running is false.  Any other action can take it.
+  if (prof._SavedAction.sa_handler != SIG_DFL || (prof._SavedAction.sa_flags & SA_SIGINFO)) {
+    sigaction(SIGPROF,&prof._SavedAction,NULL);
+  }
+  clock_gettime(CLOCK_MONOTONIC,&prof._EndTime);
+  size_t samples = 0;
+  size_t end = std::min(prof._Fill.load(),prof._Capacity);
+  for ( size_t pos=0; pos+2<=end && prof._Buffer[pos]!=0; pos += prof._Buffer[pos]+1 ) ++samples;
+  return Values(make_fixnum(samples),make_fixnum(prof._Dropped.load()));
+}
+
+struct ProfileSample {
+  void*                  _Process;
+  std::vector<uintptr_t> _Pcs;   // leaf first
+  bool operator<(const ProfileSample& other) const {
+    if (this->_Process != other._Process) return this->_Process < other._Process;
+    return this->_Pcs < other._Pcs;
+  }
+};
+
+/*! Collapse identical stacks in the sample buffer into counts.
+    Return addresses have one subtracted so they land inside the call
+    instruction and not in whatever follows a noreturn call. */
+static void sample_profiler_aggregate(std::map<ProfileSample,size_t>& counts) {
+  SampleProfiler& prof = global_sample_profiler;
+  if (prof._Running.load()) {
+    SIMPLE_ERROR(BF("Stop the sample profiler before looking at its samples"));
+  }
+  if (!prof._Buffer) return;
+  size_t end = std::min(prof._Fill.load(),prof._Capacity);
+  for ( size_t pos=0; pos+2<=end && prof._Buffer[pos]!=0; pos += prof._Buffer[pos]+1 ) {
+    size_t depth = prof._Buffer[pos]-1;
+    ProfileSample sample;
+    sample._Process = (void*)prof._Buffer[pos+1];
+    sample._Pcs.resize(depth);
+    for ( size_t i=0; i<depth; ++i ) {
+      uintptr_t pc = prof._Buffer[pos+2+i];
+      sample._Pcs[i] = (i==0) ? pc : pc-1;
+    }
+    counts[sample]++;
+  }
+}
+
+/*! Name the function containing address using the loaded library and
+    jitted object tables, then *jit-saved-symbol-info* */
+std::string sample_profiler_symbolize(uintptr_t address, std::map<uintptr_t,std::string>& cache) {
+  auto found = cache.find(address);
+  if (found != cache.end()) return found->second;
+  std::string name;
+  const char* symbol;
+  uintptr_t start, end;
+  char type;
+  if (lookup_address(address,symbol,start,end,type)) {
+    name = symbol;
+  } else {
+    T_sp info = llvm_sys__lookup_jit_symbol_info((void*)address);
+    if (info.consp() && cl__stringp(oCar(info))) {
+      name = gc::As_unsafe<String_sp>(oCar(info))->get_std_string();
+    }
+  }
+  if (name.size() == 0) {
+    stringstream ss;
+    ss << "0x" << std::hex << address;
+    name = ss.str();
+  } else {
+    std::string demangled;
+    if (maybe_demangle(name,demangled)) name = demangled;
+  }
+  // Folded stack lines use ; between frames and a space before the count
+  for ( auto& c : name ) if (c==';' || c=='\n') c = ':';
+  cache[address] = name;
+  return name;
+}
+
+std::map<void*,std::string> sample_profiler_process_names() {
+  std::map<void*,std::string> names;
+  for ( auto cur : _lisp->processes() ) {
+    mp::Process_sp process = gc::As<mp::Process_sp>(oCar(cur));
+    T_sp name = process->_Name;
+    names[(void*)process.raw_()] = cl__stringp(name) ? gc::As_unsafe<String_sp>(name)->get_std_string() : _rep_(name);
+  }
+  return names;
+}
+
+std::string sample_profiler_process_name(void* process, std::map<void*,std::string>& names) {
+  auto found = names.find(process);
+  if (found != names.end()) return found->second;
+  stringstream ss;
+  if (process) ss << "process@" << process;
+  else ss << "foreign-thread";
+  return ss.str();
+}
+
+CL_DOCSTRING("Return an alist of (folded-stack . count) for the samples of the last profiler run.  Each folded stack is the process name followed by the frames from the outermost in, separated by semicolons.");
+CL_DEFUN List_sp core__sample_profiler_folded_stacks()
+{
+  std::map<ProfileSample,size_t> counts;
+  sample_profiler_aggregate(counts);
+  std::map<uintptr_t,std::string> cache;
+  std::map<void*,std::string> names = sample_profiler_process_names();
+  ql::list result;
+  for ( auto& entry : counts ) {
+    stringstream ss;
+    ss << sample_profiler_process_name(entry.first._Process,names);
+    for ( auto it = entry.first._Pcs.rbegin(); it != entry.first._Pcs.rend(); ++it ) {
+      ss << ";" << sample_profiler_symbolize(*it,cache);
+    }
+    result << Cons_O::create(SimpleBaseString_O::make(ss.str()),make_fixnum(entry.second));
+  }
+  return result.cons();
+}
+
+/* ----------------------------------------------------------------------
+ * Just enough protocol buffer encoding to write pprof's profile.proto.
+ * pprof reads the uncompressed form as well as the gzipped one.
+ */
+static void pb_varint(std::string& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back((char)((value&0x7f)|0x80));
+    value >>= 7;
+  }
+  out.push_back((char)value);
+}
+
+static void pb_uint(std::string& out, int field, uint64_t value) {
+  pb_varint(out,(field<<3)|0);
+  pb_varint(out,value);
+}
+
+static void pb_bytes(std::string& out, int field, const std::string& bytes) {
+  pb_varint(out,(field<<3)|2);
+  pb_varint(out,bytes.size());
+  out += bytes;
+}
+
+static void pb_packed(std::string& out, int field, const std::vector<uint64_t>& values) {
+  std::string packed;
+  for ( auto value : values ) pb_varint(packed,value);
+  pb_bytes(out,field,packed);
+}
+
+struct PprofStrings {
+  std::vector<std::string> _Strings;
+  std::map<std::string,uint64_t> _Index;
+  PprofStrings() { this->intern(""); };
+  uint64_t intern(const std::string& str) {
+    auto found = this->_Index.find(str);
+    if (found != this->_Index.end()) return found->second;
+    uint64_t index = this->_Strings.size();
+    this->_Strings.push_back(str);
+    this->_Index[str] = index;
+    return index;
+  }
+};
+
+static std::string pprof_value_type(PprofStrings& strings, const std::string& type, const std::string& unit) {
+  std::string vt;
+  pb_uint(vt,1,strings.intern(type));
+  pb_uint(vt,2,strings.intern(unit));
+  return vt;
+}
+
+static std::string sample_profiler_pprof() {
+  SampleProfiler& prof = global_sample_profiler;
+  std::map<ProfileSample,size_t> counts;
+  sample_profiler_aggregate(counts);
+  std::map<uintptr_t,std::string> cache;
+  std::map<void*,std::string> names = sample_profiler_process_names();
+  PprofStrings strings;
+  std::map<uintptr_t,uint64_t> locations;
+  std::map<std::string,uint64_t> functions;
+  std::string profile;
+  uint64_t period = 1000000000/prof._Frequency;
+  pb_bytes(profile,1,pprof_value_type(strings,"samples","count"));
+  pb_bytes(profile,1,pprof_value_type(strings,"cpu","nanoseconds"));
+  uint64_t thread_key = strings.intern("thread");
+  for ( auto& entry : counts ) {
+    std::vector<uint64_t> location_ids;
+    for ( auto pc : entry.first._Pcs ) {
+      auto found = locations.find(pc);
+      if (found == locations.end()) {
+        found = locations.emplace(pc,locations.size()+1).first;
+      }
+      location_ids.push_back(found->second);
+    }
+    std::string sample;
+    pb_packed(sample,1,location_ids);
+    pb_packed(sample,2,std::vector<uint64_t>{entry.second,entry.second*period});
+    std::string label;
+    pb_uint(label,1,thread_key);
+    pb_uint(label,2,strings.intern(sample_profiler_process_name(entry.first._Process,names)));
+    pb_bytes(sample,3,label);
+    pb_bytes(profile,2,sample);
+  }
+  for ( auto& location : locations ) {
+    std::string name = sample_profiler_symbolize(location.first,cache);
+    auto found = functions.find(name);
+    if (found == functions.end()) {
+      found = functions.emplace(name,functions.size()+1).first;
+    }
+    std::string line;
+    pb_uint(line,1,found->second);
+    std::string loc;
+    pb_uint(loc,1,location.second);
+    pb_uint(loc,3,location.first);
+    pb_bytes(loc,4,line);
+    pb_bytes(profile,4,loc);
+  }
+  for ( auto& function : functions ) {
+    std::string fn;
+    pb_uint(fn,1,function.second);
+    pb_uint(fn,2,strings.intern(function.first));
+    pb_uint(fn,3,strings.intern(function.first));
+    pb_bytes(profile,5,fn);
+  }
+  for ( auto& str : strings._Strings ) pb_bytes(profile,6,str);
+  uint64_t start_ns = (uint64_t)prof._StartTime.tv_sec*1000000000+prof._StartTime.tv_nsec;
+  uint64_t end_ns = (uint64_t)prof._EndTime.tv_sec*1000000000+prof._EndTime.tv_nsec;
+  pb_uint(profile,10,end_ns-start_ns);
+  pb_bytes(profile,11,pprof_value_type(strings,"cpu","nanoseconds"));
+  pb_uint(profile,12,period);
+  return profile;
+}
+
+CL_LAMBDA(pathname &key (format :folded));
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Write the samples of the last profiler run to PATHNAME.
+FORMAT :FOLDED writes folded stacks for flamegraph.pl, :PPROF writes a profile.proto for pprof.)doc");
+CL_DEFUN void core__sample_profiler_write(T_sp pathname, T_sp format)
+{
+  std::string filename = core__coerce_to_filename(pathname)->get_std_string();
+  std::ofstream fout(filename,std::ios::out|std::ios::binary|std::ios::trunc);
+  if (!fout) {
+    SIMPLE_ERROR(BF("Could not open %s to write the profile") % filename);
+  }
+  if (format == kw::_sym_folded) {
+    List_sp stacks = core__sample_profiler_folded_stacks();
+    for ( auto cur : stacks ) {
+      Cons_sp entry = gc::As<Cons_sp>(oCar(cur));
+      fout << gc::As<String_sp>(oCar(entry))->get_std_string() << " " << unbox_fixnum(gc::As<Fixnum_sp>(oCdr(entry))) << std::endl;
+    }
+  } else if (format == kw::_sym_pprof) {
+    std::string profile = sample_profiler_pprof();
+    fout.write(profile.data(),profile.size());
+  } else {
+    SIMPLE_ERROR(BF("The profile format must be :folded or :pprof - not %s") % _rep_(format));
+  }
+  fout.close();
+}
+
+};
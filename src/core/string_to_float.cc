@@ -0,0 +1,380 @@
+/*
+    File: string_to_float.cc
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+See directory 'clasp/licenses' for full details.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+
+/*
+ * Decimal to binary float conversion.
+ *
+ * The decimal is first read into a 64 bit significand w and a power of
+ * ten q.  Small exact cases use Clinger's fast path (one exact floating
+ * point multiply or divide).  Everything else goes through the
+ * Eisel-Lemire algorithm (Daniel Lemire, "Number Parsing at a Gigabyte
+ * per Second", 2021) which multiplies w by a 128 bit approximation of
+ * 5^q and can tell when that approximation is good enough to round
+ * correctly.  The rare inputs where it can't, and inputs with more than
+ * 19 significant digits whose rounding depends on the dropped digits,
+ * fall back to strtod/strtof which are exact.
+ */
+
+#include <clasp/core/foundation.h>
+#include <clasp/core/object.h>
+#include <clasp/core/numbers.h>
+#include <clasp/core/character.h>
+#include <clasp/core/symbolTable.h>
+#include <clasp/core/array.h>
+#include <clasp/core/sequence.h>
+#include <clasp/core/lispStream.h>
+#include <clasp/core/clasp_gmpxx.h>
+#include <clasp/core/string_to_float.h>
+#include <clasp/core/wrappers.h>
+
+namespace core {
+
+#define EL_SMALLEST_POWER_OF_TEN -342
+#define EL_LARGEST_POWER_OF_TEN 308
+#define EL_TABLE_SIZE (EL_LARGEST_POWER_OF_TEN - EL_SMALLEST_POWER_OF_TEN + 1)
+#define EL_MAX_DIGITS 19
+
+typedef unsigned __int128 el_uint128;
+
+/*! 128 bit truncated approximations of 5^q with the top bit set, computed
+    with GMP the first time a float is parsed. */
+struct EiselLemireTable {
+  uint64_t high[EL_TABLE_SIZE];
+  uint64_t low[EL_TABLE_SIZE];
+  EiselLemireTable() {
+    mpz_class two128 = mpz_class(1) << 128;
+    mpz_class two127 = mpz_class(1) << 127;
+    for (int q = EL_SMALLEST_POWER_OF_TEN; q <= EL_LARGEST_POWER_OF_TEN; ++q) {
+      mpz_class c;
+      if (q < 0) {
+        mpz_class power5;
+        mpz_ui_pow_ui(power5.get_mpz_t(), 5, -q);
+        size_t z = mpz_sizeinbase(power5.get_mpz_t(), 2);
+        // mpz_sizeinbase gives bits, z is ceil(log2(5^-q)) since 5^-q isn't a power of two
+        size_t b = (q >= -27) ? z + 127 : 2 * z + 2 * 64;
+        c = (mpz_class(1) << b) / power5 + 1;
+        while (c >= two128) c >>= 1;
+      } else {
+        mpz_ui_pow_ui(c.get_mpz_t(), 5, q);
+        while (c < two127) c <<= 1;
+        while (c >= two128) c >>= 1;
+      }
+      mpz_class mask = (mpz_class(1) << 64) - 1;
+      mpz_class lo = c & mask;
+      mpz_class hi = c >> 64;
+      this->high[q - EL_SMALLEST_POWER_OF_TEN] = mpz_get_ui(hi.get_mpz_t());
+      this->low[q - EL_SMALLEST_POWER_OF_TEN] = mpz_get_ui(lo.get_mpz_t());
+    }
+  }
+};
+
+static const EiselLemireTable &eisel_lemire_table() {
+  static EiselLemireTable table;
+  return table;
+}
+
+struct DoubleFormat {
+  typedef double float_type;
+  typedef uint64_t bits_type;
+  static const int mantissa_explicit_bits = 52;
+  static const int minimum_exponent = -1023;
+  static const int infinite_power = 0x7FF;
+  static const int min_exponent_round_to_even = -4;
+  static const int max_exponent_round_to_even = 23;
+  static const int smallest_power_of_ten = -342;
+  static const int largest_power_of_ten = 308;
+  static const int max_exponent_fast_path = 22;
+  static float_type exact_power_of_ten(int q) {
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    return powers[q];
+  }
+  static float_type strto(const char *str) { return ::strtod(str, NULL); }
+};
+
+struct SingleFormat {
+  typedef float float_type;
+  typedef uint32_t bits_type;
+  static const int mantissa_explicit_bits = 23;
+  static const int minimum_exponent = -127;
+  static const int infinite_power = 0xFF;
+  static const int min_exponent_round_to_even = -17;
+  static const int max_exponent_round_to_even = 10;
+  static const int smallest_power_of_ten = -65;
+  static const int largest_power_of_ten = 38;
+  static const int max_exponent_fast_path = 10;
+  static float_type exact_power_of_ten(int q) {
+    static const float powers[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    return powers[q];
+  }
+  static float_type strto(const char *str) { return ::strtof(str, NULL); }
+};
+
+/*! Compute the biased exponent and explicit mantissa bits of w * 10^q.
+    Return false if the result can't be determined this way. */
+template <typename Format>
+static bool eisel_lemire(int64_t q, uint64_t w, uint64_t &mantissa, int32_t &power2) {
+  if (w == 0 || q < Format::smallest_power_of_ten) {
+    mantissa = 0;
+    power2 = 0;
+    return true;
+  }
+  if (q > Format::largest_power_of_ten) {
+    mantissa = 0;
+    power2 = Format::infinite_power;
+    return true;
+  }
+  const EiselLemireTable &table = eisel_lemire_table();
+  int lz = __builtin_clzll(w);
+  w <<= lz;
+  const uint64_t precision_mask = 0xFFFFFFFFFFFFFFFFull >> (Format::mantissa_explicit_bits + 3);
+  size_t index = q - EL_SMALLEST_POWER_OF_TEN;
+  el_uint128 first = (el_uint128)w * table.high[index];
+  uint64_t high = (uint64_t)(first >> 64);
+  uint64_t low = (uint64_t)first;
+  if ((high & precision_mask) == precision_mask) {
+    // The truncated product is too close to a rounding boundary, use the low word of 5^q too
+    el_uint128 second = (el_uint128)w * table.low[index];
+    uint64_t secondHigh = (uint64_t)(second >> 64);
+    low += secondHigh;
+    if (secondHigh > low) high++;
+  }
+  if (low == 0xFFFFFFFFFFFFFFFFull && (q < -27 || q > 55)) return false;
+  int upperbit = (int)(high >> 63);
+  int shift = upperbit + 64 - Format::mantissa_explicit_bits - 3;
+  mantissa = high >> shift;
+  power2 = (int32_t)((((152170 + 65536) * (int32_t)q) >> 16) + 63) + upperbit - lz - Format::minimum_exponent;
+  if (power2 <= 0) {
+    // Subnormal
+    if (-power2 + 1 >= 64) {
+      mantissa = 0;
+      power2 = 0;
+      return true;
+    }
+    mantissa >>= -power2 + 1;
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    power2 = (mantissa < (1ull << Format::mantissa_explicit_bits)) ? 0 : 1;
+    return true;
+  }
+  if (low <= 1 && q >= Format::min_exponent_round_to_even && q <= Format::max_exponent_round_to_even && (mantissa & 3) == 1) {
+    // Exactly halfway between two floats - round to even
+    if ((mantissa << shift) == high) mantissa &= ~1ull;
+  }
+  mantissa += (mantissa & 1);
+  mantissa >>= 1;
+  if (mantissa >= (2ull << Format::mantissa_explicit_bits)) {
+    mantissa = (1ull << Format::mantissa_explicit_bits);
+    power2++;
+  }
+  mantissa &= ~(1ull << Format::mantissa_explicit_bits);
+  if (power2 >= Format::infinite_power) {
+    power2 = Format::infinite_power;
+    mantissa = 0;
+  }
+  return true;
+}
+
+static inline bool exponent_marker_p(char c) {
+  switch (c) {
+  case 'e': case 'E':
+  case 's': case 'S':
+  case 'f': case 'F':
+  case 'd': case 'D':
+  case 'l': case 'L':
+      return true;
+  default:
+      return false;
+  }
+}
+
+/*! Scan a decimal float into w * 10^q, at most EL_MAX_DIGITS significant
+    digits are kept and truncated is set if nonzero digits were dropped. */
+static bool scan_decimal_float(const char *cur, const char *end, bool &negative, uint64_t &w, int64_t &q, bool &truncated) {
+  negative = false;
+  w = 0;
+  q = 0;
+  truncated = false;
+  if (cur < end && (*cur == '+' || *cur == '-')) {
+    negative = (*cur == '-');
+    ++cur;
+  }
+  size_t digits = 0;
+  size_t significant = 0;
+  for (; cur < end && isdigit(*cur); ++cur, ++digits) {
+    if (significant < EL_MAX_DIGITS) {
+      w = w * 10 + (*cur - '0');
+      if (w) ++significant;
+    } else {
+      ++q;
+      truncated |= (*cur != '0');
+    }
+  }
+  if (cur < end && *cur == '.') {
+    ++cur;
+    for (; cur < end && isdigit(*cur); ++cur, ++digits) {
+      if (significant < EL_MAX_DIGITS) {
+        w = w * 10 + (*cur - '0');
+        if (w) ++significant;
+        --q;
+      } else {
+        truncated |= (*cur != '0');
+      }
+    }
+  }
+  if (digits == 0) return false;
+  if (cur < end && exponent_marker_p(*cur)) {
+    ++cur;
+    bool negativeExponent = false;
+    if (cur < end && (*cur == '+' || *cur == '-')) {
+      negativeExponent = (*cur == '-');
+      ++cur;
+    }
+    if (cur == end || !isdigit(*cur)) return false;
+    int64_t exponent = 0;
+    for (; cur < end && isdigit(*cur); ++cur) {
+      // Anything this large is zero or infinity anyway
+      if (exponent < 0x10000000) exponent = exponent * 10 + (*cur - '0');
+    }
+    q += negativeExponent ? -exponent : exponent;
+  }
+  return cur == end;
+}
+
+template <typename Format>
+static typename Format::float_type assemble_float(bool negative, uint64_t mantissa, int32_t power2) {
+  typename Format::bits_type bits = (typename Format::bits_type)(mantissa | ((uint64_t)power2 << Format::mantissa_explicit_bits));
+  if (negative) bits |= (typename Format::bits_type)1 << (sizeof(bits) * 8 - 1);
+  typename Format::float_type result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+template <typename Format>
+static bool parse_decimal_float(const char *begin, const char *end, typename Format::float_type &result) {
+  typedef typename Format::float_type float_type;
+  bool negative;
+  uint64_t w;
+  int64_t q;
+  bool truncated;
+  if (!scan_decimal_float(begin, end, negative, w, q, truncated)) return false;
+  if (!truncated && q >= -Format::max_exponent_fast_path && q <= Format::max_exponent_fast_path && w <= (2ull << Format::mantissa_explicit_bits)) {
+    // Clinger's fast path - w and 10^|q| are both exact so one rounding gives the right answer
+    float_type value = (float_type)w;
+    if (q < 0) value = value / Format::exact_power_of_ten(-q);
+    else value = value * Format::exact_power_of_ten(q);
+    result = negative ? -value : value;
+    return true;
+  }
+  uint64_t mantissa;
+  int32_t power2;
+  bool ok = eisel_lemire<Format>(q, w, mantissa, power2);
+  if (ok && truncated) {
+    // The exact value lies between w and w+1 times 10^q, both must round the same way
+    uint64_t mantissaUp;
+    int32_t power2Up;
+    ok = eisel_lemire<Format>(q, w + 1, mantissaUp, power2Up) && mantissa == mantissaUp && power2 == power2Up;
+  }
+  if (ok) {
+    result = assemble_float<Format>(negative, mantissa, power2);
+    return true;
+  }
+  // Hard case - let the C library do it exactly
+  std::string str(begin, end);
+  for (size_t i = 0; i < str.size(); ++i) {
+    if (exponent_marker_p(str[i])) str[i] = 'e';
+  }
+  result = Format::strto(str.c_str());
+  return true;
+}
+
+bool clasp_parse_double(const char *begin, const char *end, double &result) {
+  return parse_decimal_float<DoubleFormat>(begin, end, result);
+}
+
+bool clasp_parse_single_float(const char *begin, const char *end, float &result) {
+  return parse_decimal_float<SingleFormat>(begin, end, result);
+}
+
+CL_LAMBDA(string &key (start 0) end (type 'double-float));
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Parse a decimal float from STRING between START and END, ignoring surrounding whitespace.
+TYPE is the float type to return. Any exponent marker is accepted and doesn't change the type.
+Return the float and the index where parsing stopped.)doc");
+CL_DEFUN T_mv core__parse_float(String_sp str, Fixnum start, T_sp end, T_sp type) {
+  Fixnum limit = cl__length(str);
+  Fixnum iend = limit;
+  if (end.notnilp()) {
+    if (!end.fixnump() || end.unsafe_fixnum() < 0 || end.unsafe_fixnum() > limit) {
+      ERROR_WRONG_TYPE_KEY_ARG(core::_sym_parse_float, kw::_sym_end, end,
+                               Integer_O::makeIntegerType(0, limit));
+    }
+    iend = end.unsafe_fixnum();
+  }
+  if ((start < 0) || (start > iend)) {
+    ERROR_WRONG_TYPE_KEY_ARG(core::_sym_parse_float, kw::_sym_start, make_fixnum(start),
+                             Integer_O::makeIntegerType(0, iend));
+  }
+  Fixnum istart = start;
+  char small[64];
+  std::string large;
+  char *chars = small;
+  if ((size_t)(iend - istart) >= sizeof(small)) {
+    large.resize(iend - istart);
+    chars = &large[0];
+  }
+  size_t len = 0;
+  for (Fixnum i = istart; i < iend; ++i) {
+    claspCharacter c = str->rowMajorAref(i).unsafe_character();
+    if (c >= 128) PARSE_ERROR(SimpleBaseString_O::make("Could not parse float from ~S"), Cons_O::create(str, _Nil<T_O>()));
+    chars[len++] = (char)c;
+  }
+  // Optional leading and trailing whitespace is ignored like parse-integer
+  const char *begin = chars;
+  const char *stop = chars + len;
+  while (begin < stop && isspace(*begin)) ++begin;
+  while (stop > begin && isspace(stop[-1])) --stop;
+  if (type == cl::_sym_single_float || type == cl::_sym_ShortFloat_O) {
+    float f;
+    if (clasp_parse_single_float(begin, stop, f)) {
+      return Values(clasp_make_single_float(f), make_fixnum(iend));
+    }
+  } else if (type == cl::_sym_double_float || type == cl::_sym_LongFloat_O) {
+    double d;
+    if (clasp_parse_double(begin, stop, d)) {
+      return Values(DoubleFloat_O::create(d), make_fixnum(iend));
+    }
+  } else {
+    SIMPLE_ERROR(BF("parse-float type must be a float type - got %s") % _rep_(type));
+  }
+  PARSE_ERROR(SimpleBaseString_O::make("Could not parse float from ~S"), Cons_O::create(str, _Nil<T_O>()));
+  UNREACHABLE();
+}
+
+SYMBOL_EXPORT_SC_(CorePkg, parse_float);
+
+};
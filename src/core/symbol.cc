@@ -206,12 +206,16 @@ Symbol_O::Symbol_O(bool dummy) : _HomePackage(_Nil<T_O>()),
                                  _SetfFunction(_Unbound<Function_O>()),
                                  _BindingIdx(NO_THREAD_LOCAL_BINDINGS),
                                  _Flags(0),
-                                 _PropertyList(_Nil<List_V>()) {};
+                                 _PropertyList(_Nil<List_V>()),
+                                 _PrintPackageCache(0),
+                                 _PrintEscapeCache(0) {};
 
 Symbol_O::Symbol_O() : Base(),
                        _BindingIdx(NO_THREAD_LOCAL_BINDINGS),
                        _Flags(0),
-                       _PropertyList(_Nil<List_V>()) {};
+                       _PropertyList(_Nil<List_V>()),
+                       _PrintPackageCache(0),
+                       _PrintEscapeCache(0) {};
 
 
 void Symbol_O::finish_setup(Package_sp pkg, bool exportp, bool shadowp) {
@@ -519,6 +523,12 @@ void Symbol_O::setPackage(T_sp p) {
   ASSERTF(p, BF("The package is UNDEFINED"));
   ASSERT(p.nilp() || gc::IsA<Package_sp>(p));
   this->_HomePackage.store(p, std::memory_order_relaxed);
+  bump_package_epoch();
+}
+
+void Symbol_O::setPackageOfFreshSymbol(T_sp p) {
+  ASSERT(p.nilp() || gc::IsA<Package_sp>(p));
+  this->_HomePackage.store(p, std::memory_order_relaxed);
 }
 
 SYMBOL_EXPORT_SC_(ClPkg, make_symbol);
@@ -45,6 +45,7 @@ THE SOFTWARE.
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <unistd.h>
 #include <pthread.h> // TODO: PORTING - frgo, 2017-08-04
 #include <signal.h>  // TODO: PORTING - frgo, 2017-08-04
@@ -128,6 +129,9 @@ SYMBOL_EXPORT_SC_(KeywordPkg, type);
 SYMBOL_EXPORT_SC_(KeywordPkg, up);
 SYMBOL_EXPORT_SC_(KeywordPkg, version);
 SYMBOL_EXPORT_SC_(KeywordPkg, wild);
+SYMBOL_EXPORT_SC_(KeywordPkg, address_space);
+SYMBOL_EXPORT_SC_(KeywordPkg, data);
+SYMBOL_EXPORT_SC_(KeywordPkg, cpu_time);
 
 
 #if defined( _TARGET_OS_DARWIN ) || defined( _TARGET_OS_FREEBSD )
@@ -1894,6 +1898,29 @@ CL_DEFUN int core__setpgrp()
   return pid;
 }
 
+CL_LAMBDA(resource soft &optional (hard nil hardp));
+CL_DOCSTRING(R"doc(Invoke unix setrlimit for RESOURCE - :address-space (bytes), :data (bytes)
+or :cpu-time (seconds).  NIL means no limit.  HARD defaults to the current hard limit.
+Signal an error if setrlimit failed.  The GC and the JIT reserve much more address
+space than they use, so to cap memory use limit :data rather than :address-space.)doc");
+CL_DEFUN void core__setrlimit(Symbol_sp resource, T_sp soft, T_sp hard, T_sp hardp)
+{
+  int which;
+  if (resource == kw::_sym_address_space) which = RLIMIT_AS;
+  else if (resource == kw::_sym_data) which = RLIMIT_DATA;
+  else if (resource == kw::_sym_cpu_time) which = RLIMIT_CPU;
+  else SIMPLE_ERROR(BF("Unknown resource %s - use :address-space, :data or :cpu-time") % _rep_(resource));
+  struct rlimit limit;
+  if (getrlimit(which, &limit) != 0) {
+    SIMPLE_ERROR(BF("getrlimit failed - error: %s") % strerror(errno));
+  }
+  limit.rlim_cur = soft.nilp() ? RLIM_INFINITY : (rlim_t)clasp_to_size(soft);
+  if (hardp.notnilp()) limit.rlim_max = hard.nilp() ? RLIM_INFINITY : (rlim_t)clasp_to_size(hard);
+  if (setrlimit(which, &limit) != 0) {
+    SIMPLE_ERROR(BF("setrlimit failed - error: %s") % strerror(errno));
+  }
+}
+
 CL_DOCSTRING("Return (values pipe0 pipe1). Signal an error if pipe failed.");
 CL_DEFUN T_mv core__pipe()
 {
@@ -58,7 +58,7 @@ namespace core {
 static bool
 potential_number_p(String_sp s, int base) {
   /* See ANSI 2.3.1.1 */
-  static cl_index i, l;
+  cl_index i, l;
   claspCharacter c;
   /* A potential number must contain at least one digit */
   bool some_digit = false;
@@ -122,8 +122,7 @@ needs_to_be_escaped(String_sp s, T_sp readtable) {
   for (cl_index i = 0, iEnd(s->length()); i < iEnd; i++) {
     claspCharacter c = clasp_as_claspCharacter(cl__char(s,i));
     Character_sp cc = clasp_make_character(c);
-    Symbol_sp syntax = core__syntax_type(readtable, cc);
-    if (syntax != kw::_sym_constituent ||
+    if (reader_syntax(readtable, cc) != syntax_constituent ||
         clasp_invalid_base_char_p(c) ||
         (c) == ':')
       return 1;
@@ -189,11 +188,105 @@ forced_print_package(T_sp package) {
   return result;
 }
 
+/* Symbol_O::_PrintEscapeCache remembers whether the symbol's name has to be
+   escaped under one readtable syntax, readtable case and *PRINT-BASE*:
+     bits 0-31   SyntaxStamp_ of the readtable
+     bits 32-37  print base
+     bits 38-39  readtable case
+     bits 40-41  0 = empty, 1 = printed as is, 2 = escaped */
+#define PRINT_ESCAPE_KEY_MASK ((((uint64_t)1) << 40) - 1)
+#define PRINT_ESCAPE_VALUE_SHIFT 40
+
+static bool
+symbol_needs_to_be_escaped(Symbol_sp x, SimpleString_sp name, T_sp readtable) {
+  if (x.nilp() || !gc::IsA<Readtable_sp>(readtable))
+    return needs_to_be_escaped(name, readtable) || all_dots(name);
+  Readtable_sp rt = gc::As_unsafe<Readtable_sp>(readtable);
+  uint64_t key = (uint64_t)rt->syntax_stamp_() |
+                 ((uint64_t)clasp_print_base() << 32) |
+                 ((uint64_t)rt->getReadtableCaseAsEnum_() << 38);
+  uint64_t cached = x->_PrintEscapeCache.load(std::memory_order_relaxed);
+  if ((cached & PRINT_ESCAPE_KEY_MASK) == key && (cached >> PRINT_ESCAPE_VALUE_SHIFT) != 0)
+    return (cached >> PRINT_ESCAPE_VALUE_SHIFT) == 2;
+  bool escape = needs_to_be_escaped(name, readtable) || all_dots(name);
+  x->_PrintEscapeCache.store(key | ((uint64_t)(escape ? 2 : 1) << PRINT_ESCAPE_VALUE_SHIFT),
+                             std::memory_order_relaxed);
+  return escape;
+}
+
+typedef enum { prefix_none = 1,
+               prefix_external,
+               prefix_internal,
+               prefix_unprintable,
+               prefix_pathological } SymbolPrefix;
+
+/* Symbol_O::_PrintPackageCache remembers the prefix the symbol needs while
+   one package is current:
+     bits 0-31   package epoch
+     bits 32-61  low bits of the current package's _Serial
+     bits 62-63  0 = empty, else prefix_none, prefix_external or prefix_internal
+   Any change to any package bumps the epoch, so the entry is never stale. */
+#define PRINT_PACKAGE_SERIAL_MASK ((((uint64_t)1) << 30) - 1)
+#define PRINT_PACKAGE_KEY_MASK ((((uint64_t)1) << 62) - 1)
+#define PRINT_PACKAGE_VALUE_SHIFT 62
+
+static SymbolPrefix
+symbol_prefix_uncached(Symbol_sp x, SimpleString_sp name, T_sp package, bool forced_package) {
+  if (!forced_package) {
+    T_mv symbol_mv = cl__find_symbol(name, _lisp->getCurrentPackage());
+    Symbol_sp sym = symbol_mv;
+    Symbol_sp intern_flag = gc::As<Symbol_sp>(symbol_mv.valueGet_(1));
+    if ((sym == x) && intern_flag.notnilp())
+      return prefix_none;
+  }
+  if (x.nilp())
+    return prefix_external;
+  Symbol_mv sym2_mv = gc::As<Package_sp>(package)->findSymbol_SimpleString(name);
+  Symbol_sp sym2 = sym2_mv;
+  Symbol_sp intern_flag2 = gc::As<Symbol_sp>(sym2_mv.valueGet_(1));
+  if (sym2 != x)
+    return prefix_unprintable;
+  if (intern_flag2 == kw::_sym_internal || forced_package)
+    return prefix_internal;
+  if (intern_flag2 == kw::_sym_external)
+    return prefix_external;
+  return prefix_pathological;
+}
+
+static SymbolPrefix
+symbol_prefix(Symbol_sp x, SimpleString_sp name, T_sp package, bool forced_package) {
+  if (x.nilp() || forced_package)
+    return symbol_prefix_uncached(x, name, package, forced_package);
+  // Read the epoch before looking anything up, so a racing change leaves a stale entry
+  uint32_t epoch = package_epoch();
+  Package_sp current = _lisp->getCurrentPackage();
+  uint64_t key = (uint64_t)epoch |
+                 (((uint64_t)current->_Serial & PRINT_PACKAGE_SERIAL_MASK) << 32);
+  uint64_t cached = x->_PrintPackageCache.load(std::memory_order_relaxed);
+  if ((cached & PRINT_PACKAGE_KEY_MASK) == key && (cached >> PRINT_PACKAGE_VALUE_SHIFT) != 0)
+    return (SymbolPrefix)(cached >> PRINT_PACKAGE_VALUE_SHIFT);
+  SymbolPrefix prefix = symbol_prefix_uncached(x, name, package, false);
+  // Only cache what we computed for the home package the epoch vouches for
+  if (prefix <= prefix_internal && x->homePackage() == package) {
+    x->_PrintPackageCache.store(key | ((uint64_t)prefix << PRINT_PACKAGE_VALUE_SHIFT),
+                                std::memory_order_relaxed);
+  }
+  return prefix;
+}
+
+static void
+write_unprintable_symbol(const char *kind, Symbol_sp x, T_sp stream) {
+  clasp_write_string(kind, stream);
+  stringstream ss;
+  ss << (void *)x.raw_();
+  clasp_write_string(ss.str(), stream);
+  clasp_write_string(">", stream);
+}
+
 void clasp_write_symbol(Symbol_sp x, T_sp stream) {
   T_sp readtable = _lisp->getCurrentReadTable();
   T_sp print_case = clasp_print_case();
   bool print_readably = clasp_print_readably();
-  bool forced_package = 0;
 
   T_sp package;
   SimpleString_sp name;
@@ -220,55 +313,30 @@ void clasp_write_symbol(Symbol_sp x, T_sp stream) {
   } else if (package == _lisp->keywordPackage()) {
     clasp_write_char(':', stream);
   } else {
-    bool print_package = false;
-    if ((forced_package = forced_print_package(package)))
-      print_package = true;
-    if (!print_package) {
-      T_mv symbol_mv = cl__find_symbol(name, _lisp->getCurrentPackage());
-      Symbol_sp sym = symbol_mv;
-      Symbol_sp intern_flag = gc::As<Symbol_sp>(symbol_mv.valueGet_(1));
-      if ((sym != x) || intern_flag.nilp())
-        print_package = true;
-    }
-    if (print_package) {
-      SimpleBaseString_sp name = SimpleBaseString_O::make(gc::As<Package_sp>(package)->packageName());
-      write_symbol_string(name, cl__readtable_case(readtable),
+    SymbolPrefix prefix = symbol_prefix(x, name, package, forced_print_package(package));
+    if (prefix != prefix_none) {
+      SimpleString_sp package_name = gc::As<Package_sp>(package)->_Name;
+      write_symbol_string(package_name, cl__readtable_case(readtable),
                           print_case, stream,
-                          needs_to_be_escaped(gc::As<Array_sp>(name), readtable));
-      if (!x.nilp()) {
-        Symbol_mv sym2_mv = cl__find_symbol(x->symbolName(), package);
-        Symbol_sp sym2 = sym2_mv;
-        Symbol_sp intern_flag2 = gc::As<Symbol_sp>(sym2_mv.valueGet_(1));
-        if (sym2 != x) {
-          clasp_write_string("<UNPRINTABLE-SYMBOL@", stream);
-          stringstream ss;
-          ss << (void *)x.raw_();
-          clasp_write_string(ss.str(), stream);
-          clasp_write_string(">", stream);
-          return;
-          SIMPLE_ERROR(BF("Can't print symbol"));
-        }
-        if (intern_flag2 == kw::_sym_internal || forced_package) {
-          clasp_write_string("::", stream);
-        } else if (intern_flag2 == kw::_sym_external) {
-          clasp_write_char(':', stream);
-        } else {
-          clasp_write_string("<PATHOLOGICAL-SYMBOL@", stream);
-          stringstream ss;
-          ss << (void *)x.raw_();
-          clasp_write_string(ss.str(), stream);
-          clasp_write_string(">", stream);
-          return;
-          SIMPLE_ERROR(BF("Pathological symbol --- cannot print"));
-        }
-      } else {
+                          needs_to_be_escaped(package_name, readtable));
+      switch (prefix) {
+      case prefix_external:
         clasp_write_char(':', stream);
+        break;
+      case prefix_internal:
+        clasp_write_string("::", stream);
+        break;
+      case prefix_unprintable:
+        write_unprintable_symbol("<UNPRINTABLE-SYMBOL@", x, stream);
+        return;
+      default:
+        write_unprintable_symbol("<PATHOLOGICAL-SYMBOL@", x, stream);
+        return;
       }
     }
   }
   write_symbol_string(name, cl__readtable_case(readtable), print_case, stream,
-                      needs_to_be_escaped(name, readtable) ||
-                          all_dots(name));
+                      symbol_needs_to_be_escaped(x, name, readtable));
 }
 
 void Symbol_O::__write__(T_sp stream) const {
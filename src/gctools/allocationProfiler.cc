@@ -0,0 +1,394 @@
+/*
+    File: allocationProfiler.cc
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+See directory 'clasp/licenses' for full details.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+
+/* ----------------------------------------------------------------------
+ * Sampling allocation profiler.
+ *
+ * registerAllocation counts down a per-thread byte budget and calls
+ * HitAllocationSampleThreshold when it runs out.  While the profiler is off
+ * that just refills the budget with ALLOCATION_SAMPLE_IDLE_BYTES.  While it is
+ * on, the stamp, size and a frame pointer backtrace of the allocation are
+ * appended to a malloc'd buffer and the budget is set to the sample interval
+ * with some jitter so that periodic allocation patterns don't alias.
+ *
+ * We are inside the allocator when this runs so nothing here may allocate
+ * from the GC - slots in the buffer are claimed with fetch_add just like the
+ * CPU sampler in sampleProfiler.cc, which also provides the symbolization.
+ *
+ * Each sample records the bytes allocated since the previous one as its
+ * weight, so summing weights estimates the bytes allocated at each site.
+ * The weight is measured against the jittered budget the thread actually
+ * drew.  The first sample a thread takes after the profiler starts follows an
+ * idle budget, which counts bytes from before the start, so it is weighted
+ * with the mean sample interval instead.
+ */
+
+#include <sched.h>
+#include <fstream>
+#include <iomanip>
+#include <clasp/core/foundation.h>
+#include <clasp/core/object.h>
+#include <clasp/core/lisp.h>
+#include <clasp/core/symbolTable.h>
+#include <clasp/core/array.h>
+#include <clasp/core/instance.h>
+#include <clasp/core/ql.h>
+#include <clasp/core/pathname.h>
+#include <clasp/core/mpPackage.h>
+#include <clasp/core/sampleProfiler.h>
+#include <clasp/gctools/gc_interface.h>
+#include <clasp/core/wrappers.h>
+
+SYMBOL_EXPORT_SC_(GcToolsPkg,with_allocation_profiling);
+SYMBOL_EXPORT_SC_(KeywordPkg,report);
+
+namespace gctools {
+
+struct AllocationProfiler {
+  std::atomic<bool>     _Running;
+  std::atomic<int>      _ActiveSamplers;
+  std::atomic<size_t>   _Fill;
+  std::atomic<size_t>   _Dropped;
+  uintptr_t*            _Buffer;
+  size_t                _Capacity;
+  size_t                _MaxDepth;
+  int64_t               _SampleInterval;
+  AllocationProfiler() : _Running(false), _ActiveSamplers(0), _Fill(0), _Dropped(0), _Buffer(NULL), _Capacity(0), _MaxDepth(0), _SampleInterval(0) {};
+};
+
+AllocationProfiler global_allocation_profiler;
+
+THREAD_LOCAL uint64_t my_allocation_sample_seed = 0;
+
+/*! Uniform in [interval/2,3*interval/2) from a per-thread xorshift generator */
+static int64_t next_sample_interval(int64_t interval) {
+  uint64_t x = my_allocation_sample_seed;
+  if (x==0) x = (uint64_t)&my_allocation_sample_seed | 1;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  my_allocation_sample_seed = x;
+  return interval/2 + (int64_t)(x % (uint64_t)interval);
+}
+
+__attribute__((noinline)) void HitAllocationSampleThreshold(GlobalAllocationProfiler* allocations, stamp_t stamp, size_t size) {
+  AllocationProfiler& prof = global_allocation_profiler;
+  // Count ourselves in before looking at _Running so stop can wait for us
+  prof._ActiveSamplers.fetch_add(1,std::memory_order_acq_rel);
+  if (!prof._Running.load(std::memory_order_acquire)) {
+    prof._ActiveSamplers.fetch_sub(1,std::memory_order_acq_rel);
+    allocations->_SampleCountdown = ALLOCATION_SAMPLE_IDLE_BYTES;
+    allocations->_SampleBudget = 0;
+    return;
+  }
+  // Bytes allocated since the last sample, including the one that crossed the threshold
+  int64_t weight = allocations->_SampleBudget ? allocations->_SampleBudget-allocations->_SampleCountdown : prof._SampleInterval;
+  allocations->_SampleBudget = next_sample_interval(prof._SampleInterval);
+  allocations->_SampleCountdown = allocations->_SampleBudget;
+  uintptr_t fp = (uintptr_t)__builtin_frame_address(0);
+  uintptr_t sp = fp;
+  uintptr_t stack_top = (uintptr_t)my_thread_low_level->_StackTop;
+  size_t max_depth = prof._MaxDepth;
+  size_t need = max_depth+4;
+  size_t start = prof._Fill.fetch_add(need,std::memory_order_relaxed);
+  if (start+need > prof._Capacity) {
+    prof._Dropped.fetch_add(1,std::memory_order_relaxed);
+    prof._ActiveSamplers.fetch_sub(1,std::memory_order_acq_rel);
+    return;
+  }
+  uintptr_t* slot = prof._Buffer+start;
+  size_t depth = 0;
+  while (depth<max_depth && fp>=sp && (fp+2*sizeof(uintptr_t))<=stack_top && (fp&(sizeof(uintptr_t)-1))==0) {
+    uintptr_t next_fp = ((uintptr_t*)fp)[0];
+    uintptr_t return_address = ((uintptr_t*)fp)[1];
+    if (return_address == 0) break;
+    slot[4+depth++] = return_address;
+    if (next_fp <= fp) break;
+    fp = next_fp;
+  }
+  slot[0] = depth;
+  slot[1] = (uintptr_t)stamp;
+  slot[3] = my_thread ? (uintptr_t)my_thread->_Process.raw_() : 0;
+  // The weight goes in last - a zero weight marks a slot that was never filled in
+  __atomic_store_n(&slot[2],(uintptr_t)(weight>(int64_t)size ? weight : size),__ATOMIC_RELEASE);
+  prof._ActiveSamplers.fetch_sub(1,std::memory_order_acq_rel);
+}
+
+CL_LAMBDA(&key (sample-interval 524288) (buffer-size 8388608) (max-depth 64));
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Start sampling allocations roughly every SAMPLE-INTERVAL bytes in every thread.
+Each sample records the stamp, the size and up to MAX-DEPTH frames of backtrace
+into a BUFFER-SIZE byte buffer.  Samples from the previous run are discarded.)doc");
+CL_DEFUN void gctools__allocation_profiler_start(Fixnum sample_interval, Fixnum buffer_size, Fixnum max_depth)
+{
+  AllocationProfiler& prof = global_allocation_profiler;
+  if (prof._Running.load()) {
+    SIMPLE_ERROR(BF("The allocation profiler is already running"));
+  }
+  if (sample_interval<2) {
+    SIMPLE_ERROR(BF("The allocation profiler sample-interval must be at least 2 - not %d") % sample_interval);
+  }
+  if (max_depth<1 || max_depth>1024) {
+    SIMPLE_ERROR(BF("The allocation profiler max-depth must be between 1 and 1024 - not %d") % max_depth);
+  }
+  size_t capacity = buffer_size/sizeof(uintptr_t);
+  if (capacity < (size_t)max_depth+4) {
+    SIMPLE_ERROR(BF("The allocation profiler buffer-size %d is too small to hold one sample") % buffer_size);
+  }
+  if (prof._Buffer) free(prof._Buffer);
+  prof._Buffer = (uintptr_t*)calloc(capacity,sizeof(uintptr_t));
+  if (!prof._Buffer) {
+    SIMPLE_ERROR(BF("Could not allocate %d bytes for the allocation profiler") % buffer_size);
+  }
+  prof._Capacity = capacity;
+  prof._MaxDepth = max_depth;
+  prof._SampleInterval = sample_interval;
+  prof._Fill.store(0);
+  prof._Dropped.store(0);
+  // Other threads notice within ALLOCATION_SAMPLE_IDLE_BYTES, start this one right away
+  my_thread_low_level->_Allocations._SampleBudget = next_sample_interval(sample_interval);
+  my_thread_low_level->_Allocations._SampleCountdown = my_thread_low_level->_Allocations._SampleBudget;
+  prof._Running.store(true,std::memory_order_release);
+}
+
+CL_DOCSTRING("Stop the allocation profiler.  Return the number of samples recorded and the number dropped because the buffer was full.");
+CL_DEFUN core::T_mv gctools__allocation_profiler_stop()
+{
+  AllocationProfiler& prof = global_allocation_profiler;
+  if (!prof._Running.load()) return Values(_Nil<core::T_O>());
+  prof._Running.store(false,std::memory_order_release);
+  while (prof._ActiveSamplers.load(std::memory_order_acquire) != 0) sched_yield();
+  size_t samples = std::min(prof._Fill.load(),prof._Capacity)/(prof._MaxDepth+4);
+  return Values(core::make_fixnum(samples),core::make_fixnum(prof._Dropped.load()));
+}
+
+struct AllocationSample {
+  void*                  _Process;
+  stamp_t                _Stamp;
+  std::vector<uintptr_t> _Pcs;   // innermost first
+  bool operator<(const AllocationSample& other) const {
+    if (this->_Process != other._Process) return this->_Process < other._Process;
+    if (this->_Stamp != other._Stamp) return this->_Stamp < other._Stamp;
+    return this->_Pcs < other._Pcs;
+  }
+};
+
+struct AllocationTotals {
+  size_t _Bytes;
+  size_t _Samples;
+  AllocationTotals() : _Bytes(0), _Samples(0) {};
+};
+
+static void allocation_profiler_aggregate(std::map<AllocationSample,AllocationTotals>& totals) {
+  AllocationProfiler& prof = global_allocation_profiler;
+  if (prof._Running.load()) {
+    SIMPLE_ERROR(BF("Stop the allocation profiler before looking at its samples"));
+  }
+  if (!prof._Buffer) return;
+  size_t record = prof._MaxDepth+4;
+  size_t end = std::min(prof._Fill.load(),prof._Capacity);
+  for ( size_t pos=0; pos+record<=end; pos += record ) {
+    uintptr_t* slot = prof._Buffer+pos;
+    if (__atomic_load_n(&slot[2],__ATOMIC_ACQUIRE) == 0) continue;
+    AllocationSample sample;
+    sample._Stamp = (stamp_t)slot[1];
+    sample._Process = (void*)slot[3];
+    // Return addresses point after the call - back up into it
+    for ( size_t i=0; i<slot[0]; ++i ) sample._Pcs.push_back(slot[4+i]-1);
+    AllocationTotals& entry = totals[sample];
+    entry._Bytes += slot[2];
+    entry._Samples++;
+  }
+}
+
+/*! Map the stamps of the instances of classes defined in Lisp to the class names.
+    Anonymous classes and the old stamps of redefined classes aren't in the class table. */
+static std::map<size_t,std::string> allocation_lisp_class_names() {
+  std::map<size_t,std::string> names;
+  _lisp->_Roots._ClassTable->maphash([&names] (core::T_sp key, core::T_sp value) {
+      core::T_sp tclass = value;
+      if (gc::IsA<core::ClassHolder_sp>(value)) {
+        core::ClassHolder_sp holder = gc::As_unsafe<core::ClassHolder_sp>(value);
+        if (holder->class_unboundp()) return;
+        tclass = holder->class_get();
+      }
+      if (!gc::IsA<core::Instance_sp>(tclass)) return;
+      core::Instance_sp class_ = gc::As_unsafe<core::Instance_sp>(tclass);
+      // A class that isn't finalized yet has no stamp
+      if (!class_->instanceRef(core::Instance_O::REF_CLASS_STAMP_FOR_INSTANCES_).fixnump()) return;
+      UnshiftedStamp stamp = Header_s::StampWtagMtag::unshift_shifted_stamp(class_->CLASS_stamp_for_instances());
+      names[Header_s::StampWtagMtag::make_nowhere_stamp(stamp)] = _rep_(class_->_className());
+    } );
+  return names;
+}
+
+static std::string allocation_stamp_name(stamp_t stamp, const std::map<size_t,std::string>& classNames) {
+  if (stamp == (stamp_t)STAMP_null) return "unmanaged";
+  if (stamp <= (stamp_t)STAMP_max) {
+    const char* name = obj_name(stamp);
+    if (name) return name;
+  } else {
+    auto found = classNames.find(Header_s::StampWtagMtag::make_nowhere_stamp(stamp));
+    if (found != classNames.end()) return found->second;
+  }
+  stringstream ss;
+  ss << "instance-stamp-" << stamp;
+  return ss.str();
+}
+
+/*! The backtrace starts inside the allocator - HitAllocationSampleThreshold,
+    registerAllocation, the GCObjectAllocator templates and Boehm itself.
+    Return true if the demangled NAME is one of those frames. */
+static bool allocation_runtime_frame_p(const std::string& name) {
+  std::string base = name.substr(0,name.find('('));
+  // Skip the return type of template instantiations
+  int depth = 0;
+  size_t start = 0;
+  for ( size_t i=0; i<base.size(); ++i ) {
+    if (base[i]=='<') ++depth;
+    else if (base[i]=='>') --depth;
+    else if (base[i]==' ' && depth==0) start = i+1;
+  }
+  base = base.substr(start);
+  return base.compare(0,9,"gctools::")==0
+    || base.compare(0,3,"GC_")==0
+    || base.find("Allocator")!=std::string::npos;
+}
+
+/*! Index of the innermost frame in PCS that is not part of the allocator */
+static size_t allocation_first_caller_frame(const std::vector<uintptr_t>& pcs, std::map<uintptr_t,std::string>& cache) {
+  for ( size_t i=0; i<pcs.size(); ++i ) {
+    if (!allocation_runtime_frame_p(core::sample_profiler_symbolize(pcs[i],cache))) return i;
+  }
+  return 0;
+}
+
+static void allocation_report_entry(std::map<std::string,AllocationTotals>& report, const std::string& name, const AllocationTotals& totals) {
+  AllocationTotals& entry = report[name];
+  entry._Bytes += totals._Bytes;
+  entry._Samples += totals._Samples;
+}
+
+static core::List_sp allocation_report_list(const std::map<std::string,AllocationTotals>& report) {
+  std::vector<std::pair<std::string,AllocationTotals>> sorted(report.begin(),report.end());
+  std::sort(sorted.begin(),sorted.end(),
+            [] (const std::pair<std::string,AllocationTotals>& x, const std::pair<std::string,AllocationTotals>& y) {
+              return x.second._Bytes > y.second._Bytes; });
+  ql::list result;
+  for ( auto& entry : sorted ) {
+    result << core::Cons_O::createList(core::SimpleBaseString_O::make(entry.first),
+                                       core::make_fixnum(entry.second._Bytes),
+                                       core::make_fixnum(entry.second._Samples));
+  }
+  return result.cons();
+}
+
+CL_DOCSTRING(R"doc(Summarize the last allocation profiler run.  Return two lists of
+(name estimated-bytes samples) sorted by bytes: one by the class (stamp) allocated
+and one by the function that called into the allocator.)doc");
+CL_DEFUN core::T_mv gctools__allocation_profiler_report()
+{
+  std::map<AllocationSample,AllocationTotals> totals;
+  allocation_profiler_aggregate(totals);
+  std::map<uintptr_t,std::string> cache;
+  std::map<std::string,AllocationTotals> by_class;
+  std::map<std::string,AllocationTotals> by_function;
+  std::map<size_t,std::string> classNames = allocation_lisp_class_names();
+  for ( auto& entry : totals ) {
+    allocation_report_entry(by_class,allocation_stamp_name(entry.first._Stamp,classNames),entry.second);
+    const std::vector<uintptr_t>& pcs = entry.first._Pcs;
+    std::string function = pcs.size() ? core::sample_profiler_symbolize(pcs[allocation_first_caller_frame(pcs,cache)],cache) : "unknown";
+    allocation_report_entry(by_function,function,entry.second);
+  }
+  return Values(allocation_report_list(by_class),allocation_report_list(by_function));
+}
+
+CL_DOCSTRING(R"doc(Return an alist of (folded-stack . estimated-bytes) for the last allocation
+profiler run.  Each folded stack is the process name, the frames from the outermost in to
+the one that called into the allocator and the class allocated, separated by semicolons.)doc");
+CL_DEFUN core::List_sp gctools__allocation_profiler_folded_stacks()
+{
+  std::map<AllocationSample,AllocationTotals> totals;
+  allocation_profiler_aggregate(totals);
+  std::map<uintptr_t,std::string> cache;
+  std::map<void*,std::string> names = core::sample_profiler_process_names();
+  std::map<size_t,std::string> classNames = allocation_lisp_class_names();
+  ql::list result;
+  for ( auto& entry : totals ) {
+    stringstream ss;
+    ss << core::sample_profiler_process_name(entry.first._Process,names);
+    const std::vector<uintptr_t>& pcs = entry.first._Pcs;
+    size_t innermost = allocation_first_caller_frame(pcs,cache);
+    for ( size_t i=pcs.size(); i>innermost; --i ) {
+      ss << ";" << core::sample_profiler_symbolize(pcs[i-1],cache);
+    }
+    ss << ";[" << allocation_stamp_name(entry.first._Stamp,classNames) << "]";
+    result << core::Cons_O::create(core::SimpleBaseString_O::make(ss.str()),core::make_fixnum(entry.second._Bytes));
+  }
+  return result.cons();
+}
+
+CL_LAMBDA(pathname &key (format :folded));
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Write the last allocation profiler run to PATHNAME.  FORMAT :FOLDED writes
+byte weighted folded stacks for flamegraph.pl, :REPORT writes the per class and
+per function tables.)doc");
+CL_DEFUN void gctools__allocation_profiler_write(core::T_sp pathname, core::T_sp format)
+{
+  std::string filename = core::core__coerce_to_filename(pathname)->get_std_string();
+  std::ofstream fout(filename,std::ios::out|std::ios::trunc);
+  if (!fout) {
+    SIMPLE_ERROR(BF("Could not open %s to write the allocation profile") % filename);
+  }
+  if (format == kw::_sym_folded) {
+    for ( auto cur : gctools__allocation_profiler_folded_stacks() ) {
+      core::Cons_sp entry = gc::As<core::Cons_sp>(oCar(cur));
+      fout << gc::As<core::String_sp>(oCar(entry))->get_std_string() << " " << core::unbox_fixnum(gc::As<core::Fixnum_sp>(oCdr(entry))) << std::endl;
+    }
+  } else if (format == kw::_sym_report) {
+    core::T_mv report = gctools__allocation_profiler_report();
+    core::List_sp by_class = report;
+    core::List_sp by_function = report.second();
+    const char* titles[2] = { "Bytes by class", "Bytes by allocating function" };
+    core::List_sp tables[2] = { by_class, by_function };
+    for ( int i=0; i<2; ++i ) {
+      fout << titles[i] << std::endl;
+      for ( auto cur : tables[i] ) {
+        core::List_sp row = oCar(cur);
+        fout << "  " << std::setw(14) << core::unbox_fixnum(gc::As<core::Fixnum_sp>(oSecond(row)))
+             << " " << std::setw(8) << core::unbox_fixnum(gc::As<core::Fixnum_sp>(oThird(row)))
+             << "  " << gc::As<core::String_sp>(oFirst(row))->get_std_string() << std::endl;
+      }
+      fout << std::endl;
+    }
+  } else {
+    SIMPLE_ERROR(BF("The allocation profile format must be :folded or :report - not %s") % _rep_(format));
+  }
+  fout.close();
+}
+
+};
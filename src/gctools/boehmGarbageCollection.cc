@@ -31,10 +31,13 @@ THE SOFTWARE.
 //#include <clasp/core/numbers.h>
 #include <clasp/core/evaluator.h>
 #include <clasp/gctools/gctoolsPackage.h>
+#include <clasp/gctools/gcFunctions.h>
 #ifdef USE_BOEHM // whole file #ifdef USE_BOEHM
 #include <clasp/gctools/boehmGarbageCollection.h>
 #include <clasp/core/debugger.h>
 #include <clasp/core/compiler.h>
+#include <gc/gc_mark.h>
+#include <fstream>
 
 
 
@@ -248,6 +251,57 @@ void* boehm_create_shadow_table(size_t nargs)
 };
 
 namespace gctools {
+struct SnapshotWalker {
+  std::ofstream* output;
+  size_t objects;
+  SnapshotWalker(std::ofstream* out) : output(out), objects(0) {};
+};
+
+/*! Write one object in the same form as the MPS formatted_objects_stepper.
+    There are no pools in the Boehm build so the pool id is always 0. */
+void boehm_snapshot_object(void* ptr, size_t sz, void* client_data)
+{
+  SnapshotWalker& walker = *(SnapshotWalker*)client_data;
+  walker.objects++;
+  uint coffeee = SNAPSHOT_OBJECT_MARK;
+  walker.output->write((char*)&coffeee,sizeof(coffeee));
+  int pool_id = 0;
+  walker.output->write((char*)&pool_id,sizeof(pool_id));
+  void* addr = (void*)((char*)ptr+sizeof(Header_s));
+  walker.output->write((char*)&addr,sizeof(addr));
+  size_t size = sz;
+  walker.output->write((char*)&size,sizeof(size));
+  walker.output->write((char*)ptr,size);
+}
+
+#if BOEHM_GC_ENUMERATE_REACHABLE_OBJECTS_INNER_AVAILABLE==1
+void* boehm_snapshot_objects(void* walker)
+{
+  GC_enumerate_reachable_objects_inner(boehm_snapshot_object,walker);
+  return NULL;
+}
+#endif
+
+/*! Runs after the Lisp has unwound, so nothing can be signaled here -
+    gctools__save_lisp_and_die checks everything it can beforehand.
+    Return false if the snapshot could not be written completely. */
+bool save_lisp_and_die(const std::string& filename)
+{
+#if BOEHM_GC_ENUMERATE_REACHABLE_OBJECTS_INNER_AVAILABLE==1
+  std::ofstream fout;
+  fout.open(filename,std::ios::out|std::ios::binary);
+  SnapshotWalker walker(&fout);
+  GC_gcollect();
+  save_snapshot_header(fout,SNAPSHOT_GC_BOEHM,sizeof(Header_s));
+  // The objects must not move or be freed while they are written
+  GC_call_with_alloc_lock(boehm_snapshot_objects,(void*)&walker);
+  fout.close();
+  return !fout.fail();
+#else
+  return false;
+#endif
+}
+
 __attribute__((noinline))
 int initializeBoehm(MainFunctionType startupFn, int argc, char *argv[], bool mpiEnabled, int mpiRank, int mpiSize) {
   GC_set_handle_fork(1);
@@ -282,7 +336,12 @@ int initializeBoehm(MainFunctionType startupFn, int argc, char *argv[], bool mpi
 #ifdef DEBUG_COUNT_ALLOCATIONS
   maybe_initialize_mythread_backtrace_allocations();
 #endif
-  int exitCode = startupFn(argc, argv, mpiEnabled, mpiRank, mpiSize);
+  int exitCode = 0;
+  try {
+    exitCode = startupFn(argc, argv, mpiEnabled, mpiRank, mpiSize);
+  } catch (core::SaveLispAndDie& ee) {
+    exitCode = save_lisp_and_die(ee._FileName) ? 0 : 1;
+  }
 #if 0
   GC_unregister_my_thread();
 #endif
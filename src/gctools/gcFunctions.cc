@@ -20,6 +20,7 @@ int gcFunctions_after;
 #include <unistd.h>
 #include <sstream>
 #include <iomanip>
+#include <fstream>
 
 #include <clasp/core/object.h>
 #include <clasp/core/bformat.h>
@@ -659,11 +660,47 @@ CL_DEFUN core::T_mv cl__room(core::T_sp x) {
 };
 
 namespace gctools {
-#ifdef USE_MPS
+
+/*! Every heap snapshot starts with this header, whichever GC wrote it.
+    Only the writer exists: there is no loader yet, so a snapshot can't be
+    restored and doesn't shorten startup - it is a dump for offline inspection.
+    The anchor is the address of a function in the executable and the roots
+    address is where _lisp->_Roots was when the snapshot was written, so a
+    tool reading the snapshot can map the addresses in it back to the
+    executable.  The header is followed by the object file manifest
+    (see llvmo::save_object_file_manifest) and then the objects, each as
+    SNAPSHOT_OBJECT_MARK, pool id, address, size_t size and the bytes. */
+void save_snapshot_header(std::ostream& out, uint32_t gc_kind, size_t header_size)
+{
+  char magic[8] = {'C','L','A','S','P','S','N','P'};
+  out.write(magic,sizeof(magic));
+  uint32_t version = SNAPSHOT_VERSION;
+  out.write((char*)&version,sizeof(version));
+  out.write((char*)&gc_kind,sizeof(gc_kind));
+  out.write((char*)&header_size,sizeof(header_size));
+  uintptr_t anchor = (uintptr_t)&gctools__save_lisp_and_die;
+  out.write((char*)&anchor,sizeof(anchor));
+  uintptr_t roots = (uintptr_t)&_lisp->_Roots;
+  out.write((char*)&roots,sizeof(roots));
+  llvmo::save_object_file_manifest(out);
+}
+
+CL_DOCSTRING("Write a snapshot of every live object to FILENAME for offline inspection and exit. Clasp has no loader for snapshots yet, so one can't be used to start an image.");
 CL_DEFUN void gctools__save_lisp_and_die(const std::string& filename)
 {
+#if defined(USE_BOEHM) && BOEHM_GC_ENUMERATE_REACHABLE_OBJECTS_INNER_AVAILABLE!=1
+  SIMPLE_ERROR(BF("save-lisp-and-die needs GC_enumerate_reachable_objects_inner, which the Boehm library of this build does not have"));
+#endif
+  {
+    // The snapshot is written after the Lisp has unwound, when nothing can be
+    // signaled any more, so check that the file can be written now
+    std::ofstream probe(filename,std::ios::out|std::ios::binary);
+    if (!probe) SIMPLE_ERROR(BF("save-lisp-and-die can't open %s for writing") % filename);
+  }
   throw(core::SaveLispAndDie(filename));
 }
+
+#ifdef USE_MPS
 CL_DEFUN void gctools__enable_underscanning(bool us)
 {
   global_underscanning = us;
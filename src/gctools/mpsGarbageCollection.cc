@@ -77,6 +77,7 @@ extern "C" {
 };
 
 #include <clasp/gctools/gctoolsPackage.h>
+#include <clasp/gctools/gcFunctions.h>
 
 namespace gctools {
 struct custom_allocator_info {
@@ -807,14 +808,14 @@ void formatted_objects_stepper(mps_addr_t addr, mps_fmt_t fmt, mps_pool_t pool,
 {
   Walker& walker = *(Walker*)p;
   walker.objects++;
-  uint coffeee = 0xeeeeffc0;
+  uint coffeee = SNAPSHOT_OBJECT_MARK;
   walker.output->write((char*)&coffeee,sizeof(coffeee));
   PoolInfo& pool_info = pool_info_from_pool(pool);
   int pool_id = (int)pool_info.Id;
   walker.output->write((char*)&pool_id,sizeof(pool_id));
   walker.output->write((char*)&addr,sizeof(addr));
   mps_addr_t next_addr = (pool_info.SkipFunction)(addr);
-  uint size = (char*)next_addr - (char*)addr;
+  size_t size = (char*)next_addr - (char*)addr;
   walker.output->write((char*)&size,sizeof(size));
   char* real_addr = (char*)addr - (pool_info.HasHeader ? sizeof(Header_s) : 0);
   walker.output->write(real_addr,size);
@@ -826,6 +827,7 @@ void save_lisp_and_die(const std::string& filename)
   fout.open(filename,std::ios::out|std::ios::binary);
   Walker walker(&fout);
   mps_arena_collect(global_arena);
+  save_snapshot_header(fout,SNAPSHOT_GC_MPS,sizeof(Header_s));
   mps_arena_formatted_objects_walk(global_arena,formatted_objects_stepper,(void*)&walker,0);
   fout.close();
   printf("%s:%d There were %zu objects\n", __FILE__, __LINE__, walker.objects);
@@ -122,7 +122,11 @@ ThreadLocalStateLowLevel::ThreadLocalStateLowLevel(void* stack_top) :
   , _RecursiveAllocationCounter(0)
 #endif
   
-{};
+{
+#ifdef USE_BOEHM
+  for ( size_t i=0; i<BOEHM_THREAD_LOCAL_SIZE_CLASSES; ++i ) this->_BoehmFreeLists[i] = NULL;
+#endif
+};
 
 ThreadLocalStateLowLevel::~ThreadLocalStateLowLevel()
 {};
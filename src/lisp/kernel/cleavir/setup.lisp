@@ -130,6 +130,41 @@ when this is t a lot of graphs will be generated.")
                     collect `(quote ,keyword)
                     collect `(quote ,value)))))
 
+;;; Calls to global generic functions are compiled with an inline cache
+;;; (see clos::inline-cache-lookup), so that a call site that keeps seeing the
+;;; same classes calls the effective method directly.
+;;; The kernel is compiled without them - the lookup needs closfastgf, and CLOS
+;;; itself must not go through inline caches.  epilogue-cclasp turns them on.
+(defvar *use-inline-caches* nil
+  "If true, calls to global generic functions get a per call site inline cache.")
+
+(defun inline-cache-excluded-name-p (function-name)
+  ;; The generic functions that implement dispatch are never inline cached,
+  ;; a miss would call back into them.
+  (member (symbol-package function-name)
+          (load-time-value (list (find-package "CLOS") (find-package "CORE")))))
+
+(defun inline-cache-compiler-macro (form env)
+  (declare (ignore env))
+  (let ((name (if (eq (first form) 'funcall) (second (second form)) (first form)))
+        (args (if (eq (first form) 'funcall) (cddr form) (rest form))))
+    (if (null args)
+        form
+        (let ((temps (loop for arg in args collect (gensym "ARG"))))
+          `(let (,@(mapcar #'list temps args))
+             (funcall (clos::inline-cache-lookup (load-time-value (clos::make-inline-cache))
+                                                 #',name ,(first temps))
+                      ,@temps))))))
+
+(defun global-compiler-macro (function-name)
+  (or (compiler-macro-function function-name)
+      (and *use-inline-caches*
+           (symbolp function-name)
+           (not (inline-cache-excluded-name-p function-name))
+           (not (eq (core:global-inline-status function-name) 'notinline))
+           (typep (fdefinition function-name) 'generic-function)
+           #'inline-cache-compiler-macro)))
+
 (defmethod cleavir-env:function-info ((environment clasp-global-environment) function-name)
   (cond
     ((and (symbolp function-name) (treat-as-special-operator-p function-name))
@@ -148,7 +183,7 @@ when this is t a lot of graphs will be generated.")
        (make-instance 'cleavir-env:global-function-info
                       :name function-name
                       :type (global-ftype function-name)
-                      :compiler-macro (compiler-macro-function function-name)
+                      :compiler-macro (global-compiler-macro function-name)
                       :inline inline-status
                       :ast cleavir-ast)))
     ;; A top-level defun for the function has been seen.
@@ -423,7 +423,8 @@ FIXME!!!! This code will have problems with multithreading if a generic function
   (loop for call-history = (safe-gf-call-history generic-function)
      for new-call-history = (update-call-history-for-add-method generic-function call-history method)
      for exchange = (safe-gf-call-history-cas generic-function call-history new-call-history)
-     until (eq exchange call-history)))
+     until (eq exchange call-history))
+  (invalidate-inline-caches generic-function))
 
 (defun update-call-history-for-remove-method (generic-function call-history method)
   (let (new-call-history)
@@ -455,14 +456,16 @@ FIXME!!!! This code will have problems with multithreading if a generic function
   (loop for call-history = (safe-gf-call-history generic-function)
         for new-call-history = (update-call-history-for-remove-method generic-function call-history method)
         for exchange = (safe-gf-call-history-cas generic-function call-history new-call-history)
-        until (eq exchange call-history)))
+        until (eq exchange call-history))
+  (invalidate-inline-caches generic-function))
 
 ;;; FIXME: Replace with atomic setf
 (defun erase-generic-function-call-history (generic-function)
   (loop for call-history = (safe-gf-call-history generic-function)
         for new-call-history = nil
         for exchange = (safe-gf-call-history-cas generic-function call-history new-call-history)
-        until (eq exchange call-history)))
+        until (eq exchange call-history))
+  (invalidate-inline-caches generic-function))
 
 (defun specializer-key-match (key1 key2)
   (declare (type simple-vector key1 key2))
@@ -714,12 +717,153 @@ It takes the arguments in two forms, as a vaslist and as a list of arguments."
                                        (calculate-fastgf-dispatch-function
                                         generic-function))))
 
-;;; Used by interpret-dtree-program.
 (defun compile-discriminating-function (generic-function)
   (set-funcallable-instance-function generic-function
                                      (calculate-fastgf-dispatch-function
                                       generic-function :compile t)))
 
+;;; Tiered compilation of discriminating functions.
+;;; interpret-dtree-program counts the calls of each generic function and when
+;;; the count reaches (dtree-compile-threshold) it calls
+;;; tiered-compile-discriminating-function with the interpreted discriminator.
+;;; The compiled discriminator replaces it only if the generic function has not
+;;; been given another discriminating function in the meantime.
+;;; Turn this on with (clos:set-dtree-compile-threshold 1024).
+
+(defvar *dtree-compile-in-background* t
+  "If true, hot discriminating functions are compiled by a single background
+process and the generic function keeps using the interpreter until that is done.")
+
+(defvar *dtree-compile-lock* (mp:make-lock :name 'dtree-compile))
+
+;;; Counters - triggered, installed, discarded because the generic function
+;;; changed while it was compiled, and failed with an error.
+(defvar *dtree-compile-counts* (make-array 4 :initial-element 0))
+
+(defun dtree-compile-count (index)
+  (mp:with-lock (*dtree-compile-lock*)
+    (incf (svref *dtree-compile-counts* index))))
+
+(defun dtree-compile-statistics ()
+  "Return as multiple values the number of discriminating function compilations that
+were triggered, installed, discarded because the generic function changed, and failed."
+  (values-list (coerce *dtree-compile-counts* 'list)))
+
+(defun compile-and-install-discriminator (generic-function interpreted-discriminator)
+  (handler-case
+      (let ((compiled (calculate-fastgf-dispatch-function generic-function :compile t)))
+        (if (compare-and-set-funcallable-instance-function
+             generic-function interpreted-discriminator compiled)
+            (dtree-compile-count 1)
+            (dtree-compile-count 2)))
+    (error (e)
+      (declare (ignorable e))
+      (dtree-compile-count 3)
+      (gf-log "Compiling the discriminating function failed: %s%N" e))))
+
+;;; Background compiles go through one queue served by one process, started
+;;; on first use, so a burst of generic functions turning hot during warm-up
+;;; doesn't start a compiler thread for each of them.
+;;; The queue holds (generic-function . interpreted-discriminator), oldest first.
+(defvar *dtree-compile-queue* nil)
+(defvar *dtree-compile-queue-lock* (mp:make-lock :name 'dtree-compile-queue))
+(defvar *dtree-compile-queue-available* (mp:make-condition-variable :name 'dtree-compile-queue))
+(defvar *dtree-compile-process* nil)
+
+(defun dtree-compile-process-loop ()
+  (loop
+    (let ((job (mp:with-lock (*dtree-compile-queue-lock*)
+                 (loop while (null *dtree-compile-queue*)
+                       do (mp:condition-variable-wait *dtree-compile-queue-available*
+                                                      *dtree-compile-queue-lock*))
+                 (pop *dtree-compile-queue*))))
+      (compile-and-install-discriminator (car job) (cdr job)))))
+
+(defun enqueue-dtree-compile (generic-function interpreted-discriminator)
+  (mp:with-lock (*dtree-compile-queue-lock*)
+    (unless (assoc generic-function *dtree-compile-queue* :test #'eq)
+      (setf *dtree-compile-queue*
+            (nconc *dtree-compile-queue*
+                   (list (cons generic-function interpreted-discriminator))))
+      (unless *dtree-compile-process*
+        (setf *dtree-compile-process*
+              (mp:process-run-function 'compile-discriminating-functions
+                                       #'dtree-compile-process-loop)))
+      (mp:condition-variable-signal *dtree-compile-queue-available*))))
+
+;;; Used by interpret-dtree-program.
+(defun tiered-compile-discriminating-function (generic-function interpreted-discriminator)
+  (dtree-compile-count 0)
+  (if *dtree-compile-in-background*
+      (enqueue-dtree-compile generic-function interpreted-discriminator)
+      (compile-and-install-discriminator generic-function interpreted-discriminator))
+  nil)
+
+;;; Inline caches.
+;;; A call to a generic function that is known at compile time can be compiled
+;;; as (funcall (inline-cache-lookup cache #'gf arg0) arg0 ...), where CACHE is
+;;; made once per call site by MAKE-INLINE-CACHE. inline-cache-lookup remembers
+;;; the effective method for the last few stamps seen at that call site, so calls
+;;; that hit skip the discriminating function entirely.
+;;; The entries of a generic function are dropped with (invalidate-inline-caches gf)
+;;; whenever outcomes in its call history change - when methods are added or removed,
+;;; when the call history is erased or when a class it was called on is redefined.
+;;; A dispatch miss only adds to the call history and leaves the entries alone.
+
+(defconstant +inline-cache-entries+ 4
+  "The number of stamps an inline cache remembers before it starts replacing them.")
+
+(defun make-inline-cache ()
+  ;; misses, epoch of the misses, then the entries.
+  (let ((cache (make-array (+ 2 +inline-cache-entries+) :initial-element nil)))
+    (setf (svref cache 0) 0
+          (svref cache 1) 0)
+    cache))
+
+(defun inline-cacheable-generic-function-p (generic-function)
+  ;; Only the first argument is checked by an inline cache, so that must be
+  ;; the only specialized argument, and it must not be eql specialized.
+  (and (eq (class-of generic-function) (find-class 'standard-generic-function))
+       (let ((profile (safe-gf-specializer-profile generic-function)))
+         (and profile
+              (> (length profile) 0)
+              (eq (svref profile 0) t)
+              (loop for i from 1 below (length profile)
+                    never (svref profile i))))))
+
+(defun inline-cache-outcome-function (outcome)
+  (cond ((effective-method-outcome-p outcome)
+         (effective-method-outcome-function outcome))
+        ((optimized-slot-reader-p outcome)
+         (let ((index (optimized-slot-reader-index outcome))
+               (slot-name (optimized-slot-reader-slot-name outcome))
+               (class (optimized-slot-reader-class outcome)))
+           (lambda (instance)
+             (let ((value (standard-location-access instance index)))
+               (if (si:sl-boundp value)
+                   value
+                   (values (slot-unbound class instance slot-name)))))))
+        (t nil)))
+
+;;; Called by inline-cache-lookup when the stamp of ARG is not in the cache.
+;;; Return the function to call and whether it may be cached for the stamp of ARG.
+;;; Calls that have not been memoized in the call history yet just go through
+;;; the generic function, which will memoize them.
+(defun inline-cache-miss (generic-function arg)
+  (let ((class (class-of arg)))
+    (if (and (inline-cacheable-generic-function-p generic-function)
+             ;; Obsolete instances must go through the discriminating function
+             ;; so that they are updated.
+             (= (core:instance-stamp arg) (core:class-stamp-for-instances class)))
+        (let* ((entry (find class (safe-gf-call-history generic-function)
+                            :key (lambda (entry) (svref (car entry) 0))
+                            :test #'eq))
+               (function (and entry (inline-cache-outcome-function (cdr entry)))))
+          (if function
+              (values function t)
+              (values generic-function nil)))
+        (values generic-function nil))))
+
 #+debug-fastgf
 (defvar *dispatch-miss-recursion-check* nil)
 
@@ -853,6 +997,8 @@ It takes the arguments in two forms, as a vaslist and as a list of arguments."
                      = (safe-gf-call-history-cas gf call-history new-call-history)
                    until (eq exchange call-history)
                    finally (gf-log "    edited call history%N")
+                           ;; Cached effective methods for instances of the old class must not be used.
+                           (invalidate-inline-caches gf)
                            (gf-log "%s%N" new-call-history)
                            (gf-log "Generating a new discriminating function%N")
                            (if new-call-history
@@ -29,7 +29,8 @@
 ;;; In this state, the next call will compute a real discriminating function.
 (defun invalidate-discriminating-function (gf)
   (set-funcallable-instance-function
-   gf (invalidated-discriminating-function-closure gf)))
+   gf (invalidated-discriminating-function-closure gf))
+  (invalidate-inline-caches gf))
 
 ;;; ----------------------------------------------------------------------
 ;;;
@@ -385,7 +385,8 @@ Boehm and MPS use a single pointer"
          %t*%      ; 3 _Class
          %function-description*%   ; 4  FunctionDescription*
          %atomic<size_t>%          ; 5  _InterpretedCalls
-         %atomic<tsp>%             ; 6 _CompiledDispatchFunction
+         %atomic<size_t>%          ; 6  _InlineCacheEpoch
+         %atomic<tsp>%             ; 7 _CompiledDispatchFunction
          )
    nil))
 (define-symbol-macro %funcallable-instance*% (llvm-sys:type-get-pointer-to %funcallable-instance%))
@@ -404,7 +405,9 @@ Boehm and MPS use a single pointer"
    (%t*% :setf-function)
    (%i32% :binding-idx)
    (%i32% :flags)
-   (%t*% :property-list)))
+   (%t*% :property-list)
+   (%i64% :print-package-cache)
+   (%i64% :print-escape-cache)))
 
 (defconstant +symbol.function-index+ 4)
 (defconstant +symbol.setf-function-index+ 5)
@@ -210,6 +210,7 @@
           btcl
           ihs-argument
           with-float-traps-masked
+          with-profiling
           enable-interrupt default-interrupt ignore-interrupt
           get-signal-handler set-signal-handler
           ;;; for asdf and slime and trivial-garbage to use ext:
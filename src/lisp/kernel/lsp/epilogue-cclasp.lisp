@@ -2,6 +2,11 @@
 (eval-when (:compile-toplevel)
   (report-lexical-var-reference-depth))
 #+cclasp
+(eval-when (:load-toplevel)
+  ;; Everything in the kernel has been loaded, so code compiled from now on
+  ;; can call generic functions through inline caches.
+  (setq clasp-cleavir::*use-inline-caches* t))
+#+cclasp
 (eval-when (:load-toplevel)
   (cl:in-package :cl-user)
   (let ((core:*use-interpreter-for-eval* nil))
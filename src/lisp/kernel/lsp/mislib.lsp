@@ -100,6 +100,40 @@ Evaluates FORM, outputs the realtime and runtime used for the evaluation to
 *TRACE-OUTPUT*, and then returns all values of FORM."
   `(do-time #'(lambda () ,form)))
 
+(defmacro ext:with-profiling ((&key output (format :folded) (frequency 100) (threads :all)
+                                 (max-depth 128) (buffer-size 8388608))
+                              &body body)
+  "Syntax: (ext:with-profiling (&key output format frequency threads max-depth buffer-size) &body body)
+Evaluates BODY with the statistical profiler sampling FREQUENCY times a second
+of CPU time.  THREADS is :ALL, :CURRENT or a list of processes.  When OUTPUT is
+given the samples are written there as :FOLDED stacks or a :PPROF profile,
+otherwise they stay available through CORE:SAMPLE-PROFILER-FOLDED-STACKS."
+  `(progn
+     (core:sample-profiler-start :frequency ,frequency :threads ,threads
+                                 :max-depth ,max-depth :buffer-size ,buffer-size)
+     (unwind-protect (progn ,@body)
+       (core:sample-profiler-stop)
+       (let ((output ,output))
+         (when output
+           (core:sample-profiler-write output :format ,format))))))
+
+(defmacro gctools:with-allocation-profiling ((&key output (format :folded) (sample-interval 524288)
+                                                 (max-depth 64) (buffer-size 8388608))
+                                             &body body)
+  "Syntax: (gctools:with-allocation-profiling (&key output format sample-interval max-depth buffer-size) &body body)
+Evaluates BODY while sampling an allocation about every SAMPLE-INTERVAL bytes.
+When OUTPUT is given the samples are written there as byte weighted :FOLDED stacks
+or a per class and per function :REPORT, otherwise they stay available through
+GCTOOLS:ALLOCATION-PROFILER-REPORT and GCTOOLS:ALLOCATION-PROFILER-FOLDED-STACKS."
+  `(progn
+     (gctools:allocation-profiler-start :sample-interval ,sample-interval
+                                        :max-depth ,max-depth :buffer-size ,buffer-size)
+     (unwind-protect (progn ,@body)
+       (gctools:allocation-profiler-stop)
+       (let ((output ,output))
+         (when output
+           (gctools:allocation-profiler-write output :format ,format))))))
+
 (defun leap-year-p (y)
   (and (zerop (mod y 4))
        (or (not (zerop (mod y 100))) (zerop (mod y 400)))))
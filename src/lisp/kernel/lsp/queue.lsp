@@ -11,6 +11,7 @@
 ;;;;AUTHORS
 ;;;;    <PJB> Pascal J. Bourguignon <pjb@informatimago.com>
 ;;;;MODIFICATIONS
+;;;;    2026-10-18      Backed by the lock-free MP:CONCURRENT-QUEUE.
 ;;;;    2017-04-16 <PJB> Aded queue-empty-p.
 ;;;;    2015-08-29 <PJB> Created.
 ;;;;BUGS
@@ -45,87 +46,57 @@
 (defstruct (queue
             (:constructor make-queue
                 (name
-                 &aux
-                   (lock (mp:make-lock :name (format nil "~A-LOCK" name)))
-                   (not-empty (mp:make-condition-variable :name (format nil "~A-NOT-EMPTY" name)))))
+                 &optional capacity
+                 &aux (native (mp:make-concurrent-queue :name name :capacity capacity))))
             (:copier nil)
             (:predicate queuep))
-  name (head nil) (tail nil) lock not-empty)
+  name native)
 
 (eval-when (:compile-toplevel :load-toplevel :execute)
   (setf (documentation 'make-queue 'function) "
-RETURN:     A new queue named NAME
+RETURN:     A new queue named NAME.  If CAPACITY is given the queue
+            is bounded and ATOMIC-ENQUEUE blocks while it is full.
 "
         (documentation 'queue-name 'function) "
 RETURN:     The name of the QUEUE.
-"
-        (documentation 'queue-head 'function) "
-RETURN:     the head CONS cell of the QUEUE.
-"
-        (documentation 'queue-tail 'function) "
-RETURN:     the tail CONS cell of the QUEUE.
 "
         (documentation 'queuep 'function) "
 RETURN:     Predicate for the QUEUE type.
 "
-        (documentation 'queue-lock 'function) "
-RETURN:     The lock of the QUEUE.
-"
-        (documentation 'queue-not-empty 'function) "
-RETURN:     The NOT-EMPTY condition variable of the QUEUE.
+        (documentation 'queue-native 'function) "
+RETURN:     The MP:CONCURRENT-QUEUE holding the entries of the QUEUE.
 "))
 
 (defun atomic-enqueue (queue message)
   "
-DO:         Atomically enqueues the MESSAGE in the QUEUE.  
+DO:         Atomically enqueues the MESSAGE in the QUEUE.
 
 RETURN:     MESSAGE
 "
-  (mp:with-lock ((queue-lock queue))
-    (if (queue-tail queue)
-        (setf (cdr (queue-tail queue)) (list message)
-              (queue-tail queue) (cdr (queue-tail queue)))
-        (setf (queue-head queue) (setf (queue-tail queue) (list message))))
-    (mp:condition-variable-signal (queue-not-empty queue)))
+  (mp:concurrent-queue-push (queue-native queue) message)
   message)
 
 (defun dequeue (queue &key (timeout nil timeoutp) (timeout-val nil timeout-val-p))
   "
 DO:         Atomically, dequeue the first message from the QUEUE.  If
-            the queue is empty,  then wait on the not-empty condition
-            of the queue.
+            the queue is empty,  then wait for a message, at most
+            TIMEOUT seconds if TIMEOUT is given.
 
-RETURN:     the dequeued MESSAGE.
+RETURN:     the dequeued MESSAGE, or TIMEOUT-VAL if the wait timed out.
 "
-  (mp:with-lock ((queue-lock queue))
-    (loop :until (queue-head queue)
-          :do (if timeout
-                  (mp:condition-variable-timedwait (queue-not-empty queue) (queue-lock queue) timeout)
-                  (mp:condition-variable-wait (queue-not-empty queue) (queue-lock queue)))
-          :if (and timeout (null (queue-head queue)))
-            :do (return-from dequeue timeout-val))
-    (if (eq (queue-head queue) (queue-tail queue))
-        (prog1 (car (queue-head queue))
-          (setf (queue-head queue) nil
-                (queue-tail queue) nil))
-        (pop (queue-head queue)))))
+  (declare (ignore timeoutp timeout-val-p))
+  (values (mp:concurrent-queue-pop (queue-native queue) timeout timeout-val)))
 
 (defun dequeue-timed (queue time)
   "
 DO:         Atomically, dequeue the first message from the QUEUE.  If
-            the queue is empty,  then wait on the not-empty condition
-            of the queue.
+            the queue is empty,  then wait at most TIME seconds for
+            a message.
 
-RETURN:     the dequeued MESSAGE.
+RETURN:     the dequeued MESSAGE and T, or NIL and NIL if the wait
+            timed out.
 "
-  (mp:with-lock ((queue-lock queue))
-    (loop :until (queue-head queue)
-          :do (mp:condition-variable-wait (queue-not-empty queue) (queue-lock queue)))
-    (if (eq (queue-head queue) (queue-tail queue))
-        (prog1 (car (queue-head queue))
-          (setf (queue-head queue) nil
-                (queue-tail queue) nil))
-        (pop (queue-head queue)))))
+  (mp:concurrent-queue-pop (queue-native queue) time nil))
 
 (defun queue-count (queue)
   "
@@ -134,8 +105,7 @@ RETURN:     The number of entries in the QUEUE.
 NOTE:       The result may be falsified immediately, if another thread
             enqueues or dequeues.
 "
-  (mp:with-lock ((queue-lock queue))
-    (length (queue-head queue))))
+  (mp:concurrent-queue-count (queue-native queue)))
 
 (defun queue-emptyp (queue)
   "
@@ -145,7 +115,7 @@ NOTE:       The result may be falsified immediately, becoming false if
             another thread enqueues, or becoming true if another
             thread dequeues.
 "
-  (not (queue-head queue)))
+  (zerop (queue-count queue)))
 
 ;;;; THE END ;;;;
          
@@ -0,0 +1,307 @@
+;;;; -*- Mode: Lisp; Syntax: Common-Lisp; indent-tabs-mode: nil; Package: MP -*-
+;;;; vim: set filetype=lisp tabstop=8 shiftwidth=2 expandtab:
+
+;;;;
+;;;;  THREAD-POOL.LSP  -- A shared work-stealing executor with futures
+;;;;                      and parallel sequence operations.
+;;;;
+;;;;  Every worker owns an MP:CONCURRENT-QUEUE.  Tasks submitted from a
+;;;;  worker go onto its own queue, tasks submitted from anywhere else go
+;;;;  onto the pool's injection queue, and a worker that runs dry steals
+;;;;  from its siblings before it goes to sleep on the injection queue.
+;;;;  Waiting on a future from inside a worker runs other tasks instead
+;;;;  of blocking, so nested parallelism cannot starve the pool.
+;;;;
+;;;;  Workers are ordinary MP processes, so they are registered with the
+;;;;  GC like any other thread.  Tasks do not see the submitting thread's
+;;;;  dynamic bindings unless the variable is listed in
+;;;;  *THREAD-POOL-CAPTURED-SPECIALS* (or the :SPECIALS argument to
+;;;;  SUBMIT), in which case its value at submission is rebound around
+;;;;  the task.
+
+(in-package "MP")
+
+(export '(thread-pool make-thread-pool thread-pool-p thread-pool-name thread-pool-size
+          thread-pool-shutdown default-thread-pool *thread-pool* *thread-pool-captured-specials*
+          future futurep submit future-value future-done-p
+          pmap preduce pdotimes psort))
+
+(defvar *thread-pool* nil
+  "The pool used by SUBMIT and the parallel sequence functions when no
+pool is given.  Created on first use by DEFAULT-THREAD-POOL.")
+
+(defvar *thread-pool-captured-specials*
+  '(*package* *readtable* *standard-output* *error-output* *trace-output*
+    *print-base* *print-radix* *print-case* *print-circle* *print-escape*
+    *print-pretty* *print-readably* *print-length* *print-level*
+    *read-base* *read-default-float-format* *read-eval*)
+  "Special variables whose values at submission time are rebound around a task.")
+
+(defvar *thread-pool-lock* (make-lock :name "thread-pool"))
+
+;;; Bound in each worker to (pool . index)
+(defvar *current-worker* nil)
+
+(defstruct (thread-pool (:constructor %make-thread-pool (name size injection locals)))
+  name size injection locals
+  (workers nil)
+  ;; Number of workers sleeping on the injection queue, in a cons so it can be CASed
+  (idle (list 0))
+  (shutdown-p nil))
+
+(defstruct (future (:constructor %make-future (function specials bindings))
+                   (:predicate futurep))
+  function specials bindings results
+  ;; :PENDING, :RUNNING, :DONE or :FAILED, in a cons so a waiter can claim the task
+  (state (list :pending))
+  condition
+  (lock (make-lock :name "future"))
+  (done (make-condition-variable :name "future-done")))
+
+(defmethod print-object ((pool thread-pool) stream)
+  (print-unreadable-object (pool stream :type t :identity t)
+    (format stream "~a ~d workers" (thread-pool-name pool) (thread-pool-size pool))))
+
+(defmethod print-object ((future future) stream)
+  (print-unreadable-object (future stream :type t :identity t)
+    (princ (car (future-state future)) stream)))
+
+(defun thread-pool-take (queue)
+  ;; :shutdown tokens are only for parked workers - put them back behind
+  ;; any tasks and look at each queued entry at most once
+  (loop repeat (1+ (concurrent-queue-count queue))
+        for task = (concurrent-queue-pop queue 0 nil)
+        do (if (or (null task) (futurep task))
+               (return task)
+               (concurrent-queue-push queue task))))
+
+(defun thread-pool-take-waiting (queue)
+  (values (concurrent-queue-pop queue nil nil)))
+
+(defun thread-pool-find-task (pool index)
+  "Return a runnable future from the worker's own queue, the injection
+queue or a sibling's queue, or NIL.  INDEX is NIL outside the pool."
+  (let* ((locals (thread-pool-locals pool))
+         (count (length locals)))
+    (or (and index (thread-pool-take (svref locals index)))
+        (thread-pool-take (thread-pool-injection pool))
+        (loop for offset from 1 to count
+              for victim = (mod (+ (or index 0) offset) count)
+              for task = (thread-pool-take (svref locals victim))
+              when task
+                return task))))
+
+(defun run-future (future)
+  "Run FUTURE in this thread unless someone else already claimed it."
+  (when (eq (cas (car (future-state future)) :pending :running) :pending)
+    (let ((results nil) (condition nil) (returned nil))
+      ;; The state is settled in the cleanup so that waiters wake up even when
+      ;; the task is left by THROW, ABORT or a condition that is not an ERROR.
+      (unwind-protect
+           (handler-case
+               (setf results (multiple-value-list
+                              (progv (future-specials future) (future-bindings future)
+                                (funcall (future-function future))))
+                     returned t)
+             (error (c) (setf condition c returned t)))
+        (with-lock ((future-lock future))
+          (setf (future-function future) nil
+                (future-bindings future) nil
+                (future-results future) results
+                (future-condition future)
+                (or condition
+                    (and (not returned)
+                         (make-condition 'simple-error
+                                         :format-control "The task of ~a was unwound without returning."
+                                         :format-arguments (list future))))
+                (car (future-state future)) (if (and returned (null condition)) :done :failed))
+          (condition-variable-broadcast (future-done future)))))))
+
+(defun thread-pool-worker-loop (pool index)
+  (let ((*current-worker* (cons pool index))
+        (injection (thread-pool-injection pool))
+        (idle (thread-pool-idle pool)))
+    (loop
+      (let ((task (thread-pool-find-task pool index)))
+        (cond (task (run-future task))
+              ((thread-pool-shutdown-p pool) (return))
+              (t
+               ;; Park on the injection queue until work arrives; submitters
+               ;; hand tasks straight to it while anyone is idle, and
+               ;; thread-pool-shutdown wakes us with :shutdown.  Work pushed
+               ;; onto a busy sibling's own queue is run by that sibling.
+               (atomic-incf (car idle))
+               (let ((task (unwind-protect (thread-pool-take-waiting injection)
+                             (atomic-decf (car idle)))))
+                 (when (futurep task) (run-future task)))))))))
+
+(defun make-thread-pool (&key (name "thread-pool") (size (core:num-logical-processors)))
+  "Create and start a pool of SIZE worker processes."
+  (check-type size (integer 1))
+  (let* ((locals (make-array size))
+         (pool (progn
+                 (dotimes (index size)
+                   (setf (svref locals index)
+                         (make-concurrent-queue :name (format nil "~a-~d" name index))))
+                 (%make-thread-pool name size
+                                    (make-concurrent-queue :name (format nil "~a-injection" name))
+                                    locals))))
+    (setf (thread-pool-workers pool)
+          (loop for index below size
+                collect (let ((index index))
+                          (process-run-function
+                           (format nil "~a-~d" name index)
+                           (lambda () (thread-pool-worker-loop pool index))))))
+    pool))
+
+(defun thread-pool-shutdown (pool &key (wait t))
+  "Let the workers of POOL exit once the queued tasks have run."
+  (setf (thread-pool-shutdown-p pool) t)
+  (when (eq pool *thread-pool*)
+    (setf *thread-pool* nil))
+  ;; Wake the parked workers; one that finds work first leaves its token queued
+  (dotimes (i (thread-pool-size pool))
+    (concurrent-queue-push (thread-pool-injection pool) :shutdown))
+  (when wait
+    (mapc #'process-join (thread-pool-workers pool)))
+  pool)
+
+(defun default-thread-pool ()
+  (or *thread-pool*
+      (with-lock (*thread-pool-lock*)
+        (or *thread-pool*
+            (setf *thread-pool* (make-thread-pool :name "default-thread-pool"))))))
+
+(defun submit (function &key (pool (default-thread-pool))
+                             (specials *thread-pool-captured-specials*))
+  "Schedule FUNCTION to be called with no arguments on POOL and return a FUTURE
+for its values.  The current values of the bound variables in SPECIALS are
+rebound around the call."
+  (let* ((specials (remove-if-not #'boundp specials))
+         (future (%make-future function specials (mapcar #'symbol-value specials)))
+         (worker *current-worker*))
+    (if (and worker
+             (eq (car worker) pool)
+             (zerop (car (thread-pool-idle pool))))
+        (concurrent-queue-push (svref (thread-pool-locals pool) (cdr worker)) future)
+        (concurrent-queue-push (thread-pool-injection pool) future))
+    future))
+
+(defun future-done-p (future)
+  (and (member (car (future-state future)) '(:done :failed)) t))
+
+(defun future-value (future)
+  "Wait for FUTURE and return the values of its function, or resignal the error
+it exited with.  A waiting worker runs other tasks in the meantime."
+  (let ((worker *current-worker*))
+    ;; Nobody has started it yet - cheaper to run it here than to wait
+    (run-future future)
+    (loop until (future-done-p future)
+          do (let ((task (and worker
+                              (thread-pool-find-task (car worker) (cdr worker)))))
+               (if task
+                   (run-future task)
+                   (with-lock ((future-lock future))
+                     (unless (future-done-p future)
+                       (condition-variable-timedwait (future-done future)
+                                                     (future-lock future)
+                                                     (if worker 0.01 1.0))))))))
+  (if (eq (car (future-state future)) :failed)
+      (error (future-condition future))
+      (values-list (future-results future))))
+
+;;; Parallel sequence operations
+
+(defun chunk-bounds (start end pool)
+  "Split [START,END) into about four chunks per worker."
+  (let* ((count (- end start))
+         (chunks (max 1 (min count (* 4 (thread-pool-size pool)))))
+         (step (ceiling count chunks)))
+    (loop for chunk-start from start below end by step
+          collect (cons chunk-start (min end (+ chunk-start step))))))
+
+(defun run-chunks (function start end pool)
+  "Call FUNCTION on each chunk of [START,END) in parallel and return the
+results in order.  The last chunk runs in the calling thread."
+  (let* ((bounds (chunk-bounds start end pool))
+         (futures (mapcar (lambda (bound)
+                            (submit (lambda () (funcall function (car bound) (cdr bound)))
+                                    :pool pool))
+                          (butlast bounds)))
+         (last-bound (car (last bounds)))
+         (last (and last-bound (funcall function (car last-bound) (cdr last-bound)))))
+    (nconc (mapcar #'future-value futures) (and last-bound (list last)))))
+
+(defun pmap (result-type function first-sequence &rest more-sequences)
+  "Like MAP, but FUNCTION is called on the elements in parallel and in no
+particular order."
+  (let* ((pool (default-thread-pool))
+         (sequences (mapcar (lambda (sequence)
+                              (if (listp sequence) (coerce sequence 'simple-vector) sequence))
+                            (cons first-sequence more-sequences)))
+         (length (reduce #'min sequences :key #'length))
+         (results (and result-type (make-array length))))
+    (run-chunks (lambda (start end)
+                  (loop for index from start below end
+                        for value = (apply function (mapcar (lambda (sequence) (aref sequence index))
+                                                            sequences))
+                        when results
+                          do (setf (svref results index) value)))
+                0 length pool)
+    (and result-type (coerce results result-type))))
+
+(defun preduce (function sequence &key key (start 0) end (initial-value nil initial-value-p))
+  "Like REDUCE, but reduces chunks of SEQUENCE in parallel.  FUNCTION must be
+associative; INITIAL-VALUE is combined in once, at the front."
+  (let* ((pool (default-thread-pool))
+         (sequence (if (listp sequence) (coerce sequence 'simple-vector) sequence))
+         (end (or end (length sequence)))
+         (partials (if (< start end)
+                       (run-chunks (lambda (chunk-start chunk-end)
+                                     (reduce function sequence :key key
+                                                               :start chunk-start :end chunk-end))
+                                   start end pool)
+                       nil)))
+    (if initial-value-p
+        (reduce function partials :initial-value initial-value)
+        (reduce function partials))))
+
+(defun parallel-dotimes (count function)
+  (run-chunks (lambda (start end)
+                (loop for index from start below end
+                      do (funcall function index)))
+              0 count (default-thread-pool))
+  nil)
+
+(defmacro pdotimes ((var count &optional result) &body body)
+  "Like DOTIMES, but the iterations run in parallel and in no particular order."
+  `(progn
+     (parallel-dotimes ,count (lambda (,var) ,@body))
+     ,result))
+
+(defun psort (sequence predicate &key key)
+  "Stable sort of SEQUENCE by PREDICATE, sorting chunks in parallel and then
+merging them pairwise in parallel.  Vectors keep their element type.  Like
+SORT, SEQUENCE is destroyed and the sorted sequence is returned."
+  (let ((pool (default-thread-pool))
+        (vector (if (listp sequence) (coerce sequence 'simple-vector) sequence)))
+    (when (< (length vector) 2)
+      (return-from psort sequence))
+    (let ((result-type `(vector ,(array-element-type vector)))
+          (runs (run-chunks (lambda (start end)
+                              (stable-sort (subseq vector start end) predicate :key key))
+                            0 (length vector) pool)))
+      (loop while (cdr runs)
+            do (setf runs (mapcar (lambda (run) (if (futurep run) (future-value run) run))
+                                  (loop for (left right) on runs by #'cddr
+                                        collect (if right
+                                                    (let ((left left) (right right))
+                                                      (submit (lambda ()
+                                                                (merge result-type left right
+                                                                       predicate :key key))
+                                                              :pool pool))
+                                                    left)))))
+      (replace vector (first runs))
+      (if (listp sequence)
+          (replace sequence vector)
+          vector))))
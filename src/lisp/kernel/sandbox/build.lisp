@@ -106,6 +106,7 @@
         "src/lisp/kernel/clos/inspect"
         "src/lisp/kernel/lsp/fli"
         "src/lisp/modules/sockets/sockets"
+        "src/lisp/modules/sockets/server"
         "src/lisp/kernel/lsp/top"
         "src/lisp/kernel/cmp/export-to-cleavir"
         "src/lisp/kernel/tag/pre-epilogue-bclasp"
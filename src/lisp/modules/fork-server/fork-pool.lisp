@@ -0,0 +1,115 @@
+;;; A pool of pre-forked children that accept clients on a shared listener.
+;;;
+;;; The parent forks POOL-SIZE children ahead of time.  Each one parks on
+;;; the non-blocking listener, accepts the next client itself and tells the
+;;; parent over a pipe so a replacement is forked straight away.  The parent
+;;; reaps children that exit and keeps the pool full.  What a child does with
+;;; its client is up to the SERVE-CLIENT function - fork-server.lisp runs a
+;;; kernel.  This file has no other dependencies so it can be loaded and
+;;; tested on its own.
+
+(in-package :cl-user)
+
+(defvar *pool-child-warmup* nil
+  "A function that a pool child calls right after it is forked, before it
+waits for a client - load or touch whatever the kernels need here so a
+client finds it ready.")
+
+(defun run-pool-child (listen notify-read notify-write serve-client
+                       &key max-idle-seconds memory-limit)
+  "Body of a parked pool child: warm up, then wait on the shared non-blocking
+listener until a client arrives or MAX-IDLE-SECONDS pass.  The client's
+stream is passed to SERVE-CLIENT.  Never returns."
+  (sockets-internal:ff-close notify-read)
+  (when memory-limit
+    ;; Not :address-space - the GC and the JIT reserve far more address
+    ;; space than they ever touch, so that limit fails children at random.
+    (core:setrlimit :data memory-limit))
+  (when *pool-child-warmup*
+    (funcall *pool-child-warmup*))
+  (let ((listen-fd (sb-bsd-sockets:socket-file-descriptor listen))
+        (deadline (and max-idle-seconds
+                       (+ (get-internal-real-time)
+                          (* max-idle-seconds internal-time-units-per-second)))))
+    (loop
+      (let ((remaining (and deadline
+                            (/ (- deadline (get-internal-real-time))
+                               (float internal-time-units-per-second 1d0)))))
+        (when (and remaining (<= remaining 0))
+          ;; Retire so that the parent replaces us with a fresh child
+          (core:cexit))
+        (sockets-internal:ll-socket-poll listen-fd 1 remaining)
+        ;; Every parked child wakes up - only one of them gets the client
+        (let ((fd (sockets-internal:ll-socket-accept-non-blocking listen-fd)))
+          (when (>= fd 0)
+            (let ((notify (sb-bsd-sockets::make-stream-from-fd notify-write :output
+                                                               :element-type 'base-char
+                                                               :name "fork-server-notify")))
+              (format notify "~d~%" (core:getpid))
+              (close notify))
+            (let* ((socket (make-instance 'sb-bsd-sockets:inet-socket
+                                          :type :stream
+                                          :protocol (sb-bsd-sockets:socket-protocol listen)
+                                          :descriptor fd))
+                   (stream (progn
+                             (setf (sb-bsd-sockets:non-blocking-mode socket) nil)
+                             (sb-bsd-sockets:socket-make-stream socket
+                                                                :input t
+                                                                :output t
+                                                                :buffering :none
+                                                                :external-format :default
+                                                                :element-type :default))))
+              (funcall serve-client stream)
+              (core:cexit))))))))
+
+(defun run-fork-server-pool (listen pool-size serve-client
+                             &key max-idle-seconds memory-limit max-clients)
+  "Keep POOL-SIZE forked children parked on LISTEN, each calling SERVE-CLIENT
+with the stream of the client it accepts.  A child tells us over a pipe
+when it takes a client and we fork its replacement straight away; children
+that exit, idle or not, are reaped and replaced.  MEMORY-LIMIT caps the data
+segment of each child in bytes.  With MAX-CLIENTS, stop forking once that
+many clients were taken and return when every child has exited - give
+MAX-IDLE-SECONDS as well so the parked ones do.  Otherwise never return."
+  (gctools:change-sigchld-sigport-handlers)
+  (setf (sb-bsd-sockets:non-blocking-mode listen) t)
+  (multiple-value-bind (notify-read notify-write)
+      (core:pipe)
+    (let ((notify (sb-bsd-sockets::make-stream-from-fd notify-read :input
+                                                       :element-type 'base-char
+                                                       :name "fork-server-notify"))
+          (idle nil)
+          (live nil)
+          (taken 0))
+      (loop
+        (loop while (and (< (length idle) pool-size)
+                         (not (and max-clients (>= taken max-clients))))
+              do (multiple-value-bind (maybe-error pid)
+                     (core:fork)
+                   (cond ((eql pid 0)
+                          (run-pool-child listen notify-read notify-write serve-client
+                                          :max-idle-seconds max-idle-seconds
+                                          :memory-limit memory-limit))
+                         ((and (integerp pid) (> pid 0))
+                          (push pid idle)
+                          (push pid live))
+                         (t (format t "fork failed: ~a ~a~%" maybe-error pid)
+                            (sleep 1)
+                            (return)))))
+        (sockets-internal:ll-socket-poll notify-read 1 1.0)
+        (loop while (listen notify)
+              do (let ((pid (parse-integer (read-line notify) :junk-allowed t)))
+                   (format t "Child ~a took a client~%" pid)
+                   (incf taken)
+                   (setf idle (remove pid idle))))
+        (loop
+          (multiple-value-bind (pid status)
+              (core:waitpid :pid -1 :nohang t)
+            (declare (ignore status))
+            (when (<= pid 0) (return))
+            (setf idle (remove pid idle)
+                  live (remove pid live))))
+        (when (and max-clients (>= taken max-clients) (null live))
+          (close notify)
+          (sockets-internal:ff-close notify-write)
+          (return taken))))))
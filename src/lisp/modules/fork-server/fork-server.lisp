@@ -2,6 +2,7 @@
 (format t "fork-server.lisp starting *features* -> ~s~%" *features*)
 (format t "fork-server.lisp - loading start-cando.lisp~%") 
 (load "source-dir:extensions;cando;src;lisp;start-cando.lisp")
+(load (merge-pathnames "fork-pool.lisp" *load-truename*))
 
 (in-package :cl-user)
 
@@ -48,7 +49,62 @@
              ,@body))))))
 
 
-(defun main-jupyterlab-fork-server (&optional (server-info-directory #P"/tmp/clasp-fork-server/"))
+(defun env-integer (name)
+  (let ((value (ext:getenv name)))
+    (and value (parse-integer value :junk-allowed t))))
+
+(defun start-lifetime-watchdog (max-lifetime)
+  "After MAX-LIFETIME seconds make the current process throw to CHILD-LIFETIME-EXCEEDED."
+  (let ((main mp:*current-process*))
+    (mp:process-run-function
+     "fork-server-lifetime"
+     (lambda ()
+       (sleep max-lifetime)
+       (format t "Child ~a reached its lifetime of ~a seconds~%" (core:getpid) max-lifetime)
+       (mp:interrupt-process main (lambda () (throw 'child-lifetime-exceeded nil)))))))
+
+(defun serve-forked-client (stream listen connection-file-name server-info-directory
+                            &key max-lifetime)
+  "Run the kernel for one client in the forked child.  Never returns."
+  (let* ((child-directory (merge-pathnames (make-pathname :directory (list :relative (format nil "~d" (core:getpid)))) server-info-directory))
+         (child-connection-file-name (make-pathname :name connection-file-name :defaults child-directory))
+         (working-directory (read-line stream)))
+    (format t "Changing working directory for child to: ~s~%" working-directory)
+    (ext:chdir working-directory t)
+    (format stream "~d~%" (core:getpid))
+    (finish-output stream)
+    (let ((client-pid (parse-integer (read-line stream))))
+      (close stream)
+      (catch 'child-lifetime-exceeded
+        (with-child-data (:child-info-directory child-directory
+                          :connection-file-name child-connection-file-name
+                          :child-pid (core:getpid)
+                          :client-pid client-pid)
+          (when max-lifetime
+            (start-lifetime-watchdog max-lifetime))
+          (format t "Starting cl-jupyter-kernel-start child pid ~d~%" (core:getpid))
+          (let* ((delay (ext:getenv "CLASP_FORK_SERVER_DELAY"))
+                 (delay-seconds (if delay (parse-integer delay) nil)))
+            (when delay-seconds
+              (format t "Delaying ~d seconds before starting server~%" delay-seconds)
+              (sleep delay-seconds)
+              (format t "Done delay~%")))
+          (cando-user:cl-jupyter-kernel-start connection-file-name)
+          (sb-bsd-sockets:socket-close listen)))
+      (format t "Child ~a is exiting - client ~a should be killed as well...~%" (core:getpid) client-pid)
+      (core:cexit))))
+
+(defun main-jupyterlab-fork-server (&optional (server-info-directory #P"/tmp/clasp-fork-server/")
+                                    &key (pool-size (or (env-integer "CLASP_FORK_SERVER_POOL") 0))
+                                      (max-idle-seconds (env-integer "CLASP_FORK_SERVER_MAX_IDLE"))
+                                      (max-lifetime (env-integer "CLASP_FORK_SERVER_MAX_LIFETIME"))
+                                      (memory-limit (env-integer "CLASP_FORK_SERVER_MEMORY_LIMIT")))
+  "Serve kernel requests on a loopback port.  With a POOL-SIZE of zero a
+child is forked for each client after it connects.  Otherwise POOL-SIZE
+children are forked ahead of time and wait for clients themselves.
+MAX-IDLE-SECONDS retires parked children, MAX-LIFETIME ends a child that
+has served a client for that many seconds and MEMORY-LIMIT caps the data
+segment of each child in bytes.  There is no limit unless one is given."
   (let ((listen (make-instance 'sb-bsd-sockets:inet-socket
                                :type :stream
                                :protocol :tcp)))
@@ -65,7 +121,18 @@
         (format t "server pid: ~a~%" (core:getpid))
         (format t "server-info-directory -> ~a~%" server-info-directory)
         ;; Create a connection queue, ignore child exit details and wait for clients.
-        (sb-bsd-sockets:socket-listen listen 5) ; listen(server_sockfd, 5);
+        (sb-bsd-sockets:socket-listen listen (if (plusp pool-size) 128 5)) ; listen(server_sockfd, 5);
+        (when (plusp pool-size)
+          (format t "Keeping a pool of ~d children~%" pool-size)
+          (run-fork-server-pool listen pool-size
+                                (lambda (stream)
+                                  (let ((connection-file-name (read-line stream)))
+                                    (format t "Pool child ~a received connection-file-name: ~s~%" (core:getpid) connection-file-name)
+                                    (finish-output)
+                                    (serve-forked-client stream listen connection-file-name server-info-directory
+                                                         :max-lifetime max-lifetime)))
+                                :max-idle-seconds max-idle-seconds
+                                :memory-limit memory-limit))
         (loop
           (format t "Server waiting~%")
           ;; Accept connection.
@@ -85,31 +152,11 @@
                    (gctools:change-sigchld-sigport-handlers)
                    (multiple-value-bind (maybe-error pid child-stream)
                        (core:fork)
-                     (if (= pid 0)
-                         (let* ((child-directory (merge-pathnames (make-pathname :directory (list :relative (format nil "~d" (core:getpid)))) server-info-directory))
-                                (child-connection-file-name (make-pathname :name connection-file-name :defaults child-directory))
-                                (working-directory (read-line stream)))
-                           (format t "Changing working directory for child to: ~s~%" working-directory)
-                           (ext:chdir working-directory t)
-                           (format stream "~d~%" (core:getpid))
-                           (finish-output stream)
-                           (let ((client-pid (parse-integer (read-line stream))))
-                             (close stream)
-                             (with-child-data (:child-info-directory child-directory
-                                               :connection-file-name child-connection-file-name
-                                               :child-pid (core:getpid)
-                                               :client-pid client-pid)
-                               (format t "Starting cl-jupyter-kernel-start child pid ~d~%" (core:getpid))
-                               (let* ((delay (ext:getenv "CLASP_FORK_SERVER_DELAY"))
-                                      (delay-seconds (if delay (parse-integer delay) nil)))
-                                 (when delay-seconds
-                                   (format t "Delaying ~d seconds before starting server~%" delay-seconds)
-                                   (sleep delay-seconds)
-                                   (format t "Done delay~%")))
-                               (cando-user:cl-jupyter-kernel-start connection-file-name)
-                               (sb-bsd-sockets:socket-close listen))
-                             (format t "Child ~a is exiting - client ~a should be killed as well...~%" (core:getpid) client-pid)
-                             (core:cexit))))))
+                     (when (= pid 0)
+                       (when memory-limit
+                         (core:setrlimit :data memory-limit))
+                       (serve-forked-client stream listen connection-file-name server-info-directory
+                                            :max-lifetime max-lifetime))))
               (progn
                 ;; parent
                 (close stream)))))))
@@ -2,11 +2,16 @@
 ;;
 ;; This file provides a port the SBCL/CMUCL 'serve-event'
 ;; functionality to ecl.  serve-event provides a lispy abstraction of
-;; unix select(2) non-blocking IO (and potentially other variants such as
-;; epoll).  It works with Unix-level file-descriptors, which can be
-;; retrieved from the sockets module using the socket-file-descriptor
+;; unix non-blocking IO.  It works with Unix-level file-descriptors, which
+;; can be retrieved from the sockets module using the socket-file-descriptor
 ;; slot.
 ;;
+;; Handlers are registered with an event loop that keeps its interest
+;; set persistent - epoll on Linux, a cached poll(2) vector elsewhere -
+;; so a wait costs time in the number of ready descriptors rather than
+;; the number registered.  *EVENT-LOOP* is the loop used by default;
+;; a thread that binds it (see WITH-EVENT-LOOP) runs its own loop.
+;;
 ;; As this file is based on SBCL's serve-event module it is being
 ;; released under the same (non) license as SBCL (i.e. public-domain).
 ;;
@@ -37,25 +42,73 @@
 (defpackage "SERVE-EVENT"
   (:use "CL" #-clasp "UFFI" #+clasp "SERVE-EVENT-INTERNAL")
   (:export "WITH-FD-HANDLER" "ADD-FD-HANDLER" "REMOVE-FD-HANDLER"
-           "SERVE-EVENT" "SERVE-ALL-EVENTS"))
+           "INVALIDATE-DESCRIPTOR" "SERVE-EVENT" "SERVE-ALL-EVENTS"
+           "*EVENT-LOOP*" "MAKE-EVENT-LOOP" "CLOSE-EVENT-LOOP" "WITH-EVENT-LOOP"
+           "WAKE-EVENT-LOOP" "EVENT-LOOP-BACKEND"))
 (in-package "SERVE-EVENT")
 
 
+(defstruct (event-loop
+             (:constructor %make-event-loop (pointer))
+             (:copier nil))
+  ;; The core:pointer to the C++ loop
+  pointer
+  ;; Descriptor -> list of the handlers registered on it
+  (handlers (make-hash-table :test #'eql))
+  (lock (mp:make-lock :name "event-loop")))
+
+(defun make-event-loop (&key backend)
+  "Create an event loop.  BACKEND is :EPOLL or :POLL, NIL picks the best
+  one available."
+  (%make-event-loop (ll-make-event-loop backend)))
+
+(defun close-event-loop (loop)
+  "Release the kernel resources of LOOP.  Its descriptors are not closed."
+  (ll-event-loop-close (event-loop-pointer loop))
+  (clrhash (event-loop-handlers loop))
+  nil)
+
+(defun event-loop-backend (loop)
+  (ll-event-loop-backend (event-loop-pointer loop)))
+
+(defun wake-event-loop (loop)
+  "Make a SERVE-EVENT waiting on LOOP in another thread return."
+  (ll-event-loop-wakeup (event-loop-pointer loop)))
+
+(defvar *event-loop* nil
+  "The event loop used when none is given.  It is created on first use.")
+
+(defvar *event-loop-lock* (mp:make-lock :name "current-event-loop"))
+
+(defun current-event-loop ()
+  ;; Two threads racing here must not each create a loop - one of them
+  ;; would register handlers on a loop nobody serves
+  (or *event-loop*
+      (mp:with-lock (*event-loop-lock*)
+        (or *event-loop* (setf *event-loop* (make-event-loop))))))
+
+(defmacro with-event-loop ((&key backend) &body body)
+  "Evaluate BODY with *EVENT-LOOP* bound to a fresh event loop that is closed
+  on exit.  Use this in a thread to give it its own loop."
+  `(let ((*event-loop* (make-event-loop :backend ,backend)))
+     (unwind-protect (progn ,@body)
+       (close-event-loop *event-loop*))))
+
+
 (defstruct (handler
-             (:constructor make-handler (descriptor direction function))
+             (:constructor make-handler (descriptor direction function loop))
              (:copier nil))
   ;; Reading or writing...
   (direction nil :type (member :input :output))
   ;; File descriptor this handler is tied to.
-  ;; FIXME: Should be based on FD_SETSIZE
   (descriptor 0)
   ;; Function to call.
-  (function nil :type function))
-
-
-(defvar *descriptor-handlers* nil
-  ;;  #!+sb-doc
-  "List of all the currently active handlers for file descriptors")
+  (function nil :type function)
+  ;; The event loop it is registered with
+  loop
+  ;; Cleared on removal so a handler removed by another one in the same
+  ;; batch of events isn't called
+  (active t))
 
 (defun coerce-to-descriptor (stream-or-fd direction)
   (etypecase stream-or-fd
@@ -70,8 +123,20 @@
     #+clos-streams
     (stream (gray::stream-file-descriptor stream-or-fd direction))))
 
-;;; Add a new handler to *descriptor-handlers*.
-(defun add-fd-handler (stream-or-fd direction function)
+(defun direction-events (direction)
+  (ecase direction
+    (:input +ev-input+)
+    (:output +ev-output+)))
+
+;;; Tell the kernel what we are waiting for on FD.  Call with the loop lock held.
+(defun update-descriptor-interest (loop fd)
+  (let ((events 0))
+    (dolist (handler (gethash fd (event-loop-handlers loop)))
+      (setf events (logior events (direction-events (handler-direction handler)))))
+    (ll-event-loop-modify (event-loop-pointer loop) fd events)))
+
+;;; Register a new handler with the event loop.
+(defun add-fd-handler (stream-or-fd direction function &key (loop (current-event-loop)))
   "Arrange to call FUNCTION whenever the fd designated by STREAM-OR-FD
   is usable. DIRECTION should be either :INPUT or :OUTPUT. The value
   returned should be passed to SYSTEM:REMOVE-FD-HANDLER when it is no
@@ -82,20 +147,36 @@
            :format-arguments (list direction)
            :datum direction
            :expected-type '(member :input :output)))
-  (let ((handler (make-handler (coerce-to-descriptor stream-or-fd direction)
-                               direction
-                               function)))
-    (push handler *descriptor-handlers*)
+  (let* ((fd (coerce-to-descriptor stream-or-fd direction))
+         (handler (make-handler fd direction function loop)))
+    (mp:with-lock ((event-loop-lock loop))
+      (push handler (gethash fd (event-loop-handlers loop)))
+      (update-descriptor-interest loop fd))
     handler))
 
-;;; Remove an old handler from *descriptor-handlers*.
+;;; Remove an old handler from its event loop.
 (defun remove-fd-handler (handler)
   ;;  #!+sb-doc
   "Removes HANDLER from the list of active handlers."
-  (setf *descriptor-handlers*
-        (delete handler *descriptor-handlers*)))
-
-;;; Add the handler to *descriptor-handlers* for the duration of BODY.
+  (let ((loop (handler-loop handler))
+        (fd (handler-descriptor handler)))
+    (setf (handler-active handler) nil)
+    (mp:with-lock ((event-loop-lock loop))
+      (let ((remaining (delete handler (gethash fd (event-loop-handlers loop)))))
+        (if remaining
+            (setf (gethash fd (event-loop-handlers loop)) remaining)
+            (remhash fd (event-loop-handlers loop))))
+      (update-descriptor-interest loop fd))))
+
+(defun invalidate-descriptor (fd &key (loop (current-event-loop)))
+  "Remove all the handlers for FD.  Call this before closing FD."
+  (mp:with-lock ((event-loop-lock loop))
+    (dolist (handler (gethash fd (event-loop-handlers loop)))
+      (setf (handler-active handler) nil))
+    (remhash fd (event-loop-handlers loop))
+    (ll-event-loop-modify (event-loop-pointer loop) fd 0)))
+
+;;; Add the handler to the event loop for the duration of BODY.
 (defmacro with-fd-handler ((fd direction function) &rest body)
   "Establish a handler with SYSTEM:ADD-FD-HANDLER for the duration of BODY.
    DIRECTION should be either :INPUT or :OUTPUT, FD is the file descriptor to
@@ -110,78 +191,49 @@
            (remove-fd-handler ,handler))))))
 
 
-(defmacro fd-zero(fdset)
-  `(ll-fd-zero ,fdset))
-
-(defmacro fd-set (fd fdset)
-  `(ll-fd-set ,fd ,fdset))
-
-(defmacro fd-isset (fd fdset)
-  `(ll-fd-isset ,fd ,fdset))
-
-(defun fdset-size ()
-  `(ll-fdset-size))
-
-
-(defun serve-event (&optional (seconds nil))
+(defun serve-event (&optional (seconds nil) (loop (current-event-loop)))
   "Receive pending events on all FD-STREAMS and dispatch to the appropriate
    handler functions. If timeout is specified, server will wait the specified
    time (in seconds) and then return, otherwise it will wait until something
    happens. Server returns T if something happened and NIL otherwise. Timeout
    0 means polling without waiting."
-
-  ;; fd_set is an opaque typedef, so we can't declare it locally.
-  ;; However we can fine out its size and allocate a char array of
-  ;; the same size which can be used in its place.
-  (let ((fsize (fdset-size)))
-    (clasp-ffi:with-foreign-objects ((rfd `(:array :unsigned-byte ,fsize))
-                                     (wfd `(:array :unsigned-byte ,fsize)))
-      (fd-zero rfd)
-      (fd-zero wfd)
-      (let ((maxfd 0))
-        ;; Load the descriptors into the relevant set
-        (dolist (handler *descriptor-handlers*)
-          (let ((fd (handler-descriptor handler)))
-            (ecase (handler-direction handler)
-              (:input (fd-set fd rfd))
-              (:output (fd-set fd wfd)))
-            (when (> fd maxfd)
-              (setf maxfd fd))))
-
-        (multiple-value-bind (retval errno)
-	    (if (null seconds)
-		;; No timeout
-                (ll-serve-event-no-timeout rfd wfd (1+ maxfd))
-                (ll-serve-event-with-timeout rfd wfd (1+ maxfd) seconds))
-
-	  (cond ((zerop retval) 
-		 nil)
-		((minusp retval)
-		 (if (= errno +eintr+)
-		     ;; suppress EINTR
-		     nil
-		     ;; otherwise error
-		     (error "Error during select retval:~A errno:~A" retval errno)))
-		((plusp retval)  
-		 (dolist (handler *descriptor-handlers*)
-		   (let ((fd (handler-descriptor handler)))
-		     (if (plusp (ecase (handler-direction handler)
-				  (:input (fd-isset fd rfd))
-				  (:output (fd-isset fd wfd))))
-			 (funcall (handler-function handler) 
-				  (handler-descriptor handler)))))
-		 t)))))))
+  (let ((pointer (event-loop-pointer loop)))
+    (multiple-value-bind (retval errno)
+        (ll-event-loop-wait pointer seconds)
+      (cond ((zerop retval)
+             nil)
+            ((minusp retval)
+             (if (= errno +eintr+)
+                 ;; suppress EINTR
+                 nil
+                 ;; otherwise error
+                 (error "Error during event wait retval:~A errno:~A" retval errno)))
+            (t
+             ;; Collect the handlers first - they may add and remove handlers
+             (let ((ready nil))
+               (mp:with-lock ((event-loop-lock loop))
+                 (dotimes (i retval)
+                   (let ((fd (ll-event-loop-ready-fd pointer i))
+                         (events (ll-event-loop-ready-events pointer i)))
+                     (dolist (handler (gethash fd (event-loop-handlers loop)))
+                       (when (logtest events (direction-events (handler-direction handler)))
+                         (push handler ready))))))
+               (dolist (handler (nreverse ready))
+                 (when (handler-active handler)
+                   (funcall (handler-function handler)
+                            (handler-descriptor handler)))))
+             t)))))
 
 
 ;;; Wait for up to timeout seconds for an event to happen. Make sure all
 ;;; pending events are processed before returning.
-(defun serve-all-events (&optional (timeout nil))
+(defun serve-all-events (&optional (timeout nil) (loop (current-event-loop)))
   "SERVE-ALL-EVENTS calls SERVE-EVENT with the specified timeout. If
 SERVE-EVENT does something (returns T) it loops over SERVE-EVENT with a
 timeout of 0 until there are no more events to serve. SERVE-ALL-EVENTS returns
 T if SERVE-EVENT did something and NIL if not."
   (do ((res nil)
-       (sval (serve-event timeout) (serve-event 0)))
+       (sval (serve-event timeout loop) (serve-event 0 loop)))
       ((null sval) res)
     (setq res t)))
 
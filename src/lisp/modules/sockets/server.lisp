@@ -0,0 +1,552 @@
+;; -*- Mode: Lisp; Syntax: Common-Lisp -*-
+
+;;; A non-blocking, multi-threaded server core.
+;;;
+;;; A SERVER runs a number of worker threads.  Each worker owns a
+;;; serve-event-internal event loop, a listening socket and every
+;;; connection that it accepted, so workers never share state and the
+;;; request path takes no locks.  Where SO_REUSEPORT is available each
+;;; worker binds its own listener to the port and the kernel spreads new
+;;; connections over them; otherwise the workers share one non-blocking
+;;; listener and whichever wins the accept takes the connection.
+;;;
+;;; Connections are served by callbacks.  The server's HANDLER is called
+;;; on the worker thread with the CONNECTION whenever more input has been
+;;; buffered or the peer has closed its end.  It consumes what it can with
+;;; CONNECTION-READ-LINE, CONNECTION-READ-OCTETS or the CONNECTION-STREAM and
+;;; queues its reply with CONNECTION-WRITE-OCTETS, CONNECTION-WRITE-STRING or
+;;; the stream; the worker writes queued output as the socket drains.
+;;; Connection functions may only be called on the worker thread that owns
+;;; the connection.  Input that the handler leaves unread may grow the
+;;; input buffer up to the server's MAX-INPUT-SIZE, a peer that sends more
+;;; than that without it being consumed is disconnected.
+
+(in-package "SB-BSD-SOCKETS")
+
+(export '(server make-server server-start server-stop server-port
+          server-running-p with-server
+          connection connection-server connection-socket connection-data
+          connection-input-available connection-eof-p
+          connection-read-octets connection-read-line
+          connection-write-octets connection-write-string
+          connection-finish-output connection-close connection-stream))
+
+(defstruct (server (:constructor %make-server))
+  handler
+  on-connect
+  on-close
+  (host "127.0.0.1")
+  (port 0)
+  (workers 1)
+  (backlog 1024)
+  (reuse-port t)
+  (buffer-size 16384)
+  (max-input-size (* 1024 1024))
+  (worker-states nil)
+  (running-p nil))
+
+(defstruct (server-worker (:constructor make-server-worker (server listener)))
+  server
+  listener
+  (event-loop (serve-event-internal:ll-make-event-loop))
+  (process nil)
+  ;; Internal real time at which a listener disarmed by a failed accept
+  ;; is armed again, or NIL
+  (accept-paused-until nil)
+  (connections (make-hash-table :test #'eql)))
+
+(defvar *server-accept-backoff* 0.1
+  "Seconds a worker stops accepting after accept fails for lack of
+descriptors or memory.  The listener is level triggered so retrying at
+once would spin until a connection is closed.")
+
+(defstruct (connection (:constructor make-connection (worker socket fd input output)))
+  worker
+  socket
+  fd
+  input
+  (input-start 0)
+  (input-end 0)
+  output
+  (output-start 0)
+  (output-end 0)
+  (events 0)
+  (eof-p nil)
+  (closing nil)
+  (closed nil)
+  (%stream nil)
+  (data nil))
+
+(defun make-server (handler &key on-connect on-close (host "127.0.0.1") (port 0)
+                                 (workers 1) (backlog 1024) (reuse-port t)
+                                 (buffer-size 16384) (max-input-size (* 1024 1024)))
+  "Make a server that calls HANDLER with a CONNECTION whenever new input
+arrives on it.  ON-CONNECT and ON-CLOSE, if given, are called with each
+connection after it is accepted and after it is closed.  WORKERS threads
+serve connections; with REUSE-PORT each of them gets its own SO_REUSEPORT
+listener.  BUFFER-SIZE is the initial size of the per-connection input and
+output buffers, which grow as needed.  The input buffer never grows past
+MAX-INPUT-SIZE octets (NIL for no limit) - a connection that fills it is
+closed.  PORT 0 picks a free port - see
+SERVER-PORT once the server is started."
+  (%make-server :handler handler :on-connect on-connect :on-close on-close
+                :host host :port port :workers workers :backlog backlog
+                :reuse-port reuse-port :buffer-size buffer-size
+                :max-input-size max-input-size))
+
+(defun make-server-listener (server port reuse-port)
+  (let ((socket (make-instance 'inet-socket :type :stream :protocol :tcp)))
+    (setf (sockopt-reuse-address socket) t)
+    #-(or :sun4sol2 :wsock :cygwin)
+    (when reuse-port
+      (setf (sockopt-reuse-port socket) t))
+    (socket-bind socket (make-inet-address (server-host server)) port)
+    (socket-listen socket (server-backlog server))
+    (setf (non-blocking-mode socket) t)
+    socket))
+
+(defun server-start (server)
+  "Open the listeners and start the worker threads of SERVER.  Returns SERVER."
+  (when (server-running-p server)
+    (error "~a is already running" server))
+  (let* ((reuse-port (and (server-reuse-port server)
+                          (> (server-workers server) 1)
+                          #+(or :sun4sol2 :wsock :cygwin) nil))
+         (primary (make-server-listener server (server-port server) reuse-port))
+         (port (nth-value 1 (socket-name primary))))
+    (setf (server-port server) port
+          (server-running-p server) t
+          (server-worker-states server)
+          (loop for index below (server-workers server)
+                collect (make-server-worker
+                         server
+                         (cond ((zerop index) primary)
+                               (reuse-port (make-server-listener server port t))
+                               (t primary)))))
+    (loop for worker in (server-worker-states server)
+          for index from 0
+          do (let ((worker worker))
+               (setf (server-worker-process worker)
+                     (mp:process-run-function
+                      (format nil "server-worker-~d" index)
+                      (lambda () (server-worker-run worker))))))
+    server))
+
+(defun server-stop (server)
+  "Stop the worker threads of SERVER and close its listeners and connections."
+  (when (server-running-p server)
+    (setf (server-running-p server) nil)
+    (let ((workers (server-worker-states server)))
+      (dolist (worker workers)
+        (serve-event-internal:ll-event-loop-wakeup (server-worker-event-loop worker)))
+      (dolist (worker workers)
+        (mp:process-join (server-worker-process worker)))
+      (let ((closed nil))
+        (dolist (worker workers)
+          (let ((listener (server-worker-listener worker)))
+            (unless (member listener closed)
+              (push listener closed)
+              (socket-close listener)))
+          (serve-event-internal:ll-event-loop-close (server-worker-event-loop worker))))
+      (setf (server-worker-states server) nil)))
+  server)
+
+(defmacro with-server ((var handler &rest options) &body body)
+  "Run BODY with VAR bound to a started server, stopping it on exit."
+  `(let ((,var (server-start (make-server ,handler ,@options))))
+     (unwind-protect (progn ,@body)
+       (server-stop ,var))))
+
+;;; The worker thread
+
+(defun server-worker-run (worker)
+  (let* ((server (server-worker-server worker))
+         (event-loop (server-worker-event-loop worker))
+         (listen-fd (socket-file-descriptor (server-worker-listener worker))))
+    (serve-event-internal:ll-event-loop-modify event-loop listen-fd serve-event-internal:+ev-input+)
+    (unwind-protect
+         (loop while (server-running-p server)
+               do (multiple-value-bind (count errno)
+                      (serve-event-internal:ll-event-loop-wait event-loop (server-worker-accept-timeout worker))
+                    (when (and (minusp count) (/= errno +eintr+))
+                      (error "Server event loop wait failed: ~a" (ll-strerror errno)))
+                    (server-worker-maybe-resume-accept worker listen-fd)
+                    (dotimes (index count)
+                      (let ((fd (serve-event-internal:ll-event-loop-ready-fd event-loop index))
+                            (events (serve-event-internal:ll-event-loop-ready-events event-loop index)))
+                        (if (= fd listen-fd)
+                            (server-worker-accept worker listen-fd)
+                            (let ((connection (gethash fd (server-worker-connections worker))))
+                              (when connection
+                                (serve-connection connection events))))))))
+      (serve-event-internal:ll-event-loop-modify event-loop listen-fd 0)
+      (dolist (connection (loop for connection being the hash-values
+                                  of (server-worker-connections worker)
+                                collect connection))
+        (connection-close connection :abort t)))))
+
+(defun server-worker-accept-timeout (worker)
+  "Seconds to wait for events - until the listener is armed again if it is
+paused, otherwise forever."
+  (let ((until (server-worker-accept-paused-until worker)))
+    (when until
+      (max 0 (/ (- until (get-internal-real-time)) internal-time-units-per-second)))))
+
+(defun server-worker-maybe-resume-accept (worker listen-fd)
+  (let ((until (server-worker-accept-paused-until worker)))
+    (when (and until (>= (get-internal-real-time) until))
+      (setf (server-worker-accept-paused-until worker) nil)
+      (serve-event-internal:ll-event-loop-modify (server-worker-event-loop worker)
+                                                 listen-fd serve-event-internal:+ev-input+))))
+
+(defun server-worker-pause-accept (worker listen-fd)
+  (serve-event-internal:ll-event-loop-modify (server-worker-event-loop worker) listen-fd 0)
+  (setf (server-worker-accept-paused-until worker)
+        (+ (get-internal-real-time)
+           (round (* *server-accept-backoff* internal-time-units-per-second)))))
+
+(defun server-worker-accept (worker listen-fd)
+  (let ((server (server-worker-server worker)))
+    (loop
+      (multiple-value-bind (fd errno)
+          (ll-socket-accept-non-blocking listen-fd)
+        (cond
+          ;; Another worker took it or the queue is drained
+          ((and (minusp fd) (= errno +eagain+)) (return))
+          ;; The pending connection is gone from the queue - try the next
+          ((and (minusp fd) (member errno (list +eintr+ +econnaborted+))))
+          ;; Out of descriptors or memory (EMFILE, ENFILE, ENOBUFS, ...).
+          ;; The connection stays queued and the listener stays readable,
+          ;; so stop watching it for a while instead of spinning.
+          ((minusp fd)
+           (server-worker-pause-accept worker listen-fd)
+           (return))
+          (t
+           (let* ((size (server-buffer-size server))
+                  (socket (make-instance 'inet-socket
+                                         :type :stream
+                                         :protocol (socket-protocol (server-worker-listener worker))
+                                         :descriptor fd))
+                  (connection (make-connection worker socket fd
+                                               (make-array size :element-type '(unsigned-byte 8))
+                                               (make-array size :element-type '(unsigned-byte 8)))))
+             (setf (gethash fd (server-worker-connections worker)) connection)
+             (connection-update-events connection)
+             (when (server-on-connect server)
+               (call-connection-callback connection (server-on-connect server))))))))))
+
+(defun call-connection-callback (connection callback)
+  ;; An error in one connection's callback must not take the worker down
+  (handler-case (funcall callback connection)
+    (error (condition)
+      (format *error-output* "~&;;; Closing ~a after error: ~a~%" connection condition)
+      (connection-close connection :abort t))))
+
+(defun serve-connection (connection events)
+  (let ((server (server-worker-server (connection-worker connection))))
+    (when (and (logtest events serve-event-internal:+ev-input+)
+               (not (connection-eof-p connection))
+               (connection-fill-input connection))
+      (call-connection-callback connection (server-handler server)))
+    (unless (connection-closed connection)
+      (when (logtest events serve-event-internal:+ev-output+)
+        (connection-flush-output connection))
+      (cond ((connection-closed connection))
+            ((and (or (connection-closing connection) (connection-eof-p connection))
+                  (= (connection-output-start connection) (connection-output-end connection)))
+             (connection-release connection))
+            (t (connection-update-events connection))))))
+
+(defun connection-update-events (connection)
+  (let ((events (logior (if (or (connection-eof-p connection) (connection-closing connection))
+                            0
+                            serve-event-internal:+ev-input+)
+                        (if (< (connection-output-start connection) (connection-output-end connection))
+                            serve-event-internal:+ev-output+
+                            0))))
+    (unless (= events (connection-events connection))
+      (serve-event-internal:ll-event-loop-modify
+       (server-worker-event-loop (connection-worker connection))
+       (connection-fd connection) events)
+      (setf (connection-events connection) events))))
+
+;;; Buffers
+
+(defun connection-fill-input (connection)
+  "Read what is available into the input buffer.  Returns true if the
+handler has something new to look at - more octets or end of file.  If the
+buffer is already at the server's MAX-INPUT-SIZE the connection is closed."
+  (let ((buffer (connection-input connection))
+        (start (connection-input-start connection))
+        (end (connection-input-end connection))
+        (max-size (server-max-input-size (connection-server connection))))
+    ;; Make room at the end, sliding the unread octets down or growing
+    (cond ((= start end)
+           (setf start 0 end 0))
+          ((and (= end (length buffer)) (plusp start))
+           (replace buffer buffer :start2 start :end2 end)
+           (setf end (- end start) start 0))
+          ((and (= end (length buffer)) max-size (>= (length buffer) max-size))
+           (format *error-output* "~&;;; Closing ~a - more than ~d octets of unread input~%"
+                   connection max-size)
+           (setf (connection-eof-p connection) t)
+           (connection-close connection :abort t)
+           (return-from connection-fill-input nil))
+          ((= end (length buffer))
+           (let ((new (make-array (if max-size
+                                      (min (* 2 (length buffer)) max-size)
+                                      (* 2 (length buffer)))
+                                  :element-type '(unsigned-byte 8))))
+             (replace new buffer)
+             (setf buffer new
+                   (connection-input connection) new))))
+    (setf (connection-input-start connection) start
+          (connection-input-end connection) end)
+    (multiple-value-bind (len errno)
+        (ll-socket-receive-into (connection-fd connection) buffer end nil nil nil nil nil)
+      (cond ((plusp len)
+             (setf (connection-input-end connection) (+ end len))
+             t)
+            ((zerop len)
+             (setf (connection-eof-p connection) t))
+            ((member errno (list +eagain+ +eintr+))
+             nil)
+            (t
+             ;; Reset or similar - there is nothing more to read or write
+             (setf (connection-eof-p connection) t
+                   (connection-output-start connection) 0
+                   (connection-output-end connection) 0))))))
+
+(defun connection-wait (connection events)
+  (multiple-value-bind (ready errno)
+      (ll-socket-poll (connection-fd connection) events nil)
+    (when (and (minusp ready) (/= errno +eintr+))
+      (error "poll on ~a failed: ~a" connection (ll-strerror errno)))))
+
+(defun connection-fill-input-blocking (connection)
+  "Wait until more input or end of file arrives.  This holds up every other
+connection of the worker so it is only for handlers that want a blocking
+read."
+  (loop until (or (connection-eof-p connection) (connection-fill-input connection))
+        do (connection-wait connection serve-event-internal:+ev-input+)))
+
+(defun connection-input-available (connection)
+  "The number of buffered input octets not yet read."
+  (- (connection-input-end connection) (connection-input-start connection)))
+
+(defun connection-read-octets (connection buffer &key (start 0) (end (length buffer)))
+  "Move up to END - START buffered input octets into BUFFER without waiting.
+Returns the number of octets moved."
+  (let* ((from (connection-input-start connection))
+         (count (min (- end start) (- (connection-input-end connection) from))))
+    (replace buffer (connection-input connection)
+             :start1 start :start2 from :end2 (+ from count))
+    (incf (connection-input-start connection) count)
+    count))
+
+(defun connection-read-line (connection)
+  "Return the next buffered line as a string, without its CR LF or LF
+terminator, or NIL if a complete line has not arrived yet.  Octets are
+mapped to characters with LATIN-1.  At end of file an unterminated last
+line is returned."
+  (let* ((input (connection-input connection))
+         (start (connection-input-start connection))
+         (end (connection-input-end connection))
+         (newline (position 10 input :start start :end end)))
+    (when (or newline (and (connection-eof-p connection) (< start end)))
+      (let* ((line-end (or newline end))
+             (text-end (if (and (> line-end start) (= (aref input (1- line-end)) 13))
+                           (1- line-end)
+                           line-end))
+             (line (make-string (- text-end start) :element-type 'base-char)))
+        (loop for index from start below text-end
+              for out from 0
+              do (setf (schar line out) (code-char (aref input index))))
+        (setf (connection-input-start connection) (if newline (1+ newline) end))
+        line))))
+
+(defun connection-reserve-output (connection count)
+  "Make room for COUNT more octets of output and return the index to write them at."
+  (let* ((buffer (connection-output connection))
+         (start (connection-output-start connection))
+         (end (connection-output-end connection)))
+    (when (> (+ end count) (length buffer))
+      (if (<= (+ (- end start) count) (length buffer))
+          (replace buffer buffer :start2 start :end2 end)
+          (let ((new (make-array (max (* 2 (length buffer)) (+ (- end start) count))
+                                 :element-type '(unsigned-byte 8))))
+            (replace new buffer :start2 start :end2 end)
+            (setf (connection-output connection) new)))
+      (setf end (- end start)
+            (connection-output-start connection) 0
+            (connection-output-end connection) end))
+    end))
+
+(defun connection-write-octets (connection octets &key (start 0) (end (length octets)))
+  "Queue the octets START to END of OCTETS for output on CONNECTION."
+  (let ((at (connection-reserve-output connection (- end start))))
+    (replace (connection-output connection) octets :start1 at :start2 start :end2 end)
+    (incf (connection-output-end connection) (- end start))
+    octets))
+
+(defun connection-write-string (connection string &key (start 0) (end (length string)))
+  "Queue the characters START to END of STRING, encoded as LATIN-1, for output."
+  (let* ((at (connection-reserve-output connection (- end start)))
+         (output (connection-output connection)))
+    (loop for index from start below end
+          for out from at
+          do (setf (aref output out) (char-code (char string index))))
+    (incf (connection-output-end connection) (- end start))
+    string))
+
+(defun connection-flush-output (connection)
+  "Write as much queued output as the socket takes without blocking.
+Returns true when all of it has been written."
+  (loop
+    (let ((start (connection-output-start connection))
+          (end (connection-output-end connection)))
+      (when (= start end)
+        (setf (connection-output-start connection) 0
+              (connection-output-end connection) 0)
+        (return t))
+      (multiple-value-bind (len errno)
+          (ll-socket-send-from (connection-fd connection) (connection-output connection)
+                               start end nil nil nil t t nil)
+        (cond ((plusp len)
+               (incf (connection-output-start connection) len))
+              ((member errno (list +eagain+ +eintr+))
+               (return nil))
+              (t
+               ;; The peer is gone - drop the output and the connection
+               (setf (connection-output-start connection) 0
+                     (connection-output-end connection) 0
+                     (connection-eof-p connection) t)
+               (return t)))))))
+
+(defun connection-finish-output (connection)
+  "Write all queued output, waiting for the socket to drain if necessary."
+  (loop until (connection-flush-output connection)
+        do (connection-wait connection serve-event-internal:+ev-output+))
+  (unless (connection-closed connection)
+    (connection-update-events connection)))
+
+(defun connection-server (connection)
+  (server-worker-server (connection-worker connection)))
+
+(defun connection-close (connection &key abort)
+  "Close CONNECTION once its queued output has been written, or at once
+discarding the output if ABORT is true."
+  (unless (connection-closed connection)
+    (setf (connection-closing connection) t)
+    (if (or abort (connection-flush-output connection))
+        (connection-release connection)
+        (connection-update-events connection)))
+  connection)
+
+(defun connection-release (connection)
+  (let ((worker (connection-worker connection)))
+    (setf (connection-closed connection) t)
+    (serve-event-internal:ll-event-loop-modify (server-worker-event-loop worker)
+                                               (connection-fd connection) 0)
+    (remhash (connection-fd connection) (server-worker-connections worker))
+    (socket-close (connection-socket connection))
+    (let ((on-close (server-on-close (server-worker-server worker))))
+      (when on-close
+        (handler-case (funcall on-close connection)
+          (error (condition)
+            (format *error-output* "~&;;; Error in on-close of ~a: ~a~%" connection condition)))))))
+
+;;; A buffered bivalent stream over a connection.  Reads are served from
+;;; the input buffer; reading past it waits for the socket (see
+;;; CONNECTION-FILL-INPUT-BLOCKING), READ-CHAR-NO-HANG and LISTEN never
+;;; wait.  Writes only queue output, FORCE-OUTPUT writes what the socket
+;;; takes now and FINISH-OUTPUT waits until everything is written.
+
+(defclass connection-stream (gray:fundamental-character-input-stream
+                             gray:fundamental-character-output-stream
+                             gray:fundamental-binary-input-stream
+                             gray:fundamental-binary-output-stream)
+  ((connection :initarg :connection :reader connection-stream-connection)
+   (column :initform 0 :accessor connection-stream-column)))
+
+(defun connection-stream (connection)
+  "Return the buffered stream of CONNECTION."
+  (or (connection-%stream connection)
+      (setf (connection-%stream connection)
+            (make-instance 'connection-stream :connection connection))))
+
+(defun connection-next-octet (connection wait)
+  (when (and wait (zerop (connection-input-available connection)))
+    (connection-fill-input-blocking connection))
+  (if (plusp (connection-input-available connection))
+      (prog1 (aref (connection-input connection) (connection-input-start connection))
+        (incf (connection-input-start connection)))
+      (if (connection-eof-p connection) :eof nil)))
+
+(defmethod gray::stream-read-byte ((stream connection-stream))
+  (connection-next-octet (connection-stream-connection stream) t))
+
+(defmethod gray::stream-read-char ((stream connection-stream))
+  (let ((octet (connection-next-octet (connection-stream-connection stream) t)))
+    (if (eq octet :eof) :eof (code-char octet))))
+
+(defmethod gray::stream-read-char-no-hang ((stream connection-stream))
+  (let ((octet (connection-next-octet (connection-stream-connection stream) nil)))
+    (if (integerp octet) (code-char octet) octet)))
+
+(defmethod gray::stream-unread-char ((stream connection-stream) char)
+  (declare (ignore char))
+  (decf (connection-input-start (connection-stream-connection stream)))
+  nil)
+
+(defmethod gray::stream-listen ((stream connection-stream))
+  (plusp (connection-input-available (connection-stream-connection stream))))
+
+(defmethod gray::stream-clear-input ((stream connection-stream))
+  (let ((connection (connection-stream-connection stream)))
+    (setf (connection-input-start connection) (connection-input-end connection))
+    nil))
+
+(defmethod gray::stream-write-byte ((stream connection-stream) integer)
+  (let* ((connection (connection-stream-connection stream))
+         (at (connection-reserve-output connection 1)))
+    (setf (aref (connection-output connection) at) integer)
+    (incf (connection-output-end connection))
+    integer))
+
+(defmethod gray::stream-write-char ((stream connection-stream) char)
+  (let* ((connection (connection-stream-connection stream))
+         (at (connection-reserve-output connection 1)))
+    (setf (aref (connection-output connection) at) (char-code char))
+    (incf (connection-output-end connection))
+    (setf (connection-stream-column stream)
+          (if (char= char #\Newline) 0 (1+ (connection-stream-column stream))))
+    char))
+
+(defmethod gray::stream-write-string ((stream connection-stream) string &optional (start 0) end)
+  (let* ((end (or end (length string)))
+         (newline (position #\Newline string :start start :end end :from-end t)))
+    (connection-write-string (connection-stream-connection stream) string :start start :end end)
+    (setf (connection-stream-column stream)
+          (if newline
+              (- end newline 1)
+              (+ (connection-stream-column stream) (- end start))))
+    string))
+
+(defmethod gray::stream-line-column ((stream connection-stream))
+  (connection-stream-column stream))
+
+(defmethod gray::stream-force-output ((stream connection-stream))
+  (let ((connection (connection-stream-connection stream)))
+    (connection-flush-output connection)
+    (unless (connection-closed connection)
+      (connection-update-events connection))
+    nil))
+
+(defmethod gray::stream-finish-output ((stream connection-stream))
+  (connection-finish-output (connection-stream-connection stream))
+  nil)
+
+(defmethod gray::close ((stream connection-stream) &key abort)
+  (connection-close (connection-stream-connection stream) :abort abort)
+  t)
@@ -27,7 +27,10 @@
           NETDB-SUCCESS-ERROR NETDB-INTERNAL-ERROR
           HOST-NOT-FOUND-ERROR TRY-AGAIN-ERROR NO-RECOVERY-ERROR
           ;;; but aren't
-          HOST-ENT-ADDRESSES HOST-ENT HOST-ENT-ADDRESS SOCKET-SEND))
+          HOST-ENT-ADDRESSES HOST-ENT HOST-ENT-ADDRESS SOCKET-SEND
+          SOCKET-RECEIVE-INTO SOCKET-SEND-FROM
+          SOCKET-RECEIVE-VECTORED SOCKET-SEND-VECTORED
+          SOCKET-RECEIVE-MESSAGES SOCKET-SEND-MESSAGES))
 
 
 
@@ -210,6 +213,43 @@ list of an ip address and a port). If no socket address is provided, send(2)
 will be called instead. Returns the number of octets written."))
 
 
+(defgeneric socket-receive-into (socket buffer
+                                 &key start end oob peek waitall dontwait)
+  (:documentation "Receive octets from SOCKET directly into the region START to END of
+BUFFER, a vector of (UNSIGNED-BYTE 8), using recv(2).  BUFFER may be
+displaced - START and END are relative to it.  Nothing is copied through an
+intermediate buffer.  Returns the number of octets
+received, or NIL if the call would block or was interrupted."))
+
+(defgeneric socket-send-from (socket buffer
+                              &key start end oob eor dontroute dontwait nosignal confirm)
+  (:documentation "Send the octets START to END of BUFFER, a vector of
+(UNSIGNED-BYTE 8) that may be displaced, on SOCKET using send(2) straight
+from the array's storage.  Returns the number of octets sent, or NIL if the call would block
+or was interrupted."))
+
+(defgeneric socket-receive-vectored (socket buffers)
+  (:documentation "Scatter one read from SOCKET across BUFFERS using readv(2).  Each
+element of BUFFERS is an octet vector or a list (VECTOR START END).  Returns
+the total number of octets read, or NIL if the call would block or was
+interrupted."))
+
+(defgeneric socket-send-vectored (socket buffers)
+  (:documentation "Gather BUFFERS into a single write on SOCKET using writev(2).  BUFFERS
+is as for SOCKET-RECEIVE-VECTORED.  Returns the total number of octets
+written, or NIL if the call would block or was interrupted."))
+
+(defgeneric socket-receive-messages (socket buffers &key dontwait)
+  (:documentation "Receive up to one datagram into each of BUFFERS with a single
+recvmmsg(2) where available.  Blocks only for the first message unless
+DONTWAIT is true.  Returns a list of the lengths of the messages received,
+or NIL if none were available."))
+
+(defgeneric socket-send-messages (socket buffers &key dontwait nosignal)
+  (:documentation "Send each of BUFFERS as its own message with a single sendmmsg(2)
+where available.  Returns the number of messages sent, or NIL if the call
+would block or was interrupted."))
+
 (defgeneric socket-close (socket &key abort)
   (:documentation "Close SOCKET.  May throw any kind of error that write(2) would have
 thrown.  If SOCKET-MAKE-STREAM has been called, calls CLOSE on that
@@ -278,6 +318,7 @@ SB-SYS:MAKE-FD-STREAM."))
         (local-buffer nil))
     (cond ((null buffer)(setq local-buffer (make-string length :initial-element #\Space :element-type 'base-char)))
           ((stringp buffer)(setq local-buffer buffer))
+          ((typep buffer '(simple-array (unsigned-byte 8) (*)))(setq local-buffer buffer))
           (t (setq local-buffer (make-string (or length (length buffer)) :initial-element #\Space :element-type 'base-char)
                    need-to-copy t)))
       ;;; and it better be a string of 8-bit chars
@@ -392,7 +433,7 @@ Examples:
         ;When will ecl support Unicode?
         (length (or length (length buffer)))
         (fd (socket-file-descriptor socket)))
-    (unless (stringp buffer)
+    (unless (or (stringp buffer) (typep buffer '(simple-array (unsigned-byte 8) (*))))
       ;;; and it better be a string of 8-bit chars
       (let ((new-buffer (make-string length :initial-element #\Space :element-type 'base-char)))
         (dotimes (x length)
@@ -412,6 +453,48 @@ Examples:
           (socket-error "send")
           len-sent))))
 
+(defmacro with-socket-result ((result errno) call where)
+  `(multiple-value-bind (,result ,errno) ,call
+     (cond ((not (eql ,result -1)) ,result)
+           ((member ,errno (list +eagain+ +eintr+)) nil)
+           (t (socket-error ,where)))))
+
+(defmethod socket-receive-into ((socket socket) buffer
+                                &key (start 0) end oob peek waitall dontwait)
+  (with-socket-result (len errno)
+      (ll-socket-receive-into (socket-file-descriptor socket) buffer start end
+                              oob peek waitall dontwait)
+    "recv"))
+
+(defmethod socket-send-from ((socket socket) buffer
+                             &key (start 0) end oob eor dontroute dontwait nosignal confirm)
+  (with-socket-result (len errno)
+      (ll-socket-send-from (socket-file-descriptor socket) buffer start end
+                           oob eor dontroute dontwait nosignal confirm)
+    "send"))
+
+(defmethod socket-receive-vectored ((socket socket) buffers)
+  (with-socket-result (len errno)
+      (ll-socket-readv (socket-file-descriptor socket) buffers)
+    "readv"))
+
+(defmethod socket-send-vectored ((socket socket) buffers)
+  (with-socket-result (len errno)
+      (ll-socket-writev (socket-file-descriptor socket) buffers)
+    "writev"))
+
+(defmethod socket-receive-messages ((socket socket) buffers &key dontwait)
+  (multiple-value-bind (lengths errno)
+      (ll-socket-recvmmsg (socket-file-descriptor socket) buffers dontwait)
+    (cond (lengths lengths)
+          ((or (null buffers) (member errno (list 0 +eagain+ +eintr+))) nil)
+          (t (socket-error "recvmmsg")))))
+
+(defmethod socket-send-messages ((socket socket) buffers &key dontwait nosignal)
+  (with-socket-result (count errno)
+      (ll-socket-sendmmsg (socket-file-descriptor socket) buffers dontwait nosignal)
+    "sendmmsg"))
+
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;;;
 ;;; UNIX SOCKETS
@@ -788,7 +871,7 @@ GET-NAME-SERVICE-ERRNO")
 (define-sockopt sockopt-dont-route sockets-internal:+SOL-SOCKET+ sockets-internal:+SO-DONTROUTE+ bool)
 (define-sockopt sockopt-linger sockets-internal:+SOL-SOCKET+ sockets-internal:+SO-LINGER+ linger)
 
-#-(or :sun4sol2 :linux :wsock :cygwin)
+#-(or :sun4sol2 :wsock :cygwin)
 (define-sockopt sockopt-reuse-port sockets-internal:+SOL-SOCKET+ sockets-internal:+SO-REUSEPORT+ bool)
 
 (define-sockopt sockopt-tcp-nodelay sockets-internal:+IPPROTO-TCP+ sockets-internal:+TCP-NODELAY+ bool)
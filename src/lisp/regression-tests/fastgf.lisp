@@ -5,3 +5,55 @@
 (defmethod fgf-foo ((x symbol)) :symbol)
 (test dispatch-symbol (eq (fgf-foo :yadda) :symbol))
 (test-expect-error dispatch-no-applicable-method (fgf-foo 1.2) :description "This should not dispatch")
+
+(defmethod fgf-tiered ((x integer)) :integer)
+(defmethod fgf-tiered ((x string)) :string)
+(test dispatch-tiered-compile
+      (let ((old-threshold (clos:dtree-compile-threshold))
+            (clos::*dtree-compile-in-background* nil))
+        (unwind-protect
+             (progn
+               (clos:set-dtree-compile-threshold 10)
+               ;; The first call installs the interpreted discriminator
+               (fgf-tiered 1)
+               (let ((interpreted (clos::generic-function-compiled-dispatch-function #'fgf-tiered))
+                     (installed (nth-value 1 (clos::dtree-compile-statistics))))
+                 (and (every (lambda (x) (eq (fgf-tiered x) :integer)) (make-list 50 :initial-element 1))
+                      ;; The call threshold was reached and a compiled discriminator replaced the interpreted one
+                      (= (1+ installed) (nth-value 1 (clos::dtree-compile-statistics)))
+                      (not (eq interpreted (clos::generic-function-compiled-dispatch-function #'fgf-tiered)))
+                      (eq (fgf-tiered "x") :string))))
+          (clos:set-dtree-compile-threshold old-threshold))))
+
+(defclass fgf-cached () ((slot :initarg :slot :accessor fgf-cached-slot)))
+(defclass fgf-cached-sub (fgf-cached) ())
+(defmethod fgf-cached-kind ((x fgf-cached)) :cached)
+(test dispatch-inline-cache
+      (let ((cache (clos::make-inline-cache))
+            (instance (make-instance 'fgf-cached-sub :slot 42)))
+        (flet ((lookup () (clos::inline-cache-lookup cache #'fgf-cached-kind instance))
+               (misses () (svref cache 0)))
+          ;; Nothing is memoized yet, so the miss goes through the generic function
+          (and (eq (lookup) #'fgf-cached-kind)
+               (eq (fgf-cached-kind instance) :cached)
+               ;; Now the effective method is cached on the second miss ...
+               (let ((target (lookup)))
+                 (and (not (eq target #'fgf-cached-kind))
+                      (eq (funcall target instance) :cached)
+                      (= (misses) 2)
+                      ;; ... and found without another miss
+                      (eq (lookup) target)
+                      (= (misses) 2)
+                      ;; Adding a method drops the entry
+                      (progn (defmethod fgf-cached-kind ((x fgf-cached-sub)) :sub)
+                             (not (eq (lookup) target)))
+                      (eq (funcall (lookup) instance) :sub)))
+               (let ((target (progn (fgf-cached-kind instance) (lookup))))
+                 (and (eq (lookup) target)
+                      (eq (funcall target instance) :sub)
+                      ;; Redefining the class drops it too, and the obsolete
+                      ;; instance goes through the generic function to be updated
+                      (progn (defclass fgf-cached-sub (fgf-cached) ((extra :initform nil)))
+                             (eq (lookup) #'fgf-cached-kind))
+                      (eq (fgf-cached-kind instance) :sub)
+                      (eql (fgf-cached-slot instance) 42)))))))
@@ -171,3 +171,62 @@
         (equalp
          (sort result #'< :key #'first)
          '((23 (1 . 2)) (24 (3 . 4)) (25 (4 . 5))))))
+
+(test hash-table-lock-free-reads
+      (let ((table (make-hash-table :test #'equal :thread-safe :lock-free)))
+        (dotimes (i 1000)
+          (setf (gethash (format nil "key~a" i) table) i))
+        (dotimes (i 500)
+          (remhash (format nil "key~a" (* 2 i)) table))
+        (and (= 500 (hash-table-count table))
+             (loop for i below 1000
+                   always (eql (gethash (format nil "key~a" i) table)
+                               (if (evenp i) nil i)))
+             (progn (clrhash table)
+                    (null (nth-value 1 (gethash "key1" table)))))))
+
+(test hash-table-equal-fingerprints
+      (let ((table (make-hash-table :test #'equal)))
+        (dotimes (i 5000)
+          (setf (gethash (format nil "~r" i) table) i))
+        (dotimes (i 2500)
+          (remhash (format nil "~r" (* 2 i)) table))
+        (dotimes (i 100)
+          (setf (gethash (format nil "~r" (* 2 i)) table) (- i)))
+        (and (= 2600 (hash-table-count table))
+             (eql -7 (gethash (format nil "~r" 14) table))
+             (eql 4999 (gethash (format nil "~r" 4999) table))
+             (null (nth-value 1 (gethash (format nil "~r" 4998) table))))))
+
+(test hash-table-incremental-resize
+      (let ((table (make-hash-table :size 65536))
+            (in-progress nil))
+        (dotimes (i 46000)
+          (setf (gethash i table) (- i)))
+        (setq in-progress (core:hash-table-resize-in-progress-p table))
+        (remhash 17 table)
+        (and in-progress
+             (= 45999 (hash-table-count table))
+             (loop for i from 18 below 46000
+                   always (eql (gethash i table) (- i)))
+             (= 45999 (let ((n 0)) (maphash (lambda (k v) (declare (ignore k v)) (incf n)) table) n))
+             (progn (dotimes (i 2000)
+                      (setf (gethash (+ 100000 i) table) i))
+                    (not (core:hash-table-resize-in-progress-p table)))
+             (eql -45999 (gethash 45999 table)))))
+
+(test hash-table-incremental-resize-maphash-once
+      (let ((table (make-hash-table :size 65536))
+            (seen (make-hash-table)))
+        (dotimes (i 46000)
+          (setf (gethash i table) i))
+        (and (core:hash-table-resize-in-progress-p table)
+             (progn (maphash (lambda (k v)
+                               (setf (gethash k table) (1+ v))
+                               (incf (gethash k seen 0)))
+                             table)
+                    (not (core:hash-table-resize-in-progress-p table)))
+             (= 46000 (hash-table-count seen))
+             (loop for i below 46000
+                   always (and (eql (gethash i seen) 1)
+                               (eql (gethash i table) (1+ i)))))))
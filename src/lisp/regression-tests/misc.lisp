@@ -217,3 +217,187 @@
         (flet ((foo () 23))
           (lambda (&key (a #'foo))
             a)))))
+
+(test mpi-serialize-round-trip
+      (let* ((shared (list 1 2 3))
+             (data (list shared shared -5 (expt 2 100) 3/4 #c(1.0d0 2.0d0) 1.5f0
+                         "string" :keyword
+                         (make-array 3 :element-type 'double-float :initial-element 2.5d0)))
+             (copy (mpi:deserialize-from-octets (mpi:serialize-to-octets data))))
+        (and (equalp copy data)
+             (eq (first copy) (second copy)))))
+
+(test mpi-serialize-circular
+      (let ((circle (list 1 2)))
+        (setf (cddr circle) circle)
+        (let ((copy (mpi:deserialize-from-octets (mpi:serialize-to-octets circle))))
+          (and (= (first copy) 1)
+               (eq (cddr copy) copy)))))
+
+(test sample-profiler-folded-stacks
+      (let ((end (+ (get-internal-run-time) (floor internal-time-units-per-second 5)))
+            (sum 0))
+        (ext:with-profiling (:frequency 1000 :threads :current)
+          (loop while (< (get-internal-run-time) end)
+                do (setq sum (+ sum (length (make-list 10))))))
+        (let ((stacks (core:sample-profiler-folded-stacks)))
+          ;; 200ms of busy work at 1000Hz must have been sampled
+          (and (consp stacks)
+               (every (lambda (entry)
+                        (and (stringp (car entry))
+                             (typep (cdr entry) '(integer 1))))
+                      stacks)))))
+
+(test allocation-profiler-report
+      (let ((keep nil))
+        (gctools:with-allocation-profiling (:sample-interval 4096)
+          (dotimes (i 20000) (push (make-list 4) keep)))
+        (multiple-value-bind (by-class by-function)
+            (gctools:allocation-profiler-report)
+          (and keep
+               (consp by-class)
+               (consp by-function)
+               (every (lambda (row) (and (stringp (first row)) (plusp (second row)))) by-class)))))
+
+(defclass allocation-profiler-point () ((x :initarg :x) (y :initarg :y)))
+
+(test allocation-profiler-lisp-class-names
+      (let ((keep nil))
+        (gctools:with-allocation-profiling (:sample-interval 4096)
+          (dotimes (i 20000) (push (make-instance 'allocation-profiler-point :x i :y i) keep)))
+        (let ((by-class (gctools:allocation-profiler-report)))
+          (and keep
+               (find "ALLOCATION-PROFILER-POINT" by-class :key #'first :test #'search)))))
+
+(test concurrent-queue-mpmc
+      (let* ((queue (mp:make-concurrent-queue :name "test" :capacity 8))
+             (n 1000)
+             (producers (loop repeat 4
+                              collect (mp:process-run-function
+                                       "producer"
+                                       (lambda () (dotimes (i n) (mp:concurrent-queue-push queue (1+ i)))))))
+             (consumers (loop repeat 4
+                              collect (mp:process-run-function
+                                       "consumer"
+                                       (lambda () (loop repeat n sum (mp:concurrent-queue-pop queue)))))))
+        (mapc #'mp:process-join producers)
+        (and (= (reduce #'+ (mapcar #'mp:process-join consumers))
+                (* 4 (/ (* n (1+ n)) 2)))
+             (zerop (mp:concurrent-queue-count queue))
+             (null (nth-value 1 (mp:concurrent-queue-pop queue 0)))
+             (= 8 (mp:concurrent-queue-capacity queue))
+             (progn (mp:concurrent-queue-push queue :a)
+                    (mp:concurrent-queue-push queue :b)
+                    (equal '(:a :b) (mp:concurrent-queue-pop-batch queue 10))))))
+
+(test concurrent-queue-pop-batch-wakes-producers
+      (let ((queue (mp:make-concurrent-queue :name "batch" :capacity 2)))
+        (mp:concurrent-queue-push queue 1)
+        (mp:concurrent-queue-push queue 2)
+        (let ((producers (loop for i from 3 to 4
+                               collect (let ((i i))
+                                         (mp:process-run-function
+                                          "blocked producer"
+                                          (lambda ()
+                                            ;; Without a wakeup this only returns at the timeout
+                                            (let ((pushed (mp:concurrent-queue-push queue i 5)))
+                                              (cons pushed (get-internal-real-time)))))))))
+          (sleep 0.3)
+          (let ((taken (mp:concurrent-queue-pop-batch queue 2))
+                (start (get-internal-real-time)))
+            (and (equal taken '(1 2))
+                 (every (lambda (result)
+                          (and (car result)
+                               (< (- (cdr result) start) internal-time-units-per-second)))
+                        (mapcar #'mp:process-join producers)))))))
+
+(test thread-pool-parallel-sequences
+      (let ((numbers (loop for i below 10000 collect (mod (* i 7919) 10007))))
+        (and (= 42 (mp:future-value (mp:submit (lambda () 42))))
+             (equalp (mp:pmap 'vector #'1+ '(1 2 3)) #(2 3 4))
+             (= (mp:preduce #'+ numbers) (reduce #'+ numbers))
+             (equal (mp:psort (copy-list numbers) #'<) (sort (copy-list numbers) #'<))
+             (let ((squares (make-array 100)))
+               (mp:pdotimes (i 100) (setf (svref squares i) (* i i)))
+               (= (svref squares 99) 9801))
+             (eq :caught (handler-case (mp:future-value (mp:submit (lambda () (error "oops"))))
+                           (error () :caught))))))
+
+(test thread-pool-future-unwound
+      (let ((future (mp::%make-future (lambda () (throw 'thread-pool-test :thrown)) nil nil)))
+        (and (eq :thrown (catch 'thread-pool-test (mp::run-future future)))
+             ;; Waiters see it finished and get an error instead of waiting forever
+             (mp:future-done-p future)
+             (eq :caught (handler-case (mp:future-value future)
+                           (error () :caught))))))
+
+(test thread-pool-shutdown-wakes-parked-workers
+      (let ((pool (mp:make-thread-pool :name "parked" :size 2)))
+        ;; Give the workers time to park on the injection queue
+        (sleep 0.2)
+        (and (= 42 (mp:future-value (mp:submit (lambda () 42) :pool pool)))
+             (eq pool (mp:thread-pool-shutdown pool)))))
+
+(test shared-mutex-upgrade-downgrade
+      (let ((m (mp:make-shared-mutex "test")))
+        (flet ((in-thread (function)
+                 (mp:process-join (mp:process-run-function "shared-mutex-test" function)))
+               (try-write () (when (mp:write-try-lock m) (mp:write-unlock m) t)))
+          (mp:shared-lock m)
+          (mp:write-lock m t)
+          ;; Downgrade - we still hold the shared lock
+          (mp:write-unlock m)
+          (let ((blocked-writer (in-thread #'try-write))
+                (other-reader (in-thread (lambda () (mp:shared-lock m) (mp:shared-unlock m) t))))
+            (mp:shared-unlock m)
+            (and (not blocked-writer)
+                 other-reader
+                 (in-thread #'try-write)
+                 (progn (mp:shared-lock m)
+                        (mp:write-try-lock m t))
+                 ;; Release both the write lock and the upgraded shared lock
+                 (progn (mp:write-unlock m t)
+                        (in-thread #'try-write)))))))
+
+(test shared-mutex-writer-preference
+      (let ((m (mp:make-shared-mutex "test"))
+            (events-lock (mp:make-lock :name "events"))
+            (events nil))
+        (flet ((note (x) (mp:with-lock (events-lock) (push x events))))
+          (mp:shared-lock m)
+          (let ((writer (mp:process-run-function
+                         "writer" (lambda () (mp:write-lock m) (note :writer) (mp:write-unlock m)))))
+            ;; Let the writer start waiting for our shared lock to drain
+            (sleep 0.2)
+            (let ((reader (mp:process-run-function
+                           "reader" (lambda () (mp:shared-lock m) (note :reader) (mp:shared-unlock m)))))
+              ;; A new reader must queue behind the waiting writer
+              (sleep 0.2)
+              (note :released)
+              (mp:shared-unlock m)
+              (mp:process-join writer)
+              (mp:process-join reader)
+              (equal (reverse events) '(:released :writer :reader)))))))
+
+(test shared-mutex-readers-and-upgraders
+      (let* ((m (mp:make-shared-mutex "test"))
+             (cell (cons 0 0))
+             (threads 8)
+             (n 1000)
+             (workers (loop repeat threads
+                            collect (mp:process-run-function
+                                     "reader"
+                                     (lambda ()
+                                       (let ((ok t))
+                                         (dotimes (i n ok)
+                                           (mp:shared-lock m)
+                                           (unless (= (car cell) (cdr cell)) (setf ok nil))
+                                           (when (zerop (mod i 10))
+                                             (mp:write-lock m t)
+                                             (incf (car cell))
+                                             (incf (cdr cell))
+                                             (mp:write-unlock m)
+                                             (unless (= (car cell) (cdr cell)) (setf ok nil)))
+                                           (mp:shared-unlock m))))))))
+        (and (every #'identity (mapcar #'mp:process-join workers))
+             (= (car cell) (cdr cell) (* threads (/ n 10))))))
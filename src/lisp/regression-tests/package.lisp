@@ -145,3 +145,44 @@
            (ext:package-remove-nickname package-desig :inexistant-nickname)))
    :type package-error)
 
+
+(test print-prefix-follows-package-changes
+      (equal
+       (let* ((home (make-package "%PRINT-PREFIX-HOME%" :use nil))
+              (user (make-package "%PRINT-PREFIX-USER%" :use nil))
+              (sym (intern "FROB" home))
+              (results nil))
+         (unwind-protect
+              (let ((*package* user))
+                (push (prin1-to-string sym) results)
+                (export sym home)
+                (push (prin1-to-string sym) results)
+                (use-package home user)
+                (push (prin1-to-string sym) results)
+                (unuse-package home user)
+                (unexport sym home)
+                (push (prin1-to-string sym) results)
+                (nreverse results))
+           (delete-package user)
+           (delete-package home)))
+       '("%PRINT-PREFIX-HOME%::FROB" "%PRINT-PREFIX-HOME%:FROB"
+         "FROB" "%PRINT-PREFIX-HOME%::FROB")))
+
+(test find-symbol-follows-intern-and-shadow
+      (let* ((base (make-package "%FIND-SYMBOL-BASE%" :use nil))
+             (user (make-package "%FIND-SYMBOL-USER%" :use (list base)))
+             (sym (intern "FROB" base)))
+        (unwind-protect
+             (progn
+               (export sym base)
+               (and (eq (find-symbol "FROB" user) sym)
+                    (eq (nth-value 1 (find-symbol "FROB" user)) :inherited)
+                    ;; A new symbol leaves the package epoch alone
+                    (progn (intern "FRESH" user)
+                           (eq (find-symbol "FROB" user) sym))
+                    (eq (nth-value 1 (find-symbol "FRESH" user)) :internal)
+                    (progn (shadow "FROB" user)
+                           (not (eq (find-symbol "FROB" user) sym)))
+                    (eq (nth-value 1 (find-symbol "FROB" user)) :internal)))
+          (delete-package user)
+          (delete-package base))))
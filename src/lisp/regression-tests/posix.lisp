@@ -68,3 +68,212 @@
        nil)))
 
 
+
+(test event-loop-wakeup-and-regular-file
+      (every (lambda (backend)
+               (let ((loop (serve-event-internal:ll-make-event-loop backend))
+                     (file "sys:regression-tests;run-all.lisp"))
+                 (unwind-protect
+                      (with-open-file (stream file :direction :input)
+                        (let ((fd (ext:file-stream-file-descriptor stream)))
+                          (serve-event-internal:ll-event-loop-wakeup loop)
+                          (and (zerop (serve-event-internal:ll-event-loop-wait loop 1))
+                               (progn
+                                 (serve-event-internal:ll-event-loop-modify
+                                  loop fd serve-event-internal:+ev-input+)
+                                 (= 1 (serve-event-internal:ll-event-loop-wait loop 1)))
+                               (= fd (serve-event-internal:ll-event-loop-ready-fd loop 0))
+                               (progn
+                                 (serve-event-internal:ll-event-loop-modify loop fd 0)
+                                 (zerop (serve-event-internal:ll-event-loop-wait loop 0))))))
+                   (serve-event-internal:ll-event-loop-close loop))))
+             '(nil :poll)))
+
+(eval-when (:compile-toplevel :load-toplevel :execute)
+  (require :serve-event))
+
+;;; A handler added while another thread is already waiting must be seen by that wait
+(test serve-event-sees-handler-added-while-waiting
+      (every (lambda (backend)
+               (serve-event:with-event-loop (:backend backend)
+                 (let ((loop serve-event:*event-loop*)
+                       (called nil))
+                   (with-open-file (stream "sys:regression-tests;run-all.lisp" :direction :input)
+                     (let* ((start (get-internal-real-time))
+                            (waiter (mp:process-run-function
+                                     'serve-event-waiter
+                                     (lambda () (serve-event:serve-event 10 loop)))))
+                       (sleep 0.2)
+                       (serve-event:add-fd-handler stream :input
+                                                   (lambda (fd)
+                                                     (declare (ignore fd))
+                                                     (setf called t))
+                                                   :loop loop)
+                       (and (mp:process-join waiter)
+                            called
+                            (< (- (get-internal-real-time) start)
+                               (* 5 internal-time-units-per-second))))))))
+             '(nil :poll)))
+
+(test server-echo-over-loopback
+      (sb-bsd-sockets:with-server
+          (server (lambda (connection)
+                    (loop for line = (sb-bsd-sockets:connection-read-line connection)
+                          while line
+                          do (sb-bsd-sockets:connection-write-string
+                              connection (format nil "~a~%" (string-upcase line))))
+                    (when (sb-bsd-sockets:connection-eof-p connection)
+                      (sb-bsd-sockets:connection-close connection)))
+                  :workers 2)
+        (every (lambda (word)
+                 (let ((client (make-instance 'sb-bsd-sockets:inet-socket
+                                              :type :stream :protocol :tcp)))
+                   (unwind-protect
+                        (let ((stream (progn
+                                        (sb-bsd-sockets:socket-connect
+                                         client #(127 0 0 1) (sb-bsd-sockets:server-port server))
+                                        (sb-bsd-sockets:socket-make-stream
+                                         client :input t :output t :buffering :full))))
+                          (write-line word stream)
+                          (finish-output stream)
+                          (string= (read-line stream) (string-upcase word)))
+                     (sb-bsd-sockets:socket-close client))))
+               '("alpha" "beta" "gamma" "delta"))))
+
+(test server-closes-connection-over-max-input-size
+      (let ((closed nil))
+        (sb-bsd-sockets:with-server
+            (server (lambda (connection) (declare (ignore connection)))
+                    :buffer-size 16 :max-input-size 64
+                    :on-close (lambda (connection)
+                                (declare (ignore connection))
+                                (setf closed t)))
+          (let ((client (make-instance 'sb-bsd-sockets:inet-socket
+                                       :type :stream :protocol :tcp)))
+            (unwind-protect
+                 (let ((stream (progn
+                                 (sb-bsd-sockets:socket-connect
+                                  client #(127 0 0 1) (sb-bsd-sockets:server-port server))
+                                 (sb-bsd-sockets:socket-make-stream
+                                  client :input t :output t :buffering :full))))
+                   ;; No newline and a handler that reads nothing - the input just piles up
+                   (write-string (make-string 1000 :initial-element #\a) stream)
+                   (finish-output stream)
+                   (loop repeat 100
+                         until closed
+                         do (sleep 0.05))
+                   closed)
+              (sb-bsd-sockets:socket-close client :abort t))))))
+
+(defun test-octets (&rest values)
+  (make-array (length values) :element-type '(unsigned-byte 8) :initial-contents values))
+
+;;; Call FUNCTION with the two ends of a TCP connection over loopback
+(defun call-with-tcp-loopback-pair (function)
+  (let ((listener (make-instance 'sb-bsd-sockets:inet-socket :type :stream :protocol :tcp))
+        (client (make-instance 'sb-bsd-sockets:inet-socket :type :stream :protocol :tcp))
+        (server nil))
+    (unwind-protect
+         (progn
+           (sb-bsd-sockets:socket-bind listener #(127 0 0 1) 0)
+           (sb-bsd-sockets:socket-listen listener 1)
+           (sb-bsd-sockets:socket-connect client #(127 0 0 1)
+                                          (nth-value 1 (sb-bsd-sockets:socket-name listener)))
+           (setf server (sb-bsd-sockets:socket-accept listener))
+           (funcall function client server))
+      (when server (sb-bsd-sockets:socket-close server))
+      (sb-bsd-sockets:socket-close client)
+      (sb-bsd-sockets:socket-close listener))))
+
+(test socket-send-from-receive-into-displaced
+      (call-with-tcp-loopback-pair
+       (lambda (client server)
+         (let* ((out-backing (make-array 16 :element-type '(unsigned-byte 8) :initial-element 0))
+                (out (make-array 8 :element-type '(unsigned-byte 8)
+                                   :displaced-to out-backing :displaced-index-offset 4))
+                (in-backing (make-array 16 :element-type '(unsigned-byte 8) :initial-element 0))
+                (in (make-array 8 :element-type '(unsigned-byte 8)
+                                  :displaced-to in-backing :displaced-index-offset 6)))
+           (replace out-backing (test-octets 1 2 3 4 5 6 7 8) :start1 4)
+           (and (= 4 (sb-bsd-sockets:socket-send-from client out :start 2 :end 6))
+                (= 4 (sb-bsd-sockets:socket-receive-into server in :start 1 :end 5 :waitall t))
+                (equalp (subseq in-backing 7 11) (test-octets 3 4 5 6))
+                (zerop (aref in-backing 6))
+                (zerop (aref in-backing 11)))))))
+
+(test socket-send-from-receive-into-simple
+      (call-with-tcp-loopback-pair
+       (lambda (client server)
+         (let ((out (test-octets 10 20 30))
+               (in (make-array 3 :element-type '(unsigned-byte 8) :initial-element 0)))
+           (and (= 3 (sb-bsd-sockets:socket-send-from client out))
+                (= 3 (sb-bsd-sockets:socket-receive-into server in :waitall t))
+                (equalp in out))))))
+
+(test socket-writev-readv
+      (call-with-tcp-loopback-pair
+       (lambda (client server)
+         (let ((head (make-array 2 :element-type '(unsigned-byte 8) :initial-element 0))
+               (tail (make-array 4 :element-type '(unsigned-byte 8) :initial-element 0)))
+           (and (= 5 (sb-bsd-sockets:socket-send-vectored
+                      client (list (test-octets 1 2 3)
+                                   (list (test-octets 9 4 5 9) 1 3))))
+                (= 5 (sb-bsd-sockets:socket-receive-vectored
+                      server (list head (list tail 1 4))))
+                (equalp head (test-octets 1 2))
+                (equalp tail (test-octets 0 3 4 5)))))))
+
+(test socket-sendmmsg-recvmmsg
+      (let ((receiver (make-instance 'sb-bsd-sockets:inet-socket :type :datagram :protocol :udp))
+            (sender (make-instance 'sb-bsd-sockets:inet-socket :type :datagram :protocol :udp)))
+        (unwind-protect
+             (let ((buffers (loop repeat 3
+                                  collect (make-array 8 :element-type '(unsigned-byte 8)
+                                                        :initial-element 0))))
+               (sb-bsd-sockets:socket-bind receiver #(127 0 0 1) 0)
+               (sb-bsd-sockets:socket-connect sender #(127 0 0 1)
+                                              (nth-value 1 (sb-bsd-sockets:socket-name receiver)))
+               (and (= 3 (sb-bsd-sockets:socket-send-messages
+                          sender (list (test-octets 1 2 3)
+                                       (test-octets 4 5)
+                                       (list (test-octets 0 6 7 0) 1 3))))
+                    (equal '(3 2 2) (sb-bsd-sockets:socket-receive-messages receiver buffers))
+                    (equalp (subseq (first buffers) 0 3) (test-octets 1 2 3))
+                    (equalp (subseq (second buffers) 0 2) (test-octets 4 5))
+                    (equalp (subseq (third buffers) 0 2) (test-octets 6 7))))
+          (sb-bsd-sockets:socket-close sender)
+          (sb-bsd-sockets:socket-close receiver))))
+
+;;; Fork a pool parent that keeps one child parked, be its one client and
+;;; wait for the parent to return once that child and its replacement exit
+(test fork-server-pool-serves-one-client
+      (progn
+        (load "sys:modules;fork-server;fork-pool.lisp")
+        (let ((listen (make-instance 'sb-bsd-sockets:inet-socket :type :stream :protocol :tcp)))
+          (sb-bsd-sockets:socket-bind listen #(127 0 0 1) 0)
+          (sb-bsd-sockets:socket-listen listen 5)
+          (let ((port (nth-value 1 (sb-bsd-sockets:socket-name listen)))
+                (pool-pid (nth-value 1 (core:fork))))
+            (when (eql pool-pid 0)
+              ;; Never fall back into the test suite from the forked pool parent
+              (unwind-protect
+                   (cl-user::run-fork-server-pool
+                    listen 1
+                    (lambda (stream)
+                      (format stream "served by ~d~%" (core:getpid))
+                      (finish-output stream))
+                    :max-idle-seconds 2 :max-clients 1)
+                (core:cexit)))
+            (sb-bsd-sockets:socket-close listen)
+            (let ((client (make-instance 'sb-bsd-sockets:inet-socket
+                                         :type :stream :protocol :tcp)))
+              (unwind-protect
+                   (let* ((stream (progn
+                                    (sb-bsd-sockets:socket-connect client #(127 0 0 1) port)
+                                    (sb-bsd-sockets:socket-make-stream
+                                     client :input t :output t :buffering :full)))
+                          (line (read-line stream)))
+                     (and (string= "served by " line :end2 (min 10 (length line)))
+                          (/= (parse-integer line :start 10) (core:getpid) pool-pid)
+                          (= pool-pid (core:waitpid :pid pool-pid))))
+                (sb-bsd-sockets:socket-close client)))))))
@@ -451,3 +451,18 @@ BBBBCCCCDDDD"))
 BBBBCCCC**DDDD"))
 
 
+
+(test print-float-shortest-double
+      (equal (mapcar #'prin1-to-string '(0.1d0 0.3d0 123.456d0))
+             '("0.1d0" "0.3d0" "123.456d0")))
+
+(test print-float-round-trip
+      (every (lambda (x) (= x (read-from-string (prin1-to-string x))))
+             (list 0.1 1.0e-45 3.4028235e38 1d23 4.9406564584124654d-324 1.17549435e-38 16777216.0 0.3d0
+                   2.2250738585072014d-308 9007199254740992d0 most-positive-double-float)))
+
+(test print-escape-follows-print-base
+      (equal (list (prin1-to-string :a1)
+                   (let ((*print-base* 16)) (prin1-to-string :a1))
+                   (prin1-to-string :a1))
+             '(":A1" ":|A1|" ":A1")))
@@ -573,3 +573,84 @@
 
 
 
+
+(test read-float-correctly-rounded
+      (and (= (read-from-string "9007199254740993d0") 9007199254740992d0)
+           (= (read-from-string "2.4703282292062328d-324") least-positive-double-float)
+           (= (read-from-string "1.00000005960464477550f0") 1.0000001f0)
+           (= (read-from-string "0.1d0") (/ 1d0 10))))
+
+(test parse-float-slice
+      (and (= (core:parse-float "x 1.5d3 y" :start 1 :end 7) 1500d0)
+           (= (core:parse-float "0.25" :type 'single-float) 0.25f0)))
+
+(test-expect-error parse-float-start-after-end
+                   (core:parse-float "1.5" :start 2 :end 1) :type type-error)
+
+(test-expect-error parse-float-negative-start
+                   (core:parse-float "1.5" :start -1) :type type-error)
+
+(test-expect-error parse-float-end-past-length
+                   (core:parse-float "1.5" :end 10) :type type-error)
+
+(test readtable-syntax-cache-invalidated
+      (let ((*readtable* (copy-readtable nil)))
+        (and (equal (read-from-string "(a!b)") (list (intern "A!B")))
+             (progn (set-syntax-from-char #\! #\Space)
+                    (equal (read-from-string "(a!b)") '(a b)))
+             (progn (set-macro-character #\! (lambda (stream char)
+                                               (declare (ignore stream char))
+                                               :bang))
+                    (equal (read-from-string "(a!b)") '(a :bang b))))))
+
+(test sharp-colon-escapes
+      (and (string= (symbol-name (read-from-string "#:foo\\bar")) "FOObAR")
+           (string= (symbol-name (read-from-string "#:|fo|o")) "foO")
+           (char= (read-from-string "#\\a") #\a)
+           (char= (read-from-string "#\\Space") #\Space)))
+
+(test map-read-events
+      (let ((events nil))
+        (with-input-from-string (stream "(a (b c) ; comment
+                                         (skip me (please)) (d . 1) \"s\") next")
+          (and (eq t (core:map-read-events
+                      (lambda (event object)
+                        (push (list event object) events)
+                        (if (and (eq event :begin-list)
+                                 (eql (peek-char t stream) #\s))
+                            :skip
+                            nil))
+                      stream))
+               (equal (nreverse events)
+                      '((:begin-list nil) (:atom a)
+                        (:begin-list nil) (:atom b) (:atom c) (:end-list nil)
+                        (:begin-list nil)
+                        (:begin-list nil) (:atom d) (:dot nil) (:atom 1) (:end-list nil)
+                        (:atom "s") (:end-list nil)))
+               (eq 'next (read stream))
+               (eq :eof (core:map-read-events (lambda (e o) (declare (ignore e o))) stream nil :eof))))))
+
+(test-expect-error map-read-events-dot-first
+                   (with-input-from-string (stream "( . a)")
+                     (core:map-read-events (lambda (e o) (declare (ignore e o))) stream))
+                   :type reader-error)
+
+(test-expect-error map-read-events-two-after-dot
+                   (with-input-from-string (stream "(a . b c)")
+                     (core:map-read-events (lambda (e o) (declare (ignore e o))) stream))
+                   :type reader-error)
+
+(test-expect-error map-read-events-nothing-after-dot
+                   (with-input-from-string (stream "(a . )")
+                     (core:map-read-events (lambda (e o) (declare (ignore e o))) stream))
+                   :type reader-error)
+
+(test map-read-events-sharp-equal
+      (let ((atoms nil))
+        (with-input-from-string (stream "(#1=(x y) #1#)")
+          (core:map-read-events (lambda (event object)
+                                  (when (eq event :atom) (push object atoms)))
+                                stream))
+        (and (= 2 (length atoms))
+             (equal (first atoms) '(x y))
+             (eq (first atoms) (second atoms)))))
@@ -192,3 +192,63 @@
         (error (e) e)))
 
 
+
+;;; fd (:cstream nil) streams are buffered in user space
+(test fd-stream-buffered-roundtrip
+      (progn
+        (with-open-file (out "fd-buffered.txt" :direction :output :cstream nil
+                                               :if-exists :supersede)
+          (dotimes (i 10000) (write-char (code-char (+ 65 (mod i 26))) out))
+          (= 10000 (file-position out)))
+        (with-open-file (in "fd-buffered.txt" :cstream nil)
+          (and (char= #\A (read-char in))
+               (char= #\B (peek-char nil in))
+               (= 1 (file-position in))
+               (progn (unread-char (read-char in) in)
+                      (char= #\B (read-char in)))
+               (= 2 (file-position in))
+               (file-position in 9999)
+               (char= (code-char (+ 65 (mod 9999 26))) (read-char in))
+               (eq :eof (read-char in nil :eof))))))
+
+(test fd-stream-buffered-io
+      (with-open-file (s "fd-buffered-io.txt" :direction :io :cstream nil
+                                              :if-exists :supersede
+                                              :if-does-not-exist :create)
+        (write-string "hello world" s)
+        (file-position s 0)
+        (and (char= #\h (read-char s))
+             (progn (write-char #\E s)
+                    (file-position s 0)
+                    (string= "hEllo world" (read-line s))))))
+
+(test fd-stream-bulk-decode
+      (let ((line (concatenate 'string "abcdefghijklmnopqrstuvwxyz" (string (code-char 955)) "0123456789")))
+        (with-open-file (out "fd-bulk.txt" :direction :output :cstream nil
+                                           :external-format :utf-8 :if-exists :supersede)
+          (write-line line out)
+          (write-line "plain ascii line" out))
+        (and (with-open-file (in "fd-bulk.txt" :cstream nil :external-format :utf-8)
+               (and (string= line (read-line in))
+                    (string= "plain ascii line" (read-line in))
+                    (eq :eof (read-line in nil :eof))))
+             (with-open-file (in "fd-bulk.txt" :cstream nil :external-format :utf-8)
+               (let ((buffer (make-string 40)))
+                 (and (= 40 (read-sequence buffer in))
+                      (string= line (subseq buffer 0 37))
+                      (char= #\Newline (char buffer 37))
+                      (string= "pl" (subseq buffer 38))))))))
+
+(test fd-stream-bulk-read
+      (let ((name (make-string 300 :initial-element #\Q))
+            (text (concatenate 'string (make-string 200 :initial-element #\x) "\\\"y"
+                               (string (code-char 955)) "z")))
+        (with-open-file (out "fd-bulk-read.txt" :direction :output :cstream nil
+                                                :external-format :utf-8 :if-exists :supersede)
+          (format out "(~a |ab|c ~s foo)~%" name text))
+        (with-open-file (in "fd-bulk-read.txt" :cstream nil :external-format :utf-8)
+          (let ((form (let ((*package* (find-package :keyword))) (read in))))
+            (and (string= name (symbol-name (first form)))
+                 (string= "abC" (symbol-name (second form)))
+                 (string= text (third form))
+                 (string= "FOO" (symbol-name (fourth form))))))))
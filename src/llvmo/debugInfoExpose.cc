@@ -483,6 +483,28 @@ CL_DEFUN size_t number_of_object_files() {
   return count;
 }
 
+/*! Write the faso file, position and code range of every object file
+    that has been added to the jit, oldest first. This tells a tool reading
+    a heap snapshot which code the addresses in it belong to. */
+void save_object_file_manifest(std::ostream& out) {
+  std::vector<ObjectFileInfo*> object_files;
+  for (ObjectFileInfo* cur = global_object_files.load(); cur; cur = cur->_next) {
+    object_files.push_back(cur);
+  }
+  size_t count = object_files.size();
+  out.write((char*)&count,sizeof(count));
+  for (auto it = object_files.rbegin(); it != object_files.rend(); ++it) {
+    ObjectFileInfo* ofi = *it;
+    size_t name_length = ofi->_faso_filename ? strlen(ofi->_faso_filename) : 0;
+    out.write((char*)&name_length,sizeof(name_length));
+    out.write(ofi->_faso_filename,name_length);
+    out.write((char*)&ofi->_faso_index,sizeof(ofi->_faso_index));
+    out.write((char*)&ofi->_objectID,sizeof(ofi->_objectID));
+    out.write((char*)&ofi->_text_segment_start,sizeof(ofi->_text_segment_start));
+    out.write((char*)&ofi->_text_segment_size,sizeof(ofi->_text_segment_size));
+  }
+}
+
 CL_LISPIFY_NAME(total_memory_allocated_for_object_files);
 CL_DEFUN size_t total_memory_allocated_for_object_files() {
   ObjectFileInfo* cur = global_object_files.load();
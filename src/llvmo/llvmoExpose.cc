@@ -4288,6 +4288,18 @@ void handleObjectEmitted(VModuleKey K, std::unique_ptr<MemoryBuffer> O) {
 
 
 
+/*! Serializes the bookkeeping that is done when an object file has been linked.
+    Recursive because that bookkeeping can call Lisp, which may jit more code. */
+mp::Mutex global_notify_loaded_mutex(FASOLINK_NAMEWORD,true);
+
+/*! The object files added with addObjectFileUnlinked that linkObjectFile has not
+    picked up yet, keyed by the start of their buffer.  Linking one object file
+    can materialize another one in the same thread, so what the memory manager
+    left in my_thread is recorded here by the NotifyLoaded callback of each
+    object file rather than read back by the thread that asked for the link.
+    Protected by global_notify_loaded_mutex. */
+std::map<const char*,ObjectFileLinkInfo> global_unlinked_object_files;
+
 CL_DEFUN ClaspJIT_sp llvm_sys__make_clasp_jit()
 {
   GC_ALLOCATE_VARIADIC(ClaspJIT_O,cj);
@@ -4325,6 +4337,19 @@ ClaspJIT_O::ClaspJIT_O() {
   this->LinkLayer->setProcessAllSections(true);
   this->LinkLayer->setNotifyLoaded( [&] (VModuleKey, const llvm::object::ObjectFile &Obj, const llvm::RuntimeDyld::LoadedObjectInfo &loadedObjectInfo) {
 //                                      printf("%s:%d  NotifyLoaded ObjectFile@%p\n", __FILE__, __LINE__, &Obj);
+                                      // Object files may be linked by several threads at once (see core:load-faso)
+                                      mp::RAIIReadWriteLock<mp::Mutex> safe_lock(global_notify_loaded_mutex);
+                                      // The memory manager has just allocated the sections of Obj in this thread
+                                      auto it = global_unlinked_object_files.find(Obj.getMemoryBufferRef().getBufferStart());
+                                      if (it!=global_unlinked_object_files.end()) {
+                                        ObjectFileLinkInfo& info = it->second;
+                                        info._loaded = true;
+                                        info._text_segment_start = my_thread->_text_segment_start;
+                                        info._text_segment_size = my_thread->_text_segment_size;
+                                        info._text_segment_SectionID = my_thread->_text_segment_SectionID;
+                                        info._stackmap = my_thread->_stackmap;
+                                        info._stackmap_size = my_thread->_stackmap_size;
+                                      }
                                       save_symbol_info(Obj,loadedObjectInfo);
                                       register_object_file_with_gdb(Obj,loadedObjectInfo);
                                     });
@@ -4426,27 +4451,75 @@ void ClaspJIT_O::addObjectFile(const char* rbuffer, size_t bytes,size_t startupI
                                const char* faso_filename, size_t faso_index,
                                bool print)
 {
+  ObjectFileLinkInfo info;
+  this->addObjectFileUnlinked(rbuffer,bytes,dylib,print);
+  if (!this->linkObjectFile(rbuffer,startupID,dylib,info,print)) {
+    SIMPLE_ERROR(BF("Could not link object file %lu of %s") % faso_index % faso_filename);
+  }
+  this->startUpObjectFile(rbuffer,bytes,startupID,faso_filename,faso_index,info,print);
+}
+
+/*! Hand the object file to the link layer. Nothing is relocated until
+    one of its symbols is looked up - linkObjectFile does that. */
+void ClaspJIT_O::addObjectFileUnlinked(const char* rbuffer, size_t bytes, JITDylib& dylib, bool print)
+{
+  {
+    mp::RAIIReadWriteLock<mp::Mutex> safe_lock(global_notify_loaded_mutex);
+    global_unlinked_object_files[rbuffer] = ObjectFileLinkInfo();
+  }
   // Create an llvm::MemoryBuffer for the ObjectFile bytes
   if (print) core::write_bf_stream(BF("%s:%d Adding object file at %p  %lu bytes\n")  % __FILE__ % __LINE__  % (void*)rbuffer % bytes );
   llvm::StringRef sbuffer((const char*)rbuffer,bytes);
   llvm::StringRef name("buffer-name");
   std::unique_ptr<llvm::MemoryBuffer> mbuffer = llvm::MemoryBuffer::getMemBuffer(sbuffer,name,false);
-  // Force the object file to be linked using MaterializationUnit::doMaterialize(...)
-  if (print) core::write_bf_stream(BF("%s:%d Materializing\n") % __FILE__ % __LINE__ );
   auto erro = this->LinkLayer->add(dylib,std::move(mbuffer),this->ES->allocateVModule());
   if (erro) {
     printf("%s:%d Could not addObjectFile\n", __FILE__, __LINE__ );
   }
+}
+
+/*! Look up the startup function of an object file added with addObjectFileUnlinked.
+    This forces the object file to be linked using MaterializationUnit::doMaterialize(...)
+    unless another lookup already did - it may be called from several threads at once,
+    so it returns false rather than signaling an error if that fails. */
+bool ClaspJIT_O::linkObjectFile(const char* rbuffer, size_t startupID, JITDylib& dylib, ObjectFileLinkInfo& info, bool print)
+{
+  if (print) core::write_bf_stream(BF("%s:%d Materializing\n") % __FILE__ % __LINE__ );
   core::T_mv startup_name_and_linkage = core::core__startup_function_name_and_linkage(startupID);
   std::string startup_name = gc::As<core::String_sp>(startup_name_and_linkage)->get_std_string();
   if (print) core::write_bf_stream(BF("%s:%d startup_name is %s\n") % __FILE__ % __LINE__ % startup_name);
-  core::Pointer_sp startup = this->lookup(dylib,startup_name);
-  if (print) core::write_bf_stream(BF("%s:%d startup address %p\n") % __FILE__ % __LINE__ % _rep_(startup));
-  // Now the my_thread thread local data structure will contain information about the new linked object file.
+  void* startup;
+  bool found = this->do_lookup(dylib,startup_name,startup);
+  if (print) core::write_bf_stream(BF("%s:%d startup address %p\n") % __FILE__ % __LINE__ % startup);
+  // The NotifyLoaded callback recorded where the object file was put, possibly in another thread
+  {
+    mp::RAIIReadWriteLock<mp::Mutex> safe_lock(global_notify_loaded_mutex);
+    auto it = global_unlinked_object_files.find(rbuffer);
+    if (it!=global_unlinked_object_files.end()) {
+      info = it->second;
+      global_unlinked_object_files.erase(it);
+    }
+  }
+  if (!found || !info._loaded) return false;
+  info._startup = startup;
+  return true;
+}
+
+/*! Register a linked object file and run its startup code.
+    This must be done in load order in the loading thread. */
+void ClaspJIT_O::startUpObjectFile(const char* rbuffer, size_t bytes, size_t startupID,
+                                   const char* faso_filename, size_t faso_index,
+                                   const ObjectFileLinkInfo& info, bool print)
+{
+  my_thread->_text_segment_start = info._text_segment_start;
+  my_thread->_text_segment_size = info._text_segment_size;
+  my_thread->_text_segment_SectionID = info._text_segment_SectionID;
+  my_thread->_stackmap = info._stackmap;
+  my_thread->_stackmap_size = info._stackmap_size;
   save_object_file_info(rbuffer,bytes,faso_filename,faso_index,startupID);
   
-  // Lookup the address of the ObjectFileStartUp function and invoke it
-  void* thread_local_startup = startup->ptr();
+  // Invoke the ObjectFileStartUp function
+  void* thread_local_startup = info._startup;
   my_thread->_ObjectFileStartUp = NULL;
   if (thread_local_startup) {
     if (print) core::write_bf_stream(BF("%s:%d thread_local_startup -> %p\n") % __FILE__ % __LINE__ % (void*)thread_local_startup);
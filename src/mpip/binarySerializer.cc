@@ -0,0 +1,516 @@
+/*
+    File: binarySerializer.cc
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+See directory 'clasp/licenses' for full details.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+
+/*
+ * The wire format is a version byte followed by one encoded object.
+ * Every object starts with a one byte tag.  Counts and fixnums are
+ * LEB128 varints (fixnums zigzag encoded).  Conses along a cdr chain are
+ * written as a single run so long lists don't recurse.  Objects that are
+ * reachable more than once (conses, vectors, instances, uninterned symbols)
+ * are found in a first pass - the first time one is written it is preceded
+ * by serial_define and later occurrences are written as serial_ref, so
+ * shared structure and circular structure survive the round trip.
+ */
+
+#include <clasp/core/foundation.h>
+#include <clasp/core/object.h>
+#include <clasp/core/lisp.h>
+#include <clasp/core/symbolTable.h>
+#include <clasp/core/cons.h>
+#include <clasp/core/symbol.h>
+#include <clasp/core/package.h>
+#include <clasp/core/numbers.h>
+#include <clasp/core/bignum.h>
+#include <clasp/core/array.h>
+#include <clasp/core/sequence.h>
+#include <clasp/core/instance.h>
+#include <clasp/core/predicates.h>
+#include <clasp/core/hashTableEq.h>
+#include <clasp/core/evaluator.h>
+#include <clasp/gctools/containers.h>
+#include <clasp/mpip/binarySerializer.h>
+#include <clasp/core/wrappers.h>
+
+namespace mpip {
+
+#define SERIALIZER_VERSION 1
+
+typedef enum {
+  serial_nil = 0,
+  serial_fixnum,
+  serial_character,
+  serial_single_float,
+  serial_double_float,
+  serial_bignum,
+  serial_ratio,
+  serial_complex,
+  serial_symbol,
+  serial_uninterned_symbol,
+  serial_list,
+  serial_simple_vector,
+  serial_raw_vector,
+  serial_element_vector,
+  serial_class,
+  serial_instance,
+  serial_unbound,
+  serial_define,
+  serial_ref
+} SerialTag;
+
+/*! Objects whose identity has to survive serialization */
+static bool serial_shareable_p(core::T_sp obj) {
+  if (obj.consp()) return true;
+  if (obj.nilp() || obj.unboundp() || !obj.generalp()) return false;
+  if (gc::IsA<core::Number_sp>(obj)) return false;
+  if (core::Symbol_sp sym = obj.asOrNull<core::Symbol_O>()) return sym->homePackage().nilp();
+  if (core::clos__classp(obj)) return false;
+  return true;
+}
+
+/*! Vectors of these element types can't be copied as raw memory */
+static bool serial_packed_element_type_p(core::T_sp element_type) {
+  return element_type == cl::_sym_bit
+    || element_type == ext::_sym_byte2
+    || element_type == ext::_sym_byte4
+    || element_type == ext::_sym_integer2
+    || element_type == ext::_sym_integer4;
+}
+
+struct BinarySerializer {
+  std::string &_Buffer;
+  //! Maps shareable objects to the number of times they were reached (1 or 2)
+  core::HashTableEq_sp _Seen;
+  //! Maps shared objects that have been written to their label
+  core::HashTableEq_sp _Labels;
+  size_t _NextLabel;
+
+  BinarySerializer(std::string &buffer) : _Buffer(buffer), _NextLabel(0) {
+    this->_Seen = core::HashTableEq_O::create_default();
+    this->_Labels = core::HashTableEq_O::create_default();
+  }
+
+  void write_byte(uint8_t b) { this->_Buffer.push_back((char)b); }
+  void write_bytes(const void *data, size_t size) { this->_Buffer.append((const char *)data, size); }
+  void write_varint(uint64_t val) {
+    while (val >= 0x80) {
+      this->write_byte((uint8_t)(val | 0x80));
+      val >>= 7;
+    }
+    this->write_byte((uint8_t)val);
+  }
+  void write_string(const std::string &str) {
+    this->write_varint(str.size());
+    this->write_bytes(str.data(), str.size());
+  }
+
+  bool sharedp(core::T_sp obj) {
+    core::T_sp count = this->_Seen->gethash(obj, _Nil<core::T_O>());
+    return count.fixnump() && count.unsafe_fixnum() > 1;
+  }
+
+  /*! First pass - find the objects that are reachable more than once */
+  void scan(core::T_sp root) {
+    gctools::Vec0<core::T_sp> stack;
+    stack.push_back(root);
+    while (stack.size() > 0) {
+      core::T_sp obj = stack.back();
+      stack.pop_back();
+      if (!serial_shareable_p(obj)) continue;
+      core::T_sp count = this->_Seen->gethash(obj, _Nil<core::T_O>());
+      if (count.notnilp()) {
+        this->_Seen->setf_gethash(obj, core::make_fixnum(2));
+        continue;
+      }
+      this->_Seen->setf_gethash(obj, core::make_fixnum(1));
+      if (obj.consp()) {
+        core::Cons_sp cons = gc::As_unsafe<core::Cons_sp>(obj);
+        stack.push_back(cons->ocdr());
+        stack.push_back(cons->ocar());
+      } else if (core::Instance_sp instance = obj.asOrNull<core::Instance_O>()) {
+        for (size_t i = 0, iEnd(instance->numberOfSlots()); i < iEnd; ++i) {
+          stack.push_back(instance->instanceRef(i));
+        }
+      } else if (core::Vector_sp vec = obj.asOrNull<core::Vector_O>()) {
+        if (vec->element_type() == cl::_sym_T_O) {
+          for (size_t i = 0, iEnd(core::cl__length(vec)); i < iEnd; ++i) {
+            stack.push_back(vec->rowMajorAref(i));
+          }
+        }
+      }
+    }
+  }
+
+  void write(core::T_sp obj) {
+    if (serial_shareable_p(obj)) {
+      core::T_sp label = this->_Labels->gethash(obj, _Nil<core::T_O>());
+      if (label.notnilp()) {
+        this->write_byte(serial_ref);
+        this->write_varint(label.unsafe_fixnum());
+        return;
+      }
+      if (this->sharedp(obj)) {
+        size_t newLabel = this->_NextLabel++;
+        this->_Labels->setf_gethash(obj, core::make_fixnum(newLabel));
+        this->write_byte(serial_define);
+        this->write_varint(newLabel);
+      }
+    }
+    this->write_object(obj);
+  }
+
+  void write_list(core::Cons_sp head) {
+    // The run ends at the first cdr that is not a cons or that is shared
+    size_t count = 1;
+    core::Cons_sp cur = head;
+    while (true) {
+      core::T_sp next = cur->ocdr();
+      if (!next.consp() || this->sharedp(next)) break;
+      cur = gc::As_unsafe<core::Cons_sp>(next);
+      ++count;
+    }
+    this->write_byte(serial_list);
+    this->write_varint(count);
+    cur = head;
+    for (size_t i = 0; i < count; ++i) {
+      this->write(cur->ocar());
+      if (i + 1 < count) cur = gc::As_unsafe<core::Cons_sp>(cur->ocdr());
+    }
+    this->write(cur->ocdr());
+  }
+
+  void write_vector(core::Vector_sp vec) {
+    core::T_sp element_type = vec->element_type();
+    size_t length = core::cl__length(vec);
+    if (element_type == cl::_sym_T_O) {
+      this->write_byte(serial_simple_vector);
+      this->write_varint(length);
+      for (size_t i = 0; i < length; ++i) this->write(vec->rowMajorAref(i));
+    } else if (serial_packed_element_type_p(element_type)) {
+      this->write_byte(serial_element_vector);
+      this->write(element_type);
+      this->write_varint(length);
+      for (size_t i = 0; i < length; ++i) this->write(vec->rowMajorAref(i));
+    } else {
+      this->write_byte(serial_raw_vector);
+      this->write(element_type);
+      this->write_varint(length);
+      if (length > 0) {
+        this->write_bytes(vec->rowMajorAddressOfElement_(0), length * vec->elementSizeInBytes());
+      }
+    }
+  }
+
+  void write_object(core::T_sp obj) {
+    if (obj.nilp()) {
+      this->write_byte(serial_nil);
+    } else if (obj.fixnump()) {
+      int64_t val = obj.unsafe_fixnum();
+      this->write_byte(serial_fixnum);
+      this->write_varint(((uint64_t)val << 1) ^ (uint64_t)(val >> 63));
+    } else if (obj.characterp()) {
+      uint32_t ch = obj.unsafe_character();
+      this->write_byte(serial_character);
+      this->write_bytes(&ch, sizeof(ch));
+    } else if (obj.single_floatp()) {
+      float f = obj.unsafe_single_float();
+      this->write_byte(serial_single_float);
+      this->write_bytes(&f, sizeof(f));
+    } else if (obj.unboundp()) {
+      this->write_byte(serial_unbound);
+    } else if (obj.consp()) {
+      this->write_list(gc::As_unsafe<core::Cons_sp>(obj));
+    } else if (core::DoubleFloat_sp df = obj.asOrNull<core::DoubleFloat_O>()) {
+      double d = df->get();
+      this->write_byte(serial_double_float);
+      this->write_bytes(&d, sizeof(d));
+    } else if (core::Bignum_sp big = obj.asOrNull<core::Bignum_O>()) {
+      mpz_class &val = big->mpz_ref();
+      size_t size = (mpz_sizeinbase(val.get_mpz_t(), 2) + 7) / 8;
+      std::string magnitude(size, '\0');
+      size_t written = 0;
+      mpz_export(&magnitude[0], &written, 1, 1, 1, 0, val.get_mpz_t());
+      this->write_byte(serial_bignum);
+      this->write_byte(sgn(val) < 0 ? 1 : 0);
+      this->write_string(magnitude.substr(0, written));
+    } else if (core::Ratio_sp ratio = obj.asOrNull<core::Ratio_O>()) {
+      this->write_byte(serial_ratio);
+      this->write(ratio->numerator());
+      this->write(ratio->denominator());
+    } else if (core::Complex_sp cplx = obj.asOrNull<core::Complex_O>()) {
+      this->write_byte(serial_complex);
+      this->write(cplx->real());
+      this->write(cplx->imaginary());
+    } else if (core::Symbol_sp sym = obj.asOrNull<core::Symbol_O>()) {
+      core::T_sp pkg = sym->homePackage();
+      if (pkg.nilp()) {
+        this->write_byte(serial_uninterned_symbol);
+      } else {
+        this->write_byte(serial_symbol);
+        this->write_string(gc::As<core::Package_sp>(pkg)->getName());
+      }
+      this->write_string(sym->symbolNameAsString());
+    } else if (core::clos__classp(obj)) {
+      this->write_byte(serial_class);
+      this->write(gc::As_unsafe<core::Instance_sp>(obj)->_className());
+    } else if (core::Instance_sp instance = obj.asOrNull<core::Instance_O>()) {
+      size_t numberOfSlots = instance->numberOfSlots();
+      this->write_byte(serial_instance);
+      this->write(instance->_instanceClass()->_className());
+      this->write_varint(numberOfSlots);
+      for (size_t i = 0; i < numberOfSlots; ++i) this->write(instance->instanceRef(i));
+    } else if (core::Vector_sp vec = obj.asOrNull<core::Vector_O>()) {
+      // Fill pointers, adjustability and displacement are not preserved
+      this->write_vector(vec);
+    } else {
+      SIMPLE_ERROR(BF("Cannot serialize %s for MPI") % _rep_(obj));
+    }
+  }
+};
+
+struct BinaryDeserializer {
+  const unsigned char *_Cur;
+  const unsigned char *_End;
+  //! Objects indexed by the label they were defined with
+  gctools::Vec0<core::T_sp> _Labels;
+
+  BinaryDeserializer(const char *data, size_t size) : _Cur((const unsigned char *)data), _End((const unsigned char *)data + size){};
+
+  void need(size_t size) {
+    if ((size_t)(this->_End - this->_Cur) < size) {
+      SIMPLE_ERROR(BF("Serialized MPI data is truncated"));
+    }
+  }
+  uint8_t read_byte() {
+    this->need(1);
+    return *this->_Cur++;
+  }
+  void read_bytes(void *data, size_t size) {
+    this->need(size);
+    memcpy(data, this->_Cur, size);
+    this->_Cur += size;
+  }
+  uint64_t read_varint() {
+    uint64_t val = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t b = this->read_byte();
+      val |= (uint64_t)(b & 0x7f) << shift;
+      if (!(b & 0x80)) return val;
+    }
+    SIMPLE_ERROR(BF("Bad varint in serialized MPI data"));
+  }
+  /*! Read the element count of a container.  Every element takes at least
+      one byte so a count larger than what is left is rejected before
+      anything is allocated for it. */
+  size_t read_length() {
+    uint64_t length = this->read_varint();
+    if (length > (uint64_t)(this->_End - this->_Cur)) {
+      SIMPLE_ERROR(BF("Length %lu in serialized MPI data is larger than the %lu bytes that remain") % length % (size_t)(this->_End - this->_Cur));
+    }
+    return length;
+  }
+  std::string read_string() {
+    size_t size = this->read_length();
+    this->need(size);
+    std::string result((const char *)this->_Cur, size);
+    this->_Cur += size;
+    return result;
+  }
+
+  /*! Containers call this as soon as they are allocated so that
+      references to them from their own children resolve */
+  void define(int64_t label, core::T_sp obj) {
+    if (label >= 0) this->_Labels[label] = obj;
+  }
+
+  core::T_sp read() {
+    uint8_t tag = this->read_byte();
+    if (tag == serial_define) {
+      size_t label = this->read_varint();
+      if (label != this->_Labels.size()) {
+        SIMPLE_ERROR(BF("Out of order label %lu in serialized MPI data") % label);
+      }
+      this->_Labels.push_back(_Nil<core::T_O>());
+      return this->read_tagged(this->read_byte(), label);
+    } else if (tag == serial_ref) {
+      size_t label = this->read_varint();
+      if (label >= this->_Labels.size()) {
+        SIMPLE_ERROR(BF("Undefined label %lu in serialized MPI data") % label);
+      }
+      return this->_Labels[label];
+    }
+    return this->read_tagged(tag, -1);
+  }
+
+  core::T_sp read_list(int64_t label) {
+    size_t count = this->read_length();
+    core::Cons_sp head = core::Cons_O::create(_Nil<core::T_O>(), _Nil<core::T_O>());
+    this->define(label, head);
+    core::Cons_sp cur = head;
+    for (size_t i = 0; i < count; ++i) {
+      cur->setCar(this->read());
+      if (i + 1 < count) {
+        core::Cons_sp next = core::Cons_O::create(_Nil<core::T_O>(), _Nil<core::T_O>());
+        cur->setCdr(next);
+        cur = next;
+      }
+    }
+    cur->setCdr(this->read());
+    return head;
+  }
+
+  core::T_sp read_tagged(uint8_t tag, int64_t label) {
+    core::T_sp result;
+    switch (tag) {
+    case serial_nil:
+      return _Nil<core::T_O>();
+    case serial_unbound:
+      return _Unbound<core::T_O>();
+    case serial_fixnum: {
+      uint64_t zz = this->read_varint();
+      return core::make_fixnum((int64_t)(zz >> 1) ^ -(int64_t)(zz & 1));
+    }
+    case serial_character: {
+      uint32_t ch;
+      this->read_bytes(&ch, sizeof(ch));
+      return core::clasp_make_character(ch);
+    }
+    case serial_single_float: {
+      float f;
+      this->read_bytes(&f, sizeof(f));
+      return core::clasp_make_single_float(f);
+    }
+    case serial_double_float: {
+      double d;
+      this->read_bytes(&d, sizeof(d));
+      return core::DoubleFloat_O::create(d);
+    }
+    case serial_bignum: {
+      bool negative = this->read_byte();
+      std::string magnitude = this->read_string();
+      mpz_class val;
+      mpz_import(val.get_mpz_t(), magnitude.size(), 1, 1, 1, 0, magnitude.data());
+      if (negative) val = -val;
+      return core::Integer_O::create(val);
+    }
+    case serial_ratio: {
+      core::Integer_sp num = gc::As<core::Integer_sp>(this->read());
+      core::Integer_sp den = gc::As<core::Integer_sp>(this->read());
+      return core::Ratio_O::create(num, den);
+    }
+    case serial_complex: {
+      core::Real_sp re = gc::As<core::Real_sp>(this->read());
+      core::Real_sp im = gc::As<core::Real_sp>(this->read());
+      return core::Complex_O::create(re, im);
+    }
+    case serial_symbol: {
+      std::string packageName = this->read_string();
+      std::string symbolName = this->read_string();
+      if (_lisp->findPackage(packageName).nilp()) {
+        SIMPLE_ERROR(BF("Cannot deserialize symbol %s - there is no package %s") % symbolName % packageName);
+      }
+      return _lisp->intern(symbolName, packageName);
+    }
+    case serial_uninterned_symbol:
+      result = core::Symbol_O::create_from_string(this->read_string());
+      this->define(label, result);
+      return result;
+    case serial_list:
+      return this->read_list(label);
+    case serial_simple_vector: {
+      size_t length = this->read_length();
+      core::SimpleVector_sp vec = core::SimpleVector_O::make(length);
+      this->define(label, vec);
+      for (size_t i = 0; i < length; ++i) (*vec)[i] = this->read();
+      return vec;
+    }
+    case serial_element_vector: {
+      core::T_sp element_type = this->read();
+      size_t length = this->read_length();
+      core::Vector_sp vec = core::core__make_vector(element_type, length);
+      this->define(label, vec);
+      for (size_t i = 0; i < length; ++i) vec->rowMajorAset(i, this->read());
+      return vec;
+    }
+    case serial_raw_vector: {
+      core::T_sp element_type = this->read();
+      size_t length = this->read_length();
+      core::Vector_sp vec = core::core__make_vector(element_type, length);
+      this->define(label, vec);
+      if (length > 0) this->read_bytes(vec->rowMajorAddressOfElement_(0), length * vec->elementSizeInBytes());
+      return vec;
+    }
+    case serial_class:
+      return core::cl__find_class(gc::As<core::Symbol_sp>(this->read()), true, _Nil<core::T_O>());
+    case serial_instance: {
+      core::T_sp theClass = core::cl__find_class(gc::As<core::Symbol_sp>(this->read()), true, _Nil<core::T_O>());
+      core::T_sp obj = core::eval::funcall(cl::_sym_allocate_instance, theClass);
+      core::Instance_sp instance = gc::As<core::Instance_sp>(obj);
+      this->define(label, instance);
+      size_t numberOfSlots = this->read_varint();
+      if (numberOfSlots != instance->numberOfSlots()) {
+        SIMPLE_ERROR(BF("Cannot deserialize instance of %s - it has %lu slots here but %lu were sent") % _rep_(theClass) % instance->numberOfSlots() % numberOfSlots);
+      }
+      for (size_t i = 0; i < numberOfSlots; ++i) instance->instanceSet(i, this->read());
+      return instance;
+    }
+    default:
+      SIMPLE_ERROR(BF("Unknown tag %d in serialized MPI data") % (int)tag);
+    }
+  }
+};
+
+void serialize_object(core::T_sp obj, std::string &buffer) {
+  BinarySerializer serializer(buffer);
+  serializer.scan(obj);
+  serializer.write_byte(SERIALIZER_VERSION);
+  serializer.write(obj);
+}
+
+core::T_sp deserialize_object(const char *data, size_t size) {
+  BinaryDeserializer deserializer(data, size);
+  uint8_t version = deserializer.read_byte();
+  if (version != SERIALIZER_VERSION) {
+    SIMPLE_ERROR(BF("Serialized MPI data has version %d - expected %d") % (int)version % SERIALIZER_VERSION);
+  }
+  return deserializer.read();
+}
+
+CL_LAMBDA(object);
+CL_DOCSTRING(R"doc(Encode OBJECT into a (simple-array ext:byte8 (*)) in the format used by MPI send and receive.)doc");
+CL_DEFUN core::T_sp mpi__serialize_to_octets(core::T_sp obj) {
+  std::string buffer;
+  serialize_object(obj, buffer);
+  return core::SimpleVector_byte8_t_O::make(buffer.size(), 0, false, buffer.size(), (const unsigned char *)buffer.data());
+}
+
+CL_LAMBDA(octets);
+CL_DOCSTRING(R"doc(Rebuild the object that was encoded into OCTETS by serialize-to-octets.)doc");
+CL_DEFUN core::T_sp mpi__deserialize_from_octets(core::T_sp octets) {
+  core::SimpleVector_byte8_t_sp vec = gc::As<core::SimpleVector_byte8_t_sp>(octets);
+  return deserialize_object((const char *)vec->begin(), vec->length());
+}
+};
@@ -34,7 +34,10 @@ THE SOFTWARE.
 #include <clasp/core/lisp.h>
 #include <clasp/core/cons.h>
 #include <clasp/core/lispStream.h>
+#include <clasp/core/array.h>
+#include <clasp/core/pointer.h>
 #include <clasp/mpip/claspMpi.h>
+#include <clasp/mpip/binarySerializer.h>
 #include <clasp/core/wrappers.h>
 
 /*
@@ -266,21 +269,16 @@ CL_DEFMETHOD int Mpi_O::Get_rank() {
   __BEGIN_DOC( mpi.MpiObject.Send, subsection, Send)
   \scriptcore::Method{mpi}{Send}{Object::data core::Int::dest core::Int::tag}
 
-  Sends the \sa{Object::data} to the process \sa{dest} with the tag \sa{tag}. The data can be any Cando-Script object - it is archived into XML format and then sent to the process \sa{dest} and then dearchived back into a Cando-Script object on the other side.
+  Sends the \sa{Object::data} to the process \sa{dest} with the tag \sa{tag}. The data can be any Lisp object that the binary serializer supports - it is encoded into octets, sent to the process \sa{dest} and then decoded back into a Lisp object on the other side.
   __END_DOC
 */
 CL_DEFMETHOD core::T_sp Mpi_O::prim_Send(int dest, int tag, core::T_sp obj) {
   _G();
 #ifdef USE_MPI
-  IMPLEMENT_ME();
-#if 0
-  core::SexpSaveArchive_sp archive = core::SexpSaveArchive_O::create();
-  archive->put(KW("only"), obj);
-  core::StringOutStream_sp sos = core::StringOutStream_O::make();
-  archive->sexpSaveArchiveWrite(sos);
-  LOG(BF("About to call MPI_Send\n%s\n") % sos->str());
-  this->_Communicator.send(dest, tag, sos->str());
-#endif
+  std::string buffer;
+  serialize_object(obj, buffer);
+  LOG(BF("About to call MPI_Send with %lu bytes") % buffer.size());
+  this->_Communicator.send(dest, tag, buffer.data(), buffer.size());
 #endif
   return _Nil<core::T_O>();
 }
@@ -295,24 +293,244 @@ CL_DEFMETHOD core::T_sp Mpi_O::prim_Send(int dest, int tag, core::T_sp obj) {
 CL_DEFMETHOD core::T_mv Mpi_O::prim_Recv(int source, int tag) {
   _G();
 #ifdef USE_MPI
-  IMPLEMENT_ME();
-#if 0
-  LOG(BF("About to call MPI_Probe")); // vp0(("About to call MPI_Probe"));
+  LOG(BF("About to call MPI_Probe"));
   boost::mpi::status stat = this->_Communicator.probe(source, tag);
   this->_Source = stat.source();
   this->_Tag = stat.tag();
-  LOG(BF("Probe command returned source %d") % this->_Source); // vp0(("Probe command returned source %d", this->_Source ));
-  string buffer;
-  this->_Communicator.recv(source, tag, buffer);
-  core::StringInputStream_sp sis = core::StringInputStream_O::create(buffer);
-  core::SexpLoadArchive_sp arch = core::SexpLoadArchive_O::create();
-  arch->parseFromStream(sis);
-  core::T_sp obj = arch->get(KW("only"));
-  //    free(buffer);
+  // Receive from the matched source/tag so a wildcard can't pick up a different message
+  std::string buffer(*stat.count<char>(), '\0');
+  this->_Communicator.recv(this->_Source, this->_Tag, &buffer[0], buffer.size());
+  core::T_sp obj = deserialize_object(buffer.data(), buffer.size());
   return Values(obj, core::make_fixnum(this->_Source), core::make_fixnum(this->_Tag));
+#else
+  return Values(_Nil<core::T_O>());
+#endif
+}
+
+#ifdef USE_MPI
+/*! State of a non-blocking send or receive, handed to Lisp as a core:pointer.
+    A receive is only matched (probed and posted) by Wait or Test because
+    the size of the serialized object isn't known until then.
+    A send is also owned by global_pending_sends until it completes, so its
+    buffer is released even if Lisp never waits for it. The request is
+    deleted when both owners have let go of it.
+    global_pending_sends_mutex guards the pending list, _Owners and the
+    MPI state of send requests because any thread may reap them.  The
+    reaper leaves a send alone while a thread blocks in Wait on it. */
+struct MpiRequest {
+  bool _Receive;
+  bool _Posted;
+  bool _Completed;
+  bool _Waiting;
+  int _Owners;
+  int _Source;
+  int _Tag;
+  boost::mpi::request _Request;
+  std::string _Buffer;
+  MpiRequest(bool receive, int source, int tag) : _Receive(receive), _Posted(false), _Completed(false), _Waiting(false), _Owners(1), _Source(source), _Tag(tag){};
+};
+
+//! Sends that were started by Isend and have not been seen to complete
+static std::vector<MpiRequest *> global_pending_sends;
+static mp::Mutex global_pending_sends_mutex(MPISENDS_NAMEWORD);
+
+//! Call with global_pending_sends_mutex held
+static void mpi_release_request(MpiRequest *req) {
+  if (--req->_Owners == 0) delete req;
+}
+
+/*! Release the buffers of the sends that have completed since the last call.
+    Called whenever a new request is made or waited on. */
+static void mpi_reap_completed_sends() {
+  WITH_READ_WRITE_LOCK(global_pending_sends_mutex);
+  auto keep = global_pending_sends.begin();
+  for (auto it = global_pending_sends.begin(); it != global_pending_sends.end(); ++it) {
+    MpiRequest *req = *it;
+    if (req->_Waiting || (!req->_Completed && !req->_Request.test())) {
+      *keep++ = req;
+      continue;
+    }
+    req->_Completed = true;
+    std::string().swap(req->_Buffer);
+    mpi_release_request(req);
+  }
+  global_pending_sends.erase(keep, global_pending_sends.end());
+}
+
+static MpiRequest *mpi_request(core::T_sp request) {
+  MpiRequest *req = (MpiRequest *)gc::As<core::Pointer_sp>(request)->ptr();
+  if (req == NULL) {
+    SIMPLE_ERROR(BF("The MPI request %s has already completed") % _rep_(request));
+  }
+  return req;
+}
+
+static void mpi_post_receive(boost::mpi::communicator &comm, MpiRequest *req, boost::mpi::status &stat) {
+  req->_Source = stat.source();
+  req->_Tag = stat.tag();
+  req->_Buffer.assign(*stat.count<char>(), '\0');
+  req->_Request = comm.irecv(req->_Source, req->_Tag, &req->_Buffer[0], req->_Buffer.size());
+  req->_Posted = true;
+}
+
+/*! Decode the object of a completed request, release the request and
+    clear the pointer so it can't be reused */
+static core::T_sp mpi_finish_request(core::T_sp request, MpiRequest *req) {
+  core::T_sp obj = _Nil<core::T_O>();
+  if (req->_Receive) obj = deserialize_object(req->_Buffer.data(), req->_Buffer.size());
+  gc::As<core::Pointer_sp>(request)->set_ptr(NULL);
+  WITH_READ_WRITE_LOCK(global_pending_sends_mutex);
+  mpi_release_request(req);
+  return obj;
+}
 #endif
+CL_DEFMETHOD core::T_sp Mpi_O::prim_Isend(int dest, int tag, core::T_sp obj) {
+#ifdef USE_MPI
+  mpi_reap_completed_sends();
+  MpiRequest *req = new MpiRequest(false, dest, tag);
+  serialize_object(obj, req->_Buffer);
+  req->_Request = this->_Communicator.isend(dest, tag, req->_Buffer.data(), req->_Buffer.size());
+  req->_Posted = true;
+  req->_Owners++;
+  {
+    WITH_READ_WRITE_LOCK(global_pending_sends_mutex);
+    global_pending_sends.push_back(req);
+  }
+  return core::Pointer_O::create(req);
+#else
+  return _Nil<core::T_O>();
+#endif
+}
+
+CL_DEFMETHOD core::T_sp Mpi_O::prim_Irecv(int source, int tag) {
+#ifdef USE_MPI
+  mpi_reap_completed_sends();
+  return core::Pointer_O::create(new MpiRequest(true, source, tag));
+#else
+  return _Nil<core::T_O>();
+#endif
+}
+
+CL_DEFMETHOD core::T_mv Mpi_O::prim_Wait(core::T_sp request) {
+#ifdef USE_MPI
+  MpiRequest *req = mpi_request(request);
+  if (!req->_Posted) {
+    boost::mpi::status stat = this->_Communicator.probe(req->_Source, req->_Tag);
+    mpi_post_receive(this->_Communicator, req, stat);
+  }
+  if (req->_Receive) {
+    if (!req->_Completed) req->_Request.wait();
+    req->_Completed = true;
+  } else {
+    bool completed;
+    {
+      WITH_READ_WRITE_LOCK(global_pending_sends_mutex);
+      completed = req->_Completed;
+      req->_Waiting = !completed;
+    }
+    if (!completed) req->_Request.wait();
+    WITH_READ_WRITE_LOCK(global_pending_sends_mutex);
+    req->_Waiting = false;
+    req->_Completed = true;
+  }
+  mpi_reap_completed_sends();
+  int source = req->_Source;
+  int tag = req->_Tag;
+  if (req->_Receive) {
+    this->_Source = source;
+    this->_Tag = tag;
+  }
+  core::T_sp obj = mpi_finish_request(request, req);
+  return Values(obj, core::make_fixnum(source), core::make_fixnum(tag));
+#else
+  return Values(_Nil<core::T_O>());
+#endif
+}
+
+CL_DEFMETHOD core::T_mv Mpi_O::prim_Test(core::T_sp request) {
+#ifdef USE_MPI
+  MpiRequest *req = mpi_request(request);
+  if (!req->_Posted) {
+    boost::optional<boost::mpi::status> stat = this->_Communicator.iprobe(req->_Source, req->_Tag);
+    if (!stat) return Values(_Nil<core::T_O>());
+    mpi_post_receive(this->_Communicator, req, *stat);
+  }
+  {
+    WITH_READ_WRITE_LOCK(global_pending_sends_mutex);
+    if (!req->_Completed && !req->_Request.test()) return Values(_Nil<core::T_O>());
+    req->_Completed = true;
+  }
+  mpi_reap_completed_sends();
+  int source = req->_Source;
+  int tag = req->_Tag;
+  if (req->_Receive) {
+    this->_Source = source;
+    this->_Tag = tag;
+  }
+  core::T_sp obj = mpi_finish_request(request, req);
+  return Values(_lisp->_true(), obj, core::make_fixnum(source), core::make_fixnum(tag));
+#else
+  return Values(_Nil<core::T_O>());
+#endif
+}
+
+CL_DEFMETHOD core::T_sp Mpi_O::prim_Bcast(core::T_sp obj, int root) {
+#ifdef USE_MPI
+  std::string buffer;
+  bool isRoot = (this->_Communicator.rank() == root);
+  if (isRoot) serialize_object(obj, buffer);
+  long size = buffer.size();
+  boost::mpi::broadcast(this->_Communicator, size, root);
+  if (isRoot) {
+    boost::mpi::broadcast(this->_Communicator, &buffer[0], size, root);
+    return obj;
+  }
+  buffer.assign(size, '\0');
+  boost::mpi::broadcast(this->_Communicator, &buffer[0], size, root);
+  return deserialize_object(buffer.data(), buffer.size());
+#else
+  return obj;
+#endif
+}
+
+// The double vector collectives hand the vector storage straight to MPI
+CL_DEFMETHOD core::T_sp Mpi_O::prim_Reduce(core::T_sp vec, core::T_sp op, int root) {
+  core::SimpleVector_double_sp in = gc::As<core::SimpleVector_double_sp>(vec);
+#ifdef USE_MPI
+  size_t length = in->length();
+  bool isRoot = (this->_Communicator.rank() == root);
+  core::SimpleVector_double_sp out = core::SimpleVector_double_O::make(isRoot ? length : 0);
+  if (length == 0) return isRoot ? core::T_sp(out) : _Nil<core::T_O>();
+  double *in_values = in->begin();
+  double *out_values = isRoot ? out->begin() : NULL;
+  if (op == cl::_sym__PLUS_) {
+    boost::mpi::reduce(this->_Communicator, in_values, length, out_values, std::plus<double>(), root);
+  } else if (op == cl::_sym__TIMES_) {
+    boost::mpi::reduce(this->_Communicator, in_values, length, out_values, std::multiplies<double>(), root);
+  } else if (op == cl::_sym_max) {
+    boost::mpi::reduce(this->_Communicator, in_values, length, out_values, boost::mpi::maximum<double>(), root);
+  } else if (op == cl::_sym_min) {
+    boost::mpi::reduce(this->_Communicator, in_values, length, out_values, boost::mpi::minimum<double>(), root);
+  } else {
+    SIMPLE_ERROR(BF("Unsupported MPI reduce operation %s - use one of + * max min") % _rep_(op));
+  }
+  if (isRoot) return out;
+  return _Nil<core::T_O>();
+#else
+  return in;
+#endif
+}
+
+CL_DEFMETHOD core::T_sp Mpi_O::prim_Allgather(core::T_sp vec) {
+  core::SimpleVector_double_sp in = gc::As<core::SimpleVector_double_sp>(vec);
+#ifdef USE_MPI
+  size_t length = in->length();
+  core::SimpleVector_double_sp out = core::SimpleVector_double_O::make(length * this->_Communicator.size());
+  if (length == 0) return out;
+  boost::mpi::all_gather(this->_Communicator, in->begin(), length, out->begin());
+  return out;
 #else
-  return _Nil<T_O>();
+  return in;
 #endif
 }
 
@@ -26,10 +26,23 @@ THE SOFTWARE.
 /* -^- */
 
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 #include <sys/select.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#ifdef _TARGET_OS_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
 #include <clasp/core/foundation.h>
 #include <clasp/core/object.h>
 #include <clasp/core/fli.h>
+#include <clasp/core/pointer.h>
+#include <clasp/core/numbers.h>
 #include <clasp/core/symbolTable.h>
 #include <clasp/serveEvent/serveEventPackage.h>
 #include <clasp/core/wrappers.h>
@@ -70,9 +83,307 @@ CL_DEFUN core::Integer_mv serve_event_internal__ll_serveEventWithTimeout(clasp_f
   return Values(Integer_O::create(selectRet), Integer_O::create((gc::Fixnum)errno));
 }
 
+/* ----------------------------------------------------------------------
+ * Persistent event loops.
+ *
+ * Unlike the fd_set functions above the interest set lives in the kernel
+ * (epoll on Linux) or in a pollfd vector that is only rebuilt when a
+ * registration changes, so a wait costs O(ready) rather than O(registered)
+ * and there is no FD_SETSIZE limit.  Each loop has an eventfd (or a pipe)
+ * so another thread can wake it, which lets every thread run its own loop.
+ * The poll backend (and epoll for always ready regular files) only sees a
+ * registration change on its next wait, so a change made while another
+ * thread is waiting wakes it up to start over - that wakeup is not reported
+ * to Lisp.  Lisp sees a loop as a
+ * core:pointer.
+ */
+
+#define EVENT_INPUT 1
+#define EVENT_OUTPUT 2
+#define EVENT_LOOP_MAX_READY 1024
+
+struct EventLoop {
+  bool                             _UsePoll;
+  int                              _EpollFd;
+  int                              _WakeRead;
+  int                              _WakeWrite;
+  std::mutex                       _Mutex;
+  std::unordered_map<int,int>      _Interest;   // fd -> EVENT_INPUT|EVENT_OUTPUT
+  std::unordered_map<int,int>      _AlwaysReady; // regular files that epoll refuses
+  bool                             _PollDirty;
+  std::vector<struct pollfd>       _PollFds;
+  std::vector<std::pair<int,int>>  _Ready;      // (fd . events) from the last wait
+  std::atomic<bool>                _WakeRequested; // set by ll-event-loop-wakeup
+  EventLoop() : _UsePoll(true), _EpollFd(-1), _WakeRead(-1), _WakeWrite(-1), _PollDirty(true), _WakeRequested(false) {};
+};
+
+SYMBOL_EXPORT_SC_(KeywordPkg, poll);
+SYMBOL_EXPORT_SC_(KeywordPkg, epoll);
+
+static EventLoop* event_loop(core::Pointer_sp pointer) {
+  EventLoop* loop = reinterpret_cast<EventLoop*>(pointer->ptr());
+  if (!loop) {
+    SIMPLE_ERROR(BF("The event loop %s has been closed") % _rep_(pointer));
+  }
+  return loop;
+}
+
+static void signal_wakeup(EventLoop* loop) {
+#ifdef _TARGET_OS_LINUX
+  if (!loop->_UsePoll) {
+    uint64_t one = 1;
+    write(loop->_WakeWrite, &one, sizeof(one));
+    return;
+  }
+#endif
+  char byte = 0;
+  write(loop->_WakeWrite, &byte, 1);
+}
+
+/*! Empty the wakeup descriptor, return true if ll-event-loop-wakeup asked for it */
+static bool drain_wakeup(EventLoop* loop) {
+  char buffer[64];
+  while (read(loop->_WakeRead, buffer, sizeof(buffer)) > 0);
+  return loop->_WakeRequested.exchange(false);
+}
+
+CL_LAMBDA(&optional backend);
+CL_DOCSTRING("Create an event loop. BACKEND is :epoll, :poll or NIL for the best available one.");
+CL_DEFUN core::Pointer_sp serve_event_internal__ll_make_event_loop(core::T_sp backend) {
+  EventLoop* loop = new EventLoop();
+#ifdef _TARGET_OS_LINUX
+  if (backend != kw::_sym_poll) {
+    loop->_EpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->_EpollFd < 0) {
+      int err = errno;
+      delete loop;
+      SIMPLE_ERROR(BF("epoll_create1 failed: %s") % strerror(err));
+    }
+    loop->_UsePoll = false;
+    loop->_WakeRead = loop->_WakeWrite = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop->_WakeRead >= 0) {
+      struct epoll_event ev;
+      ev.events = EPOLLIN;
+      ev.data.fd = loop->_WakeRead;
+      epoll_ctl(loop->_EpollFd, EPOLL_CTL_ADD, loop->_WakeRead, &ev);
+    }
+  }
+#else
+  if (backend == kw::_sym_epoll) {
+    delete loop;
+    SIMPLE_ERROR(BF("The epoll event loop backend is not available on this platform"));
+  }
+#endif
+  if (loop->_UsePoll) {
+    int fds[2];
+    if (pipe(fds) == 0) {
+      for (int i = 0; i < 2; ++i) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+      }
+      loop->_WakeRead = fds[0];
+      loop->_WakeWrite = fds[1];
+    }
+  }
+  if (loop->_WakeRead < 0) {
+    int err = errno;
+    if (loop->_EpollFd >= 0) close(loop->_EpollFd);
+    delete loop;
+    SIMPLE_ERROR(BF("Could not create the wakeup descriptor for an event loop: %s") % strerror(err));
+  }
+  return core::Pointer_O::create(loop);
+}
+
+CL_DOCSTRING("Close the event loop and release its descriptors.  Registered descriptors are not closed.");
+CL_DEFUN void serve_event_internal__ll_event_loop_close(core::Pointer_sp pointer) {
+  EventLoop* loop = reinterpret_cast<EventLoop*>(pointer->ptr());
+  if (!loop) return;
+  pointer->set_ptr(NULL);
+  if (loop->_EpollFd >= 0) close(loop->_EpollFd);
+  if (loop->_WakeWrite != loop->_WakeRead) close(loop->_WakeWrite);
+  close(loop->_WakeRead);
+  delete loop;
+}
+
+CL_DOCSTRING("Return :epoll or :poll");
+CL_DEFUN core::Symbol_sp serve_event_internal__ll_event_loop_backend(core::Pointer_sp pointer) {
+  return event_loop(pointer)->_UsePoll ? kw::_sym_poll : kw::_sym_epoll;
+}
+
+CL_DOCSTRING(R"doc(Set the events (a logior of +ev-input+ and +ev-output+) that the loop waits
+for on FD.  Zero removes FD from the loop.  Registrations persist across waits.)doc");
+CL_DEFUN void serve_event_internal__ll_event_loop_modify(core::Pointer_sp pointer, int fd, int events) {
+  EventLoop* loop = event_loop(pointer);
+  std::lock_guard<std::mutex> guard(loop->_Mutex);
+  auto found = loop->_Interest.find(fd);
+  int old_events = (found == loop->_Interest.end()) ? 0 : found->second;
+  if (old_events == events) return;
+  bool rewait = loop->_UsePoll;
+#ifdef _TARGET_OS_LINUX
+  if (!loop->_UsePoll) {
+    struct epoll_event ev;
+    ev.events = ((events & EVENT_INPUT) ? EPOLLIN : 0) | ((events & EVENT_OUTPUT) ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+    int op = (events == 0) ? EPOLL_CTL_DEL : (old_events == 0) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    if (loop->_AlwaysReady.count(fd)) {
+      // Never made it into the epoll set
+      if (events == 0) loop->_AlwaysReady.erase(fd);
+      else loop->_AlwaysReady[fd] = events;
+      rewait = true;
+    } else if (epoll_ctl(loop->_EpollFd, op, fd, &ev) < 0) {
+      if (op == EPOLL_CTL_ADD && errno == EPERM) {
+        // Regular files can't be polled - like select we report them as always ready
+        loop->_AlwaysReady[fd] = events;
+        rewait = true;
+      } else if (op == EPOLL_CTL_DEL && (errno == EBADF || errno == ENOENT)) {
+        // A descriptor that was closed behind our back has already left the epoll set
+      } else {
+        SIMPLE_ERROR(BF("epoll_ctl on descriptor %d failed: %s") % fd % strerror(errno));
+      }
+    }
+  }
+#endif
+  if (events == 0)
+    loop->_Interest.erase(fd);
+  else
+    loop->_Interest[fd] = events;
+  loop->_PollDirty = true;
+  // A thread blocked in the wait has the old interest set, make it pick up the new one
+  if (rewait) signal_wakeup(loop);
+}
+
+/*! What is left of TIMEOUT_MS (-1 is forever) when a wait is restarted */
+static int remaining_timeout(std::chrono::steady_clock::time_point deadline, int timeout_ms) {
+  if (timeout_ms <= 0) return timeout_ms;
+  auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+  return (remaining > 0) ? (int)remaining : 0;
+}
+
+CL_LAMBDA(loop seconds);
+CL_DOCSTRING(R"doc(Wait up to SECONDS (NIL means forever) for registered descriptors to become ready.
+Return (values count errno) like select, the ready descriptors are read with
+ll-event-loop-ready-fd and ll-event-loop-ready-events.  A wakeup from another
+thread returns a count of zero.)doc");
+CL_DEFUN core::Integer_mv serve_event_internal__ll_event_loop_wait(core::Pointer_sp pointer, core::T_sp seconds) {
+  EventLoop* loop = event_loop(pointer);
+  int timeout_ms = -1;
+  if (seconds.notnilp()) {
+    double secs = clasp_to_double(gc::As<core::Number_sp>(seconds));
+    if (secs < 0.0) {
+      SIMPLE_ERROR(BF("Illegal timeout %lf seconds") % secs);
+    }
+    timeout_ms = (secs > 2.0e6) ? 2000000000 : (int)ceil(secs * 1000.0);
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms < 0 ? 0 : timeout_ms);
+  gc::Fixnum result;
+  int saved_errno = 0;
+ again:
+  loop->_Ready.clear();
+#ifdef _TARGET_OS_LINUX
+  if (!loop->_UsePoll) {
+    struct epoll_event events[EVENT_LOOP_MAX_READY];
+    bool woken = false;
+    bool requested = false;
+    {
+      std::lock_guard<std::mutex> guard(loop->_Mutex);
+      for (auto& entry : loop->_AlwaysReady) loop->_Ready.emplace_back(entry.first, entry.second);
+    }
+    if (loop->_Ready.size()) timeout_ms = 0;
+    result = epoll_wait(loop->_EpollFd, events, EVENT_LOOP_MAX_READY, timeout_ms);
+    saved_errno = errno;
+    for (gc::Fixnum i = 0; i < result; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == loop->_WakeRead) {
+        woken = true;
+        requested = drain_wakeup(loop);
+        continue;
+      }
+      // Errors and hangups wake both directions, select reports them as readable and writable
+      int ready = 0;
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) ready |= EVENT_INPUT;
+      if (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) ready |= EVENT_OUTPUT;
+      loop->_Ready.emplace_back(fd, ready);
+    }
+    if (result >= 0) result = loop->_Ready.size();
+    if (result == 0 && woken && !requested) {
+      timeout_ms = remaining_timeout(deadline, timeout_ms);
+      goto again;
+    }
+    return Values(Integer_O::create(result), Integer_O::create((gc::Fixnum)saved_errno));
+  }
+#endif
+  {
+    std::lock_guard<std::mutex> guard(loop->_Mutex);
+    if (loop->_PollDirty) {
+      loop->_PollFds.clear();
+      struct pollfd wake;
+      wake.fd = loop->_WakeRead;
+      wake.events = POLLIN;
+      wake.revents = 0;
+      loop->_PollFds.push_back(wake);
+      for (auto& entry : loop->_Interest) {
+        struct pollfd pfd;
+        pfd.fd = entry.first;
+        pfd.events = ((entry.second & EVENT_INPUT) ? POLLIN : 0) | ((entry.second & EVENT_OUTPUT) ? POLLOUT : 0);
+        pfd.revents = 0;
+        loop->_PollFds.push_back(pfd);
+      }
+      loop->_PollDirty = false;
+    }
+  }
+  result = poll(loop->_PollFds.data(), loop->_PollFds.size(), timeout_ms);
+  saved_errno = errno;
+  if (result > 0) {
+    bool woken = loop->_PollFds[0].revents != 0;
+    bool requested = woken && drain_wakeup(loop);
+    for (size_t i = 1; i < loop->_PollFds.size(); ++i) {
+      short revents = loop->_PollFds[i].revents;
+      if (!revents) continue;
+      int ready = 0;
+      if (revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL)) ready |= EVENT_INPUT;
+      if (revents & (POLLOUT | POLLHUP | POLLERR | POLLNVAL)) ready |= EVENT_OUTPUT;
+      loop->_Ready.emplace_back(loop->_PollFds[i].fd, ready);
+    }
+    result = loop->_Ready.size();
+    if (result == 0 && woken && !requested) {
+      // Only ll-event-loop-modify woke us - wait again on the rebuilt vector
+      timeout_ms = remaining_timeout(deadline, timeout_ms);
+      goto again;
+    }
+  }
+  return Values(Integer_O::create(result), Integer_O::create((gc::Fixnum)saved_errno));
+}
+
+CL_DEFUN int serve_event_internal__ll_event_loop_ready_fd(core::Pointer_sp pointer, size_t index) {
+  EventLoop* loop = event_loop(pointer);
+  if (index >= loop->_Ready.size()) {
+    SIMPLE_ERROR(BF("Ready index %lu is out of range - there are %lu ready descriptors") % index % loop->_Ready.size());
+  }
+  return loop->_Ready[index].first;
+}
+
+CL_DEFUN int serve_event_internal__ll_event_loop_ready_events(core::Pointer_sp pointer, size_t index) {
+  EventLoop* loop = event_loop(pointer);
+  if (index >= loop->_Ready.size()) {
+    SIMPLE_ERROR(BF("Ready index %lu is out of range - there are %lu ready descriptors") % index % loop->_Ready.size());
+  }
+  return loop->_Ready[index].second;
+}
+
+CL_DOCSTRING("Make a thread blocked in ll-event-loop-wait on LOOP return.  Safe to call from any thread.");
+CL_DEFUN void serve_event_internal__ll_event_loop_wakeup(core::Pointer_sp pointer) {
+  EventLoop* loop = event_loop(pointer);
+  loop->_WakeRequested.store(true);
+  signal_wakeup(loop);
+}
+
 void initialize_serveEvent_globals() {
   SYMBOL_EXPORT_SC_(ServeEventPkg, _PLUS_EINTR_PLUS_);
   _sym__PLUS_EINTR_PLUS_->defconstant(Integer_O::create((gc::Fixnum)EINTR));
+  SYMBOL_EXPORT_SC_(ServeEventPkg, _PLUS_ev_input_PLUS_);
+  _sym__PLUS_ev_input_PLUS_->defconstant(Integer_O::create((gc::Fixnum)EVENT_INPUT));
+  SYMBOL_EXPORT_SC_(ServeEventPkg, _PLUS_ev_output_PLUS_);
+  _sym__PLUS_ev_output_PLUS_->defconstant(Integer_O::create((gc::Fixnum)EVENT_OUTPUT));
 };
 
 
@@ -82,5 +393,13 @@ void initialize_serveEvent_globals() {
   SYMBOL_EXPORT_SC_(ServeEventPkg, ll_fdset_size);
   SYMBOL_EXPORT_SC_(ServeEventPkg, ll_serveEventNoTimeout);
   SYMBOL_EXPORT_SC_(ServeEventPkg, ll_serveEventWithTimeout);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_make_event_loop);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_event_loop_close);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_event_loop_backend);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_event_loop_modify);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_event_loop_wait);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_event_loop_ready_fd);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_event_loop_ready_events);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_event_loop_wakeup);
 
 };
@@ -36,6 +36,11 @@ THE SOFTWARE.
 #include <netinet/tcp.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <math.h>
+#include <limits.h>
+#include <vector>
 #ifndef MSG_CONFIRM
 #define MSG_CONFIRM 0
 #endif
@@ -48,9 +53,13 @@ THE SOFTWARE.
 #ifndef MSG_EOR
 #define MSG_EOR 0
 #endif
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
 #include <clasp/core/foundation.h>
 #include <clasp/core/object.h>
 #include <clasp/core/array.h>
+#include <clasp/core/ql.h>
 #include <clasp/core/symbolTable.h>
 #include <clasp/core/lispStream.h>
 #include <clasp/core/evaluator.h>
@@ -72,6 +81,12 @@ safe_buffer_pointer(core::T_sp x, uint size) {
       } else if (core::SimpleBaseString_sp strb = x.asOrNull<core::SimpleBaseString_O>()) {
     ok = (size <= strb->arrayTotalSize());
     address = (void*)&(*strb)[0]; // str->addressOfBuffer();
+  } else if (core::SimpleVector_byte8_t_sp bytes = x.asOrNull<core::SimpleVector_byte8_t_O>()) {
+    ok = (size <= bytes->length());
+    address = (void*)&(*bytes)[0];
+  } else if (core::SimpleVector_int8_t_sp sbytes = x.asOrNull<core::SimpleVector_int8_t_O>()) {
+    ok = (size <= sbytes->length());
+    address = (void*)&(*sbytes)[0];
   } else if (core::ComplexVector_T_sp vec = x.asOrNull<core::ComplexVector_T_O>()) {
     int divisor = vec->elementSizeInBytes();
     size = (size + divisor - 1) / divisor;
@@ -86,6 +101,54 @@ safe_buffer_pointer(core::T_sp x, uint size) {
   return address;
 }
 
+/*! Return the address of the octets [start,end) of an octet vector.
+    Displaced and fill pointer vectors are resolved to the simple vector
+    underneath so the kernel reads and writes the storage in place. */
+static unsigned char *
+octet_buffer_range(core::T_sp x, core::T_sp tstart, core::T_sp tend, size_t &count) {
+  if (!gc::IsA<core::Array_sp>(x) || gc::As_unsafe<core::Array_sp>(x)->rank() != 1) {
+    SIMPLE_ERROR(BF("Socket buffer must be a vector of (unsigned-byte 8) - got %s") % _rep_(x));
+  }
+  core::AbstractSimpleVector_sp asv;
+  size_t vstart, vend;
+  gc::As_unsafe<core::Array_sp>(x)->asAbstractSimpleVectorRange(asv, vstart, vend);
+  if (!gc::IsA<core::SimpleVector_byte8_t_sp>(asv) &&
+      !gc::IsA<core::SimpleVector_int8_t_sp>(asv) &&
+      !gc::IsA<core::SimpleBaseString_sp>(asv)) {
+    SIMPLE_ERROR(BF("Socket buffer must be a vector of (unsigned-byte 8) - got %s") % _rep_(x));
+  }
+  size_t length = vend - vstart;
+  size_t start = tstart.nilp() ? 0 : core::clasp_to_size(tstart);
+  size_t end = tend.nilp() ? length : core::clasp_to_size(tend);
+  if (end > length || start > end) {
+    SIMPLE_ERROR(BF("Illegal socket buffer bounds start %d end %d for buffer of length %d") % start % end % length);
+  }
+  count = end - start;
+  return (unsigned char*)asv->rowMajorAddressOfElement_(vstart + start);
+}
+
+/*! Fill iov from a list of buffer specifiers - each element is either
+    an octet vector or a list (vector start end). */
+static void fill_iovecs(core::List_sp buffers, std::vector<struct iovec> &iov) {
+  for (auto cur : buffers) {
+    core::T_sp spec = core::oCar(cur);
+    core::T_sp buffer = spec;
+    core::T_sp start = _Nil<core::T_O>();
+    core::T_sp end = _Nil<core::T_O>();
+    if (spec.consp()) {
+      buffer = core::oCar(spec);
+      start = core::oCadr(spec);
+      end = core::oCaddr(spec);
+    }
+    struct iovec one;
+    one.iov_base = octet_buffer_range(buffer, start, end, one.iov_len);
+    iov.push_back(one);
+  }
+  if (iov.size() > IOV_MAX) {
+    SIMPLE_ERROR(BF("Too many socket buffers %d - the limit is %d") % iov.size() % IOV_MAX);
+  }
+}
+
 static void fill_inet_sockaddr(struct sockaddr_in *sockaddr, int port,
                                int a1, int a2, int a3, int a4) {
   bzero(sockaddr, sizeof(struct sockaddr_in));
@@ -307,6 +370,57 @@ CL_DEFUN core::T_mv sockets_internal__ll_socketAccept_inetSocket(int sfd) {
   return Values(core::Integer_O::create((gc::Fixnum)return0), return1, core::Integer_O::create((gc::Fixnum)return2));
 }
 
+CL_LAMBDA(sfd);
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Accept a connection on the listening descriptor sfd and put the new
+descriptor in non-blocking, close-on-exec mode.  Return (values fd errno) -
+fd is -1 with errno EAGAIN when no connection is pending.)doc");
+CL_DEFUN core::T_mv sockets_internal__ll_socketAcceptNonBlocking(int sfd) {
+  int new_fd;
+  clasp_disable_interrupts();
+#ifdef _TARGET_OS_LINUX
+  new_fd = accept4(sfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+  new_fd = accept(sfd, NULL, NULL);
+  if (new_fd >= 0) {
+    fcntl(new_fd, F_SETFL, fcntl(new_fd, F_GETFL) | O_NONBLOCK);
+    fcntl(new_fd, F_SETFD, FD_CLOEXEC);
+  }
+#endif
+  int err = errno;
+  clasp_enable_interrupts();
+  return Values(core::make_fixnum(new_fd),core::make_fixnum(err));
+}
+
+CL_LAMBDA(fd events seconds);
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Wait up to seconds (NIL means forever) for fd to become ready.
+events is a logior of 1 (input) and 2 (output).  Return (values ready errno)
+where ready is the logior of the ready directions, zero on timeout and -1
+on failure.)doc");
+CL_DEFUN core::T_mv sockets_internal__ll_socketPoll(int fd, int events, core::T_sp seconds) {
+  int timeout_ms = -1;
+  if (seconds.notnilp()) {
+    double secs = core::clasp_to_double(gc::As<core::Number_sp>(seconds));
+    timeout_ms = (secs <= 0.0) ? 0 : (secs > 2.0e6) ? 2000000000 : (int)ceil(secs * 1000.0);
+  }
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = ((events & 1) ? POLLIN : 0) | ((events & 2) ? POLLOUT : 0);
+  pfd.revents = 0;
+  clasp_disable_interrupts();
+  int result = poll(&pfd, 1, timeout_ms);
+  int err = errno;
+  clasp_enable_interrupts();
+  if (result > 0) {
+    // Like select, errors and hangups make both directions ready
+    result = 0;
+    if (pfd.revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL)) result |= (events & 1);
+    if (pfd.revents & (POLLOUT | POLLHUP | POLLERR | POLLNVAL)) result |= (events & 2);
+  }
+  return Values(core::make_fixnum(result),core::make_fixnum(err));
+}
+
 CL_LAMBDA(port ip0 ip1 ip2 ip3 socket-file-descriptor);
 CL_DECLARE();
 CL_DOCSTRING("ll_socketConnect_inetSocket");
@@ -469,6 +583,190 @@ CL_DEFUN core::Integer_sp sockets_internal__ll_socketSendNoAddress(int fb,
   return core::Integer_O::create((gc::Fixnum)(len));
 }
 
+CL_LAMBDA(fd buffer start end oob peek waitall dontwait);
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Receive directly into the octets [start,end) of buffer.
+Return (values length errno).)doc");
+CL_DEFUN core::T_mv sockets_internal__ll_socketReceiveInto(int fd,
+                                                           core::T_sp buffer,
+                                                           core::T_sp start,
+                                                           core::T_sp end,
+                                                           bool oob,
+                                                           bool peek,
+                                                           bool waitall,
+                                                           bool dontwait)
+{
+  size_t count;
+  unsigned char *address = octet_buffer_range(buffer, start, end, count);
+  int flags = (oob ? MSG_OOB : 0) |
+              (peek ? MSG_PEEK : 0) |
+              (waitall ? MSG_WAITALL : 0) |
+              (dontwait ? MSG_DONTWAIT : 0);
+  ssize_t len;
+  clasp_disable_interrupts();
+  len = recv(fd, address, count, flags);
+  int err = errno;
+  clasp_enable_interrupts();
+  return Values(core::make_fixnum(len),core::make_fixnum(err));
+}
+
+CL_LAMBDA(fd buffer start end oob eor dontroute dontwait nosignal confirm);
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Send the octets [start,end) of buffer without copying them.
+Return (values length errno).)doc");
+CL_DEFUN core::T_mv sockets_internal__ll_socketSendFrom(int fd,
+                                                        core::T_sp buffer,
+                                                        core::T_sp start,
+                                                        core::T_sp end,
+                                                        bool oob,
+                                                        bool eor,
+                                                        bool dontroute,
+                                                        bool dontwait,
+                                                        bool nosignal,
+                                                        bool confirm)
+{
+  size_t count;
+  unsigned char *address = octet_buffer_range(buffer, start, end, count);
+  int flags = (oob ? MSG_OOB : 0) |
+              (eor ? MSG_EOR : 0) |
+              (dontroute ? MSG_DONTROUTE : 0) |
+              (dontwait ? MSG_DONTWAIT : 0) |
+              (nosignal ? MSG_NOSIGNAL : 0) |
+              (confirm ? MSG_CONFIRM : 0);
+  ssize_t len;
+  clasp_disable_interrupts();
+#if (MSG_NOSIGNAL == 0) && defined(SO_NOSIGPIPE)
+  {
+    int sockopt = nosignal;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE,
+               REINTERPRET_CAST(char *, &sockopt),
+               sizeof(int));
+  }
+#endif
+  len = send(fd, address, count, flags);
+  int err = errno;
+  clasp_enable_interrupts();
+  return Values(core::make_fixnum(len),core::make_fixnum(err));
+}
+
+CL_LAMBDA(fd buffers);
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Scatter one read(2) across a list of octet buffers with readv(2).
+Each element of buffers is a vector or a list (vector start end).
+Return (values total-length errno).)doc");
+CL_DEFUN core::T_mv sockets_internal__ll_socketReadv(int fd, core::List_sp buffers)
+{
+  std::vector<struct iovec> iov;
+  fill_iovecs(buffers, iov);
+  ssize_t len;
+  clasp_disable_interrupts();
+  len = readv(fd, iov.data(), iov.size());
+  int err = errno;
+  clasp_enable_interrupts();
+  return Values(core::make_fixnum(len),core::make_fixnum(err));
+}
+
+CL_LAMBDA(fd buffers);
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Gather a list of octet buffers into one write(2) with writev(2).
+Each element of buffers is a vector or a list (vector start end).
+Return (values total-length errno).)doc");
+CL_DEFUN core::T_mv sockets_internal__ll_socketWritev(int fd, core::List_sp buffers)
+{
+  std::vector<struct iovec> iov;
+  fill_iovecs(buffers, iov);
+  ssize_t len;
+  clasp_disable_interrupts();
+  len = writev(fd, iov.data(), iov.size());
+  int err = errno;
+  clasp_enable_interrupts();
+  return Values(core::make_fixnum(len),core::make_fixnum(err));
+}
+
+CL_LAMBDA(fd buffers dontwait);
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Receive up to one datagram into each of buffers with recvmmsg(2).
+Unless dontwait is true, block only until the first message arrives.
+Return (values list-of-message-lengths errno) - the list is NIL on failure.)doc");
+CL_DEFUN core::T_mv sockets_internal__ll_socketRecvmmsg(int fd, core::List_sp buffers, bool dontwait)
+{
+  std::vector<struct iovec> iov;
+  fill_iovecs(buffers, iov);
+  std::vector<size_t> lengths;
+  int err = 0;
+  clasp_disable_interrupts();
+#ifdef _TARGET_OS_LINUX
+  std::vector<struct mmsghdr> msgs(iov.size());
+  for (size_t i = 0; i < iov.size(); ++i) {
+    memset(&msgs[i], 0, sizeof(struct mmsghdr));
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  int received = recvmmsg(fd, msgs.data(), msgs.size(), dontwait ? MSG_DONTWAIT : MSG_WAITFORONE, NULL);
+  err = errno;
+  for (int i = 0; i < received; ++i) lengths.push_back(msgs[i].msg_len);
+#else
+  // No recvmmsg - block for the first message, then drain without waiting
+  for (size_t i = 0; i < iov.size(); ++i) {
+    int flags = (dontwait || i > 0) ? MSG_DONTWAIT : 0;
+    ssize_t len = recv(fd, iov[i].iov_base, iov[i].iov_len, flags);
+    if (len < 0) {
+      err = errno;
+      break;
+    }
+    lengths.push_back(len);
+  }
+#endif
+  clasp_enable_interrupts();
+  ql::list result;
+  for (auto len : lengths) result << core::make_fixnum(len);
+  return Values(result.cons(),core::make_fixnum(lengths.empty() ? err : 0));
+}
+
+CL_LAMBDA(fd buffers dontwait nosignal);
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Send each of buffers as a separate message with sendmmsg(2).
+Return (values messages-sent errno).)doc");
+CL_DEFUN core::T_mv sockets_internal__ll_socketSendmmsg(int fd, core::List_sp buffers, bool dontwait, bool nosignal)
+{
+  std::vector<struct iovec> iov;
+  fill_iovecs(buffers, iov);
+  int flags = (dontwait ? MSG_DONTWAIT : 0) |
+              (nosignal ? MSG_NOSIGNAL : 0);
+  int sent = 0;
+  int err = 0;
+  clasp_disable_interrupts();
+#ifdef _TARGET_OS_LINUX
+  std::vector<struct mmsghdr> msgs(iov.size());
+  for (size_t i = 0; i < iov.size(); ++i) {
+    memset(&msgs[i], 0, sizeof(struct mmsghdr));
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  sent = sendmmsg(fd, msgs.data(), msgs.size(), flags);
+  err = errno;
+#else
+#if (MSG_NOSIGNAL == 0) && defined(SO_NOSIGPIPE)
+  {
+    int sockopt = nosignal;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE,
+               REINTERPRET_CAST(char *, &sockopt),
+               sizeof(int));
+  }
+#endif
+  for (size_t i = 0; i < iov.size(); ++i) {
+    if (send(fd, iov[i].iov_base, iov[i].iov_len, flags) < 0) {
+      err = errno;
+      if (sent == 0) sent = -1;
+      break;
+    }
+    ++sent;
+  }
+#endif
+  clasp_enable_interrupts();
+  return Values(core::make_fixnum(sent),core::make_fixnum(err));
+}
+
 CL_LAMBDA(fd name family);
 CL_DECLARE();
 CL_DOCSTRING("ll_socketBind_localSocket");
@@ -833,6 +1131,8 @@ void initialize_sockets_globals() {
   _sym__PLUS_EAGAIN_PLUS_->defconstant(core::Integer_O::create((gc::Fixnum)EAGAIN));
   SYMBOL_EXPORT_SC_(SocketsPkg, _PLUS_EBADF_PLUS_);
   _sym__PLUS_EBADF_PLUS_->defconstant(core::Integer_O::create((gc::Fixnum)EBADF));
+  SYMBOL_EXPORT_SC_(SocketsPkg, _PLUS_ECONNABORTED_PLUS_);
+  _sym__PLUS_ECONNABORTED_PLUS_->defconstant(core::Integer_O::create((gc::Fixnum)ECONNABORTED));
   SYMBOL_EXPORT_SC_(SocketsPkg, _PLUS_ECONNREFUSED_PLUS_);
   _sym__PLUS_ECONNREFUSED_PLUS_->defconstant(core::Integer_O::create((gc::Fixnum)ECONNREFUSED));
   SYMBOL_EXPORT_SC_(SocketsPkg, _PLUS_ETIMEDOUT_PLUS_);
@@ -890,7 +1190,7 @@ void initialize_sockets_globals() {
   _sym__PLUS_SO_DONTROUTE_PLUS_->defconstant(core::Integer_O::create((gc::Fixnum)SO_DONTROUTE));
   SYMBOL_EXPORT_SC_(SocketsPkg, _PLUS_SO_LINGER_PLUS_);
   _sym__PLUS_SO_LINGER_PLUS_->defconstant(core::Integer_O::create((gc::Fixnum)SO_LINGER));
-#ifndef _TARGET_OS_LINUX
+#ifdef SO_REUSEPORT
   SYMBOL_EXPORT_SC_(SocketsPkg, _PLUS_SO_REUSEPORT_PLUS_);
   _sym__PLUS_SO_REUSEPORT_PLUS_->defconstant(core::Integer_O::create((gc::Fixnum)SO_REUSEPORT));
 #endif
@@ -910,11 +1210,19 @@ void initialize_sockets_globals() {
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_getProtocolByName);
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketBind_inetSocket);
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketAccept_inetSocket);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketAcceptNonBlocking);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketPoll);
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketConnect_inetSocket);
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketPeername_inetSocket);
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketName);
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketSendAddress);
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketSendNoAddress);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketReceiveInto);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketSendFrom);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketReadv);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketWritev);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketRecvmmsg);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketSendmmsg);
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketBind_localSocket);
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketAccept_localSocket);
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketConnect_localSocket);
@@ -26,6 +26,7 @@ SRC_CORE_FILES = \
         'random',
         'record',
         'debugger',
+        'sampleProfiler',
         'debug_unixes',
         'debug_macosx',
         'smallMap',
@@ -71,6 +72,7 @@ SRC_CORE_FILES = \
 #        'sexpSaveArchive',
         'readtable',
         'float_to_digits',
+        'string_to_float',
         'pathname',
         'commandLineOptions',
         'exceptions',
@@ -155,6 +157,7 @@ def collect_clasp_c_source_files(bld):
                  'gcalloc',
                  'gcweak',
                  'memoryManagement',
+                 'allocationProfiler',
                  'mygc.c']) + \
              collect_c_source_files(bld, 'src/clbind/', [
                  'adapter',
@@ -187,7 +190,8 @@ def collect_clasp_c_source_files(bld):
                  'llvmoPackage',
                  'clbindLlvmExpose']) + \
              collect_c_source_files(bld, 'src/mpip/', [
-                 'claspMpi'
+                 'claspMpi',
+                 'binarySerializer'
              ]) + \
              collect_c_source_files(bld, 'src/asttooling/', [
                  'astVisitor',
@@ -354,6 +358,7 @@ def collect_bclasp_lisp_files(**kwargs):
         "src/lisp/kernel/lsp/fli",
         "src/lisp/kernel/lsp/posix",
         "src/lisp/modules/sockets/sockets",
+        "src/lisp/modules/sockets/server",
         "src/lisp/kernel/lsp/top",
         "src/lisp/kernel/tag/pre-epilogue-bclasp",
         "src/lisp/kernel/lsp/epilogue-bclasp",
@@ -364,6 +369,7 @@ def collect_bclasp_lisp_files(**kwargs):
 def collect_cclasp_lisp_files(**kwargs):
     return collect_bclasp_lisp_files(**kwargs) + cleavir_file_list + [
         "src/lisp/kernel/lsp/queue",
+        "src/lisp/kernel/lsp/thread-pool",
         "src/lisp/kernel/cmp/compile-file-parallel",
         "src/lisp/kernel/lsp/generated-encodings",
         "src/lisp/kernel/lsp/encodings",